@@ -0,0 +1,283 @@
+#include "LuaAllocationProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace lpp
+{
+	namespace
+	{
+		constexpr const char kOutsideLua[] = "[C++]";
+	}
+
+	LuaAllocationProfiler::LuaAllocationProfiler(LuaState* pState, size_t sampleBytes)
+		: m_pState(pState)
+		, m_sampleBytes(std::max<size_t>(1, sampleBytes))
+		, m_baseAlloc(nullptr)
+		, m_pBaseAllocData(nullptr)
+		, m_countdown(static_cast<int64_t>(m_sampleBytes))
+		, m_sampleCount(0)
+	{
+		lua_State* L = pState->GetState();
+
+		m_baseAlloc = lua_getallocf(L, &m_pBaseAllocData);
+		lua_setallocf(L, &LuaAllocationProfiler::Allocate, this);
+		pState->SetAllocationProfiler(this);
+	}
+
+	LuaAllocationProfiler::~LuaAllocationProfiler()
+	{
+		m_pState->SetAllocationProfiler(nullptr);
+
+		// A wrapper the state does not know still calls into the profiler, Carrying on would use it after it is destroyed.
+		if (!m_pState->RemoveAllocator(&LuaAllocationProfiler::Allocate, this, m_baseAlloc, m_pBaseAllocData))
+		{
+			std::fprintf(stderr, "LuaAllocationProfiler destroyed under an allocator installed after it, Remove that allocator first.\n");
+			std::abort();
+		}
+	}
+
+	bool LuaAllocationProfiler::ReplaceBaseAllocator(lua_Alloc alloc, void* pUserData, lua_Alloc baseAlloc, void* pBaseAllocData)
+	{
+		if (m_baseAlloc != alloc || m_pBaseAllocData != pUserData)
+			return false;
+
+		m_baseAlloc = baseAlloc;
+		m_pBaseAllocData = pBaseAllocData;
+		return true;
+	}
+
+	void LuaAllocationProfiler::Reset()
+	{
+		m_sites.clear();
+		m_siteIndices.clear();
+		m_blocks.clear();
+		m_pending.clear();
+		m_sampleCount = 0;
+		m_countdown = static_cast<int64_t>(m_sampleBytes);
+	}
+
+	void* LuaAllocationProfiler::Allocate(void* pUserData, void* pBlock, size_t oldSize, size_t newSize)
+	{
+		LuaAllocationProfiler* pProfiler = static_cast<LuaAllocationProfiler*>(pUserData);
+
+		void* pNewBlock = pProfiler->m_baseAlloc(pProfiler->m_pBaseAllocData, pBlock, oldSize, newSize);
+		if (!pNewBlock && newSize > 0)
+			return nullptr;
+
+		// When allocating, oldSize holds the type of the object instead of a size.
+		const size_t oldBytes = pBlock ? oldSize : 0;
+
+		if (pBlock && !pProfiler->m_blocks.empty())
+		{
+			auto it = pProfiler->m_blocks.find(pBlock);
+			if (it != pProfiler->m_blocks.end())
+			{
+				if (newSize == 0)
+				{
+					pProfiler->Forget(pBlock);
+				}
+				else if (pNewBlock != pBlock)
+				{
+					// The block moved, Its sample moves with it.
+					Block block = it->second;
+					pProfiler->m_blocks.erase(it);
+					pProfiler->m_blocks[pNewBlock] = block;
+
+					if (block.site < 0)
+						pProfiler->m_pending[block.pendingIndex].pBlock = pNewBlock;
+				}
+			}
+		}
+
+		if (newSize <= oldBytes)
+			return pNewBlock;
+
+		pProfiler->m_countdown -= static_cast<int64_t>(newSize - oldBytes);
+		if (pProfiler->m_countdown > 0)
+			return pNewBlock;
+
+		// Every sample interval crossed adds its bytes to the sample.
+		const size_t crossings = static_cast<size_t>(-pProfiler->m_countdown) / pProfiler->m_sampleBytes + 1;
+		pProfiler->m_countdown += static_cast<int64_t>(crossings * pProfiler->m_sampleBytes);
+		pProfiler->Sample(pNewBlock, crossings * pProfiler->m_sampleBytes, pBlock == nullptr);
+
+		return pNewBlock;
+	}
+
+	void LuaAllocationProfiler::Sample(void* pBlock, size_t weight, bool isNewBlock)
+	{
+		++m_sampleCount;
+
+		auto [it, isNew] = m_blocks.try_emplace(pBlock, Block{ -1, 0, 0 });
+		Block& block = it->second;
+
+		// A grown block that was sampled before keeps its site, The growth is counted for that site.
+		if (!isNew && block.site >= 0)
+		{
+			LuaAllocationSite& site = m_sites[block.site];
+			site.allocatedBytes += weight;
+			++site.allocationCount;
+			site.liveBytes += weight;
+			block.weight += weight;
+			return;
+		}
+
+		if (!isNew)
+		{
+			m_pending[block.pendingIndex].weight += weight;
+			block.weight += weight;
+			return;
+		}
+
+		lua_State* T = m_pState->GetRunningThread();
+		block.weight = weight;
+
+		// lua_getstack only follows the call infos, It is safe at any allocation.
+		lua_Debug info;
+		const bool isRunning = lua_getstack(T, 0, &info) != 0;
+
+		// Only a grown block can be the stack being moved, Then the frames hold offsets and lua_getinfo can't be used.
+		if (isRunning && !isNewBlock)
+		{
+			block.pendingIndex = m_pending.size();
+			m_pending.push_back(Pending{ pBlock, weight });
+
+			lua_sethook(T, &LuaState::Hook, lua_gethookmask(T) | LUA_MASKCOUNT, 1);
+			return;
+		}
+
+		block.site = GetSite(isRunning ? GetLocation(T) : kOutsideLua);
+
+		LuaAllocationSite& site = m_sites[block.site];
+		site.allocatedBytes += weight;
+		++site.allocationCount;
+		site.liveBytes += weight;
+		++site.liveCount;
+	}
+
+	void LuaAllocationProfiler::Forget(void* pBlock)
+	{
+		auto it = m_blocks.find(pBlock);
+		if (it == m_blocks.end())
+			return;
+
+		// Pending samples are counted as allocated by the hook, It finds the block gone.
+		if (it->second.site >= 0)
+		{
+			LuaAllocationSite& site = m_sites[it->second.site];
+			site.liveBytes -= it->second.weight;
+			--site.liveCount;
+		}
+		else
+		{
+			m_pending[it->second.pendingIndex].pBlock = nullptr;
+		}
+
+		m_blocks.erase(it);
+	}
+
+	void LuaAllocationProfiler::ResolvePending(lua_State* pThread)
+	{
+		if (m_pending.empty())
+			return;
+
+		// Growing the vector of sites allocates with the C++ heap, Not the lua allocator.
+		const int siteIndex = GetSite(GetLocation(pThread));
+		LuaAllocationSite& site = m_sites[siteIndex];
+
+		for (const Pending& pending : m_pending)
+		{
+			site.allocatedBytes += pending.weight;
+			++site.allocationCount;
+
+			if (!pending.pBlock)
+				continue;
+
+			Block& block = m_blocks[pending.pBlock];
+			block.site = siteIndex;
+			site.liveBytes += block.weight;
+			++site.liveCount;
+		}
+
+		m_pending.clear();
+	}
+
+	std::string LuaAllocationProfiler::GetLocation(lua_State* pThread)
+	{
+		// The nearest Lua function, An allocating C function like string.rep is named by its caller.
+		lua_Debug info;
+		for (int level = 0; lua_getstack(pThread, level, &info); ++level)
+		{
+			lua_getinfo(pThread, "Sln", &info);
+			if (*info.what == 'C')
+				continue;
+
+			char location[LUA_IDSIZE + 96];
+			std::snprintf(location, sizeof(location), "%s:%d (%s)", info.short_src, info.currentline,
+				*info.what == 'm' ? "main chunk" : info.name ? info.name : "anonymous");
+			return location;
+		}
+
+		return kOutsideLua;
+	}
+
+	int LuaAllocationProfiler::GetSite(const std::string& location)
+	{
+		auto [it, isNew] = m_siteIndices.try_emplace(location, static_cast<int>(m_sites.size()));
+		if (isNew)
+		{
+			m_sites.emplace_back();
+			m_sites.back().location = location;
+		}
+
+		return it->second;
+	}
+
+	std::vector<LuaAllocationSite> LuaAllocationProfiler::GetSites() const
+	{
+		std::vector<LuaAllocationSite> sites = m_sites;
+		std::sort(sites.begin(), sites.end(), [](const LuaAllocationSite& left, const LuaAllocationSite& right)
+		{
+			return left.liveBytes != right.liveBytes ? left.liveBytes > right.liveBytes : left.allocatedBytes > right.allocatedBytes;
+		});
+
+		return sites;
+	}
+
+	std::string LuaAllocationProfiler::GetReport(size_t count) const
+	{
+		std::vector<LuaAllocationSite> sites = GetSites();
+		const size_t topCount = std::min(count, sites.size());
+
+		std::string report;
+		char line[512];
+
+		std::snprintf(line, sizeof(line), "%llu samples of %zu bytes\n%12s %8s %12s %8s  %s\n", static_cast<unsigned long long>(m_sampleCount),
+			m_sampleBytes, "live bytes", "live", "allocated", "count", "site");
+		report += line;
+
+		const auto writeSite = [&](const LuaAllocationSite& site)
+		{
+			std::snprintf(line, sizeof(line), "%12llu %8llu %12llu %8llu  %s\n", static_cast<unsigned long long>(site.liveBytes),
+				static_cast<unsigned long long>(site.liveCount), static_cast<unsigned long long>(site.allocatedBytes),
+				static_cast<unsigned long long>(site.allocationCount), site.location.c_str());
+			report += line;
+		};
+
+		for (size_t i = 0; i < topCount; ++i)
+			writeSite(sites[i]);
+
+		std::partial_sort(sites.begin(), sites.begin() + topCount, sites.end(), [](const LuaAllocationSite& left, const LuaAllocationSite& right)
+		{
+			return left.allocatedBytes > right.allocatedBytes;
+		});
+
+		report += "most allocated\n";
+		for (size_t i = 0; i < topCount; ++i)
+			writeSite(sites[i]);
+
+		return report;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <LuaState.h>
+
+namespace lpp
+{
+	/// Sampled allocations of a single call site, See LuaAllocationProfiler::GetSites().
+	struct LuaAllocationSite
+	{
+		std::string location;			///< "source:line (function)" of the Lua code, "[C++]" for allocations made outside of Lua code.
+		uint64_t allocatedBytes = 0;	///< Estimated bytes allocated by the site.
+		uint64_t allocationCount = 0;	///< Sampled allocations of the site, Every allocation when sampling every byte.
+		uint64_t liveBytes = 0;			///< Estimated bytes of the site not freed yet.
+		uint64_t liveCount = 0;			///< Sampled allocations of the site not freed yet.
+	};
+
+	/// \class LuaAllocationProfiler
+	/// \brief Allocator wrapper attributing the heap of a state to the Lua functions and lines allocating it.
+	///
+	/// Every `sampleBytes` allocated bytes one allocation is sampled and counts for `sampleBytes`, So the estimate is unbiased and
+	/// the cost stays bounded at any allocation rate. A sample is attributed to the nearest Lua function on the stack of the running
+	/// thread and its current line, Allocations of a C function like `string.rep` belong to the line calling it.
+	/// Sampled blocks are followed until they are freed, So GetSites() also tells which code holds on to the heap.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaAllocationProfiler profiler(&state, 64 * 1024);
+	/// RunFrames();
+	/// std::cout << profiler.GetReport(10);
+	/// ~~~~~
+	///
+	/// \devnote While lua grows a stack its frames hold offsets instead of pointers, So the stack can't be read when a block grows.
+	/// Grown blocks arm a one-shot count on the hook instead, It attributes them at the next safe point of the same function, Which may report
+	/// a later line such as the head of the enclosing loop. Like the memory limit it wraps the allocator of the state, Foreign wrappers installed afterwards must be removed before it is destroyed.
+	class LuaAllocationProfiler
+	{
+	public:
+		static constexpr size_t kDefaultSampleBytes = 64 * 1024;
+
+	private:
+		struct Block
+		{
+			int site;		///< -1 until the hook looked it up.
+			size_t weight;
+			size_t pendingIndex;
+		};
+
+		struct Pending
+		{
+			void* pBlock;
+			size_t weight;
+		};
+
+		LuaState* m_pState;
+		size_t m_sampleBytes;
+
+		lua_Alloc m_baseAlloc;
+		void* m_pBaseAllocData;
+
+		// Bytes left until the next sample.
+		int64_t m_countdown;
+
+		std::vector<LuaAllocationSite> m_sites;
+		std::unordered_map<std::string, int> m_siteIndices;
+
+		// Sampled blocks still allocated, And samples waiting for the hook.
+		std::unordered_map<void*, Block> m_blocks;
+		std::vector<Pending> m_pending;
+
+		uint64_t m_sampleCount;
+
+	public:
+		/// Wraps the allocator of the state.
+		/// \param sampleBytes Bytes between samples, 1 records every allocation.
+		explicit LuaAllocationProfiler(LuaState* pState, size_t sampleBytes = kDefaultSampleBytes);
+
+		/// Removes the wrapper through LuaState::RemoveAllocator(), So the memory limit may be set or removed in between.
+		/// Aborts if an allocator the state does not know was installed afterwards and is still in place.
+		~LuaAllocationProfiler();
+
+		LuaAllocationProfiler(const LuaAllocationProfiler&) = delete;
+		LuaAllocationProfiler& operator=(const LuaAllocationProfiler&) = delete;
+
+		size_t GetSampleBytes() const { return m_sampleBytes; }
+		uint64_t GetSampleCount() const { return m_sampleCount; }
+
+		/// Every site with samples, The most live bytes first.
+		std::vector<LuaAllocationSite> GetSites() const;
+
+		/// The sites holding the most live bytes as a table of text, Followed by the sites allocating the most.
+		std::string GetReport(size_t count = 20) const;
+
+		/// Drops the samples, Blocks sampled before are not followed anymore.
+		void Reset();
+
+		/// Whether grown blocks wait for the hook to look up their site.
+		bool HasPending() const { return !m_pending.empty(); }
+
+		/// Called by the hook of the state, Looks up the site for the samples taken since the last hook.
+		void ResolvePending(lua_State* pThread);
+
+		/// Forwards to another allocator when the one the profiler wraps is removed, See LuaState::RemoveAllocator().
+		/// \return False if the profiler does not wrap `alloc`.
+		bool ReplaceBaseAllocator(lua_Alloc alloc, void* pUserData, lua_Alloc baseAlloc, void* pBaseAllocData);
+
+	private:
+
+		/// Attributes the sample right away, Or through the hook for grown blocks.
+		void Sample(void* pBlock, size_t weight, bool isNewBlock);
+
+		/// Counts the block as freed if it was sampled.
+		void Forget(void* pBlock);
+
+		/// "source:line (function)" of the nearest Lua function on the stack.
+		static std::string GetLocation(lua_State* pThread);
+
+		int GetSite(const std::string& location);
+
+		static void* Allocate(void* pUserData, void* pBlock, size_t oldSize, size_t newSize);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "LuaArenaAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace lpp
+{
+
+#pragma region Initialization / Construction
+
+	LuaArenaAllocator::LuaArenaAllocator(size_t capacity, size_t chunkSize)
+		: m_pCursor(nullptr)
+		, m_pEnd(nullptr)
+		, m_pLastBlock(nullptr)
+		, m_pLargeBlocks(nullptr)
+		, m_chunkSize(Align(chunkSize > 0 ? chunkSize : kDefaultChunkSize))
+		, m_capacity(capacity)
+		, m_reservedBytes(0)
+		, m_usedBytes(0)
+		, m_failedCount(0)
+	{}
+
+	LuaArenaAllocator::~LuaArenaAllocator()
+	{
+		Reset();
+
+		for (const Chunk& chunk : m_chunks)
+			std::free(chunk.pData);
+	}
+
+	void LuaArenaAllocator::Reset()
+	{
+		while (m_pLargeBlocks)
+			FreeLarge(m_pLargeBlocks + 1);
+
+		// Keep the first chunk, The next state will need it right away.
+		for (size_t i = 1; i < m_chunks.size(); ++i)
+		{
+			std::free(m_chunks[i].pData);
+			m_reservedBytes -= m_chunks[i].size;
+		}
+
+		if (m_chunks.size() > 1)
+			m_chunks.resize(1);
+
+		m_pCursor = m_chunks.empty() ? nullptr : m_chunks[0].pData;
+		m_pEnd = m_chunks.empty() ? nullptr : m_chunks[0].pData + m_chunks[0].size;
+		m_pLastBlock = nullptr;
+		m_usedBytes = 0;
+	}
+
+#pragma endregion
+
+	void* LuaArenaAllocator::Allocate(void* pUserData, void* pBlock, size_t oldSize, size_t newSize)
+	{
+		LuaArenaAllocator* pArena = static_cast<LuaArenaAllocator*>(pUserData);
+
+		if (newSize == 0)
+		{
+			if (pBlock)
+				pArena->FreeBlock(pBlock, oldSize);
+
+			return nullptr;
+		}
+
+		// When allocating, oldSize holds the type of the object instead of a size.
+		if (!pBlock)
+			return pArena->AllocateBlock(newSize);
+
+		return pArena->ReallocateBlock(pBlock, oldSize, newSize);
+	}
+
+	void* LuaArenaAllocator::AllocateBlock(size_t size)
+	{
+		if (IsLarge(size))
+			return AllocateLarge(size);
+
+		const size_t alignedSize = Align(size);
+
+		if (static_cast<size_t>(m_pEnd - m_pCursor) < alignedSize)
+		{
+			// The rest of the current chunk is wasted, Blocks are small compared to a chunk.
+			size_t chunkSize = m_chunkSize;
+			if (m_capacity > 0)
+				chunkSize = std::max(alignedSize, std::min(chunkSize, m_capacity - std::min(m_capacity, m_reservedBytes)));
+
+			if (!Reserve(chunkSize))
+				return nullptr;
+
+			char* pData = static_cast<char*>(std::malloc(chunkSize));
+			if (!pData)
+			{
+				m_reservedBytes -= chunkSize;
+				return nullptr;
+			}
+
+			m_chunks.push_back({ pData, chunkSize });
+			m_pCursor = pData;
+			m_pEnd = pData + chunkSize;
+		}
+
+		void* pBlock = m_pCursor;
+		m_pCursor += alignedSize;
+		m_pLastBlock = static_cast<char*>(pBlock);
+		m_usedBytes += alignedSize;
+
+		return pBlock;
+	}
+
+	void LuaArenaAllocator::FreeBlock(void* pBlock, size_t size)
+	{
+		if (IsLarge(size))
+		{
+			FreeLarge(pBlock);
+			return;
+		}
+
+		// Anything but the last block stays until Reset().
+		if (IsLastBlock(pBlock))
+		{
+			m_pCursor = m_pLastBlock;
+			m_pLastBlock = nullptr;
+			m_usedBytes -= Align(size);
+		}
+	}
+
+	void* LuaArenaAllocator::ReallocateBlock(void* pBlock, size_t oldSize, size_t newSize)
+	{
+		const bool isOldLarge = IsLarge(oldSize);
+		const bool isNewLarge = IsLarge(newSize);
+
+		if (isOldLarge && isNewLarge)
+		{
+			LargeBlock* pHeader = static_cast<LargeBlock*>(pBlock) - 1;
+
+			if (newSize > oldSize && !Reserve(newSize - oldSize))
+				return nullptr;
+
+			LargeBlock* pNewHeader = static_cast<LargeBlock*>(std::realloc(pHeader, sizeof(LargeBlock) + newSize));
+			if (!pNewHeader)
+			{
+				if (newSize > oldSize)
+					m_reservedBytes -= newSize - oldSize;
+
+				return nullptr;
+			}
+
+			if (newSize < oldSize)
+				m_reservedBytes -= oldSize - newSize;
+
+			m_usedBytes = m_usedBytes - oldSize + newSize;
+			pNewHeader->size = newSize;
+
+			// The block may have moved, Relink its neighbours.
+			if (pNewHeader->pPrev)
+				pNewHeader->pPrev->pNext = pNewHeader;
+			else
+				m_pLargeBlocks = pNewHeader;
+
+			if (pNewHeader->pNext)
+				pNewHeader->pNext->pPrev = pNewHeader;
+
+			return pNewHeader + 1;
+		}
+
+		if (!isOldLarge && !isNewLarge)
+		{
+			const size_t oldAligned = Align(oldSize);
+			const size_t newAligned = Align(newSize);
+
+			if (IsLastBlock(pBlock) && m_pLastBlock + newAligned <= m_pEnd)
+			{
+				m_pCursor = m_pLastBlock + newAligned;
+				m_usedBytes = m_usedBytes - oldAligned + newAligned;
+				return pBlock;
+			}
+
+			if (newAligned <= oldAligned)
+				return pBlock;
+		}
+
+		void* pNewBlock = AllocateBlock(newSize);
+		if (!pNewBlock)
+		{
+			// Lua expects shrinking to succeed, A large block shrunk this way is released by Reset().
+			return newSize <= oldSize ? pBlock : nullptr;
+		}
+
+		std::memcpy(pNewBlock, pBlock, std::min(oldSize, newSize));
+		FreeBlock(pBlock, oldSize);
+		return pNewBlock;
+	}
+
+	void* LuaArenaAllocator::AllocateLarge(size_t size)
+	{
+		const size_t totalSize = sizeof(LargeBlock) + size;
+
+		if (!Reserve(totalSize))
+			return nullptr;
+
+		LargeBlock* pHeader = static_cast<LargeBlock*>(std::malloc(totalSize));
+		if (!pHeader)
+		{
+			m_reservedBytes -= totalSize;
+			return nullptr;
+		}
+
+		pHeader->pPrev = nullptr;
+		pHeader->pNext = m_pLargeBlocks;
+		pHeader->size = size;
+
+		if (m_pLargeBlocks)
+			m_pLargeBlocks->pPrev = pHeader;
+
+		m_pLargeBlocks = pHeader;
+		m_usedBytes += size;
+
+		return pHeader + 1;
+	}
+
+	void LuaArenaAllocator::FreeLarge(void* pBlock)
+	{
+		LargeBlock* pHeader = static_cast<LargeBlock*>(pBlock) - 1;
+
+		if (pHeader->pPrev)
+			pHeader->pPrev->pNext = pHeader->pNext;
+		else
+			m_pLargeBlocks = pHeader->pNext;
+
+		if (pHeader->pNext)
+			pHeader->pNext->pPrev = pHeader->pPrev;
+
+		m_reservedBytes -= sizeof(LargeBlock) + pHeader->size;
+		m_usedBytes -= pHeader->size;
+
+		std::free(pHeader);
+	}
+
+	bool LuaArenaAllocator::Reserve(size_t size)
+	{
+		if (m_capacity > 0 && m_reservedBytes + size > m_capacity)
+		{
+			++m_failedCount;
+			return false;
+		}
+
+		m_reservedBytes += size;
+		return true;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace lpp
+{
+	/// \class LuaArenaAllocator
+	/// \brief A monotonic `lua_Alloc` for short-lived states, Frees are no-ops and the whole arena is released at once.
+	///
+	/// Blocks are bump allocated from chunks, Freeing or shrinking the most recent block rolls the cursor back.
+	/// Blocks larger than a quarter chunk get their own malloc and are released right away when lua frees them.
+	/// Once the reserved memory would exceed the capacity, Allocations fail and lua raises `LUA_ERRMEM`.
+	///
+	/// Pass it to a LuaState to get a request-scoped state, Destroying such a state skips `lua_close` and calls Reset().
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaArenaAllocator arena(4 * 1024 * 1024);
+	///
+	/// for (const Request& request : requests)
+	/// {
+	///		LuaState state(&arena);
+	///		state.Init();
+	///		HandleRequest(state, request);
+	/// }	// Everything the request allocated is released here.
+	/// ~~~~~
+	/// \devnote One state at a time, The arena must outlive it.
+	class LuaArenaAllocator
+	{
+	public:
+		static constexpr size_t kDefaultChunkSize = 64 * 1024;
+		static constexpr size_t kAlignment = 16;
+
+	private:
+		struct Chunk
+		{
+			char* pData;
+			size_t size;
+		};
+
+		/// Header in front of a large block, Links every large block so Reset() can release them.
+		struct alignas(kAlignment) LargeBlock
+		{
+			LargeBlock* pPrev;
+			LargeBlock* pNext;
+			size_t size;
+		};
+
+		std::vector<Chunk> m_chunks;
+		char* m_pCursor;
+		char* m_pEnd;
+		char* m_pLastBlock;
+
+		LargeBlock* m_pLargeBlocks;
+
+		size_t m_chunkSize;
+		size_t m_capacity;
+		size_t m_reservedBytes;
+		size_t m_usedBytes;
+		size_t m_failedCount;
+
+	public:
+		/// \param capacity Maximum amount of bytes reserved from the system, Zero means unlimited.
+		/// \param chunkSize Size of the chunks blocks are bump allocated from.
+		explicit LuaArenaAllocator(size_t capacity = 0, size_t chunkSize = kDefaultChunkSize);
+		~LuaArenaAllocator();
+
+		LuaArenaAllocator(const LuaArenaAllocator&) = delete;
+		LuaArenaAllocator& operator=(const LuaArenaAllocator&) = delete;
+
+		/// Releases every block, The first chunk is kept for the next state.
+		void Reset();
+
+		void SetCapacity(size_t capacity) { m_capacity = capacity; }
+		size_t GetCapacity() const { return m_capacity; }
+
+		/// Bytes reserved from the system, Chunks and large blocks.
+		size_t GetReservedBytes() const { return m_reservedBytes; }
+
+		/// Bytes handed out to lua and not rolled back or released.
+		size_t GetUsedBytes() const { return m_usedBytes; }
+
+		/// Amount of allocations that failed because of the capacity.
+		size_t GetFailedCount() const { return m_failedCount; }
+
+		/// The `lua_Alloc` function, `pUserData` is the LuaArenaAllocator.
+		static void* Allocate(void* pUserData, void* pBlock, size_t oldSize, size_t newSize);
+
+	private:
+
+		void* AllocateBlock(size_t size);
+		void FreeBlock(void* pBlock, size_t size);
+		void* ReallocateBlock(void* pBlock, size_t oldSize, size_t newSize);
+
+		void* AllocateLarge(size_t size);
+		void FreeLarge(void* pBlock);
+
+		bool IsLarge(size_t size) const { return size > m_chunkSize / 4; }
+
+		/// Whether the block was bump allocated last, Then it can grow, shrink or be freed in place.
+		bool IsLastBlock(void* pBlock) const { return pBlock != nullptr && pBlock == m_pLastBlock; }
+
+		bool Reserve(size_t size);
+
+		static size_t Align(size_t size) { return (size + kAlignment - 1) & ~(kAlignment - 1); }
+	};
+}
\ No newline at end of file
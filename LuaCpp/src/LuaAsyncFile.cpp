@@ -0,0 +1,304 @@
+#include "LuaAsyncFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+
+namespace lpp
+{
+	namespace
+	{
+		// long is 32 bits on Windows, Offsets past 2 GB need the 64 bit variants.
+		int Seek(std::FILE* pFile, int64_t offset, int origin)
+		{
+#if defined(_WIN32)
+			return _fseeki64(pFile, offset, origin);
+#else
+			return fseeko(pFile, static_cast<off_t>(offset), origin);
+#endif
+		}
+
+		int64_t Tell(std::FILE* pFile)
+		{
+#if defined(_WIN32)
+			return _ftelli64(pFile);
+#else
+			return static_cast<int64_t>(ftello(pFile));
+#endif
+		}
+	}
+
+#pragma region FileSlot
+
+	/// Completion slot holding the file contents or the error of a job.
+	class LuaAsyncFile::FileSlot : public LuaPendingSlot
+	{
+		std::string m_buffer;
+		std::string m_message;
+		bool m_isSuccess = false;
+		bool m_isWrite = false;
+
+	public:
+		explicit FileSlot(bool isWrite) : m_isWrite(isWrite) {}
+
+		/// Called by a worker, The buffer is moved in so the data is not copied again until Lua interns it.
+		void Succeed(std::string&& buffer)
+		{
+			{
+				std::unique_lock<std::mutex> lock = Lock();
+				m_buffer = std::move(buffer);
+				m_isSuccess = true;
+			}
+
+			Complete(State::Resolved);
+		}
+
+		void Fail(std::string&& message)
+		{
+			{
+				std::unique_lock<std::mutex> lock = Lock();
+				m_message = std::move(message);
+				m_isSuccess = false;
+			}
+
+			Complete(State::Resolved);
+		}
+
+	protected:
+		int PushResults(lua_State* pState) override
+		{
+			if (!m_isSuccess)
+			{
+				lua_pushnil(pState);
+				lua_pushlstring(pState, m_message.data(), m_message.size());
+				return 2;
+			}
+
+			if (m_isWrite)
+			{
+				lua_pushboolean(pState, true);
+				return 1;
+			}
+
+			lua_pushlstring(pState, m_buffer.data(), m_buffer.size());
+
+			// Lua owns a copy now, Release ours right away.
+			std::string().swap(m_buffer);
+			return 1;
+		}
+	};
+
+#pragma endregion
+
+#pragma region Initialization / Construction
+
+	LuaAsyncFile::LuaAsyncFile(LuaState* pState, size_t workerCount, const char* libraryName)
+		: m_pState(pState)
+		, m_libraryName(libraryName)
+		, m_isStopping(false)
+	{
+		lua_State* L = m_pState->GetState();
+
+		const luaL_Reg functions[] =
+		{
+			{ "readFile", &LuaAsyncFile::LuaReadFile },
+			{ "readRange", &LuaAsyncFile::LuaReadRange },
+			{ "writeFile", &LuaAsyncFile::LuaWriteFile },
+			{ nullptr, nullptr }
+		};
+
+		lua_newtable(L);								// [lib]
+		lua_pushlightuserdata(L, this);					// [lib, this]
+		luaL_setfuncs(L, functions, 1);					// [lib]
+		lua_setglobal(L, m_libraryName.c_str());		// []
+
+		if (workerCount == 0)
+			workerCount = 1;
+
+		m_workers.reserve(workerCount);
+		for (size_t i = 0; i < workerCount; ++i)
+			m_workers.emplace_back(&LuaAsyncFile::WorkerLoop, this);
+	}
+
+	LuaAsyncFile::~LuaAsyncFile()
+	{
+		std::deque<Job> cancelled;
+
+		{
+			std::unique_lock<std::mutex> lock(m_jobMutex);
+			m_isStopping = true;
+			cancelled.swap(m_jobs);
+		}
+
+		m_jobSignal.notify_all();
+
+		for (std::thread& worker : m_workers)
+			worker.join();
+
+		for (Job& job : cancelled)
+			job.pSlot->Fail("Cancelled, The async file library was destroyed.");
+
+		// The library table points at this object.
+		lua_State* L = m_pState->GetState();
+		lua_pushnil(L);
+		lua_setglobal(L, m_libraryName.c_str());
+	}
+
+#pragma endregion
+
+	size_t LuaAsyncFile::GetQueuedCount()
+	{
+		std::unique_lock<std::mutex> lock(m_jobMutex);
+		return m_jobs.size();
+	}
+
+	int LuaAsyncFile::Submit(lua_State* pState, Job&& job)
+	{
+		std::shared_ptr<FileSlot> pSlot = std::make_shared<FileSlot>(job.type == JobType::Write);
+		job.pSlot = pSlot;
+
+		{
+			std::unique_lock<std::mutex> lock(m_jobMutex);
+			m_jobs.push_back(std::move(job));
+		}
+
+		m_jobSignal.notify_one();
+
+		return LuaPendingSlot::Yield(pState, std::move(pSlot));
+	}
+
+	void LuaAsyncFile::WorkerLoop()
+	{
+		for (;;)
+		{
+			Job job;
+
+			{
+				std::unique_lock<std::mutex> lock(m_jobMutex);
+				m_jobSignal.wait(lock, [this]() { return m_isStopping || !m_jobs.empty(); });
+
+				if (m_isStopping)
+					return;
+
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+			}
+
+			Execute(job);
+		}
+	}
+
+	void LuaAsyncFile::Execute(Job& job)
+	{
+		const char* mode = job.type == JobType::Write ? "wb" : "rb";
+
+		std::FILE* pFile = std::fopen(job.path.c_str(), mode);
+		if (!pFile)
+		{
+			job.pSlot->Fail(job.path + ": Could not open file.");
+			return;
+		}
+
+		if (job.type == JobType::Write)
+		{
+			size_t written = std::fwrite(job.data.data(), 1, job.data.size(), pFile);
+			std::fclose(pFile);
+
+			if (written != job.data.size())
+				job.pSlot->Fail(job.path + ": Could not write file.");
+			else
+				job.pSlot->Succeed(std::string());
+
+			return;
+		}
+
+		const int64_t fileSize = Seek(pFile, 0, SEEK_END) == 0 ? Tell(pFile) : -1;
+		const int64_t offset = job.type == JobType::ReadRange ? job.offset : 0;
+
+		if (fileSize < 0 || Seek(pFile, offset, SEEK_SET) != 0)
+		{
+			std::fclose(pFile);
+			job.pSlot->Fail(job.path + ": Could not seek in file.");
+			return;
+		}
+
+		// The size a script asks for is clamped to the file, A range past the end of the file returns what is there.
+		const int64_t available = std::max<int64_t>(0, fileSize - offset);
+		const int64_t size = job.type == JobType::Read ? fileSize : std::min(job.size, available);
+
+		// Exceptions must not leave the worker thread.
+		std::string buffer;
+		try
+		{
+			buffer.resize(static_cast<size_t>(size));
+		}
+		catch (const std::exception&)
+		{
+			std::fclose(pFile);
+			job.pSlot->Fail(job.path + ": Not enough memory to read file.");
+			return;
+		}
+
+		size_t read = std::fread(&buffer[0], 1, buffer.size(), pFile);
+		std::fclose(pFile);
+
+		// The file may have shrunk since its size was read.
+		buffer.resize(read);
+		job.pSlot->Succeed(std::move(buffer));
+	}
+
+#pragma region Lua Functions
+
+	LuaAsyncFile* LuaAsyncFile::GetUpvalue(lua_State* pState)
+	{
+		// Checked before any C++ object lives on the C stack, luaL_error does not unwind it when lua is compiled as C.
+		if (!lua_isyieldable(pState))
+			luaL_error(pState, "Async file functions can only be called from a coroutine.");
+
+		return static_cast<LuaAsyncFile*>(lua_touserdata(pState, lua_upvalueindex(1)));
+	}
+
+	int LuaAsyncFile::LuaReadFile(lua_State* pState)
+	{
+		LuaAsyncFile* pFiles = GetUpvalue(pState);
+
+		size_t length = 0;
+		const char* path = luaL_checklstring(pState, 1, &length);
+
+		Job job{ JobType::Read, std::string(path, length), 0, 0, std::string(), nullptr };
+		return pFiles->Submit(pState, std::move(job));
+	}
+
+	int LuaAsyncFile::LuaReadRange(lua_State* pState)
+	{
+		LuaAsyncFile* pFiles = GetUpvalue(pState);
+
+		size_t length = 0;
+		const char* path = luaL_checklstring(pState, 1, &length);
+		lua_Integer offset = luaL_checkinteger(pState, 2);
+		lua_Integer size = luaL_checkinteger(pState, 3);
+
+		luaL_argcheck(pState, offset >= 0, 2, "offset must be positive");
+		luaL_argcheck(pState, size >= 0, 3, "size must be positive");
+
+		Job job{ JobType::ReadRange, std::string(path, length), offset, size, std::string(), nullptr };
+		return pFiles->Submit(pState, std::move(job));
+	}
+
+	int LuaAsyncFile::LuaWriteFile(lua_State* pState)
+	{
+		LuaAsyncFile* pFiles = GetUpvalue(pState);
+
+		size_t pathLength = 0;
+		const char* path = luaL_checklstring(pState, 1, &pathLength);
+
+		size_t dataLength = 0;
+		const char* data = luaL_checklstring(pState, 2, &dataLength);
+
+		Job job{ JobType::Write, std::string(path, pathLength), 0, 0, std::string(data, dataLength), nullptr };
+		return pFiles->Submit(pState, std::move(job));
+	}
+
+#pragma endregion
+
+}
\ No newline at end of file
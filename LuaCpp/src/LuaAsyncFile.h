@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <LuaPendingQueue.h>
+#include <LuaState.h>
+
+namespace lpp
+{
+	/// \class LuaAsyncFile
+	/// \brief Non-blocking file access for scripts, Backed by a small pool of worker threads.
+	///
+	/// Registers a library table (`asyncio` by default) with:
+	/// - `asyncio.readFile(path)` returns the whole file as a string.
+	/// - `asyncio.readRange(path, offset, size)` returns up to `size` bytes starting at `offset`.
+	/// - `asyncio.writeFile(path, data)` returns true.
+	///
+	/// On failure the functions return `nil, message` like the `io` library. Every call suspends the calling coroutine
+	/// (see LuaPending) while a worker does the I/O, The buffer is pushed with a single `lua_pushlstring` when the coroutine resumes.
+	/// The coroutines have to be driven by a LuaScheduler or LuaCoroutine, Calling the functions from the main thread raises an error.
+	///
+	/// \devnote Workers only touch the file system and the completion slots, Never the lua state.
+	class LuaAsyncFile
+	{
+	public:
+		static constexpr size_t kDefaultWorkerCount = 2;
+		static constexpr const char* kDefaultLibraryName = "asyncio";
+
+	private:
+		enum class JobType
+		{
+			Read,
+			ReadRange,
+			Write,
+		};
+
+		class FileSlot;
+
+		struct Job
+		{
+			JobType type;
+			std::string path;
+			int64_t offset;
+			int64_t size;
+			std::string data;
+			std::shared_ptr<FileSlot> pSlot;
+		};
+
+		LuaState* m_pState;
+		std::string m_libraryName;
+
+		std::vector<std::thread> m_workers;
+		std::mutex m_jobMutex;
+		std::condition_variable m_jobSignal;
+		std::deque<Job> m_jobs;
+		bool m_isStopping;
+
+	public:
+		/// Starts the workers and registers the library table as a global of the state.
+		explicit LuaAsyncFile(LuaState* pState, size_t workerCount = kDefaultWorkerCount, const char* libraryName = kDefaultLibraryName);
+
+		/// Fails the jobs that did not start yet and joins the workers.
+		~LuaAsyncFile();
+
+		LuaAsyncFile(const LuaAsyncFile&) = delete;
+		LuaAsyncFile& operator=(const LuaAsyncFile&) = delete;
+
+		/// Amount of jobs queued and not picked up by a worker yet.
+		size_t GetQueuedCount();
+
+	private:
+
+		/// Queues the job and suspends the calling coroutine until it completes.
+		int Submit(lua_State* pState, Job&& job);
+
+		void WorkerLoop();
+
+		static void Execute(Job& job);
+
+		static LuaAsyncFile* GetUpvalue(lua_State* pState);
+
+		/// `readFile(path)`
+		static int LuaReadFile(lua_State* pState);
+
+		/// `readRange(path, offset, size)`
+		static int LuaReadRange(lua_State* pState);
+
+		/// `writeFile(path, data)`
+		static int LuaWriteFile(lua_State* pState);
+	};
+}
\ No newline at end of file
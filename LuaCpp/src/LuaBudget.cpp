@@ -0,0 +1,90 @@
+#include "LuaBudget.h"
+
+#include <algorithm>
+
+namespace lpp
+{
+	LuaBudget::LuaBudget(LuaState* pState, uint64_t maxInstructions, double maxMicros, lua_State* pThread, int checkInterval)
+		: m_pState(pState)
+		, m_pThread(pThread ? pThread : pState->GetState())
+		, m_pPrevious(pState->GetBudget())
+		, m_maxInstructions(maxInstructions)
+		, m_maxMicros(maxMicros)
+		, m_checkInterval(std::max(1, checkInterval))
+		, m_instructionCount(0)
+		, m_start(Clock::now())
+		, m_status(LuaBudgetStatus::Running)
+	{
+		if (!HasLimits())
+			return;
+
+		m_pState->SetBudget(this);
+		Apply(m_pThread, m_pThread != pState->GetState());
+	}
+
+	LuaBudget::~LuaBudget()
+	{
+		if (!HasLimits())
+			return;
+
+		m_pState->SetBudget(m_pPrevious);
+
+		// Counts left on other threads are removed the next time they fire without a budget.
+		m_pState->UpdateHook(m_pThread);
+	}
+
+	void LuaBudget::Apply(lua_State* pThread, bool isYieldable)
+	{
+		if (!HasLimits())
+			return;
+
+		if (isYieldable && std::find(m_yieldableThreads.begin(), m_yieldableThreads.end(), pThread) == m_yieldableThreads.end())
+			m_yieldableThreads.push_back(pThread);
+
+		m_pState->UpdateHook(pThread);
+	}
+
+	int LuaBudget::GetHookCount() const
+	{
+		if (IsExceeded())
+			return 1;
+
+		if (m_maxInstructions == 0)
+			return m_checkInterval;
+
+		const uint64_t remaining = m_maxInstructions > m_instructionCount ? m_maxInstructions - m_instructionCount : 1;
+		return static_cast<int>(std::min<uint64_t>(remaining, static_cast<uint64_t>(m_checkInterval)));
+	}
+
+	void LuaBudget::Check(lua_State* pThread, int instructionCount)
+	{
+		if (!IsExceeded())
+		{
+			// Threads applied by an outer budget may still run with another interval, So the count comes from the hook.
+			m_instructionCount += static_cast<uint64_t>(std::max(1, instructionCount));
+
+			if (m_maxInstructions > 0 && m_instructionCount >= m_maxInstructions)
+				m_status = LuaBudgetStatus::InstructionsExceeded;
+			else if (m_maxMicros > 0.0 && GetElapsedMicros() >= m_maxMicros)
+				m_status = LuaBudgetStatus::TimeExceeded;
+		}
+
+		// Once exceeded every instruction checks, So a script catching the error with pcall stops right after.
+		m_pState->UpdateHook(pThread);
+
+		if (!IsExceeded())
+			return;
+
+		if (lua_isyieldable(pThread) && std::find(m_yieldableThreads.begin(), m_yieldableThreads.end(), pThread) != m_yieldableThreads.end())
+		{
+			lua_yield(pThread, 0);
+			return;
+		}
+
+		// Level 0 is the function being interrupted, A count hook runs without a call info of its own.
+		luaL_where(pThread, 0);
+		lua_pushstring(pThread, m_status == LuaBudgetStatus::InstructionsExceeded ? "instruction budget exceeded" : "time budget exceeded");
+		lua_concat(pThread, 2);
+		lua_error(pThread);
+	}
+}
\ No newline at end of file
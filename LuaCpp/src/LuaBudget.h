@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <LuaState.h>
+
+namespace lpp
+{
+	enum class LuaBudgetStatus
+	{
+		Running,				///< Neither limit was reached.
+		InstructionsExceeded,	///< The script ran more instructions than allowed.
+		TimeExceeded,			///< The script ran longer than allowed.
+	};
+
+	/// \class LuaBudget
+	/// \brief Limits the instructions and wall-clock time of everything a state runs while the budget exists.
+	///
+	/// The budget adds a count to the hook of the thread, Every `checkInterval` instructions the hook adds up the instructions and
+	/// reads the clock. Past a limit it raises "instruction budget exceeded" or "time budget exceeded" through `lua_pcall`, So
+	/// LuaVar::Call(), LuaState::Execute() and friends fail as for any other error and GetStatus() tells the budget was the cause.
+	/// Inside a coroutine resumed from C++ the hook yields instead, The coroutine continues from there on the next Resume().
+	///
+	/// Without limits no hook is installed, The hook is removed again when the budget is destroyed.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// {
+	///		LuaBudget budget(&state, 1000000, 5000.0);
+	///		if (!state.Execute("handlers.onRequest()") && budget.IsExceeded())
+	///			Abort(request);
+	/// }
+	///
+	/// // Time slicing, The behaviour yields after 200us and resumes next frame.
+	/// LuaBudget slice(&state, 0, 200.0, behaviour.GetThread());
+	/// behaviour.Resume();
+	/// ~~~~~
+	///
+	/// \devnote Only one budget per state is active, A nested budget replaces the outer one until it is destroyed.
+	/// Coroutines created by the script inherit the hook and error instead of yielding, Their resumer runs out of budget right after.
+	/// C functions are not counted, A single long call into C only ends at the next Lua instruction.
+	class LuaBudget
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		static constexpr int kDefaultCheckInterval = 1000;
+
+	private:
+		LuaState* m_pState;
+		lua_State* m_pThread;
+		LuaBudget* m_pPrevious;
+
+		uint64_t m_maxInstructions;
+		double m_maxMicros;
+		int m_checkInterval;
+
+		uint64_t m_instructionCount;
+		Clock::time_point m_start;
+		LuaBudgetStatus m_status;
+
+		// Threads the hook may yield, Only compared and never touched.
+		std::vector<lua_State*> m_yieldableThreads;
+
+	public:
+		/// Starts the budget, Zero disables a limit.
+		/// \param pThread The thread running the code, nullptr for the main thread. A coroutine thread makes the budget yield it.
+		/// \param checkInterval Instructions between two checks, Lower is more precise and costs more.
+		LuaBudget(LuaState* pState, uint64_t maxInstructions, double maxMicros = 0.0, lua_State* pThread = nullptr, int checkInterval = kDefaultCheckInterval);
+
+		/// Removes the hook or restores the budget it replaced.
+		~LuaBudget();
+
+		LuaBudget(const LuaBudget&) = delete;
+		LuaBudget& operator=(const LuaBudget&) = delete;
+
+		LuaBudgetStatus GetStatus() const { return m_status; }
+		bool IsExceeded() const { return m_status != LuaBudgetStatus::Running; }
+
+		/// Instructions counted so far, Rounded down to the check interval.
+		uint64_t GetInstructionCount() const { return m_instructionCount; }
+
+		double GetElapsedMicros() const { return std::chrono::duration<double, std::micro>(Clock::now() - m_start).count(); }
+
+		/// Counts the instructions of another thread too, e.g. before resuming it. LuaCoroutine does this on every resume.
+		/// \param isYieldable Whether running out of budget yields the thread instead of raising an error.
+		void Apply(lua_State* pThread, bool isYieldable);
+
+		bool HasLimits() const { return m_maxInstructions > 0 || m_maxMicros > 0.0; }
+
+		/// Instructions until the next check, Never past the instruction limit. 1 once exceeded.
+		int GetHookCount() const;
+
+		/// Called by the hook of the state, Raises the error or yields when the budget ran out.
+		/// \param instructionCount The count of the hook that fired, Smaller than GetHookCount() when a profiler shares the hook.
+		void Check(lua_State* pThread, int instructionCount);
+	};
+}
\ No newline at end of file
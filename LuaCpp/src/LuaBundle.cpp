@@ -0,0 +1,488 @@
+#include "LuaBundle.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include <LuaLoader.h>
+
+namespace lpp
+{
+	namespace fs = std::filesystem;
+
+	namespace
+	{
+		constexpr char kBundleMagic[4] = { 'L', 'P', 'P', 'B' };
+
+		struct BundleHeader
+		{
+			char magic[4];
+			uint32_t version;
+			uint32_t entryCount;
+			uint32_t reserved;
+		};
+
+		struct BundleEntry
+		{
+			uint64_t nameOffset;
+			uint64_t chunkNameOffset;
+			uint64_t dataOffset;
+			uint64_t dataSize;
+			uint32_t nameLength;
+			uint32_t flags;
+		};
+
+		/// Quotes a string as a C++ literal, Escaping everything outside of printable ascii.
+		std::string ToLiteral(const std::string& text)
+		{
+			std::string literal = "\"";
+			for (unsigned char c : text)
+			{
+				if (c == '"' || c == '\\')
+				{
+					literal += '\\';
+					literal += static_cast<char>(c);
+				}
+				else if (c < 0x20 || c > 0x7e || c == '?')
+				{
+					// Octal escapes end after three digits, Hex escapes would swallow following characters.
+					literal += '\\';
+					literal += static_cast<char>('0' + ((c >> 6) & 7));
+					literal += static_cast<char>('0' + ((c >> 3) & 7));
+					literal += static_cast<char>('0' + (c & 7));
+				}
+				else
+				{
+					literal += static_cast<char>(c);
+				}
+			}
+
+			return literal + "\"";
+		}
+	}
+
+#pragma region LuaBundle
+
+	LuaBundle::LuaBundle()
+		: m_pData(nullptr)
+		, m_size(0)
+#if defined(_WIN32)
+		, m_pFile(nullptr)
+		, m_pMapping(nullptr)
+#endif
+	{}
+
+	LuaBundle::~LuaBundle()
+	{
+		Close();
+	}
+
+	bool LuaBundle::Open(const char* path)
+	{
+		Close();
+		m_path = path;
+
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		m_pData = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		m_size = static_cast<size_t>(size.QuadPart);
+		m_pFile = file;
+		m_pMapping = mapping;
+#else
+		int file = ::open(path, O_RDONLY);
+		if (file < 0)
+			return false;
+
+		struct stat info;
+		if (::fstat(file, &info) != 0 || info.st_size == 0)
+		{
+			::close(file);
+			return false;
+		}
+
+		void* pMapped = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+		// The mapping stays valid without the descriptor.
+		::close(file);
+
+		if (pMapped == MAP_FAILED)
+			return false;
+
+		m_pData = static_cast<const char*>(pMapped);
+		m_size = static_cast<size_t>(info.st_size);
+#endif
+
+		if (!m_pData || !ReadIndex())
+		{
+			//DEBUG_LOG("Invalid script bundle: %s", path);
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void LuaBundle::Close()
+	{
+		m_chunks.clear();
+
+#if defined(_WIN32)
+		if (m_pData)
+			UnmapViewOfFile(m_pData);
+
+		if (m_pMapping)
+			CloseHandle(m_pMapping);
+
+		if (m_pFile)
+			CloseHandle(m_pFile);
+
+		m_pFile = nullptr;
+		m_pMapping = nullptr;
+#else
+		if (m_pData)
+			::munmap(const_cast<char*>(m_pData), m_size);
+#endif
+
+		m_pData = nullptr;
+		m_size = 0;
+	}
+
+	bool LuaBundle::ReadIndex()
+	{
+		if (m_size < sizeof(BundleHeader))
+			return false;
+
+		BundleHeader header;
+		std::memcpy(&header, m_pData, sizeof(BundleHeader));
+
+		if (std::memcmp(header.magic, kBundleMagic, sizeof(kBundleMagic)) != 0 || header.version != kVersion)
+			return false;
+
+		if (header.entryCount > (m_size - sizeof(BundleHeader)) / sizeof(BundleEntry))
+			return false;
+
+		m_chunks.reserve(header.entryCount);
+
+		// Checks that a string of the given length and its null terminator lie within the mapping.
+		auto isValidString = [this](uint64_t offset, uint64_t length)
+		{
+			return offset < m_size && length < m_size - offset && m_pData[offset + length] == '\0';
+		};
+
+		for (uint32_t i = 0; i < header.entryCount; ++i)
+		{
+			BundleEntry entry;
+			std::memcpy(&entry, m_pData + sizeof(BundleHeader) + i * sizeof(BundleEntry), sizeof(BundleEntry));
+
+			if (!isValidString(entry.nameOffset, entry.nameLength)
+				|| entry.chunkNameOffset >= m_size || !std::memchr(m_pData + entry.chunkNameOffset, '\0', m_size - entry.chunkNameOffset)
+				|| entry.dataOffset > m_size || entry.dataSize > m_size - entry.dataOffset)
+				return false;
+
+			Chunk chunk;
+			chunk.pData = m_pData + entry.dataOffset;
+			chunk.size = static_cast<size_t>(entry.dataSize);
+			chunk.chunkName = m_pData + entry.chunkNameOffset;
+			chunk.isBytecode = (entry.flags & kFlagBytecode) != 0;
+
+			m_chunks.emplace(std::string_view(m_pData + entry.nameOffset, entry.nameLength), chunk);
+		}
+
+		return true;
+	}
+
+	int LuaBundle::Load(lua_State* pState, std::string_view name) const
+	{
+		auto it = m_chunks.find(name);
+		if (it == m_chunks.end())
+		{
+			lua_pushfstring(pState, "no chunk '%s' in bundle '%s'", std::string(name).c_str(), m_path.c_str());
+			return LUA_ERRFILE;
+		}
+
+		const Chunk& chunk = it->second;
+		return luaL_loadbufferx(pState, chunk.pData, chunk.size, chunk.chunkName, chunk.isBytecode ? "b" : "t");
+	}
+
+	bool LuaBundle::InstallSearcher(lua_State* pState)
+	{
+		return LuaLoader::InsertSearcher(pState, &LuaBundle::Search, this);
+	}
+
+	int LuaBundle::Search(lua_State* pState)
+	{
+		const LuaBundle* pBundle = static_cast<const LuaBundle*>(lua_touserdata(pState, lua_upvalueindex(1)));
+
+		size_t length = 0;
+		const char* name = luaL_checklstring(pState, 1, &length);
+
+		auto it = pBundle->m_chunks.find(std::string_view(name, length));
+		if (it == pBundle->m_chunks.end())
+		{
+			lua_pushfstring(pState, "no module '%s' in bundle '%s'", name, pBundle->m_path.c_str());
+			return 1;
+		}
+
+		const Chunk& chunk = it->second;
+		if (luaL_loadbufferx(pState, chunk.pData, chunk.size, chunk.chunkName, chunk.isBytecode ? "b" : "t") != LUA_OK)
+			return luaL_error(pState, "error loading module '%s' from bundle '%s':\n\t%s", name, pBundle->m_path.c_str(), lua_tostring(pState, -1));
+
+		// Passed to the loader as its second argument like the file name of the file searcher.
+		lua_pushstring(pState, chunk.chunkName);
+		return 2;
+	}
+
+#pragma endregion
+
+#pragma region LuaBundleWriter
+
+	LuaBundleWriter::LuaBundleWriter(bool isStripping)
+		: m_pCompiler(nullptr)
+		, m_isStripping(isStripping)
+	{}
+
+	LuaBundleWriter::~LuaBundleWriter()
+	{
+		if (m_pCompiler)
+			lua_close(m_pCompiler);
+	}
+
+	bool LuaBundleWriter::Add(const std::string& name, const std::string& code, bool isCompiling, const std::string& chunkName)
+	{
+		Chunk chunk{ name, chunkName.empty() ? "=" + name : chunkName, std::string(), isCompiling };
+
+		if (!isCompiling)
+		{
+			chunk.data = code;
+			m_chunks.push_back(std::move(chunk));
+			return true;
+		}
+
+		if (!m_pCompiler)
+			m_pCompiler = luaL_newstate();
+
+		if (luaL_loadbufferx(m_pCompiler, code.data(), code.size(), chunk.chunkName.c_str(), "t") != LUA_OK)
+		{
+			m_error = lua_tostring(m_pCompiler, -1);
+			lua_pop(m_pCompiler, 1);
+			return false;
+		}
+
+		lua_dump(m_pCompiler, &LuaLoader::WriteBytecode, &chunk.data, m_isStripping ? 1 : 0);
+		lua_pop(m_pCompiler, 1);
+
+		m_chunks.push_back(std::move(chunk));
+		return true;
+	}
+
+	bool LuaBundleWriter::AddFile(const std::string& path, const std::string& name, bool isCompiling)
+	{
+		std::string code;
+		if (!LuaLoader::ReadFile(path, code))
+		{
+			m_error = "cannot open " + path;
+			return false;
+		}
+
+		// Stored without the BOM and shebang too, The bundle loads its chunks from memory.
+		return Add(name, std::string(LuaLoader::SkipHeader(code)), isCompiling, "@" + path);
+	}
+
+	bool LuaBundleWriter::AddDirectory(const std::string& directory, bool isCompiling)
+	{
+		std::error_code error;
+		for (const fs::directory_entry& file : fs::recursive_directory_iterator(directory, error))
+		{
+			if (!file.is_regular_file() || file.path().extension() != ".lua")
+				continue;
+
+			const std::string name = GetModuleName(file.path().lexically_relative(directory).generic_string());
+			if (!AddFile(file.path().generic_string(), name, isCompiling))
+				return false;
+		}
+
+		if (error)
+		{
+			m_error = directory + ": " + error.message();
+			return false;
+		}
+
+		return true;
+	}
+
+	std::string LuaBundleWriter::GetModuleName(const std::string& relativePath)
+	{
+		fs::path relative = fs::path(relativePath).replace_extension();
+		if (relative.filename() == "init" && relative.has_parent_path())
+			relative = relative.parent_path();
+
+		std::string name = relative.generic_string();
+		for (char& c : name)
+		{
+			if (c == '/')
+				c = '.';
+		}
+
+		return name;
+	}
+
+	bool LuaBundleWriter::Write(const char* path)
+	{
+		BundleHeader header;
+		std::memcpy(header.magic, kBundleMagic, sizeof(kBundleMagic));
+		header.version = LuaBundle::kVersion;
+		header.entryCount = static_cast<uint32_t>(m_chunks.size());
+		header.reserved = 0;
+
+		// Strings and data follow the index.
+		std::vector<BundleEntry> entries(m_chunks.size());
+		std::string blob;
+		const uint64_t blobOffset = sizeof(BundleHeader) + entries.size() * sizeof(BundleEntry);
+
+		for (size_t i = 0; i < m_chunks.size(); ++i)
+		{
+			const Chunk& chunk = m_chunks[i];
+			BundleEntry& entry = entries[i];
+
+			entry.nameOffset = blobOffset + blob.size();
+			entry.nameLength = static_cast<uint32_t>(chunk.name.size());
+			blob.append(chunk.name.c_str(), chunk.name.size() + 1);
+
+			entry.chunkNameOffset = blobOffset + blob.size();
+			blob.append(chunk.chunkName.c_str(), chunk.chunkName.size() + 1);
+
+			entry.dataOffset = blobOffset + blob.size();
+			entry.dataSize = chunk.data.size();
+			entry.flags = chunk.isBytecode ? LuaBundle::kFlagBytecode : 0;
+			blob.append(chunk.data);
+		}
+
+		std::FILE* pFile = std::fopen(path, "wb");
+		if (!pFile)
+		{
+			m_error = std::string("cannot open ") + path;
+			return false;
+		}
+
+		bool isWritten = std::fwrite(&header, sizeof(BundleHeader), 1, pFile) == 1
+			&& (entries.empty() || std::fwrite(entries.data(), sizeof(BundleEntry), entries.size(), pFile) == entries.size())
+			&& std::fwrite(blob.data(), 1, blob.size(), pFile) == blob.size();
+
+		isWritten = std::fclose(pFile) == 0 && isWritten;
+		if (!isWritten)
+			m_error = std::string("cannot write ") + path;
+
+		return isWritten;
+	}
+
+	bool LuaBundleWriter::WriteEmbedded(const char* path, const std::string& symbol)
+	{
+		static constexpr char kHex[] = "0123456789abcdef";
+
+		// The index is searched with a binary search.
+		std::vector<const Chunk*> sorted;
+		for (const Chunk& chunk : m_chunks)
+			sorted.push_back(&chunk);
+
+		std::sort(sorted.begin(), sorted.end(), [](const Chunk* pLeft, const Chunk* pRight) { return pLeft->name < pRight->name; });
+
+		std::string source = "// Generated by LuaCppEmbed, Do not edit.\n\n#include <LuaEmbeddedScripts.h>\n\nnamespace\n{\n";
+
+		for (size_t i = 0; i < sorted.size(); ++i)
+		{
+			const std::string& data = sorted[i]->data;
+
+			source += "\tconstexpr unsigned char kChunk" + std::to_string(i) + "[] =\n\t{";
+			for (size_t j = 0; j < data.size(); ++j)
+			{
+				const unsigned char byte = static_cast<unsigned char>(data[j]);
+
+				source += (j % 16 == 0) ? "\n\t\t" : " ";
+				source += "0x";
+				source += kHex[byte >> 4];
+				source += kHex[byte & 15];
+				source += ',';
+			}
+
+			// Arrays can't be empty.
+			if (data.empty())
+				source += "\n\t\t0";
+
+			source += "\n\t};\n\n";
+		}
+
+		if (!sorted.empty())
+		{
+			source += "\tconstexpr lpp::LuaEmbeddedChunk kChunks[] =\n\t{\n";
+			for (size_t i = 0; i < sorted.size(); ++i)
+			{
+				const Chunk& chunk = *sorted[i];
+				const std::string array = "kChunk" + std::to_string(i);
+
+				source += "\t\t{ " + ToLiteral(chunk.name) + ", " + ToLiteral(chunk.chunkName) + ", " + array + ", "
+					+ std::to_string(chunk.data.size()) + ", " + (chunk.isBytecode ? "true" : "false") + " },\n";
+			}
+
+			source += "\t};\n";
+		}
+
+		source += "}\n\nextern const lpp::LuaEmbeddedScripts " + symbol + " = { ";
+		source += sorted.empty() ? std::string("nullptr, 0") : "kChunks, " + std::to_string(sorted.size());
+		source += " };\n";
+
+		// Leave the file alone when nothing changed.
+		{
+			std::ifstream existing(path, std::ios::binary);
+			if (existing)
+			{
+				std::ostringstream content;
+				content << existing.rdbuf();
+				if (content.str() == source)
+					return true;
+			}
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file || !file.write(source.data(), source.size()))
+		{
+			m_error = std::string("cannot write ") + path;
+			return false;
+		}
+
+		return true;
+	}
+
+#pragma endregion
+
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <lua.hpp>
+
+namespace lpp
+{
+	/// \class LuaBundle
+	/// \brief A single indexed file of source or bytecode chunks, Memory-mapped and loaded by `require` through a `package.searchers` entry.
+	///
+	/// Chunks are passed to `lua_load` straight from the mapping, Nothing is copied or read through stdio.
+	/// Bundles are created with LuaBundleWriter and usually mounted with LuaState::MountBundle().
+	///
+	/// The file layout, All integers little endian:
+	/// ~~~~~
+	/// Header   { char magic[4] = "LPPB"; uint32 version; uint32 entryCount; uint32 reserved; }
+	/// Entry[]  { uint64 nameOffset; uint64 chunkNameOffset; uint64 dataOffset; uint64 dataSize; uint32 nameLength; uint32 flags; }
+	/// Strings and chunk data, Names are null terminated.
+	/// ~~~~~
+	class LuaBundle
+	{
+	public:
+		static constexpr uint32_t kVersion = 1;
+		static constexpr uint32_t kFlagBytecode = 1;
+
+		struct Chunk
+		{
+			const char* pData;
+			size_t size;
+			const char* chunkName;
+			bool isBytecode;
+		};
+
+	private:
+		std::string m_path;
+
+		const char* m_pData;
+		size_t m_size;
+
+#if defined(_WIN32)
+		void* m_pFile;
+		void* m_pMapping;
+#endif
+
+		// Names point into the mapping.
+		std::unordered_map<std::string_view, Chunk> m_chunks;
+
+	public:
+		LuaBundle();
+		~LuaBundle();
+
+		LuaBundle(const LuaBundle&) = delete;
+		LuaBundle& operator=(const LuaBundle&) = delete;
+
+		/// Maps the bundle and reads its index.
+		/// \return False when the file can't be mapped or is not a valid bundle.
+		bool Open(const char* path);
+
+		void Close();
+
+		bool IsOpen() const { return m_pData != nullptr; }
+		const std::string& GetPath() const { return m_path; }
+
+		bool Contains(std::string_view name) const { return m_chunks.find(name) != m_chunks.end(); }
+		size_t GetChunkCount() const { return m_chunks.size(); }
+
+		/// Pushes the chunk as a function like `luaL_loadfile`.
+		/// \return The status of `lua_load`, `LUA_ERRFILE` with a message when the bundle has no such chunk.
+		int Load(lua_State* pState, std::string_view name) const;
+
+		/// Inserts a searcher for this bundle into `package.searchers`, Right after the `package.preload` searcher.
+		/// \return False when the package library is not open.
+		/// \devnote The bundle must outlive the state.
+		bool InstallSearcher(lua_State* pState);
+
+	private:
+
+		bool ReadIndex();
+
+		/// `package.searchers` entry, The bundle is the upvalue.
+		static int Search(lua_State* pState);
+	};
+
+	/// \class LuaBundleWriter
+	/// \brief Builds a LuaBundle or a LuaEmbeddedScripts translation unit from sources, Optionally compiling them to bytecode.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaBundleWriter writer;
+	/// writer.AddDirectory("scripts", true);
+	/// writer.Write("scripts.bundle");
+	/// ~~~~~
+	class LuaBundleWriter
+	{
+		struct Chunk
+		{
+			std::string name;
+			std::string chunkName;
+			std::string data;
+			bool isBytecode;
+		};
+
+		std::vector<Chunk> m_chunks;
+		lua_State* m_pCompiler;
+		bool m_isStripping;
+		std::string m_error;
+
+	public:
+		/// \param isStripping Strips debug information from compiled chunks.
+		explicit LuaBundleWriter(bool isStripping = false);
+		~LuaBundleWriter();
+
+		LuaBundleWriter(const LuaBundleWriter&) = delete;
+		LuaBundleWriter& operator=(const LuaBundleWriter&) = delete;
+
+		/// Adds a chunk under a module name, e.g. "ui.button".
+		/// \param isCompiling Stores bytecode instead of source, Fails when the code does not compile.
+		bool Add(const std::string& name, const std::string& code, bool isCompiling, const std::string& chunkName = std::string());
+
+		/// Adds a file, The chunk name is the path like `luaL_loadfile` would use.
+		/// A UTF-8 BOM and a first line starting with '#' are skipped like `luaL_loadfile` does.
+		bool AddFile(const std::string& path, const std::string& name, bool isCompiling);
+
+		/// Adds every `.lua` file below the directory, "ui/button.lua" becomes "ui.button" and "ui/init.lua" becomes "ui".
+		bool AddDirectory(const std::string& directory, bool isCompiling);
+
+		bool Write(const char* path);
+
+		/// Writes the chunks as constexpr byte arrays in a C++ translation unit defining `extern const lpp::LuaEmbeddedScripts <symbol>`, See LuaEmbeddedScripts.
+		/// The file is left untouched when its content would not change so builds stay incremental.
+		bool WriteEmbedded(const char* path, const std::string& symbol);
+
+		size_t GetChunkCount() const { return m_chunks.size(); }
+
+		/// The module name `require` uses for a script path relative to the script root, "ui/button.lua" becomes "ui.button".
+		static std::string GetModuleName(const std::string& relativePath);
+
+		/// The error of the last call that failed.
+		const std::string& GetError() const { return m_error; }
+	};
+}
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "LuaBytecodeCache.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include <LuaLoader.h>
+
+namespace lpp
+{
+	namespace fs = std::filesystem;
+
+	namespace
+	{
+		constexpr char kEntryMagic[4] = { 'L', 'P', 'P', 'C' };
+		constexpr uint32_t kEntryVersion = 1;
+		constexpr const char* kEntryExtension = ".luac";
+
+		struct EntryHeader
+		{
+			char magic[4];
+			uint32_t version;
+			int64_t modifiedTime;
+			uint64_t sourceSize;
+			uint64_t sourceHash;
+			uint64_t bytecodeSize;
+		};
+
+		double GetMicros(std::chrono::steady_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	LuaBytecodeCache::LuaBytecodeCache(const std::string& directory, bool isStripping)
+		: m_directory(directory)
+		, m_isStripping(isStripping)
+	{
+		std::error_code error;
+		fs::create_directories(m_directory, error);
+	}
+
+	int LuaBytecodeCache::Load(lua_State* pState, const char* fileName)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		std::error_code error;
+		const fs::file_time_type time = fs::last_write_time(fileName, error);
+		const uintmax_t size = error ? 0 : fs::file_size(fileName, error);
+
+		if (error)
+		{
+			lua_pushfstring(pState, "cannot open %s", fileName);
+			return LUA_ERRFILE;
+		}
+
+		const int64_t modifiedTime = static_cast<int64_t>(time.time_since_epoch().count());
+		const std::string entryPath = GetEntryPath(fileName);
+
+		std::string source;
+		bool isSourceRead = false;
+
+		std::string entry;
+		if (LuaLoader::ReadFile(entryPath, entry) && entry.size() >= sizeof(EntryHeader))
+		{
+			EntryHeader header;
+			std::memcpy(&header, entry.data(), sizeof(EntryHeader));
+
+			bool isValid = std::memcmp(header.magic, kEntryMagic, sizeof(kEntryMagic)) == 0
+				&& header.version == kEntryVersion
+				&& header.sourceSize == size
+				&& header.bytecodeSize == entry.size() - sizeof(EntryHeader);
+
+			// Only the time changed, e.g. after a checkout. The entry is still good when the content is the same.
+			if (isValid && header.modifiedTime != modifiedTime)
+			{
+				isSourceRead = LuaLoader::ReadFile(fileName, source);
+				isValid = isSourceRead && Hash(source.data(), source.size()) == header.sourceHash;
+
+				if (isValid)
+					Touch(entryPath, modifiedTime);
+			}
+
+			if (isValid)
+			{
+				const std::string chunkName = std::string("@") + fileName;
+				if (luaL_loadbufferx(pState, entry.data() + sizeof(EntryHeader), header.bytecodeSize, chunkName.c_str(), "b") == LUA_OK)
+				{
+					++m_stats.hitCount;
+					m_stats.hitMicros += GetMicros(start);
+					return LUA_OK;
+				}
+
+				// Bytecode of another lua version, Compile it again.
+				lua_pop(pState, 1);
+			}
+		}
+
+		if (!isSourceRead && !LuaLoader::ReadFile(fileName, source))
+		{
+			lua_pushfstring(pState, "cannot read %s", fileName);
+			return LUA_ERRFILE;
+		}
+
+		int result = Compile(pState, fileName, entryPath, source, modifiedTime);
+
+		++m_stats.missCount;
+		m_stats.missMicros += GetMicros(start);
+		return result;
+	}
+
+	int LuaBytecodeCache::Compile(lua_State* pState, const char* fileName, const std::string& entryPath, const std::string& source, int64_t modifiedTime)
+	{
+		const std::string_view code = LuaLoader::SkipHeader(source);
+		const std::string chunkName = std::string("@") + fileName;
+		int result = luaL_loadbufferx(pState, code.data(), code.size(), chunkName.c_str(), "t");
+		if (result != LUA_OK)
+			return result;
+
+		std::string bytecode;
+		lua_dump(pState, &LuaLoader::WriteBytecode, &bytecode, m_isStripping ? 1 : 0);
+
+		EntryHeader header;
+		std::memcpy(header.magic, kEntryMagic, sizeof(kEntryMagic));
+		header.version = kEntryVersion;
+		header.modifiedTime = modifiedTime;
+		header.sourceSize = source.size();
+		header.sourceHash = Hash(source.data(), source.size());
+		header.bytecodeSize = bytecode.size();
+
+		// Written next to the entry and renamed, So a crash never leaves a half written entry behind.
+		const std::string tempPath = entryPath + ".tmp";
+
+		std::FILE* pFile = std::fopen(tempPath.c_str(), "wb");
+		bool isWritten = pFile != nullptr;
+
+		if (pFile)
+		{
+			isWritten = std::fwrite(&header, sizeof(EntryHeader), 1, pFile) == 1
+				&& std::fwrite(bytecode.data(), 1, bytecode.size(), pFile) == bytecode.size();
+			isWritten = std::fclose(pFile) == 0 && isWritten;
+		}
+
+		std::error_code error;
+		if (isWritten)
+			fs::rename(tempPath, entryPath, error);
+
+		if (!isWritten || error)
+		{
+			//DEBUG_LOG("Could not write bytecode cache entry: %s", entryPath.c_str());
+			fs::remove(tempPath, error);
+			++m_stats.writeErrorCount;
+		}
+		else
+		{
+			++m_stats.writeCount;
+		}
+
+		return LUA_OK;
+	}
+
+	void LuaBytecodeCache::Touch(const std::string& entryPath, int64_t modifiedTime)
+	{
+		std::FILE* pFile = std::fopen(entryPath.c_str(), "r+b");
+		if (!pFile)
+			return;
+
+		std::fseek(pFile, offsetof(EntryHeader, modifiedTime), SEEK_SET);
+		std::fwrite(&modifiedTime, sizeof(modifiedTime), 1, pFile);
+		std::fclose(pFile);
+	}
+
+	void LuaBytecodeCache::Clear()
+	{
+		std::error_code error;
+		for (const fs::directory_entry& file : fs::directory_iterator(m_directory, error))
+		{
+			if (file.path().extension() == kEntryExtension)
+				fs::remove(file.path(), error);
+		}
+	}
+
+	std::string LuaBytecodeCache::GetEntryPath(const char* fileName) const
+	{
+		// The same script reached through different relative paths shares its entry.
+		std::error_code error;
+		std::string path = fs::absolute(fileName, error).lexically_normal().string();
+		if (error)
+			path = fileName;
+
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(Hash(path.data(), path.size())));
+
+		return (fs::path(m_directory) / (std::string(name) + kEntryExtension)).string();
+	}
+
+	uint64_t LuaBytecodeCache::Hash(const char* pData, size_t size)
+	{
+		uint64_t hash = 14695981039346656037ull;
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= static_cast<unsigned char>(pData[i]);
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <lua.hpp>
+
+namespace lpp
+{
+	/// Counters of a LuaBytecodeCache.
+	struct LuaBytecodeCacheStats
+	{
+		size_t hitCount = 0;			///< Scripts loaded from the cache.
+		size_t missCount = 0;			///< Scripts compiled from source.
+		size_t writeCount = 0;			///< Entries written.
+		size_t writeErrorCount = 0;		///< Entries that could not be written.
+		double hitMicros = 0.0;			///< Total time loading scripts from the cache.
+		double missMicros = 0.0;		///< Total time compiling scripts and writing their entries.
+	};
+
+	/// \class LuaBytecodeCache
+	/// \brief Persistent on-disk cache of compiled scripts used by LuaState::LoadScript().
+	///
+	/// Each script gets one entry in the cache directory holding its modification time, size, a hash of its source and the `lua_dump` output.
+	/// An entry is used as is when the modification time and size match, When only the time changed the source is hashed
+	/// and the entry is still used if the content is the same. Anything else recompiles the script and rewrites the entry.
+	/// Bytecode of another lua version is rejected by `lua_load` and recompiled as well.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaBytecodeCache cache("cache/scripts");
+	/// state.SetBytecodeCache(&cache);
+	/// state.LoadScript("scripts/main.lua");
+	/// ~~~~~
+	/// \devnote Stripped bytecode has no debug information, Errors then have no line numbers.
+	class LuaBytecodeCache
+	{
+		std::string m_directory;
+		bool m_isStripping;
+		LuaBytecodeCacheStats m_stats;
+
+	public:
+		/// \param directory Created when it does not exist.
+		/// \param isStripping Strips debug information from the stored bytecode.
+		explicit LuaBytecodeCache(const std::string& directory, bool isStripping = false);
+
+		/// Loads the script as a function on top of the stack like `luaL_loadfile`, Using the cached bytecode when the entry is valid.
+		/// \return The status of the load, `LUA_ERRFILE` when the script can't be read.
+		int Load(lua_State* pState, const char* fileName);
+
+		/// Removes every entry from the cache directory.
+		void Clear();
+
+		const std::string& GetDirectory() const { return m_directory; }
+		bool IsStripping() const { return m_isStripping; }
+
+		const LuaBytecodeCacheStats& GetStats() const { return m_stats; }
+
+		/// FNV-1a hash, Used for the entry names and the content of the scripts.
+		static uint64_t Hash(const char* pData, size_t size);
+
+	private:
+
+		std::string GetEntryPath(const char* fileName) const;
+
+		/// Compiles the source, Pushing the function or the error, And writes the entry on success.
+		int Compile(lua_State* pState, const char* fileName, const std::string& entryPath, const std::string& source, int64_t modifiedTime);
+
+		/// Rewrites the header of a valid entry after the modification time of the script changed.
+		void Touch(const std::string& entryPath, int64_t modifiedTime);
+	};
+}
\ No newline at end of file
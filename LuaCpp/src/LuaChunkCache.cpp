@@ -0,0 +1,107 @@
+#include "LuaChunkCache.h"
+
+#include <functional>
+
+#include <LuaState.h>
+
+#define L m_pState->GetState()
+
+namespace lpp
+{
+	LuaChunkCache::LuaChunkCache(LuaState* pState, size_t maxCount, size_t maxBytes)
+		: m_pState(pState)
+		, m_maxCount(maxCount)
+		, m_maxBytes(maxBytes)
+		, m_bytes(0)
+		, m_hitCount(0)
+		, m_missCount(0)
+		, m_evictionCount(0)
+	{}
+
+	int LuaChunkCache::Push(std::string_view code, const char* chunkName)
+	{
+		const std::string_view name = chunkName ? std::string_view(chunkName) : std::string_view();
+		const size_t hash = std::hash<std::string_view>()(code) ^ (std::hash<std::string_view>()(name) << 1);
+
+		auto range = m_index.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			ChunkList::iterator chunk = it->second;
+			if (chunk->code != code || chunk->chunkName != name)
+				continue;
+
+			// Move to the front of the LRU list.
+			m_chunks.splice(m_chunks.begin(), m_chunks, chunk);
+			++m_hitCount;
+
+			lua_rawgeti(L, LUA_REGISTRYINDEX, chunk->ref);			// [func]
+			return LUA_OK;
+		}
+
+		++m_missCount;
+
+		Chunk chunk{ hash, LUA_NOREF, std::string(code), std::string(name) };
+
+		// Like luaL_loadstring the code is the chunk name when there is none.
+		const char* pChunkName = chunkName ? chunkName : chunk.code.c_str();
+
+		int result = luaL_loadbufferx(L, chunk.code.data(), chunk.code.size(), pChunkName, "t");	// [func]
+		if (result != LUA_OK)
+			return result;
+
+		lua_pushvalue(L, -1);									// [func, func]
+		chunk.ref = luaL_ref(L, LUA_REGISTRYINDEX);				// [func]
+
+		m_bytes += GetSize(chunk);
+		m_chunks.push_front(std::move(chunk));
+		m_index.emplace(hash, m_chunks.begin());
+
+		Evict();
+		return LUA_OK;
+	}
+
+	void LuaChunkCache::Clear()
+	{
+		for (const Chunk& chunk : m_chunks)
+			luaL_unref(L, LUA_REGISTRYINDEX, chunk.ref);
+
+		m_chunks.clear();
+		m_index.clear();
+		m_bytes = 0;
+	}
+
+	void LuaChunkCache::SetLimits(size_t maxCount, size_t maxBytes)
+	{
+		m_maxCount = maxCount;
+		m_maxBytes = maxBytes;
+		Evict();
+	}
+
+	void LuaChunkCache::Evict()
+	{
+		// The newest chunk stays even when it is larger than the byte limit by itself.
+		while (m_chunks.size() > 1
+			&& ((m_maxCount > 0 && m_chunks.size() > m_maxCount) || (m_maxBytes > 0 && m_bytes > m_maxBytes)))
+		{
+			Remove(std::prev(m_chunks.end()));
+			++m_evictionCount;
+		}
+	}
+
+	void LuaChunkCache::Remove(ChunkList::iterator chunk)
+	{
+		auto range = m_index.equal_range(chunk->hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second == chunk)
+			{
+				m_index.erase(it);
+				break;
+			}
+		}
+
+		luaL_unref(L, LUA_REGISTRYINDEX, chunk->ref);
+		m_bytes -= GetSize(*chunk);
+		m_chunks.erase(chunk);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <lua.hpp>
+
+namespace lpp
+{
+	class LuaState;
+
+	/// \class LuaChunkCache
+	/// \brief Keeps compiled chunks of source code in the registry so running the same code again skips the parser.
+	///
+	/// Chunks are looked up by a hash of their code and chunk name, A hit is a single `lua_rawgeti`.
+	/// The least recently used chunks are unreferenced once the cache holds more than `maxCount` chunks or `maxBytes` bytes of source.
+	/// Code that fails to compile is not cached. Used by LuaState::Execute() and LuaState::LoadScript(code, chunkName).
+	///
+	/// \devnote Like LuaThreadPool the cache never touches the lua state in its destructor, `lua_close` releases the references.
+	class LuaChunkCache
+	{
+	public:
+		static constexpr size_t kDefaultMaxCount = 256;
+		static constexpr size_t kDefaultMaxBytes = 1024 * 1024;
+
+	private:
+		struct Chunk
+		{
+			size_t hash;
+			int ref;
+			std::string code;
+			std::string chunkName;
+		};
+
+		using ChunkList = std::list<Chunk>;
+
+		LuaState* m_pState;
+
+		// Most recently used first.
+		ChunkList m_chunks;
+		std::unordered_multimap<size_t, ChunkList::iterator> m_index;
+
+		size_t m_maxCount;
+		size_t m_maxBytes;
+		size_t m_bytes;
+
+		size_t m_hitCount;
+		size_t m_missCount;
+		size_t m_evictionCount;
+
+	public:
+		explicit LuaChunkCache(LuaState* pState, size_t maxCount = kDefaultMaxCount, size_t maxBytes = kDefaultMaxBytes);
+
+		LuaChunkCache(const LuaChunkCache&) = delete;
+		LuaChunkCache& operator=(const LuaChunkCache&) = delete;
+
+		/// Pushes the compiled function of the code, Compiling and caching it when it is not cached yet.
+		/// \param chunkName Name used in error messages like `luaL_loadbuffer`, nullptr uses the code itself.
+		/// \return `LUA_OK` or the error of `lua_load`, In which case the error message is pushed instead.
+		int Push(std::string_view code, const char* chunkName = nullptr);
+
+		/// Unreferences every cached chunk.
+		void Clear();
+
+		/// Sets the limits and evicts chunks until the cache fits. Zero means no limit.
+		void SetLimits(size_t maxCount, size_t maxBytes);
+
+		size_t GetCount() const { return m_chunks.size(); }
+		size_t GetBytes() const { return m_bytes; }
+
+		size_t GetHitCount() const { return m_hitCount; }
+		size_t GetMissCount() const { return m_missCount; }
+		size_t GetEvictionCount() const { return m_evictionCount; }
+
+	private:
+
+		/// Removes the least recently used chunks until the limits are met.
+		void Evict();
+
+		void Remove(ChunkList::iterator it);
+
+		static size_t GetSize(const Chunk& chunk) { return chunk.code.size() + chunk.chunkName.size(); }
+	};
+}
\ No newline at end of file
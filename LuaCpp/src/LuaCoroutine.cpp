@@ -0,0 +1,163 @@
+#include "LuaCoroutine.h"
+
+#include <LuaBudget.h>
+#include <LuaVar.h>
+
+namespace lpp
+{
+
+#pragma region Initialization / Construction
+
+	LuaCoroutine::LuaCoroutine()
+		: m_pState(nullptr)
+		, m_status(LuaCoroutineStatus::Dead)
+		, m_resultCount(0)
+	{}
+
+	LuaCoroutine::LuaCoroutine(LuaState* pState, const LuaVar& function)
+		: m_pState(pState)
+		, m_thread(pState->GetThreadPool().Acquire())
+		, m_status(LuaCoroutineStatus::Dead)
+		, m_resultCount(0)
+	{
+		Reset(function);
+	}
+
+	LuaCoroutine::LuaCoroutine(LuaCoroutine&& other) noexcept
+		: m_pState(other.m_pState)
+		, m_thread(std::exchange(other.m_thread, LuaThread()))
+		, m_status(std::exchange(other.m_status, LuaCoroutineStatus::Dead))
+		, m_resultCount(std::exchange(other.m_resultCount, 0))
+		, m_error(std::move(other.m_error))
+	{}
+
+	LuaCoroutine& LuaCoroutine::operator=(LuaCoroutine&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Release();
+
+			m_pState = other.m_pState;
+			m_thread = std::exchange(other.m_thread, LuaThread());
+			m_status = std::exchange(other.m_status, LuaCoroutineStatus::Dead);
+			m_resultCount = std::exchange(other.m_resultCount, 0);
+			m_error = std::move(other.m_error);
+		}
+
+		return *this;
+	}
+
+	LuaCoroutine::~LuaCoroutine()
+	{
+		Release();
+	}
+
+	void LuaCoroutine::Release()
+	{
+		if (m_pState && m_thread.IsValid())
+		{
+			m_pState->GetPendingQueue().Cancel(m_thread.pThread);
+			m_pState->GetThreadPool().Release(m_thread);
+		}
+
+		m_thread = LuaThread();
+	}
+
+#pragma endregion
+
+	bool LuaCoroutine::Reset(const LuaVar& function)
+	{
+		if (!m_pState || m_status == LuaCoroutineStatus::Running)
+			return false;
+
+		if (!m_thread.IsValid())
+			m_thread = m_pState->GetThreadPool().Acquire();
+
+		lua_State* T = m_thread.pThread;
+
+		m_pState->GetPendingQueue().Cancel(T);
+
+		// Dead threads can't be resumed again, Resetting them makes them reusable.
+		if (lua_status(T) != LUA_OK || lua_gettop(T) != 0)
+			ResetThread(T, m_pState->GetState());
+
+		m_resultCount = 0;
+		m_error.clear();
+
+		if (!function.PushToStack(T) || !lua_isfunction(T, -1))	// [func]
+		{
+			lua_settop(T, 0);									// []
+			m_status = LuaCoroutineStatus::Dead;
+			return false;
+		}
+
+		m_status = LuaCoroutineStatus::Suspended;
+		return true;
+	}
+
+	bool LuaCoroutine::IsWaiting() const
+	{
+		return m_pState && m_thread.IsValid() && m_pState->GetPendingQueue().IsWaiting(m_thread.pThread);
+	}
+
+	bool LuaCoroutine::BeginResume()
+	{
+		if (!IsSuspended())
+			return false;
+
+		// The continuation of the bound function pushes the results once the pending result completed.
+		LuaPendingQueue& pendingQueue = m_pState->GetPendingQueue();
+		if (pendingQueue.IsWaiting(m_thread.pThread) && !pendingQueue.IsReady(m_thread.pThread))
+			return false;
+
+		// The values of the previous yield have to be removed before resuming.
+		lua_pop(m_thread.pThread, m_resultCount);
+		m_resultCount = 0;
+
+		return true;
+	}
+
+	bool LuaCoroutine::FinishResume(int argCount)
+	{
+		lua_State* T = m_thread.pThread;
+
+		m_status = LuaCoroutineStatus::Running;
+
+		// A budget running out inside the coroutine yields it instead of raising an error.
+		// The profiler samples the coroutine while it runs.
+		if (LuaBudget* pBudget = m_pState->GetBudget())
+			pBudget->Apply(T, true);
+		else if (m_pState->GetTracer() || m_pState->GetProfiler())
+			m_pState->UpdateHook(T);
+
+		lua_State* pResumer = m_pState->GetRunningThread();
+		m_pState->SetRunningThread(T);
+
+		int resultCount = 0;
+		int result = lua_resume(T, m_pState->GetState(), argCount, &resultCount);
+
+		m_pState->SetRunningThread(pResumer);
+
+		switch (result)
+		{
+		case LUA_YIELD:
+			m_status = LuaCoroutineStatus::Suspended;
+			m_resultCount = resultCount;
+			return true;
+		case LUA_OK:
+			m_status = LuaCoroutineStatus::Dead;
+			m_resultCount = resultCount;
+			return true;
+		default:
+		{
+			const char* msg = lua_tostring(T, -1);
+			m_error = msg ? msg : "Unknown coroutine error.";
+			m_status = LuaCoroutineStatus::Error;
+			m_resultCount = 0;
+			//DEBUG_LOG("Coroutine error: %s", m_error.c_str());
+			return false;
+		}
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <lua.hpp>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <LuaState.h>
+#include <LuaStack.h>
+#include <LuaThreadPool.h>
+
+namespace lpp
+{
+	class LuaVar;
+
+	template<typename Type>
+	class LuaYieldRange;
+
+	enum class LuaCoroutineStatus
+	{
+		Suspended,	///< Not started yet or yielded, Resume() continues the function.
+		Running,	///< Currently executing.
+		Dead,		///< The function returned.
+		Error,		///< The function raised an error, See LuaCoroutine::GetError().
+	};
+
+	/// \class LuaCoroutine
+	/// \brief Drives a Lua function as a coroutine straight from C++ using `lua_resume`.
+	///
+	/// Unlike calling `coroutine.resume` through LuaVar::Call no result table is built, Yielded values stay on the stack of the coroutine
+	/// until the next Resume() and are read in place using GetResult().
+	/// The thread is taken from the LuaThreadPool of the state and returned to it on destruction, So short lived coroutines are cheap.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaCoroutine behaviour(&state, LuaVar(&state, "Patrol"));
+	/// while (behaviour.Resume(deltaTime) && behaviour.IsSuspended())
+	///		float wait = behaviour.GetResult<float>();
+	/// ~~~~~
+	class LuaCoroutine
+	{
+		LuaState* m_pState;
+		LuaThread m_thread;
+		LuaCoroutineStatus m_status;
+		int m_resultCount;
+		std::string m_error;
+
+	public:
+
+		/// Creates an empty coroutine, Reset() must be called before it can be resumed.
+		LuaCoroutine();
+
+		/// Creates a coroutine running the function.
+		LuaCoroutine(LuaState* pState, const LuaVar& function);
+
+		LuaCoroutine(const LuaCoroutine&) = delete;
+		LuaCoroutine& operator=(const LuaCoroutine&) = delete;
+		LuaCoroutine(LuaCoroutine&&) noexcept;
+		LuaCoroutine& operator=(LuaCoroutine&&) noexcept;
+
+		/// Returns the thread to the pool of the state.
+		~LuaCoroutine();
+
+		/// Starts over with a new function, Reusing the thread even if the coroutine died with an error.
+		/// \return False if the LuaVar is not a function.
+		bool Reset(const LuaVar& function);
+
+		/// Resumes the coroutine, The arguments are passed to the function on the first resume and returned from `coroutine.yield` afterwards.
+		/// \return False if the coroutine could not be resumed or raised an error.
+		template<typename... Args>
+		bool Resume(Args&&... args);
+
+		LuaCoroutineStatus GetStatus() const { return m_status; }
+
+		/// Whether Resume() can continue the coroutine.
+		bool IsSuspended() const { return m_status == LuaCoroutineStatus::Suspended && m_thread.IsValid(); }
+
+		/// Whether the coroutine is suspended on a LuaPending result of a bound function.
+		/// Resume() fails until the pending result completes, Resuming afterwards returns the results to the script and ignores the arguments.
+		bool IsWaiting() const;
+
+		/// Whether the function returned or raised an error.
+		bool IsDead() const { return m_status == LuaCoroutineStatus::Dead || m_status == LuaCoroutineStatus::Error; }
+
+		/// The error message if the status is LuaCoroutineStatus::Error.
+		const std::string& GetError() const { return m_error; }
+
+		/// Amount of values yielded or returned by the last Resume().
+		int GetResultCount() const { return m_resultCount; }
+
+		/// Parse a value yielded or returned by the last Resume(), Indices start at 1.
+		template<typename Type>
+		Type GetResult(int index = 1) const;
+
+		/// Parse the first sizeof...(Types) values yielded or returned by the last Resume().
+		template<typename... Types>
+		std::tuple<Types...> GetResults() const;
+
+		/// Iterate the values yielded by the coroutine, Every step resumes it without arguments.
+		/// \code for (int value : coroutine.Yields<int>()) \endcode
+		template<typename Type>
+		LuaYieldRange<Type> Yields();
+
+		/// The thread the coroutine runs on.
+		lua_State* GetThread() const { return m_thread.pThread; }
+
+	private:
+
+		/// Pops the previous results and checks whether the coroutine can be resumed.
+		bool BeginResume();
+
+		/// Resumes the thread with the arguments on top of its stack and updates the status.
+		bool FinishResume(int argCount);
+
+		void Release();
+
+		template<typename... Types, size_t... Indices>
+		std::tuple<Types...> GetResults(std::index_sequence<Indices...>) const;
+	};
+
+	/// Input iterator resuming a coroutine on every increment, Ends when the coroutine returns or fails.
+	template<typename Type>
+	class LuaYieldIterator
+	{
+		LuaCoroutine* m_pCoroutine;
+		Type m_value;
+
+	public:
+		/// Also serves as the End iterator.
+		LuaYieldIterator() : m_pCoroutine(nullptr), m_value() {}
+		explicit LuaYieldIterator(LuaCoroutine* pCoroutine) : m_pCoroutine(pCoroutine), m_value() { ++(*this); }
+
+		LuaYieldIterator& operator++()
+		{
+			if (!m_pCoroutine->Resume() || !m_pCoroutine->IsSuspended())
+			{
+				m_pCoroutine = nullptr;
+				return *this;
+			}
+
+			m_value = m_pCoroutine->template GetResult<Type>();
+			return *this;
+		}
+
+		const Type& operator*() const { return m_value; }
+		const Type* operator->() const { return &m_value; }
+
+		bool operator==(const LuaYieldIterator& other) const { return m_pCoroutine == other.m_pCoroutine; }
+		bool operator!=(const LuaYieldIterator& other) const { return !(*this == other); }
+	};
+
+	template<typename Type>
+	class LuaYieldRange
+	{
+		LuaCoroutine* m_pCoroutine;
+
+	public:
+		explicit LuaYieldRange(LuaCoroutine* pCoroutine) : m_pCoroutine(pCoroutine) {}
+
+		LuaYieldIterator<Type> begin() { return LuaYieldIterator<Type>(m_pCoroutine); }
+		LuaYieldIterator<Type> end() { return LuaYieldIterator<Type>(); }
+	};
+
+#pragma region Template Definitions
+
+	template<typename... Args>
+	inline bool LuaCoroutine::Resume(Args&&... args)
+	{
+		if (!BeginResume())
+			return false;
+
+		// C++ 17 Fold Expression on the ',' operator.
+		((void)LuaStack::Push<Args>(m_thread.pThread, std::forward<Args>(args)), ...);
+
+		return FinishResume(sizeof...(Args));
+	}
+
+	template<typename Type>
+	inline Type LuaCoroutine::GetResult(int index) const
+	{
+		if (index < 1 || index > m_resultCount)
+			return Type();
+
+		const int stackIndex = lua_gettop(m_thread.pThread) - m_resultCount + index;
+		return LuaStack::Get<Type>(m_thread.pThread, stackIndex);
+	}
+
+	template<typename... Types>
+	inline std::tuple<Types...> LuaCoroutine::GetResults() const
+	{
+		return GetResults<Types...>(std::index_sequence_for<Types...>());
+	}
+
+	template<typename... Types, size_t... Indices>
+	inline std::tuple<Types...> LuaCoroutine::GetResults(std::index_sequence<Indices...>) const
+	{
+		return std::tuple<Types...>(GetResult<Types>(static_cast<int>(Indices) + 1)...);
+	}
+
+	template<typename Type>
+	inline LuaYieldRange<Type> LuaCoroutine::Yields()
+	{
+		return LuaYieldRange<Type>(this);
+	}
+
+#pragma endregion
+
+}
\ No newline at end of file
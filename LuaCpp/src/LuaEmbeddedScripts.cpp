@@ -0,0 +1,67 @@
+#include "LuaEmbeddedScripts.h"
+
+#include <algorithm>
+#include <string>
+
+#include <LuaLoader.h>
+
+namespace lpp
+{
+	namespace
+	{
+		int LoadChunk(lua_State* pState, const LuaEmbeddedChunk& chunk)
+		{
+			return luaL_loadbufferx(pState, reinterpret_cast<const char*>(chunk.pData), chunk.size, chunk.chunkName, chunk.isBytecode ? "b" : "t");
+		}
+	}
+
+	const LuaEmbeddedChunk* LuaEmbeddedScripts::Find(std::string_view name) const
+	{
+		const LuaEmbeddedChunk* pEnd = pChunks + count;
+		const LuaEmbeddedChunk* pChunk = std::lower_bound(pChunks, pEnd, name, [](const LuaEmbeddedChunk& chunk, std::string_view name)
+		{
+			return std::string_view(chunk.name) < name;
+		});
+
+		return (pChunk != pEnd && pChunk->name == name) ? pChunk : nullptr;
+	}
+
+	int LuaEmbeddedScripts::Load(lua_State* pState, std::string_view name) const
+	{
+		const LuaEmbeddedChunk* pChunk = Find(name);
+		if (!pChunk)
+		{
+			lua_pushfstring(pState, "no embedded chunk '%s'", std::string(name).c_str());
+			return LUA_ERRFILE;
+		}
+
+		return LoadChunk(pState, *pChunk);
+	}
+
+	bool LuaEmbeddedScripts::InstallSearcher(lua_State* pState) const
+	{
+		// The scripts are constant, The searcher never writes through the pointer.
+		return LuaLoader::InsertSearcher(pState, &LuaEmbeddedScripts::Search, const_cast<LuaEmbeddedScripts*>(this));
+	}
+
+	int LuaEmbeddedScripts::Search(lua_State* pState)
+	{
+		const LuaEmbeddedScripts* pScripts = static_cast<const LuaEmbeddedScripts*>(lua_touserdata(pState, lua_upvalueindex(1)));
+
+		size_t length = 0;
+		const char* name = luaL_checklstring(pState, 1, &length);
+
+		const LuaEmbeddedChunk* pChunk = pScripts->Find(std::string_view(name, length));
+		if (!pChunk)
+		{
+			lua_pushfstring(pState, "no embedded module '%s'", name);
+			return 1;
+		}
+
+		if (LoadChunk(pState, *pChunk) != LUA_OK)
+			return luaL_error(pState, "error loading embedded module '%s':\n\t%s", name, lua_tostring(pState, -1));
+
+		lua_pushstring(pState, pChunk->chunkName);
+		return 2;
+	}
+}
\ No newline at end of file
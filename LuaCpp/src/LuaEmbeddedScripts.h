@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include <lua.hpp>
+
+namespace lpp
+{
+	/// A chunk compiled into the executable by LuaCppEmbed.
+	struct LuaEmbeddedChunk
+	{
+		const char* name;
+		const char* chunkName;
+		const unsigned char* pData;
+		size_t size;
+		bool isBytecode;
+	};
+
+	/// \class LuaEmbeddedScripts
+	/// \brief The index of chunks in a translation unit generated by the LuaCppEmbed tool, Sorted by module name.
+	///
+	/// The generated data is constant initialized, Registering it with LuaState::MountScripts() costs a single `package.searchers` entry
+	/// and `require` loads the chunks from the executable image without any file I/O.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// -- premake5.lua
+	/// embedscripts("scripts", "kGameScripts")
+	///
+	/// // C++
+	/// extern const lpp::LuaEmbeddedScripts kGameScripts;
+	/// state.MountScripts(kGameScripts);
+	/// ~~~~~
+	struct LuaEmbeddedScripts
+	{
+		const LuaEmbeddedChunk* pChunks;
+		size_t count;
+
+		/// \return The chunk of the module or nullptr.
+		const LuaEmbeddedChunk* Find(std::string_view name) const;
+
+		bool Contains(std::string_view name) const { return Find(name) != nullptr; }
+
+		/// Pushes the chunk as a function like `luaL_loadfile`.
+		/// \return The status of `lua_load`, `LUA_ERRFILE` with a message when there is no such chunk.
+		int Load(lua_State* pState, std::string_view name) const;
+
+		/// Inserts a searcher for the chunks into `package.searchers`, Right after the `package.preload` searcher.
+		/// \return False when the package library is not open.
+		bool InstallSearcher(lua_State* pState) const;
+
+		/// `package.searchers` entry, The scripts are the upvalue.
+		static int Search(lua_State* pState);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdio>
+#include <exception>
+#include <type_traits>
+
+#include <lua.hpp>
+
+/// \file LuaExceptions.h
+/// Translates C++ exceptions thrown by bound functions into lua errors.
+///
+/// Lua raises errors either with longjmp (compiled as C, the default) or by throwing (compiled as C++, `--lua-errors=exceptions`
+/// defines LUACPP_LUA_EXCEPTIONS). In both modes a C++ exception must not reach the lua frames, longjmp mode can't unwind them at all
+/// and in exception mode lua would swallow it as an unknown error. Every binding wrapper therefore catches and re-raises with lua_error.
+
+namespace lpp
+{
+	/// Maximum length of the error message generated from an exception, Longer messages are truncated.
+	constexpr size_t kMaxExceptionMessageLength = 256;
+
+	/// Checks if a function or member function pointer type is marked `noexcept`.
+	template<typename Function>
+	struct is_noexcept_function : std::false_type {};
+
+	template<typename ReturnType, typename... Args>
+	struct is_noexcept_function<ReturnType(*)(Args...) noexcept> : std::true_type {};
+
+	template<typename Object, typename ReturnType, typename... Args>
+	struct is_noexcept_function<ReturnType(Object::*)(Args...) noexcept> : std::true_type {};
+
+	template<typename Object, typename ReturnType, typename... Args>
+	struct is_noexcept_function<ReturnType(Object::*)(Args...) const noexcept> : std::true_type {};
+
+	template<typename Function>
+	constexpr bool is_noexcept_function_v = is_noexcept_function<Function>::value;
+
+	/// Writes "exception in 'name': what" into the buffer, The name is looked up from the call info so successful calls never pay for it.
+	inline void FormatExceptionMessage(lua_State* pState, char(&message)[kMaxExceptionMessageLength], const char* what)
+	{
+		lua_Debug info;
+		const char* name = "?";
+
+		if (lua_getstack(pState, 0, &info) && lua_getinfo(pState, "n", &info) && info.name)
+			name = info.name;
+
+		std::snprintf(message, kMaxExceptionMessageLength, "exception in '%s': %s", name, what);
+	}
+
+	/// Calls the binding and turns an escaping exception into a lua error.
+	/// \tparam IsNoexcept When the bound function can't throw the call is made without a try block.
+	/// \return The result of the call, The amount of values pushed.
+	template<bool IsNoexcept, typename Call>
+	inline int CallWithExceptionBoundary(lua_State* pState, Call&& call)
+	{
+		if constexpr (IsNoexcept)
+		{
+			return call();
+		}
+		else
+		{
+			char message[kMaxExceptionMessageLength];
+
+			try
+			{
+				return call();
+			}
+			catch (const std::exception& e)
+			{
+				FormatExceptionMessage(pState, message, e.what());
+			}
+#if !defined(LUACPP_LUA_EXCEPTIONS)
+			// In exception mode lua errors and yields are thrown too, Those have to pass through untouched.
+			catch (...)
+			{
+				FormatExceptionMessage(pState, message, "unknown exception");
+			}
+#endif
+
+			// Raised after leaving the handler, A longjmp out of it would leak the exception object.
+			return luaL_error(pState, "%s", message);
+		}
+	}
+}
\ No newline at end of file
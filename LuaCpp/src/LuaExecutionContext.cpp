@@ -0,0 +1,64 @@
+#include "LuaExecutionContext.h"
+
+#include <utility>
+
+namespace lpp
+{
+	LuaExecutionContext::LuaExecutionContext(LuaState* pState)
+		: m_pState(pState)
+		, m_thread(pState->GetThreadPool().Acquire())
+	{}
+
+	LuaExecutionContext::~LuaExecutionContext()
+	{
+		Release();
+	}
+
+	LuaExecutionContext::LuaExecutionContext(LuaExecutionContext&& other) noexcept
+		: m_pState(other.m_pState)
+		, m_thread(std::exchange(other.m_thread, LuaThread()))
+	{}
+
+	LuaExecutionContext& LuaExecutionContext::operator=(LuaExecutionContext&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Release();
+			m_pState = other.m_pState;
+			m_thread = std::exchange(other.m_thread, LuaThread());
+		}
+
+		return *this;
+	}
+
+	bool LuaExecutionContext::Execute(std::string_view code, const char* chunkName)
+	{
+		lua_State* pMain = m_pState->GetState();
+
+		// The cache pushes onto the main thread, The function moves over to run on the stack of the context.
+		if (m_pState->GetChunkCache().Push(code, chunkName) != LUA_OK)
+		{
+			//DEBUG_LOG("%s", lua_tostring(pMain, -1));
+			lua_pop(pMain, 1);
+			return false;
+		}
+
+		lua_xmove(pMain, m_thread.pThread, 1);										// [func]
+
+		if (lua_pcall(m_thread.pThread, 0, 0, 0) != LUA_OK)
+		{
+			LUACPP_STATS(m_pState->GetStats().OnCallFailed();)
+			//DEBUG_LOG("%s", lua_tostring(m_thread.pThread, -1));
+			lua_pop(m_thread.pThread, 1);
+			return false;
+		}
+
+		return true;
+	}
+
+	void LuaExecutionContext::Release()
+	{
+		if (m_thread.IsValid())
+			m_pState->GetThreadPool().Release(std::exchange(m_thread, LuaThread()));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string_view>
+
+#include <LuaVar.h>
+
+namespace lpp
+{
+	/// \class LuaExecutionContext
+	/// \brief A request-scoped Lua thread taken from the LuaThreadPool of a state, With its own stack.
+	///
+	/// Requests sharing one state each get their own stack while sharing the globals, The compiled code and the bindings,
+	/// Instead of paying for a whole LuaState per request. The thread goes back to the pool when the context is destroyed.
+	/// LuaVar and LuaVar::Call() take the thread as their context to run on its stack.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaExecutionContext context(&state);
+	/// LuaVar handlers = context.GetGlobal("handlers");
+	/// LuaVar response = handlers.Call(context.GetState(), "onRequest", path);
+	/// ~~~~~
+	///
+	/// \devnote Only destroying a LuaVar using the context is safe after the context is destroyed, The thread may run another request by then.
+	class LuaExecutionContext
+	{
+		LuaState* m_pState;
+		LuaThread m_thread;
+
+	public:
+		/// Acquires a thread from the pool of the state.
+		explicit LuaExecutionContext(LuaState* pState);
+
+		/// Resets the thread and releases it to the pool.
+		~LuaExecutionContext();
+
+		LuaExecutionContext(const LuaExecutionContext&) = delete;
+		LuaExecutionContext& operator=(const LuaExecutionContext&) = delete;
+
+		LuaExecutionContext(LuaExecutionContext&& other) noexcept;
+		LuaExecutionContext& operator=(LuaExecutionContext&& other) noexcept;
+
+		/// The thread of the context, Pass it to LuaVar and LuaVar::Call().
+		lua_State* GetState() const { return m_thread.pThread; }
+
+		LuaState* GetOwner() const { return m_pState; }
+
+		/// References a global using the stack of the context.
+		LuaVar GetGlobal(const char* globalName) const { return LuaVar(m_pState, m_thread.pThread, globalName); }
+
+		/// Runs code through the chunk cache of the state on the stack of the context.
+		/// \return Wether the code compiled and ran without errors
+		bool Execute(std::string_view code, const char* chunkName = nullptr);
+
+	private:
+
+		void Release();
+	};
+}
\ No newline at end of file
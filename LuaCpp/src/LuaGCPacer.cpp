@@ -0,0 +1,157 @@
+#include "LuaGCPacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace lpp
+{
+	// Weight of the newest frame in the smoothed allocation rate and step time.
+	constexpr double kSmoothing = 0.25;
+
+	constexpr int kMinStepKB = 1;
+	constexpr int kMaxStepKB = 64 * 1024;
+	constexpr int kInitialStepKB = 16;
+
+	// A single step aims for this fraction of the budget so several steps fit in a frame.
+	constexpr double kStepBudgetFraction = 0.25;
+
+#pragma region LuaPauseHistogram
+
+	void LuaPauseHistogram::Record(double micros)
+	{
+		size_t bucket = 0;
+		if (micros >= 1.0)
+			bucket = std::min(static_cast<size_t>(std::log2(micros)) + 1, kBucketCount - 1);
+
+		++buckets[bucket];
+		++count;
+		totalMicros += micros;
+		maxMicros = std::max(maxMicros, micros);
+	}
+
+	double LuaPauseHistogram::GetPercentile(double percentile) const
+	{
+		if (count == 0)
+			return 0.0;
+
+		const double threshold = percentile * count;
+		uint64_t seen = 0;
+
+		for (size_t i = 0; i < kBucketCount; ++i)
+		{
+			seen += buckets[i];
+			if (seen >= threshold)
+				return std::ldexp(1.0, static_cast<int>(i));
+		}
+
+		return maxMicros;
+	}
+
+#pragma endregion
+
+#pragma region Initialization / Construction
+
+	LuaGCPacer::LuaGCPacer(LuaState* pState, double budgetMicros, double headroom)
+		: m_pState(pState)
+		, m_budgetMicros(budgetMicros)
+		, m_headroom(headroom)
+		, m_stepKB(kInitialStepKB)
+		, m_stepMicros(0.0)
+		, m_lastTotalAllocated(0)
+		, m_liveBytes(0)
+		, m_allocationRate(0.0)
+		, m_cycleCount(0)
+		, m_wasTracking(pState->IsTrackingAllocations())
+		, m_wasRunning(pState->IsGCRunning())
+		, m_previousMode(pState->SetIncrementalGC())
+	{
+		m_pState->SetGCRunning(false);
+		m_pState->SetAllocationTracking(true);
+
+		m_lastTotalAllocated = m_pState->GetTotalAllocatedBytes();
+		m_liveBytes = m_pState->GetHeapBytes();
+	}
+
+	LuaGCPacer::~LuaGCPacer()
+	{
+		// Zero parameters keep the ones the generational mode had before.
+		if (m_previousMode == LuaGCMode::Generational)
+			m_pState->SetGenerationalGC();
+
+		m_pState->SetAllocationTracking(m_wasTracking);
+		m_pState->SetGCRunning(m_wasRunning);
+	}
+
+#pragma endregion
+
+	double LuaGCPacer::Frame(double deltaSeconds)
+	{
+		const size_t totalAllocated = m_pState->GetTotalAllocatedBytes();
+		const size_t allocated = totalAllocated - m_lastTotalAllocated;
+		m_lastTotalAllocated = totalAllocated;
+
+		if (deltaSeconds > 0.0)
+		{
+			const double rate = allocated / deltaSeconds;
+			m_allocationRate += (rate - m_allocationRate) * kSmoothing;
+		}
+
+		// Zero at the live size, One at the target.
+		const size_t heapBytes = m_pState->GetHeapBytes();
+		const double headroomBytes = std::max(1.0, m_liveBytes * m_headroom);
+		const double pressure = heapBytes > m_liveBytes ? (heapBytes - m_liveBytes) / headroomBytes : 0.0;
+
+		// Keep up with this frame's allocations, Up to three times faster when the heap nears the target.
+		// Past the target the whole budget is used.
+		const bool isOverTarget = pressure >= 1.0;
+		double workKB = allocated / 1024.0 * (1.0 + 2.0 * pressure);
+
+		if (workKB <= 0.0 && !isOverTarget)
+			return 0.0;
+
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point start = Clock::now();
+
+		double elapsedMicros = 0.0;
+		size_t stepCount = 0;
+
+		// Don't start a step that is expected to overrun the budget, Except the first one when the heap is over the target.
+		while (elapsedMicros + m_stepMicros <= m_budgetMicros || (stepCount == 0 && isOverTarget))
+		{
+			if (!isOverTarget && workKB <= 0.0)
+				break;
+
+			const Clock::time_point stepStart = Clock::now();
+			const bool isCycleFinished = lua_gc(m_pState->GetState(), LUA_GCSTEP, m_stepKB) != 0;
+			const Clock::time_point stepEnd = Clock::now();
+
+			++stepCount;
+			workKB -= m_stepKB;
+			elapsedMicros = std::chrono::duration<double, std::micro>(stepEnd - start).count();
+
+			// Aim the next steps at a fraction of the budget.
+			const double stepMicros = std::chrono::duration<double, std::micro>(stepEnd - stepStart).count();
+			m_stepMicros = m_stepMicros > 0.0 ? m_stepMicros + (stepMicros - m_stepMicros) * kSmoothing : stepMicros;
+
+			const double stepTarget = m_budgetMicros * kStepBudgetFraction;
+			if (stepMicros > 0.0)
+			{
+				const double scale = std::clamp(stepTarget / stepMicros, 0.5, 2.0);
+				m_stepKB = std::clamp(static_cast<int>(m_stepKB * scale), kMinStepKB, kMaxStepKB);
+			}
+
+			if (isCycleFinished)
+			{
+				m_liveBytes = m_pState->GetHeapBytes();
+				++m_cycleCount;
+				break;
+			}
+		}
+
+		if (stepCount > 0)
+			m_histogram.Record(elapsedMicros);
+
+		return elapsedMicros;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <LuaState.h>
+
+namespace lpp
+{
+	/// Histogram of pause times with power of two buckets in microseconds, Bucket `i` counts pauses below `2^i` microseconds.
+	struct LuaPauseHistogram
+	{
+		static constexpr size_t kBucketCount = 24;
+
+		uint64_t buckets[kBucketCount] = {};
+		uint64_t count = 0;
+		double totalMicros = 0.0;
+		double maxMicros = 0.0;
+
+		void Record(double micros);
+
+		/// Upper bound of the bucket holding the percentile, e.g. 0.99.
+		double GetPercentile(double percentile) const;
+
+		double GetAverage() const { return count > 0 ? totalMicros / count : 0.0; }
+	};
+
+	/// \class LuaGCPacer
+	/// \brief Opt-in pacer running the incremental collector in a per-frame time budget.
+	///
+	/// While the pacer exists the automatic collector of the state is stopped, So collection work only happens in Frame().
+	/// Each frame it measures the allocation rate through the allocation tracking of the state and picks how much work to do,
+	/// The closer the heap gets to `live * (1 + headroom)` the more of the budget it uses. The size of a single step adapts
+	/// to the measured step time so a step never starts when it would overrun the budget.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaGCPacer pacer(&state, 500.0, 0.5);
+	///
+	/// while (running)
+	/// {
+	///		UpdateScripts();
+	///		pacer.Frame(deltaSeconds);
+	/// }
+	/// ~~~~~
+	/// \devnote The atomic phase of a cycle is a single step, With large gray sets or weak tables it can still exceed the budget,
+	/// But it happens inside Frame() and never in the middle of script execution.
+	class LuaGCPacer
+	{
+	public:
+		static constexpr double kDefaultBudgetMicros = 1000.0;
+		static constexpr double kDefaultHeadroom = 0.5;
+
+	private:
+		LuaState* m_pState;
+
+		double m_budgetMicros;
+		double m_headroom;
+
+		int m_stepKB;
+		double m_stepMicros;
+
+		size_t m_lastTotalAllocated;
+		size_t m_liveBytes;
+		double m_allocationRate;
+		size_t m_cycleCount;
+
+		bool m_wasTracking;
+		bool m_wasRunning;
+		LuaGCMode m_previousMode;
+
+		LuaPauseHistogram m_histogram;
+
+	public:
+		/// Stops the automatic collector, Switches to incremental mode and enables allocation tracking.
+		/// \param budgetMicros Maximum time spent collecting per Frame().
+		/// \param headroom Heap growth over the live size the pacer aims to stay below, 0.5 means 50%.
+		explicit LuaGCPacer(LuaState* pState, double budgetMicros = kDefaultBudgetMicros, double headroom = kDefaultHeadroom);
+
+		/// Restores the collector mode, The automatic collector and allocation tracking as they were.
+		~LuaGCPacer();
+
+		LuaGCPacer(const LuaGCPacer&) = delete;
+		LuaGCPacer& operator=(const LuaGCPacer&) = delete;
+
+		/// Runs collection work for this frame within the budget.
+		/// \param deltaSeconds Time since the last frame, Used for the allocation rate.
+		/// \return The time spent collecting in microseconds.
+		double Frame(double deltaSeconds);
+
+		void SetBudget(double budgetMicros) { m_budgetMicros = budgetMicros; }
+		double GetBudget() const { return m_budgetMicros; }
+
+		void SetHeadroom(double headroom) { m_headroom = headroom; }
+		double GetHeadroom() const { return m_headroom; }
+
+		/// Bytes allocated per second, Smoothed over the last frames.
+		double GetAllocationRate() const { return m_allocationRate; }
+
+		/// Heap size after the last finished cycle.
+		size_t GetLiveBytes() const { return m_liveBytes; }
+
+		/// Heap size the pacer tries to stay below.
+		size_t GetTargetBytes() const { return static_cast<size_t>(m_liveBytes * (1.0 + m_headroom)); }
+
+		/// Current size of a step in KB, As passed to `lua_gc(LUA_GCSTEP)`.
+		int GetStepSize() const { return m_stepKB; }
+
+		/// Cycles finished by the pacer.
+		size_t GetCycleCount() const { return m_cycleCount; }
+
+		/// Time spent collecting per Frame() that did any work.
+		const LuaPauseHistogram& GetPauseHistogram() const { return m_histogram; }
+	};
+}
\ No newline at end of file
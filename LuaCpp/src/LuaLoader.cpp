@@ -0,0 +1,75 @@
+#include "LuaLoader.h"
+
+#include <cstdio>
+
+namespace lpp
+{
+	bool LuaLoader::InsertSearcher(lua_State* pState, lua_CFunction search, void* pUpvalue)
+	{
+		lua_getglobal(pState, "package");										// [package]
+		if (!lua_istable(pState, -1))
+		{
+			lua_pop(pState, 1);
+			return false;
+		}
+
+		lua_getfield(pState, -1, "searchers");									// [package, searchers]
+
+		// Shift every searcher after the preload searcher up by one.
+		lua_Integer count = static_cast<lua_Integer>(luaL_len(pState, -1));
+		for (lua_Integer i = count; i >= 2; --i)
+		{
+			lua_rawgeti(pState, -1, i);											// [package, searchers, searcher]
+			lua_rawseti(pState, -2, i + 1);										// [package, searchers]
+		}
+
+		lua_pushlightuserdata(pState, pUpvalue);								// [package, searchers, upvalue]
+		lua_pushcclosure(pState, search, 1);									// [package, searchers, search]
+		lua_rawseti(pState, -2, 2);												// [package, searchers]
+		lua_pop(pState, 2);														// []
+		return true;
+	}
+
+	bool LuaLoader::ReadFile(const std::string& path, std::string& data)
+	{
+		std::FILE* pFile = std::fopen(path.c_str(), "rb");
+		if (!pFile)
+			return false;
+
+		std::fseek(pFile, 0, SEEK_END);
+		long size = std::ftell(pFile);
+		std::fseek(pFile, 0, SEEK_SET);
+
+		if (size < 0)
+		{
+			std::fclose(pFile);
+			return false;
+		}
+
+		data.resize(static_cast<size_t>(size));
+		size_t read = std::fread(&data[0], 1, data.size(), pFile);
+		std::fclose(pFile);
+
+		return read == data.size();
+	}
+
+	std::string_view LuaLoader::SkipHeader(std::string_view source)
+	{
+		if (source.substr(0, 3) == "\xEF\xBB\xBF")
+			source.remove_prefix(3);
+
+		if (!source.empty() && source[0] == '#')
+		{
+			const size_t newline = source.find('\n');
+			source.remove_prefix(newline != std::string_view::npos ? newline : source.size());
+		}
+
+		return source;
+	}
+
+	int LuaLoader::WriteBytecode(lua_State*, const void* pData, size_t size, void* pUserData)
+	{
+		static_cast<std::string*>(pUserData)->append(static_cast<const char*>(pData), size);
+		return 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <lua.hpp>
+
+namespace lpp
+{
+	/// \class LuaLoader
+	/// \brief Helpers shared by the ways LuaCpp loads scripts, So bundles, Embedded scripts and the caches load them alike.
+	class LuaLoader
+	{
+	public:
+		/// Inserts a `package.searchers` entry right after the `package.preload` searcher, So later searchers override earlier ones.
+		/// \param pUpvalue Passed to the searcher as its only upvalue, A light userdata.
+		/// \return False when the package library is not open.
+		static bool InsertSearcher(lua_State* pState, lua_CFunction search, void* pUpvalue);
+
+		/// Reads a whole file in binary mode.
+		/// \return False when the file can't be opened or read completely.
+		static bool ReadFile(const std::string& path, std::string& data);
+
+		/// The code of a script file without a UTF-8 BOM and a first line starting with '#', Like `luaL_loadfile` skips them.
+		/// The newline of that line stays so line numbers match.
+		static std::string_view SkipHeader(std::string_view source);
+
+		/// `lua_Writer` for `lua_dump` appending the bytecode to the std::string passed as the user data.
+		static int WriteBytecode(lua_State* pState, const void* pData, size_t size, void* pUserData);
+	};
+}
\ No newline at end of file
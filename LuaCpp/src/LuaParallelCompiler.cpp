@@ -0,0 +1,312 @@
+#include "LuaParallelCompiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+
+#include <LuaBundle.h>
+#include <LuaLoader.h>
+#include <LuaState.h>
+
+namespace lpp
+{
+	namespace fs = std::filesystem;
+
+	namespace
+	{
+		bool IsIdentifier(char c)
+		{
+			return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+		}
+	}
+
+	LuaParallelCompiler::LuaParallelCompiler(size_t workerCount, bool isStripping)
+		: m_workerCount(workerCount > 0 ? workerCount : std::max<size_t>(1, std::thread::hardware_concurrency()))
+		, m_isStripping(isStripping)
+		, m_compileMicros(0.0)
+	{}
+
+	void LuaParallelCompiler::AddFile(const std::string& path, const std::string& name)
+	{
+		LuaCompiledScript script;
+		script.name = name;
+		script.chunkName = "@" + path;
+		script.path = path;
+		m_scripts.push_back(std::move(script));
+	}
+
+	void LuaParallelCompiler::AddSource(const std::string& name, const std::string& code, const std::string& chunkName)
+	{
+		LuaCompiledScript script;
+		script.name = name;
+		script.chunkName = chunkName.empty() ? "=" + name : chunkName;
+		script.source = code;
+		m_scripts.push_back(std::move(script));
+	}
+
+	bool LuaParallelCompiler::AddDirectory(const std::string& directory)
+	{
+		std::error_code error;
+		for (const fs::directory_entry& file : fs::recursive_directory_iterator(directory, error))
+		{
+			if (file.is_regular_file() && file.path().extension() == ".lua")
+				AddFile(file.path().generic_string(), LuaBundleWriter::GetModuleName(file.path().lexically_relative(directory).generic_string()));
+		}
+
+		if (error)
+		{
+			m_error = directory + ": " + error.message();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool LuaParallelCompiler::Compile()
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		std::atomic<size_t> next(0);
+		auto work = [this, &next]()
+		{
+			lua_State* pCompiler = luaL_newstate();
+
+			for (size_t i = next++; i < m_scripts.size(); i = next++)
+			{
+				if (m_scripts[i].bytecode.empty())
+					CompileScript(pCompiler, m_scripts[i]);
+			}
+
+			lua_close(pCompiler);
+		};
+
+		// The calling thread is one of the workers.
+		std::vector<std::thread> workers;
+		const size_t workerCount = std::min(m_workerCount, std::max<size_t>(1, m_scripts.size()));
+		for (size_t i = 1; i < workerCount; ++i)
+			workers.emplace_back(work);
+
+		work();
+
+		for (std::thread& worker : workers)
+			worker.join();
+
+		m_compileMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		m_error.clear();
+		for (const LuaCompiledScript& script : m_scripts)
+		{
+			if (!script.error.empty())
+				m_error += (m_error.empty() ? "" : "\n") + script.error;
+		}
+
+		return m_error.empty();
+	}
+
+	void LuaParallelCompiler::CompileScript(lua_State* pCompiler, LuaCompiledScript& script) const
+	{
+		script.error.clear();
+
+		if (!script.path.empty() && script.source.empty() && !LuaLoader::ReadFile(script.path, script.source))
+		{
+			script.error = "cannot open " + script.path;
+			return;
+		}
+
+		FindDependencies(script);
+
+		const std::string_view code = LuaLoader::SkipHeader(script.source);
+		if (luaL_loadbufferx(pCompiler, code.data(), code.size(), script.chunkName.c_str(), "t") != LUA_OK)
+		{
+			script.error = lua_tostring(pCompiler, -1);
+			lua_pop(pCompiler, 1);
+			return;
+		}
+
+		lua_dump(pCompiler, &LuaLoader::WriteBytecode, &script.bytecode, m_isStripping ? 1 : 0);
+		lua_pop(pCompiler, 1);
+
+		std::string().swap(script.source);
+	}
+
+	void LuaParallelCompiler::FindDependencies(LuaCompiledScript& script)
+	{
+		static constexpr char kRequire[] = "require";
+		static constexpr size_t kRequireLength = sizeof(kRequire) - 1;
+
+		script.dependencies.clear();
+
+		const std::string& source = script.source;
+		for (size_t position = source.find(kRequire); position != std::string::npos; position = source.find(kRequire, position + 1))
+		{
+			// Skip names like `prerequire` or `require_all`.
+			if ((position > 0 && IsIdentifier(source[position - 1])) || IsIdentifier(source[position + kRequireLength]))
+				continue;
+
+			size_t i = position + kRequireLength;
+			while (i < source.size() && std::isspace(static_cast<unsigned char>(source[i])))
+				++i;
+
+			if (i < source.size() && source[i] == '(')
+			{
+				++i;
+				while (i < source.size() && std::isspace(static_cast<unsigned char>(source[i])))
+					++i;
+			}
+
+			if (i >= source.size() || (source[i] != '"' && source[i] != '\''))
+				continue;
+
+			const size_t end = source.find(source[i], i + 1);
+			if (end == std::string::npos)
+				break;
+
+			std::string name = source.substr(i + 1, end - i - 1);
+			if (std::find(script.dependencies.begin(), script.dependencies.end(), name) == script.dependencies.end())
+				script.dependencies.push_back(std::move(name));
+		}
+	}
+
+	std::vector<size_t> LuaParallelCompiler::GetLoadOrder() const
+	{
+		std::unordered_map<std::string, size_t> indices;
+		for (size_t i = 0; i < m_scripts.size(); ++i)
+			indices.emplace(m_scripts[i].name, i);
+
+		enum class Mark { None, Visiting, Done };
+		std::vector<Mark> marks(m_scripts.size(), Mark::None);
+
+		std::vector<size_t> order;
+		order.reserve(m_scripts.size());
+
+		// Depth first with an explicit stack, Corpora can have long require chains.
+		std::vector<std::pair<size_t, size_t>> stack;
+		for (size_t root = 0; root < m_scripts.size(); ++root)
+		{
+			if (marks[root] != Mark::None)
+				continue;
+
+			marks[root] = Mark::Visiting;
+			stack.emplace_back(root, 0);
+
+			while (!stack.empty())
+			{
+				auto& [index, dependency] = stack.back();
+				const std::vector<std::string>& dependencies = m_scripts[index].dependencies;
+
+				if (dependency == dependencies.size())
+				{
+					marks[index] = Mark::Done;
+					order.push_back(index);
+					stack.pop_back();
+					continue;
+				}
+
+				auto it = indices.find(dependencies[dependency++]);
+
+				// Modules outside the corpus are left to require, A module in a cycle runs before the one requiring it last.
+				if (it != indices.end() && marks[it->second] == Mark::None)
+				{
+					marks[it->second] = Mark::Visiting;
+					stack.emplace_back(it->second, 0);
+				}
+			}
+		}
+
+		return order;
+	}
+
+	bool LuaParallelCompiler::Load(LuaState& state, std::string& error) const
+	{
+		if (m_scripts.empty())
+			return true;
+
+		lua_State* L = state.GetState();
+
+		lua_getglobal(L, "package");													// [package]
+		if (!lua_istable(L, -1))
+		{
+			lua_pop(L, 1);
+			error = "the package library is not open";
+			return false;
+		}
+
+		lua_getfield(L, -1, "loaded");												// [package, loaded]
+
+		for (size_t index : GetLoadOrder())
+		{
+			const LuaCompiledScript& script = m_scripts[index];
+			if (script.bytecode.empty())
+				continue;
+
+			if (lua_getfield(L, -1, script.name.c_str()) != LUA_TNIL && lua_toboolean(L, -1))
+			{
+				lua_pop(L, 1);
+				continue;
+			}
+			lua_pop(L, 1);															// [package, loaded]
+
+			// Called like a loader of require, With the module name and the chunk name.
+			int result = luaL_loadbufferx(L, script.bytecode.data(), script.bytecode.size(), script.chunkName.c_str(), "b");
+			if (result == LUA_OK)
+			{
+				lua_pushstring(L, script.name.c_str());
+				lua_pushstring(L, script.chunkName.c_str());							// [package, loaded, func, name, chunkName]
+				result = lua_pcall(L, 2, 1, 0);										// [package, loaded, module]
+			}
+
+			if (result != LUA_OK)
+			{
+				const char* pMessage = lua_tostring(L, -1);
+				error = script.name + ": " + (pMessage ? pMessage : "error object is not a string");
+				lua_pop(L, 3);
+				return false;
+			}
+
+			// A module returning nothing may have set its own package.loaded entry.
+			if (lua_isnil(L, -1))
+			{
+				lua_pop(L, 1);
+				if (lua_getfield(L, -1, script.name.c_str()) == LUA_TNIL)
+				{
+					lua_pop(L, 1);
+					lua_pushboolean(L, 1);
+				}
+			}
+
+			lua_setfield(L, -2, script.name.c_str());								// [package, loaded]
+		}
+
+		lua_pop(L, 2);																// []
+		return true;
+	}
+
+	bool LuaParallelCompiler::Run(LuaState& state, std::string& error) const
+	{
+		lua_State* L = state.GetState();
+
+		for (const LuaCompiledScript& script : m_scripts)
+		{
+			if (script.bytecode.empty())
+				continue;
+
+			int result = luaL_loadbufferx(L, script.bytecode.data(), script.bytecode.size(), script.chunkName.c_str(), "b");
+			if (result == LUA_OK)
+				result = lua_pcall(L, 0, 0, 0);
+
+			if (result != LUA_OK)
+			{
+				const char* pMessage = lua_tostring(L, -1);
+				error = script.name + ": " + (pMessage ? pMessage : "error object is not a string");
+				lua_pop(L, 1);
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <lua.hpp>
+
+namespace lpp
+{
+	class LuaState;
+
+	/// A script compiled by LuaParallelCompiler.
+	struct LuaCompiledScript
+	{
+		/// The module name, Stored in `package.loaded` by LuaParallelCompiler::Load().
+		std::string name;
+		std::string chunkName;
+
+		/// Empty when the script is added from memory.
+		std::string path;
+
+		/// The code, Released once compiled.
+		std::string source;
+
+		std::string bytecode;
+
+		/// Modules passed to `require` with a constant name, Found by scanning the source.
+		std::vector<std::string> dependencies;
+
+		/// Why the script could not be read or compiled, Empty on success.
+		std::string error;
+	};
+
+	/// \class LuaParallelCompiler
+	/// \brief Reads and compiles a corpus of scripts on worker threads, Then runs the bytecode in a LuaState in dependency order.
+	///
+	/// Every worker owns a scratch `lua_State` and takes scripts off a shared counter, So compile time scales with the core count.
+	/// Dependencies come from scanning the source for `require "name"` and `require("name")` with a constant name.
+	/// Load() runs every module after the modules it requires and stores its result in `package.loaded`, Like `require` would.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaParallelCompiler compiler;
+	/// compiler.AddDirectory("scripts");
+	/// if (!compiler.Compile() || !compiler.Load(state))
+	///		printf("%s\n", compiler.GetError().c_str());
+	/// ~~~~~
+	class LuaParallelCompiler
+	{
+		std::vector<LuaCompiledScript> m_scripts;
+
+		size_t m_workerCount;
+		bool m_isStripping;
+
+		double m_compileMicros;
+		std::string m_error;
+
+	public:
+		/// \param workerCount Zero uses one worker per hardware thread.
+		/// \param isStripping Strips debug information from the bytecode.
+		explicit LuaParallelCompiler(size_t workerCount = 0, bool isStripping = false);
+
+		/// Adds a script file, It is read by a worker during Compile().
+		void AddFile(const std::string& path, const std::string& name);
+
+		/// Adds a script from memory.
+		void AddSource(const std::string& name, const std::string& code, const std::string& chunkName = std::string());
+
+		/// Adds every `.lua` file below the directory with the module names of LuaBundleWriter::GetModuleName().
+		bool AddDirectory(const std::string& directory);
+
+		/// Compiles every script that has no bytecode yet.
+		/// \return False when any script failed, See GetError() and LuaCompiledScript::error.
+		bool Compile();
+
+		/// Runs the compiled modules in dependency order, Skipping modules already in `package.loaded`.
+		/// Cyclic dependencies are run in the order the scripts were added.
+		/// \return False when a module raised an error, Modules run before it stay loaded.
+		bool Load(LuaState& state) { return Load(state, m_error); }
+
+		/// Load() leaving the compiler untouched, Several threads may load the same compiler into their own states at once.
+		bool Load(LuaState& state, std::string& error) const;
+
+		/// Runs every compiled script once in the order they were added, Like LuaState::LoadScript() without touching `package.loaded`.
+		/// \return False when a script raised an error, Scripts after it are not run.
+		bool Run(LuaState& state) { return Run(state, m_error); }
+
+		/// Run() leaving the compiler untouched, Several threads may run the same compiler on their own states at once.
+		bool Run(LuaState& state, std::string& error) const;
+
+		/// Indices into GetScripts() with every module after its dependencies.
+		std::vector<size_t> GetLoadOrder() const;
+
+		const std::vector<LuaCompiledScript>& GetScripts() const { return m_scripts; }
+		size_t GetWorkerCount() const { return m_workerCount; }
+
+		/// The wall clock time of the last Compile().
+		double GetCompileMicros() const { return m_compileMicros; }
+
+		/// The error of the last call that failed.
+		const std::string& GetError() const { return m_error; }
+
+	private:
+
+		/// Reads, Scans and compiles a single script on a worker.
+		void CompileScript(lua_State* pCompiler, LuaCompiledScript& script) const;
+
+		static void FindDependencies(LuaCompiledScript& script);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <LuaPendingQueue.h>
+#include <LuaStack.h>
+
+namespace lpp
+{
+	/// Slot storing the typed results of a LuaPending until the coroutine is resumed.
+	template<typename... Rets>
+	class LuaPendingValues : public LuaPendingSlot
+	{
+		std::tuple<std::decay_t<Rets>...> m_values;
+
+	public:
+		template<typename... Values>
+		void Resolve(Values&&... values)
+		{
+			{
+				std::unique_lock<std::mutex> lock = Lock();
+				if (!IsWaitingLocked())
+					return;
+
+				m_values = std::tuple<std::decay_t<Rets>...>(std::forward<Values>(values)...);
+			}
+
+			Complete(State::Resolved);
+		}
+
+	protected:
+		int PushResults(lua_State* pState) override
+		{
+			std::apply([pState](auto&... values) { ((void)LuaStack::Push(pState, values), ...); }, m_values);
+			return static_cast<int>(sizeof...(Rets));
+		}
+	};
+
+	/// \class LuaPending
+	/// \brief The result of a bound C++ function that completes later, e.g. an asset fetch or a timer.
+	///
+	/// A member function bound with LuaVar::BindMemberFunction may return a LuaPending instead of a value.
+	/// The calling coroutine is then suspended with `lua_yieldk` and the Lua script continues once Resolve() or Reject() is called,
+	/// Receiving the resolved values as the return values of the call. Resolve() and Reject() may be called from any thread.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// lpp::LuaPending<std::string> AssetLoader::Fetch(std::string path)
+	/// {
+	///		lpp::LuaPending<std::string> pending;
+	///		m_requests.push_back({ path, pending });
+	///		return pending;
+	/// }
+	///
+	/// -- Lua, inside a coroutine
+	/// local data = loader:fetch("level.json")
+	/// ~~~~~
+	template<typename... Rets>
+	class LuaPending
+	{
+		std::shared_ptr<LuaPendingValues<Rets...>> m_pSlot;
+
+	public:
+		LuaPending() : m_pSlot(std::make_shared<LuaPendingValues<Rets...>>()) {}
+
+		/// Completes the pending result, The values are returned to Lua when the coroutine resumes.
+		template<typename... Values>
+		void Resolve(Values&&... values) const
+		{
+			static_assert(sizeof...(Values) == sizeof...(Rets), "LuaPending::Resolve expects a value for every result type.");
+			m_pSlot->Resolve(std::forward<Values>(values)...);
+		}
+
+		/// Completes the pending result with an error raised inside the coroutine.
+		void Reject(std::string error) const { m_pSlot->Reject(std::move(error)); }
+
+		bool IsDone() const { return m_pSlot->IsDone(); }
+
+		std::shared_ptr<LuaPendingSlot> GetSlot() const { return m_pSlot; }
+	};
+
+	/// Checks if the type is a LuaPending.
+	template<typename T>
+	struct is_lua_pending : std::false_type {};
+
+	template<typename... Rets>
+	struct is_lua_pending<LuaPending<Rets...>> : std::true_type {};
+
+	template<typename T>
+	constexpr bool is_lua_pending_v = is_lua_pending<std::decay_t<T>>::value;
+}
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "LuaPendingQueue.h"
+
+#include <LuaState.h>
+
+namespace lpp
+{
+
+#pragma region LuaPendingSlot
+
+	LuaPendingSlot::State LuaPendingSlot::GetState() const
+	{
+		std::unique_lock<std::mutex> lock = Lock();
+		return m_state;
+	}
+
+	void LuaPendingSlot::Reject(std::string error)
+	{
+		std::unique_lock<std::mutex> lock = Lock();
+
+		// A late rejection must not replace the error of a slot that was already completed.
+		if (m_state != State::Waiting)
+			return;
+
+		m_error = std::move(error);
+		CompleteLocked(State::Rejected);
+	}
+
+	void LuaPendingSlot::Complete(State state)
+	{
+		std::unique_lock<std::mutex> lock = Lock();
+		CompleteLocked(state);
+	}
+
+	void LuaPendingSlot::CompleteLocked(State state)
+	{
+		// Only the first completion counts.
+		if (m_state != State::Waiting)
+			return;
+
+		m_state = state;
+
+		// Notified under the lock, The queue detaches its slots under the same lock before it is destroyed.
+		if (m_pQueue)
+			m_pQueue->NotifyReady(shared_from_this());
+	}
+
+	int LuaPendingSlot::Yield(lua_State* pState, std::shared_ptr<LuaPendingSlot> pSlot)
+	{
+		if (!pSlot->IsDone())
+		{
+			if (!lua_isyieldable(pState))
+			{
+				// Release before raising, lua_error does not unwind C++ frames when lua is compiled as C.
+				pSlot.reset();
+				return luaL_error(pState, "A pending result can only be awaited inside a coroutine.");
+			}
+
+			LuaPendingSlot* pRawSlot = pSlot.get();
+			if (LuaState::FromState(pState)->GetPendingQueue().Wait(pState, pSlot))
+			{
+				// The queue keeps the slot alive while the coroutine is suspended.
+				pSlot.reset();
+				return lua_yieldk(pState, 0, reinterpret_cast<lua_KContext>(pRawSlot), &LuaPendingSlot::Continue);
+			}
+		}
+
+		// Completed before we could yield, Return the results right away.
+		if (pSlot->GetState() == State::Rejected)
+		{
+			lua_pushstring(pState, pSlot->m_error.c_str());
+			pSlot.reset();
+			return lua_error(pState);
+		}
+
+		return pSlot->PushResults(pState);
+	}
+
+	int LuaPendingSlot::Continue(lua_State* pState, int, lua_KContext context)
+	{
+		LuaPendingSlot* pRawSlot = reinterpret_cast<LuaPendingSlot*>(context);
+
+		// Resumed before completion (e.g. by `coroutine.resume` from Lua), Keep waiting.
+		if (!pRawSlot->IsDone())
+			return lua_yieldk(pState, 0, context, &LuaPendingSlot::Continue);
+
+		std::shared_ptr<LuaPendingSlot> pSlot = LuaState::FromState(pState)->GetPendingQueue().Take(pState);
+		if (pSlot.get() != pRawSlot)
+			return 0;
+
+		if (pSlot->GetState() == State::Rejected)
+		{
+			lua_pushstring(pState, pSlot->m_error.c_str());
+			pSlot.reset();
+			return lua_error(pState);
+		}
+
+		return pSlot->PushResults(pState);
+	}
+
+#pragma endregion
+
+#pragma region LuaPendingQueue
+
+	LuaPendingQueue::~LuaPendingQueue()
+	{
+		// Detach the slots so late completions do not touch a destroyed queue.
+		for (auto& [pThread, pSlot] : m_waiting)
+		{
+			std::unique_lock<std::mutex> lock = pSlot->Lock();
+			pSlot->m_pQueue = nullptr;
+		}
+	}
+
+	bool LuaPendingQueue::Wait(lua_State* pThread, const std::shared_ptr<LuaPendingSlot>& pSlot)
+	{
+		{
+			std::unique_lock<std::mutex> lock = pSlot->Lock();
+			if (pSlot->m_state != LuaPendingSlot::State::Waiting)
+				return false;
+
+			pSlot->m_pThread = pThread;
+			pSlot->m_pQueue = this;
+		}
+
+		m_waiting[pThread] = pSlot;
+		return true;
+	}
+
+	void LuaPendingQueue::Cancel(lua_State* pThread)
+	{
+		auto it = m_waiting.find(pThread);
+		if (it == m_waiting.end())
+			return;
+
+		{
+			std::unique_lock<std::mutex> lock = it->second->Lock();
+			it->second->m_pQueue = nullptr;
+		}
+
+		m_waiting.erase(it);
+	}
+
+	bool LuaPendingQueue::IsWaiting(lua_State* pThread) const
+	{
+		return m_waiting.find(pThread) != m_waiting.end();
+	}
+
+	bool LuaPendingQueue::IsReady(lua_State* pThread) const
+	{
+		auto it = m_waiting.find(pThread);
+		return it != m_waiting.end() && it->second->IsDone();
+	}
+
+	size_t LuaPendingQueue::PopReady(std::vector<lua_State*>& threads)
+	{
+		std::vector<std::shared_ptr<LuaPendingSlot>> ready;
+
+		{
+			std::unique_lock<std::mutex> lock(m_readyMutex);
+			ready.swap(m_ready);
+		}
+
+		size_t count = 0;
+		for (const std::shared_ptr<LuaPendingSlot>& pSlot : ready)
+		{
+			// Skip slots whose coroutine was cancelled or is waiting on something else by now.
+			auto it = m_waiting.find(pSlot->m_pThread);
+			if (it == m_waiting.end() || it->second != pSlot)
+				continue;
+
+			threads.push_back(pSlot->m_pThread);
+			++count;
+		}
+
+		return count;
+	}
+
+	void LuaPendingQueue::NotifyReady(std::shared_ptr<LuaPendingSlot> pSlot)
+	{
+		std::unique_lock<std::mutex> lock(m_readyMutex);
+		m_ready.push_back(std::move(pSlot));
+	}
+
+	std::shared_ptr<LuaPendingSlot> LuaPendingQueue::Take(lua_State* pThread)
+	{
+		auto it = m_waiting.find(pThread);
+		if (it == m_waiting.end())
+			return nullptr;
+
+		std::shared_ptr<LuaPendingSlot> pSlot = std::move(it->second);
+		m_waiting.erase(it);
+		return pSlot;
+	}
+
+#pragma endregion
+
+}
\ No newline at end of file
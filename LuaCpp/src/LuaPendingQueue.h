@@ -0,0 +1,129 @@
+#pragma once
+
+#include <lua.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lpp
+{
+	class LuaPendingQueue;
+
+	/// \class LuaPendingSlot
+	/// \brief Completion state shared between a coroutine that yielded on a pending result and the C++ code finishing it.
+	///
+	/// The slot can be completed from any thread, The results are only pushed on the lua thread once the coroutine is resumed.
+	/// See LuaPending<Rets...> for the typed handle returned by bound functions.
+	class LuaPendingSlot : public std::enable_shared_from_this<LuaPendingSlot>
+	{
+	public:
+		enum class State
+		{
+			Waiting,
+			Resolved,
+			Rejected,
+		};
+
+	private:
+		mutable std::mutex m_mutex;
+		State m_state;
+		std::string m_error;
+		lua_State* m_pThread;
+		LuaPendingQueue* m_pQueue;
+
+		friend class LuaPendingQueue;
+
+	public:
+		LuaPendingSlot() : m_state(State::Waiting), m_pThread(nullptr), m_pQueue(nullptr) {}
+		virtual ~LuaPendingSlot() = default;
+
+		LuaPendingSlot(const LuaPendingSlot&) = delete;
+		LuaPendingSlot& operator=(const LuaPendingSlot&) = delete;
+
+		State GetState() const;
+
+		/// Whether the slot was resolved or rejected.
+		bool IsDone() const { return GetState() != State::Waiting; }
+
+		/// Completes the slot with an error, The error is raised inside the coroutine when it is resumed.
+		void Reject(std::string error);
+
+		/// Yields the running coroutine until the slot is completed, Called by the binding layer for functions returning a LuaPending.
+		/// If the slot is already completed the results are pushed right away without yielding.
+		/// \return The amount of values returned to Lua, To be returned from the lua_CFunction.
+		static int Yield(lua_State* pState, std::shared_ptr<LuaPendingSlot> pSlot);
+
+	protected:
+
+		/// Pushes the results on the stack of the resumed coroutine.
+		/// \return The amount of values pushed.
+		virtual int PushResults(lua_State* pState) = 0;
+
+		/// Marks the slot as completed and notifies the queue of the state it is waiting in.
+		void Complete(State state);
+
+		std::unique_lock<std::mutex> Lock() const { return std::unique_lock<std::mutex>(m_mutex); }
+
+		/// Whether the slot is still waiting, The caller must hold the lock.
+		bool IsWaitingLocked() const { return m_state == State::Waiting; }
+
+	private:
+
+		/// Complete() for callers already holding the lock.
+		void CompleteLocked(State state);
+
+		/// Continuation passed to `lua_yieldk`, Pushes the results or raises the error of the slot.
+		static int Continue(lua_State* pState, int status, lua_KContext context);
+	};
+
+	/// \class LuaPendingQueue
+	/// \brief Keeps track of the coroutines of a LuaState that yielded on a pending result.
+	///
+	/// Completed slots are collected in a ready list guarded by a mutex, So results can be delivered from worker threads.
+	/// Everything else must be called from the thread owning the LuaState.
+	class LuaPendingQueue
+	{
+		std::unordered_map<lua_State*, std::shared_ptr<LuaPendingSlot>> m_waiting;
+
+		std::mutex m_readyMutex;
+		std::vector<std::shared_ptr<LuaPendingSlot>> m_ready;
+
+	public:
+		LuaPendingQueue() = default;
+		~LuaPendingQueue();
+
+		LuaPendingQueue(const LuaPendingQueue&) = delete;
+		LuaPendingQueue& operator=(const LuaPendingQueue&) = delete;
+
+		/// Registers the thread as waiting on the slot.
+		/// \return False if the slot was completed in the meantime, The caller should push the results without yielding.
+		bool Wait(lua_State* pThread, const std::shared_ptr<LuaPendingSlot>& pSlot);
+
+		/// Stops waiting on behalf of the thread, e.g. when the coroutine is destroyed. A later completion of the slot is ignored.
+		void Cancel(lua_State* pThread);
+
+		/// Whether the thread is suspended on a pending result.
+		bool IsWaiting(lua_State* pThread) const;
+
+		/// Whether the thread is suspended on a pending result that was completed and can be resumed.
+		bool IsReady(lua_State* pThread) const;
+
+		/// Collects the threads whose pending results completed since the last call.
+		/// \return The amount of threads added to `threads`.
+		size_t PopReady(std::vector<lua_State*>& threads);
+
+		/// Amount of coroutines suspended on a pending result.
+		size_t GetWaitingCount() const { return m_waiting.size(); }
+
+	private:
+		friend class LuaPendingSlot;
+
+		/// Called by LuaPendingSlot::Complete from any thread, With the lock of the slot held.
+		void NotifyReady(std::shared_ptr<LuaPendingSlot> pSlot);
+
+		/// Removes the slot the thread waits on and returns it, Called by the continuation once the coroutine resumed.
+		std::shared_ptr<LuaPendingSlot> Take(lua_State* pThread);
+	};
+}
\ No newline at end of file
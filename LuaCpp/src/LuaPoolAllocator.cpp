@@ -0,0 +1,226 @@
+#include "LuaPoolAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace lpp
+{
+	namespace
+	{
+		constexpr size_t kChunkSize = 64 * 1024;
+
+		struct FreeListNode
+		{
+			FreeListNode* pNext;
+		};
+
+		/// Free lists of exited threads and every chunk ever allocated, Only touched when a thread cache runs dry or exits.
+		struct SharedPool
+		{
+			std::mutex mutex;
+			FreeListNode* freeLists[LuaPoolAllocator::kSizeClassCount] = {};
+			std::vector<void*> chunks;
+		};
+
+		SharedPool& GetSharedPool()
+		{
+			// Never destroyed, States destroyed during static destruction still release their blocks to it.
+			static SharedPool* pPool = new SharedPool();
+			return *pPool;
+		}
+
+		size_t GetSizeClass(size_t size)
+		{
+			return (size - 1) / LuaPoolAllocator::kSizeClassGranularity;
+		}
+
+		size_t GetClassSize(size_t sizeClass)
+		{
+			return (sizeClass + 1) * LuaPoolAllocator::kSizeClassGranularity;
+		}
+
+		/// Free lists owned by one thread, No locking needed.
+		struct ThreadCache
+		{
+			FreeListNode* freeLists[LuaPoolAllocator::kSizeClassCount] = {};
+
+			~ThreadCache()
+			{
+				SharedPool& shared = GetSharedPool();
+				std::unique_lock<std::mutex> lock(shared.mutex);
+
+				for (size_t i = 0; i < LuaPoolAllocator::kSizeClassCount; ++i)
+				{
+					FreeListNode* pHead = freeLists[i];
+					if (!pHead)
+						continue;
+
+					FreeListNode* pTail = pHead;
+					while (pTail->pNext)
+						pTail = pTail->pNext;
+
+					pTail->pNext = shared.freeLists[i];
+					shared.freeLists[i] = pHead;
+				}
+			}
+
+			/// Takes the shared free list of the class or carves a new chunk into blocks.
+			bool Refill(size_t sizeClass)
+			{
+				SharedPool& shared = GetSharedPool();
+				std::unique_lock<std::mutex> lock(shared.mutex);
+
+				if (shared.freeLists[sizeClass])
+				{
+					freeLists[sizeClass] = shared.freeLists[sizeClass];
+					shared.freeLists[sizeClass] = nullptr;
+					return true;
+				}
+
+				char* pChunk = static_cast<char*>(std::malloc(kChunkSize));
+				if (!pChunk)
+					return false;
+
+				shared.chunks.push_back(pChunk);
+				lock.unlock();
+
+				const size_t blockSize = GetClassSize(sizeClass);
+				const size_t blockCount = kChunkSize / blockSize;
+
+				FreeListNode* pHead = nullptr;
+				for (size_t i = blockCount; i > 0; --i)
+				{
+					FreeListNode* pNode = reinterpret_cast<FreeListNode*>(pChunk + (i - 1) * blockSize);
+					pNode->pNext = pHead;
+					pHead = pNode;
+				}
+
+				freeLists[sizeClass] = pHead;
+				return true;
+			}
+		};
+
+		thread_local ThreadCache t_cache;
+	}
+
+	void* LuaPoolAllocator::Allocate(void* pUserData, void* pBlock, size_t oldSize, size_t newSize)
+	{
+		LuaPoolAllocator* pAllocator = static_cast<LuaPoolAllocator*>(pUserData);
+
+		if (newSize == 0)
+		{
+			if (pBlock)
+				pAllocator->FreeBlock(pBlock, oldSize);
+
+			return nullptr;
+		}
+
+		// When allocating, oldSize holds the type of the object instead of a size.
+		if (!pBlock)
+			return pAllocator->AllocateBlock(newSize);
+
+		const bool isOldPooled = oldSize <= kMaxPooledSize;
+		const bool isNewPooled = newSize <= kMaxPooledSize;
+
+		if (isOldPooled && isNewPooled && GetSizeClass(oldSize) == GetSizeClass(newSize))
+		{
+			pAllocator->m_stats.bytesInUse -= oldSize;
+			pAllocator->OnAllocated(newSize);
+			return pBlock;
+		}
+
+		if (!isOldPooled && !isNewPooled)
+		{
+			void* pNewBlock = std::realloc(pBlock, newSize);
+			if (!pNewBlock)
+				return nullptr;
+
+			pAllocator->m_stats.bytesInUse -= oldSize;
+			pAllocator->OnAllocated(newSize);
+			return pNewBlock;
+		}
+
+		void* pNewBlock = pAllocator->AllocateBlock(newSize);
+		if (!pNewBlock)
+		{
+			// Lua expects shrinking to succeed, The old block is large enough and gets pooled once it is freed with the new size.
+			if (newSize <= oldSize)
+			{
+				pAllocator->m_stats.bytesInUse -= oldSize;
+				pAllocator->OnAllocated(newSize);
+				return pBlock;
+			}
+
+			return nullptr;
+		}
+
+		std::memcpy(pNewBlock, pBlock, std::min(oldSize, newSize));
+		pAllocator->FreeBlock(pBlock, oldSize);
+		return pNewBlock;
+	}
+
+	void* LuaPoolAllocator::AllocateBlock(size_t size)
+	{
+		if (size > kMaxPooledSize)
+		{
+			void* pBlock = std::malloc(size);
+			if (!pBlock)
+				return nullptr;
+
+			++m_stats.fallbackCount;
+			++m_stats.allocationCount;
+			OnAllocated(size);
+			return pBlock;
+		}
+
+		const size_t sizeClass = GetSizeClass(size);
+
+		FreeListNode* pNode = t_cache.freeLists[sizeClass];
+		if (!pNode)
+		{
+			if (!t_cache.Refill(sizeClass))
+				return nullptr;
+
+			pNode = t_cache.freeLists[sizeClass];
+		}
+
+		t_cache.freeLists[sizeClass] = pNode->pNext;
+
+		++m_stats.pooledCount;
+		++m_stats.allocationCount;
+		OnAllocated(size);
+		return pNode;
+	}
+
+	void LuaPoolAllocator::FreeBlock(void* pBlock, size_t size)
+	{
+		OnFreed(size);
+
+		if (size > kMaxPooledSize)
+		{
+			std::free(pBlock);
+			return;
+		}
+
+		const size_t sizeClass = GetSizeClass(size);
+
+		FreeListNode* pNode = static_cast<FreeListNode*>(pBlock);
+		pNode->pNext = t_cache.freeLists[sizeClass];
+		t_cache.freeLists[sizeClass] = pNode;
+	}
+
+	void LuaPoolAllocator::OnAllocated(size_t size)
+	{
+		m_stats.bytesInUse += size;
+		m_stats.peakBytesInUse = std::max(m_stats.peakBytesInUse, m_stats.bytesInUse);
+	}
+
+	void LuaPoolAllocator::OnFreed(size_t size)
+	{
+		++m_stats.freeCount;
+		m_stats.bytesInUse -= size;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+
+namespace lpp
+{
+	/// Allocation counters of a single LuaPoolAllocator, And so of the state using it.
+	struct LuaAllocatorStats
+	{
+		size_t allocationCount = 0;		///< Blocks allocated, Including the new block of a reallocation that changed size class.
+		size_t freeCount = 0;			///< Blocks released.
+		size_t pooledCount = 0;			///< Allocations served from the size-class pool.
+		size_t fallbackCount = 0;		///< Allocations too large for the pool, Served by malloc.
+		size_t bytesInUse = 0;			///< Bytes currently requested by lua.
+		size_t peakBytesInUse = 0;		///< Highest bytesInUse seen.
+	};
+
+	/// \class LuaPoolAllocator
+	/// \brief A `lua_Alloc` keeping small blocks in free lists per 16 byte size class.
+	///
+	/// Blocks up to kMaxPooledSize bytes are taken from thread-local free lists, Refilled from 64KB chunks, Larger blocks fall back to malloc.
+	/// Lua tells the allocator the size of every block it releases so the blocks carry no header.
+	/// The pool memory is reused by every state on every thread but never returned to the system, When a thread exits its free lists are handed to the next thread that needs them.
+	///
+	/// Each instance only keeps the statistics, Give every state its own instance to get per-state numbers.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaPoolAllocator allocator;
+	/// LuaState state(&LuaPoolAllocator::Allocate, &allocator);
+	/// state.Init();
+	/// ~~~~~
+	/// \devnote The allocator must outlive the state.
+	class LuaPoolAllocator
+	{
+	public:
+		static constexpr size_t kSizeClassGranularity = 16;
+		static constexpr size_t kMaxPooledSize = 512;
+		static constexpr size_t kSizeClassCount = kMaxPooledSize / kSizeClassGranularity;
+
+	private:
+		LuaAllocatorStats m_stats;
+
+	public:
+		LuaPoolAllocator() = default;
+
+		LuaPoolAllocator(const LuaPoolAllocator&) = delete;
+		LuaPoolAllocator& operator=(const LuaPoolAllocator&) = delete;
+
+		const LuaAllocatorStats& GetStats() const { return m_stats; }
+
+		/// The `lua_Alloc` function, `pUserData` is the LuaPoolAllocator.
+		static void* Allocate(void* pUserData, void* pBlock, size_t oldSize, size_t newSize);
+
+	private:
+
+		void* AllocateBlock(size_t size);
+		void FreeBlock(void* pBlock, size_t size);
+
+		void OnAllocated(size_t size);
+		void OnFreed(size_t size);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "LuaProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+namespace lpp
+{
+	namespace
+	{
+		// The signal profiler of the process, Read by the signal handler.
+		std::atomic<LuaProfiler*> s_pSignalProfiler(nullptr);
+
+#if !defined(_WIN32)
+		pthread_t s_signalThread;
+		struct sigaction s_previousAction;
+#endif
+	}
+
+	LuaProfiler::LuaProfiler(LuaState* pState, double frequency, LuaProfilerMode mode)
+		: m_pState(pState)
+		, m_frequency(std::max(1.0, frequency))
+		, m_mode(mode)
+		, m_sampleCount(0)
+		, m_isStopping(false)
+		, m_isSampleDue(false)
+		, m_dueCount(0)
+	{
+		Reset();
+	}
+
+	LuaProfiler::~LuaProfiler()
+	{
+		Stop();
+	}
+
+	bool LuaProfiler::Start()
+	{
+		if (IsRunning() || m_pState->GetProfiler())
+			return false;
+
+		if (m_mode == LuaProfilerMode::Signal && !InstallSignal())
+			return false;
+
+		m_pState->SetProfiler(this);
+		m_pState->UpdateHook(m_pState->GetState());
+		m_isStopping = false;
+		m_sampler = std::thread(&LuaProfiler::SamplerLoop, this);
+		return true;
+	}
+
+	void LuaProfiler::Stop()
+	{
+		if (!IsRunning())
+			return;
+
+		{
+			std::unique_lock<std::mutex> lock(m_signalMutex);
+			m_isStopping = true;
+		}
+
+		m_signal.notify_all();
+		m_sampler.join();
+
+		// Signals sent before the join were delivered when it returned, The handler can go.
+		if (m_mode == LuaProfilerMode::Signal)
+			RemoveSignal();
+
+		// Counts left on coroutines are removed the next time they fire, The state has no profiler anymore.
+		m_pState->SetProfiler(nullptr);
+		m_pState->UpdateHook(m_pState->GetState());
+		m_isSampleDue = false;
+	}
+
+	void LuaProfiler::Reset()
+	{
+		m_frames.clear();
+		m_frameIndices.clear();
+		m_nodes.clear();
+		m_sampleCount = 0;
+
+		// The root of the call tree.
+		m_nodes.emplace_back();
+	}
+
+	void LuaProfiler::SamplerLoop()
+	{
+		const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / m_frequency));
+		auto next = std::chrono::steady_clock::now() + period;
+
+		std::unique_lock<std::mutex> lock(m_signalMutex);
+		while (!m_signal.wait_until(lock, next, [this]() { return m_isStopping; }))
+		{
+			// The hook takes the sample on the thread running the state.
+			m_isSampleDue = true;
+			++m_dueCount;
+
+#if !defined(_WIN32)
+			if (m_mode == LuaProfilerMode::Signal)
+				pthread_kill(s_signalThread, SIGPROF);
+#endif
+
+			// Skips ticks missed while the machine was busy instead of catching up with a burst.
+			next = std::max(next + period, std::chrono::steady_clock::now());
+		}
+	}
+
+#if defined(_WIN32)
+	bool LuaProfiler::InstallSignal()
+	{
+		//DEBUG_LOG("LuaProfilerMode::Signal is not supported on Windows, Use LuaProfilerMode::CountHook.");
+		return false;
+	}
+
+	void LuaProfiler::RemoveSignal()
+	{
+	}
+
+	void LuaProfiler::OnSignal(int)
+	{
+	}
+#else
+	bool LuaProfiler::InstallSignal()
+	{
+		LuaProfiler* pExpected = nullptr;
+		if (!s_pSignalProfiler.compare_exchange_strong(pExpected, this))
+			return false;
+
+		// Written before the sampler thread starts, So it reads them without a lock.
+		s_signalThread = pthread_self();
+
+		struct sigaction action = {};
+		action.sa_handler = &LuaProfiler::OnSignal;
+		action.sa_flags = SA_RESTART;
+		sigemptyset(&action.sa_mask);
+
+		if (sigaction(SIGPROF, &action, &s_previousAction) != 0)
+		{
+			s_pSignalProfiler = nullptr;
+			return false;
+		}
+
+		return true;
+	}
+
+	void LuaProfiler::RemoveSignal()
+	{
+		sigaction(SIGPROF, &s_previousAction, nullptr);
+		s_pSignalProfiler = nullptr;
+	}
+
+	void LuaProfiler::OnSignal(int)
+	{
+		LuaProfiler* pProfiler = s_pSignalProfiler.load(std::memory_order_relaxed);
+		if (!pProfiler)
+			return;
+
+		// lua_sethook may be called from a signal, The hook takes the sample and UpdateHook() puts back the hook the state needs.
+		lua_State* pThread = pProfiler->m_pState->GetRunningThread();
+		lua_sethook(pThread, &LuaState::Hook, lua_gethookmask(pThread) | LUA_MASKCOUNT, 1);
+	}
+#endif
+
+	void LuaProfiler::Sample(lua_State* pThread)
+	{
+		m_isSampleDue = false;
+
+		// Level 0 is the running function, The stack is collected leaf first.
+		m_stack.clear();
+
+		lua_Debug info;
+		for (int level = 0; level < kMaxDepth && lua_getstack(pThread, level, &info); ++level)
+		{
+			lua_getinfo(pThread, "Sn", &info);
+			m_stack.push_back(GetFrame(info));
+		}
+
+		if (m_stack.empty())
+			return;
+
+		int node = 0;
+		++m_nodes[0].totalCount;
+
+		for (auto it = m_stack.rbegin(); it != m_stack.rend(); ++it)
+		{
+			auto [child, isNew] = m_nodes[node].children.try_emplace(*it, static_cast<int>(m_nodes.size()));
+			if (isNew)
+			{
+				Node& added = m_nodes.emplace_back();
+				added.frame = *it;
+				added.parent = node;
+			}
+
+			node = child->second;
+			++m_nodes[node].totalCount;
+		}
+
+		++m_nodes[node].selfCount;
+		++m_sampleCount;
+	}
+
+	int LuaProfiler::GetFrame(lua_Debug& info)
+	{
+		char name[LUA_IDSIZE + 96];
+
+		if (*info.what == 'C')
+			std::snprintf(name, sizeof(name), "[C] %s", info.name ? info.name : "?");
+		else if (*info.what == 'm')
+			std::snprintf(name, sizeof(name), "main chunk %s", info.short_src);
+		else
+			std::snprintf(name, sizeof(name), "%s %s:%d", info.name ? info.name : "anonymous", info.short_src, info.linedefined);
+
+		auto [it, isNew] = m_frameIndices.try_emplace(name, static_cast<int>(m_frames.size()));
+		if (isNew)
+			m_frames.push_back(name);
+
+		return it->second;
+	}
+
+	std::string LuaProfiler::GetCollapsedStacks() const
+	{
+		std::string output;
+		std::string path;
+		WriteCollapsed(output, 0, path);
+		return output;
+	}
+
+	void LuaProfiler::WriteCollapsed(std::string& output, int node, std::string& path) const
+	{
+		const Node& current = m_nodes[node];
+		const size_t length = path.size();
+
+		if (current.frame >= 0)
+		{
+			if (!path.empty())
+				path += ';';
+
+			// The format splits frames on ';' and the count on the last space.
+			std::string frame = m_frames[current.frame];
+			std::replace(frame.begin(), frame.end(), ';', ',');
+			path += frame;
+
+			if (current.selfCount > 0)
+			{
+				output += path;
+				output += ' ';
+				output += std::to_string(current.selfCount);
+				output += '\n';
+			}
+		}
+
+		for (const auto& [frame, child] : current.children)
+			WriteCollapsed(output, child, path);
+
+		path.resize(length);
+	}
+
+	std::vector<LuaProfileEntry> LuaProfiler::GetTop(size_t count) const
+	{
+		std::vector<LuaProfileEntry> entries(m_frames.size());
+		std::vector<int> lastSeen(m_frames.size(), -1);
+
+		for (size_t i = 0; i < m_frames.size(); ++i)
+			entries[i].function = m_frames[i];
+
+		for (size_t i = 1; i < m_nodes.size(); ++i)
+		{
+			const Node& node = m_nodes[i];
+			LuaProfileEntry& entry = entries[node.frame];
+			entry.selfSamples += node.selfCount;
+
+			// Recursion puts a frame on the stack more than once, Its total only counts the outermost.
+			bool isNested = false;
+			for (int parent = node.parent; parent > 0 && !isNested; parent = m_nodes[parent].parent)
+				isNested = m_nodes[parent].frame == node.frame;
+
+			if (!isNested)
+				entry.totalSamples += node.totalCount;
+		}
+
+		for (LuaProfileEntry& entry : entries)
+			entry.selfPercent = m_sampleCount > 0 ? 100.0 * entry.selfSamples / m_sampleCount : 0.0;
+
+		const size_t topCount = std::min(count, entries.size());
+		std::partial_sort(entries.begin(), entries.begin() + topCount, entries.end(), [](const LuaProfileEntry& left, const LuaProfileEntry& right)
+		{
+			return left.selfSamples != right.selfSamples ? left.selfSamples > right.selfSamples : left.totalSamples > right.totalSamples;
+		});
+
+		entries.resize(topCount);
+		return entries;
+	}
+
+	std::string LuaProfiler::GetReport(size_t count) const
+	{
+		std::string report;
+		char line[512];
+
+		std::snprintf(line, sizeof(line), "%llu samples\n%8s %8s %7s  %s\n", static_cast<unsigned long long>(m_sampleCount), "self", "total", "self%", "function");
+		report += line;
+
+		for (const LuaProfileEntry& entry : GetTop(count))
+		{
+			std::snprintf(line, sizeof(line), "%8llu %8llu %6.2f%%  %s\n", static_cast<unsigned long long>(entry.selfSamples),
+				static_cast<unsigned long long>(entry.totalSamples), entry.selfPercent, entry.function.c_str());
+			report += line;
+		}
+
+		return report;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <LuaState.h>
+
+namespace lpp
+{
+	/// Samples of a single function, See LuaProfiler::GetTop().
+	struct LuaProfileEntry
+	{
+		std::string function;		///< "name source:line", The line the function is defined on.
+		uint64_t selfSamples = 0;	///< Samples taken while the function itself was running.
+		uint64_t totalSamples = 0;	///< Samples taken while the function was on the stack.
+		double selfPercent = 0.0;	///< Self samples over all samples, 0 to 100.
+	};
+
+	/// How the hook of the state is made to fire for a due sample, See LuaProfiler.
+	enum class LuaProfilerMode
+	{
+		Signal,		///< The sampler thread signals the thread running the state and the handler arms a one-shot hook, POSIX only.
+		CountHook,	///< A count hook checks every kCheckInterval instructions, Tight loops run about 2.3 times as long. Not for production.
+	};
+
+	/// \class LuaProfiler
+	/// \brief Sampling CPU profiler for the Lua code of a state.
+	///
+	/// A sampler thread wakes up at the frequency, Marks a sample as due and sends SIGPROF to the thread that started the profiler.
+	/// The signal handler arms a count hook of one instruction on the running Lua thread like the interrupt handler of `lua.c` does,
+	/// The hook walks the stack with `lua_getinfo`, Adds the sample to a call tree and removes itself. Between samples no hook runs.
+	///
+	/// The call tree is written as collapsed stacks for flamegraph.pl or speedscope, Or as a report of the top functions.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaProfiler profiler(&state);
+	/// profiler.Start();
+	/// RunFrames();
+	/// profiler.Stop();
+	/// std::ofstream("frames.folded") << profiler.GetCollapsedStacks();
+	/// ~~~~~
+	///
+	/// \devnote Start() and Stop() must be called on the thread running the state and only one signal profiler runs per process.
+	/// The signal interrupts that thread, System calls of the host restart but some like `sleep` may still return early.
+	/// Time spent in a C function is sampled when it returns to Lua. Coroutines resumed by scripts are not tracked by the state,
+	/// Their time is sampled in the resumer once they yield. A running LuaBudget counts only one instruction for the check
+	/// a sample cuts short. The results may only be read from the thread running the state.
+	///
+	/// LuaProfilerMode::CountHook keeps a count hook on the thread all the time and needs no signals, It works on Windows and for
+	/// coroutines resumed by scripts but any count hook makes lua trap every instruction. Only use it for local measurements.
+	class LuaProfiler
+	{
+	public:
+		static constexpr double kDefaultFrequency = 1000.0;
+
+		/// Deeper stacks are cut off at the root.
+		static constexpr int kMaxDepth = 128;
+
+		/// Instructions between two checks of the hook for a due sample.
+		static constexpr int kCheckInterval = 1000;
+
+	private:
+		struct Node
+		{
+			int frame = -1;
+			int parent = -1;
+			uint64_t selfCount = 0;
+			uint64_t totalCount = 0;
+			std::unordered_map<int, int> children;
+		};
+
+		LuaState* m_pState;
+		double m_frequency;
+		LuaProfilerMode m_mode;
+
+		// Frame names and the call tree, Touched by the hook on the thread running the state only.
+		std::vector<std::string> m_frames;
+		std::unordered_map<std::string, int> m_frameIndices;
+		std::vector<Node> m_nodes;
+		uint64_t m_sampleCount;
+		std::vector<int> m_stack;
+
+		std::thread m_sampler;
+		std::mutex m_signalMutex;
+		std::condition_variable m_signal;
+		bool m_isStopping;
+		std::atomic<bool> m_isSampleDue;
+		std::atomic<uint64_t> m_dueCount;
+
+	public:
+		explicit LuaProfiler(LuaState* pState, double frequency = kDefaultFrequency, LuaProfilerMode mode = LuaProfilerMode::Signal);
+
+		/// Stops sampling, The samples remain readable until the profiler is destroyed.
+		~LuaProfiler();
+
+		LuaProfiler(const LuaProfiler&) = delete;
+		LuaProfiler& operator=(const LuaProfiler&) = delete;
+
+		/// Starts the sampler thread, Only one profiler per state can run.
+		/// \return False if this or another profiler is already running on the state, Another signal profiler runs in the process
+		/// or signals are not supported.
+		bool Start();
+		void Stop();
+		bool IsRunning() const { return m_sampler.joinable(); }
+
+		LuaProfilerMode GetMode() const { return m_mode; }
+
+		/// Drops all samples.
+		void Reset();
+
+		uint64_t GetSampleCount() const { return m_sampleCount; }
+
+		/// Times the sampler marked a sample as due, Higher than the sample count when no Lua code was running.
+		uint64_t GetDueCount() const { return m_dueCount; }
+
+		/// One line per stack "root;caller;function count", The format of flamegraph.pl and speedscope.
+		std::string GetCollapsedStacks() const;
+
+		/// The functions with the most self samples, Most first.
+		std::vector<LuaProfileEntry> GetTop(size_t count) const;
+
+		/// GetTop() as a table of text.
+		std::string GetReport(size_t count = 20) const;
+
+		/// Whether the sampler marked a sample as due since the last one was taken.
+		bool IsSampleDue() const { return m_isSampleDue; }
+
+		/// Called by the hook of the state, Takes a sample of the stack of the thread the hook fired on.
+		void Sample(lua_State* pThread);
+
+	private:
+
+		void SamplerLoop();
+
+		bool InstallSignal();
+		void RemoveSignal();
+
+		/// SIGPROF handler, Arms the hook of the thread running the state.
+		static void OnSignal(int signal);
+
+		int GetFrame(lua_Debug& info);
+
+		void WriteCollapsed(std::string& output, int node, std::string& path) const;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "LuaReferenceTracker.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <tuple>
+
+namespace lpp
+{
+	LuaReferenceTracker::LuaReferenceTracker(LuaState* pState)
+		: m_pState(pState)
+		, m_isRunning(false)
+	{}
+
+	LuaReferenceTracker::~LuaReferenceTracker()
+	{
+		Stop();
+	}
+
+	bool LuaReferenceTracker::Start()
+	{
+#ifdef LUACPP_TRACK_REFERENCES
+		if (m_isRunning || m_pState->GetReferenceTracker())
+			return false;
+
+		m_isRunning = true;
+		m_pState->SetReferenceTracker(this);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void LuaReferenceTracker::Stop()
+	{
+		if (!m_isRunning)
+			return;
+
+		m_pState->SetReferenceTracker(nullptr);
+		m_isRunning = false;
+	}
+
+	void LuaReferenceTracker::OnReferenceCreated(int reference, const LuaSourceLocation& location)
+	{
+		m_references[reference] = Reference{ location, Clock::now() };
+	}
+
+	void LuaReferenceTracker::OnReferenceReleased(int reference)
+	{
+		m_references.erase(reference);
+	}
+
+	std::vector<LuaReferenceSite> LuaReferenceTracker::GetSites(double minSeconds) const
+	{
+		const Clock::time_point now = Clock::now();
+
+		// Keyed by the location, The file and function strings are literals.
+		using SiteKey = std::tuple<const char*, int, const char*>;
+		std::map<SiteKey, LuaReferenceSite> sites;
+		std::map<SiteKey, std::map<std::string, size_t>> siteTypes;
+
+		for (const auto& [reference, entry] : m_references)
+		{
+			const double seconds = std::chrono::duration<double>(now - entry.created).count();
+			if (seconds < minSeconds)
+				continue;
+
+			const SiteKey key(entry.location.file, entry.location.line, entry.location.function);
+
+			LuaReferenceSite& site = sites[key];
+			site.location = entry.location;
+			++site.liveCount;
+			site.oldestSeconds = std::max(site.oldestSeconds, seconds);
+
+			++siteTypes[key][GetTypeName(reference)];
+		}
+
+		std::vector<LuaReferenceSite> result;
+		result.reserve(sites.size());
+
+		for (auto& [key, site] : sites)
+		{
+			site.types.assign(siteTypes[key].begin(), siteTypes[key].end());
+			SortCounts(site.types);
+			result.push_back(std::move(site));
+		}
+
+		std::sort(result.begin(), result.end(), [](const LuaReferenceSite& a, const LuaReferenceSite& b) { return a.oldestSeconds > b.oldestSeconds; });
+		return result;
+	}
+
+	std::vector<std::pair<std::string, size_t>> LuaReferenceTracker::GetTypes(double minSeconds) const
+	{
+		const Clock::time_point now = Clock::now();
+
+		std::map<std::string, size_t> types;
+		for (const auto& [reference, entry] : m_references)
+		{
+			if (std::chrono::duration<double>(now - entry.created).count() >= minSeconds)
+				++types[GetTypeName(reference)];
+		}
+
+		std::vector<std::pair<std::string, size_t>> result(types.begin(), types.end());
+		SortCounts(result);
+		return result;
+	}
+
+	std::string LuaReferenceTracker::GetReport(size_t maxSites, double minSeconds) const
+	{
+		const std::vector<LuaReferenceSite> sites = GetSites(minSeconds);
+
+		size_t liveCount = 0;
+		for (const LuaReferenceSite& site : sites)
+			liveCount += site.liveCount;
+
+		char line[512];
+		std::snprintf(line, sizeof(line), "%zu live references from %zu sites\n%8s %10s  site\n", liveCount, sites.size(), "count", "oldest");
+		std::string report = line;
+
+		for (size_t i = 0; i < sites.size() && i < maxSites; ++i)
+		{
+			const LuaReferenceSite& site = sites[i];
+
+			std::snprintf(line, sizeof(line), "%8zu %9.1fs  %s:%d (%s)", site.liveCount, site.oldestSeconds, site.location.file, site.location.line, site.location.function);
+			report += line;
+
+			for (const auto& [type, count] : site.types)
+			{
+				std::snprintf(line, sizeof(line), " %s %zu", type.c_str(), count);
+				report += line;
+			}
+
+			report += '\n';
+		}
+
+		report += "by type\n";
+		for (const auto& [type, count] : GetTypes(minSeconds))
+		{
+			std::snprintf(line, sizeof(line), "%8zu  %s\n", count, type.c_str());
+			report += line;
+		}
+
+		return report;
+	}
+
+	const char* LuaReferenceTracker::GetTypeName(int reference) const
+	{
+		lua_State* L = m_pState->GetState();
+
+		const char* name = lua_typename(L, lua_rawgeti(L, LUA_REGISTRYINDEX, reference));	// [value]
+		lua_pop(L, 1);																		// []
+		return name;
+	}
+
+	void LuaReferenceTracker::SortCounts(std::vector<std::pair<std::string, size_t>>& counts)
+	{
+		std::stable_sort(counts.begin(), counts.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+	}
+}
\ No newline at end of file
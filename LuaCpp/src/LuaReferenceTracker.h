@@ -0,0 +1,129 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <LuaState.h>
+
+/// \file LuaReferenceTracker.h
+/// Defining LUACPP_TRACK_REFERENCES (premake defines it in Debug or with `--track-references`) makes every LuaVar keep the site it was
+/// created at for LuaReferenceTracker. Without it LuaVar carries no site and LuaReferenceTracker::Start() fails.
+/// Every project including the headers has to agree on it.
+
+#ifdef LUACPP_TRACK_REFERENCES
+#define LUACPP_TRACKING(...) __VA_ARGS__
+#else
+#define LUACPP_TRACKING(...)
+#endif
+
+namespace lpp
+{
+	/// The place in the code a LuaVar was created, Captured by a default argument like `std::source_location` in C++20.
+	struct LuaSourceLocation
+	{
+		const char* file = "";
+		const char* function = "";
+		int line = 0;
+
+		/// The location of the caller when used as a default argument.
+		static constexpr LuaSourceLocation Current(const char* file = __builtin_FILE(), const char* function = __builtin_FUNCTION(), int line = __builtin_LINE()) noexcept
+		{
+			return LuaSourceLocation{ file, function, line };
+		}
+	};
+
+	/// Live references taken at the same location, See LuaReferenceTracker::GetSites().
+	struct LuaReferenceSite
+	{
+		LuaSourceLocation location;
+		size_t liveCount = 0;
+		double oldestSeconds = 0.0;		///< Age of the oldest live reference.
+
+		/// Lua type names and how many of the references hold one, Most first.
+		std::vector<std::pair<std::string, size_t>> types;
+	};
+
+	/// \class LuaReferenceTracker
+	/// \brief Records where every registry reference taken by LuaVar was created, To find the LuaVars that are never released.
+	///
+	/// LuaVars stored in long-lived containers or never destroyed pin their Lua value and grow the registry.
+	/// While the tracker runs every reference taken gets its creation site and time, Releasing it forgets them again.
+	/// The report lists the references still alive grouped by site and by the type of their value, Oldest first.
+	///
+	/// LuaVars returned by GetField(), operator[] and Call() are attributed to the site of the LuaVar they came from.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaReferenceTracker tracker(&state);
+	/// tracker.Start();
+	/// RunLevel();
+	/// std::printf("%s", tracker.GetReport(10, 60.0).c_str());	// Sites of references older than a minute.
+	/// ~~~~~
+	///
+	/// \devnote Only references taken while the tracker runs are listed. The types are read from the registry when reporting,
+	/// Call the report functions on the thread running the state. A LuaVar constructed in place by a container, e.g. `emplace_back`,
+	/// gets a site in the standard library, Construct it and move it in instead.
+	class LuaReferenceTracker
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+	private:
+		struct Reference
+		{
+			LuaSourceLocation location;
+			Clock::time_point created;
+		};
+
+		LuaState* m_pState;
+		bool m_isRunning;
+
+		std::unordered_map<int, Reference> m_references;
+
+	public:
+		explicit LuaReferenceTracker(LuaState* pState);
+
+		/// Stops tracking.
+		~LuaReferenceTracker();
+
+		LuaReferenceTracker(const LuaReferenceTracker&) = delete;
+		LuaReferenceTracker& operator=(const LuaReferenceTracker&) = delete;
+
+		/// \return False if this or another tracker is already running on the state, Or LUACPP_TRACK_REFERENCES is not defined.
+		bool Start();
+
+		/// Stops recording, The list stays as it was when stopped until Reset().
+		void Stop();
+
+		bool IsRunning() const { return m_isRunning; }
+
+		/// Forgets every recorded reference.
+		void Reset() { m_references.clear(); }
+
+		/// Called by LuaVar for every registry slot it takes and releases.
+		void OnReferenceCreated(int reference, const LuaSourceLocation& location);
+		void OnReferenceReleased(int reference);
+
+		size_t GetLiveCount() const { return m_references.size(); }
+
+		/// The live references grouped by site, The site with the oldest reference first.
+		/// \param minSeconds Leave out the references younger than this, Leaks are the ones that stay.
+		std::vector<LuaReferenceSite> GetSites(double minSeconds = 0.0) const;
+
+		/// The live references grouped by the type of their value, Most first.
+		std::vector<std::pair<std::string, size_t>> GetTypes(double minSeconds = 0.0) const;
+
+		/// The sites and types as a table.
+		std::string GetReport(size_t maxSites = 20, double minSeconds = 0.0) const;
+
+	private:
+
+		/// Reads the type name of the value in the registry slot.
+		const char* GetTypeName(int reference) const;
+
+		static void SortCounts(std::vector<std::pair<std::string, size_t>>& counts);
+	};
+}
\ No newline at end of file
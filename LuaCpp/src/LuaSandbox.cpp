@@ -0,0 +1,267 @@
+#include "LuaSandbox.h"
+
+#include <string_view>
+
+namespace lpp
+{
+	namespace
+	{
+		// A proxy handed out as a key stands for its table when passed back.
+		void ToOriginal(lua_State* pState, int index, int originals)
+		{
+			if (!lua_istable(pState, index))
+				return;
+
+			lua_pushvalue(pState, index);
+			if (lua_rawget(pState, originals) != LUA_TNIL)
+				lua_replace(pState, index);
+			else
+				lua_pop(pState, 1);
+		}
+	}
+
+	const std::vector<std::string>& LuaSandbox::GetDefaultWhitelist()
+	{
+		static const std::vector<std::string> kDefaultWhitelist =
+		{
+			"assert", "error", "ipairs", "next", "pairs", "pcall", "select", "tonumber", "tostring", "type", "xpcall", "print",
+			"setmetatable", "getmetatable", "rawget", "rawequal", "rawlen", "_VERSION",
+			"string", "table", "math", "utf8", "coroutine",
+			"os.time", "os.clock", "os.date", "os.difftime",
+		};
+
+		return kDefaultWhitelist;
+	}
+
+	LuaSandbox::LuaSandbox(LuaState* pState, const std::vector<std::string>& whitelist)
+		: m_pState(pState)
+	{
+		lua_State* L = pState->GetState();
+
+		lua_createtable(L, 0, static_cast<int>(whitelist.size()));						// [base]
+		const int base = lua_gettop(L);
+
+		// Weak caches shared by every proxy of the sandbox, The proxies keep them alive through their upvalues.
+		lua_newtable(L);																// [base, proxies]
+		lua_newtable(L);																// [base, proxies, originals]
+		lua_createtable(L, 0, 1);
+		lua_pushliteral(L, "k");
+		lua_setfield(L, -2, "__mode");
+		lua_pushvalue(L, -1);
+		lua_setmetatable(L, -3);
+		lua_setmetatable(L, -3);
+		const int proxies = base + 1;
+		const int originals = base + 2;
+
+		for (const std::string& name : whitelist)
+		{
+			const size_t dot = name.find('.');
+			const std::string root = name.substr(0, dot);
+
+			// Not raw so lazy libraries open.
+			lua_getglobal(L, root.c_str());												// [base, value]
+			if (lua_isnil(L, -1))
+			{
+				lua_pop(L, 1);
+				continue;
+			}
+
+			if (dot == std::string::npos)
+			{
+				lua_setfield(L, base, root.c_str());									// [base]
+				continue;
+			}
+
+			if (!lua_istable(L, -1))
+			{
+				lua_pop(L, 1);
+				continue;
+			}
+
+			// A whole library wins over single functions of it.
+			lua_getfield(L, base, root.c_str());										// [base, library, subset]
+			if (lua_isnil(L, -1))
+			{
+				lua_pop(L, 1);
+				lua_newtable(L);														// [base, library, subset]
+				lua_pushvalue(L, -1);
+				lua_setfield(L, base, root.c_str());
+			}
+			else if (lua_rawequal(L, -1, -2))
+			{
+				lua_pop(L, 2);
+				continue;
+			}
+
+			const std::string field = name.substr(dot + 1);
+			lua_getfield(L, -2, field.c_str());											// [base, library, subset, value]
+			lua_setfield(L, -2, field.c_str());											// [base, library, subset]
+			lua_pop(L, 2);																// [base]
+		}
+
+		// Every table a script can reach through the base becomes read-only.
+		lua_pushnil(L);																	// [base, nil]
+		while (lua_next(L, base) != 0)													// [base, key, value]
+		{
+			if (lua_istable(L, -1))
+			{
+				PushReadOnly(L, proxies, originals);									// [base, key, proxy]
+				lua_pushvalue(L, -2);													// [base, key, proxy, key]
+				lua_insert(L, -2);														// [base, key, key, proxy]
+				lua_rawset(L, base);													// [base, key]
+			}
+			else
+			{
+				lua_pop(L, 1);															// [base, key]
+			}
+		}
+
+		lua_pop(L, 2);																	// [base]
+		m_base = LuaVar(pState, base);
+
+		// Shared by every environment.
+		lua_createtable(L, 0, 2);														// [base, meta]
+		lua_pushvalue(L, base);
+		lua_setfield(L, -2, "__index");
+		lua_pushboolean(L, 0);
+		lua_setfield(L, -2, "__metatable");
+		m_environmentMeta = LuaVar(pState, -1);
+		lua_pop(L, 2);																	// []
+
+		// getmetatable("").__index would hand out the original string table.
+		lua_pushliteral(L, "");
+		if (lua_getmetatable(L, -1))													// ["", meta]
+		{
+			lua_pushboolean(L, 0);
+			lua_setfield(L, -2, "__metatable");
+			lua_pop(L, 1);
+		}
+		lua_pop(L, 1);
+	}
+
+	LuaVar LuaSandbox::CreateEnvironment() const
+	{
+		lua_State* L = m_pState->GetState();
+
+		lua_createtable(L, 0, 1);														// [env]
+		lua_pushvalue(L, -1);
+		lua_setfield(L, -2, "_G");
+
+		m_environmentMeta.PushToStack(L);												// [env, meta]
+		lua_setmetatable(L, -2);														// [env]
+
+		LuaVar environment(m_pState, -1);
+		lua_pop(L, 1);
+		return environment;
+	}
+
+	void LuaSandbox::PushReadOnly(lua_State* pState, int proxies, int originals)
+	{
+		const int table = lua_gettop(pState);											// [t]
+
+		lua_pushvalue(pState, table);
+		if (lua_rawget(pState, proxies) != LUA_TNIL)									// [t, proxy]
+		{
+			lua_remove(pState, table);													// [proxy]
+			return;
+		}
+
+		lua_pop(pState, 1);																// [t]
+		lua_newtable(pState);															// [t, proxy]
+		lua_createtable(pState, 0, 5);													// [t, proxy, meta]
+
+		// Tables read through the proxy are proxied too.
+		lua_pushvalue(pState, table);
+		lua_pushvalue(pState, proxies);
+		lua_pushvalue(pState, originals);
+		lua_pushcclosure(pState, &LuaSandbox::ReadOnlyIndex, 3);
+		lua_setfield(pState, -2, "__index");
+
+		lua_pushcfunction(pState, &LuaSandbox::ReadOnlyNewIndex);
+		lua_setfield(pState, -2, "__newindex");
+
+		lua_pushvalue(pState, table);
+		lua_pushcclosure(pState, &LuaSandbox::ReadOnlyLength, 1);
+		lua_setfield(pState, -2, "__len");
+
+		// next(t) of the original would leak it, The iterator keeps it in an upvalue instead.
+		lua_pushvalue(pState, table);
+		lua_pushvalue(pState, proxies);
+		lua_pushvalue(pState, originals);
+		lua_pushcclosure(pState, &LuaSandbox::ReadOnlyPairs, 3);
+		lua_setfield(pState, -2, "__pairs");
+
+		lua_pushboolean(pState, 0);
+		lua_setfield(pState, -2, "__metatable");
+
+		lua_setmetatable(pState, -2);													// [t, proxy]
+
+		lua_pushvalue(pState, table);
+		lua_pushvalue(pState, -2);
+		lua_rawset(pState, proxies);													// proxies[t] = proxy
+
+		lua_pushvalue(pState, -1);
+		lua_pushvalue(pState, table);
+		lua_rawset(pState, originals);													// originals[proxy] = t
+
+		lua_remove(pState, table);														// [proxy]
+	}
+
+	int LuaSandbox::ReadOnlyIndex(lua_State* pState)
+	{
+		ToOriginal(pState, 2, lua_upvalueindex(3));
+		lua_settop(pState, 2);															// [proxy, key]
+		lua_gettable(pState, lua_upvalueindex(1));										// [proxy, value]
+
+		if (lua_istable(pState, -1))
+			PushReadOnly(pState, lua_upvalueindex(2), lua_upvalueindex(3));			// [proxy, proxied]
+
+		return 1;
+	}
+
+	int LuaSandbox::ReadOnlyNewIndex(lua_State* pState)
+	{
+		return luaL_error(pState, "attempt to modify a read-only table (key '%s')", luaL_tolstring(pState, 2, nullptr));
+	}
+
+	int LuaSandbox::ReadOnlyLength(lua_State* pState)
+	{
+		lua_pushinteger(pState, static_cast<lua_Integer>(lua_rawlen(pState, lua_upvalueindex(1))));
+		return 1;
+	}
+
+	int LuaSandbox::ReadOnlyPairs(lua_State* pState)
+	{
+		lua_pushvalue(pState, lua_upvalueindex(1));
+		lua_pushvalue(pState, lua_upvalueindex(2));
+		lua_pushvalue(pState, lua_upvalueindex(3));
+		lua_pushcclosure(pState, &LuaSandbox::ReadOnlyNext, 3);						// [next]
+		lua_pushvalue(pState, 1);														// [next, proxy]
+		lua_pushnil(pState);															// [next, proxy, nil]
+		return 3;
+	}
+
+	int LuaSandbox::ReadOnlyNext(lua_State* pState)
+	{
+		lua_settop(pState, 2);															// [proxy, key]
+		ToOriginal(pState, 2, lua_upvalueindex(3));
+
+		if (lua_next(pState, lua_upvalueindex(1)) == 0)								// [proxy, key, value]
+		{
+			lua_pushnil(pState);
+			return 1;
+		}
+
+		if (lua_istable(pState, -1))
+			PushReadOnly(pState, lua_upvalueindex(2), lua_upvalueindex(3));			// [proxy, key, proxied]
+
+		if (lua_istable(pState, -2))
+		{
+			lua_pushvalue(pState, -2);
+			PushReadOnly(pState, lua_upvalueindex(2), lua_upvalueindex(3));			// [proxy, key, value, proxied]
+			lua_replace(pState, -3);													// [proxy, proxied, value]
+		}
+
+		return 2;
+	}
+}
\ No newline at end of file
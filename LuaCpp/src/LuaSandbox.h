@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <LuaVar.h>
+
+namespace lpp
+{
+	/// \class LuaSandbox
+	/// \brief Hands out cheap `_ENV` tables for untrusted scripts, Sharing one read-only base built from a whitelist of globals.
+	///
+	/// The base holds only the whitelisted globals, Dotted names like "os.time" take single functions out of a library.
+	/// Whitelisted tables and every table reached through them are exposed as read-only proxies, So one script can not patch `string`,
+	/// `math` or a nested field of a shared config for another.
+	/// An environment is an empty table falling back to the base through `__index`, Globals a script sets stay in its own environment.
+	/// Many sandboxes in one state cost a table each instead of a LuaState each.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaSandbox sandbox(&state);
+	/// LuaVar environment = sandbox.CreateEnvironment();
+	/// state.Execute("count = (count or 0) + 1", environment);
+	/// ~~~~~
+	///
+	/// \devnote Nested tables get their proxy when a script first reaches them, A weak cache shared by the sandbox hands out the same proxy
+	/// for a table reached twice or through a cycle. The constructor locks the metatable of strings with `__metatable` since it leads to the
+	/// original `string` table.
+	/// Whitelisting `rawset`, `debug`, `load` or `require` opens holes in the sandbox, None of them are in the default whitelist.
+	class LuaSandbox
+	{
+		LuaState* m_pState;
+		LuaVar m_base;
+		LuaVar m_environmentMeta;
+
+	public:
+		/// Safe globals: the base functions without file access or raw writes, string, table, math, utf8, coroutine and the clock of os.
+		static const std::vector<std::string>& GetDefaultWhitelist();
+
+		/// Builds the base from the current globals of the state, Missing globals are skipped.
+		explicit LuaSandbox(LuaState* pState, const std::vector<std::string>& whitelist = GetDefaultWhitelist());
+
+		/// Creates a new environment, Pass it to LuaState::Execute() or LuaState::LoadScript(). `_G` of the environment is itself.
+		LuaVar CreateEnvironment() const;
+
+		/// The shared base of every environment, Scripts can not reach it.
+		const LuaVar& GetBase() const { return m_base; }
+
+	private:
+
+		/// Replaces the table at the top of the stack with its read-only proxy, Creating the proxy when the table has none yet.
+		/// \param proxies \param originals Absolute or upvalue indices of the caches mapping tables to proxies and back.
+		static void PushReadOnly(lua_State* pState, int proxies, int originals);
+
+		static int ReadOnlyIndex(lua_State* pState);
+		static int ReadOnlyNewIndex(lua_State* pState);
+		static int ReadOnlyLength(lua_State* pState);
+		static int ReadOnlyPairs(lua_State* pState);
+		static int ReadOnlyNext(lua_State* pState);
+	};
+}
\ No newline at end of file
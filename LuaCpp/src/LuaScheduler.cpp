@@ -0,0 +1,363 @@
+#include "LuaScheduler.h"
+
+#include <chrono>
+#include <cmath>
+
+#include <LuaVar.h>
+
+namespace lpp
+{
+	// Tolerance for comparing wake times against the wheel time, Which accumulates rounding errors.
+	constexpr double kTimeEpsilon = 1e-9;
+
+#pragma region Initialization / Construction
+
+	LuaScheduler::LuaScheduler(LuaState* pState, double resolution, size_t slotCount)
+		: m_pState(pState)
+		, m_nextId(1)
+		, m_wheel(slotCount > 0 ? slotCount : 1)
+		, m_wheelCursor(0)
+		, m_wheelTime(0.0)
+		, m_resolution(resolution > 0.0 ? resolution : kDefaultResolution)
+		, m_sleepingCount(0)
+		, m_now(0.0)
+		, m_timeBudget(0.0)
+	{
+		lua_State* L = m_pState->GetState();
+
+		lua_pushlightuserdata(L, this);
+		lua_pushcclosure(L, &LuaScheduler::LuaWait, 1);
+		lua_setglobal(L, "wait");
+
+		lua_pushlightuserdata(L, this);
+		lua_pushcclosure(L, &LuaScheduler::LuaWaitEvent, 1);
+		lua_setglobal(L, "waitEvent");
+	}
+
+	LuaScheduler::~LuaScheduler()
+	{
+		lua_State* L = m_pState->GetState();
+
+		// The globals point at this scheduler.
+		lua_pushnil(L);
+		lua_setglobal(L, "wait");
+		lua_pushnil(L);
+		lua_setglobal(L, "waitEvent");
+	}
+
+#pragma endregion
+
+#pragma region Tasks
+
+	LuaScheduler::TaskId LuaScheduler::AddTask(LuaCoroutine&& coroutine)
+	{
+		TaskId id = m_nextId++;
+
+		m_threadTasks[coroutine.GetThread()] = id;
+
+		Task task;
+		task.coroutine = std::move(coroutine);
+		m_tasks.emplace(id, std::move(task));
+
+		return id;
+	}
+
+	void LuaScheduler::RemoveTask(TaskId id)
+	{
+		auto it = m_tasks.find(id);
+		if (it == m_tasks.end())
+			return;
+
+		if (it->second.state == LuaTaskState::Sleeping)
+			--m_sleepingCount;
+
+		m_threadTasks.erase(it->second.coroutine.GetThread());
+
+		// The coroutine returns its thread to the pool of the state.
+		m_tasks.erase(it);
+	}
+
+	void LuaScheduler::Kill(TaskId id)
+	{
+		Task* pTask = FindTask(id);
+		if (!pTask)
+			return;
+
+		// Killed from inside its own coroutine, Remove it once it suspends.
+		if (pTask->state == LuaTaskState::Running)
+		{
+			pTask->isKilled = true;
+			return;
+		}
+
+		RemoveTask(id);
+	}
+
+	void LuaScheduler::Wake(TaskId id)
+	{
+		Task* pTask = FindTask(id);
+		if (!pTask)
+			return;
+
+		if (pTask->state == LuaTaskState::Sleeping || pTask->state == LuaTaskState::WaitingEvent)
+			MakeRunnable(id);
+	}
+
+	void LuaScheduler::Signal(const std::string& eventName)
+	{
+		std::unique_lock<std::mutex> lock(m_signalMutex);
+		m_signals.push_back(eventName);
+	}
+
+	LuaTaskState LuaScheduler::GetTaskState(TaskId id) const
+	{
+		auto it = m_tasks.find(id);
+		return it != m_tasks.end() ? it->second.state : LuaTaskState::Runnable;
+	}
+
+	LuaScheduler::Task* LuaScheduler::FindTask(TaskId id)
+	{
+		auto it = m_tasks.find(id);
+		return it != m_tasks.end() ? &it->second : nullptr;
+	}
+
+	void LuaScheduler::MakeRunnable(TaskId id)
+	{
+		Task* pTask = FindTask(id);
+		if (!pTask)
+			return;
+
+		if (pTask->state == LuaTaskState::Sleeping)
+			--m_sleepingCount;
+
+		pTask->state = LuaTaskState::Runnable;
+		m_runQueue.push_back(id);
+	}
+
+	void LuaScheduler::OnSuspended(TaskId id)
+	{
+		Task* pTask = FindTask(id);
+		if (!pTask)
+			return;
+
+		LuaCoroutine& coroutine = pTask->coroutine;
+
+		if (pTask->isKilled || coroutine.GetStatus() == LuaCoroutineStatus::Dead)
+		{
+			RemoveTask(id);
+			return;
+		}
+
+		if (coroutine.GetStatus() == LuaCoroutineStatus::Error)
+		{
+			if (m_errorHandler)
+				m_errorHandler(id, coroutine.GetError());
+
+			//DEBUG_LOG("Scheduled coroutine failed: %s", coroutine.GetError().c_str());
+			RemoveTask(id);
+			return;
+		}
+
+		if (coroutine.IsWaiting())
+		{
+			pTask->state = LuaTaskState::WaitingPending;
+			return;
+		}
+
+		// `wait` and `waitEvent` already parked the task, A plain yield continues next tick.
+		if (pTask->state == LuaTaskState::Running)
+		{
+			pTask->state = LuaTaskState::Runnable;
+			m_nextTickQueue.push_back(id);
+		}
+	}
+
+	bool LuaScheduler::RunTask(TaskId id)
+	{
+		Task* pTask = FindTask(id);
+
+		// Stale entry of a task that was killed or woken twice.
+		if (!pTask || pTask->state != LuaTaskState::Runnable)
+			return false;
+
+		pTask->state = LuaTaskState::Running;
+		pTask->coroutine.Resume();
+
+		OnSuspended(id);
+		return true;
+	}
+
+#pragma endregion
+
+#pragma region Tick / Timer Wheel
+
+	size_t LuaScheduler::Tick(double now)
+	{
+		m_now = now;
+
+		// Events signaled since the last tick.
+		std::vector<std::string> signals;
+		{
+			std::unique_lock<std::mutex> lock(m_signalMutex);
+			signals.swap(m_signals);
+		}
+
+		for (const std::string& eventName : signals)
+		{
+			auto it = m_eventWaiters.find(eventName);
+			if (it == m_eventWaiters.end())
+				continue;
+
+			for (TaskId id : it->second)
+			{
+				Task* pTask = FindTask(id);
+				if (pTask && pTask->state == LuaTaskState::WaitingEvent)
+					MakeRunnable(id);
+			}
+
+			m_eventWaiters.erase(it);
+		}
+
+		// Pending results of bound functions that completed.
+		m_readyThreads.clear();
+		m_pState->GetPendingQueue().PopReady(m_readyThreads);
+
+		for (lua_State* pThread : m_readyThreads)
+		{
+			auto it = m_threadTasks.find(pThread);
+			if (it == m_threadTasks.end())
+				continue;
+
+			Task* pTask = FindTask(it->second);
+			if (pTask && pTask->state == LuaTaskState::WaitingPending)
+				MakeRunnable(it->second);
+		}
+
+		AdvanceWheel(now);
+
+		// Coroutines that yielded since the last tick.
+		m_runQueue.insert(m_runQueue.end(), m_nextTickQueue.begin(), m_nextTickQueue.end());
+		m_nextTickQueue.clear();
+
+		// Resume what is due, Always resume at least one task so a tiny budget can't stall the scheduler.
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point start = Clock::now();
+
+		size_t resumeCount = 0;
+		while (!m_runQueue.empty())
+		{
+			if (m_timeBudget > 0.0 && resumeCount > 0)
+			{
+				std::chrono::duration<double> elapsed = Clock::now() - start;
+				if (elapsed.count() >= m_timeBudget)
+					break;
+			}
+
+			TaskId id = m_runQueue.front();
+			m_runQueue.pop_front();
+
+			if (RunTask(id))
+				++resumeCount;
+		}
+
+		return resumeCount;
+	}
+
+	void LuaScheduler::Schedule(TaskId id, double wakeTime)
+	{
+		Task* pTask = FindTask(id);
+		if (!pTask)
+			return;
+
+		pTask->state = LuaTaskState::Sleeping;
+		pTask->wakeTime = wakeTime;
+		++m_sleepingCount;
+
+		// Round up to the first slot starting at or after the wake time, At least the next slot.
+		double slots = std::ceil((wakeTime - m_wheelTime) / m_resolution - kTimeEpsilon);
+		size_t ticks = slots > 1.0 ? static_cast<size_t>(slots) : 1;
+
+		size_t slot = (m_wheelCursor + ticks) % m_wheel.size();
+		m_wheel[slot].push_back({ id, wakeTime });
+	}
+
+	void LuaScheduler::AdvanceWheel(double now)
+	{
+		const size_t slotCount = m_wheel.size();
+		size_t steps = 0;
+
+		while (m_wheelTime + m_resolution <= now + kTimeEpsilon)
+		{
+			if (steps == slotCount)
+			{
+				// Every slot was visited once, Jump the wheel ahead instead of spinning it more.
+				size_t skipped = static_cast<size_t>((now - m_wheelTime) / m_resolution);
+				m_wheelTime += skipped * m_resolution;
+				m_wheelCursor = (m_wheelCursor + skipped) % slotCount;
+				break;
+			}
+
+			m_wheelCursor = (m_wheelCursor + 1) % slotCount;
+			m_wheelTime += m_resolution;
+			++steps;
+
+			std::vector<TimerEntry>& entries = m_wheel[m_wheelCursor];
+
+			// Entries that are not due belong to a later rotation of the wheel.
+			size_t kept = 0;
+			for (const TimerEntry& entry : entries)
+			{
+				if (entry.wakeTime > now + kTimeEpsilon)
+				{
+					entries[kept++] = entry;
+					continue;
+				}
+
+				// Ignore timers of tasks that were woken or killed in the meantime.
+				Task* pTask = FindTask(entry.id);
+				if (pTask && pTask->state == LuaTaskState::Sleeping && pTask->wakeTime == entry.wakeTime)
+					MakeRunnable(entry.id);
+			}
+
+			entries.resize(kept);
+		}
+	}
+
+#pragma endregion
+
+#pragma region Lua Functions
+
+	int LuaScheduler::LuaWait(lua_State* pState)
+	{
+		LuaScheduler* pScheduler = static_cast<LuaScheduler*>(lua_touserdata(pState, lua_upvalueindex(1)));
+
+		auto it = pScheduler->m_threadTasks.find(pState);
+		if (it == pScheduler->m_threadTasks.end() || !lua_isyieldable(pState))
+			return luaL_error(pState, "wait can only be called from a coroutine started by LuaScheduler::Spawn.");
+
+		double seconds = luaL_optnumber(pState, 1, 0.0);
+		pScheduler->Schedule(it->second, pScheduler->m_now + seconds);
+
+		return lua_yield(pState, 0);
+	}
+
+	int LuaScheduler::LuaWaitEvent(lua_State* pState)
+	{
+		LuaScheduler* pScheduler = static_cast<LuaScheduler*>(lua_touserdata(pState, lua_upvalueindex(1)));
+
+		auto it = pScheduler->m_threadTasks.find(pState);
+		if (it == pScheduler->m_threadTasks.end() || !lua_isyieldable(pState))
+			return luaL_error(pState, "waitEvent can only be called from a coroutine started by LuaScheduler::Spawn.");
+
+		const char* eventName = luaL_checkstring(pState, 1);
+
+		Task* pTask = pScheduler->FindTask(it->second);
+		pTask->state = LuaTaskState::WaitingEvent;
+		pScheduler->m_eventWaiters[eventName].push_back(it->second);
+
+		return lua_yield(pState, 0);
+	}
+
+#pragma endregion
+
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <LuaCoroutine.h>
+#include <LuaState.h>
+
+namespace lpp
+{
+	class LuaVar;
+
+	enum class LuaTaskState
+	{
+		Runnable,		///< Queued to run on the next Tick().
+		Running,		///< Currently resumed.
+		Sleeping,		///< Called `wait(seconds)`, Woken by the timer wheel.
+		WaitingEvent,	///< Called `waitEvent(name)`, Woken by LuaScheduler::Signal().
+		WaitingPending,	///< Suspended on a LuaPending result of a bound function.
+	};
+
+	/// \class LuaScheduler
+	/// \brief Owns many coroutines of one LuaState and only resumes the ones that have something to do.
+	///
+	/// Scripts suspend themselves with the registered globals `wait(seconds)` and `waitEvent(name)`, Or by awaiting a LuaPending result.
+	/// A plain `coroutine.yield()` continues on the next tick. Sleeping coroutines are kept in a hashed timer wheel,
+	/// So a Tick() only touches the wheel slots that passed and the coroutines that are due.
+	///
+	/// The scheduler is driven from the host loop with Tick(now) where `now` is in seconds on any monotonic clock.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaScheduler scheduler(&state);
+	/// scheduler.SetTimeBudget(0.002);
+	/// scheduler.Spawn(LuaVar(&state, "GuardBehaviour"), guardTable);
+	///
+	/// while (running)
+	///		scheduler.Tick(clock.GetSeconds());
+	/// ~~~~~
+	class LuaScheduler
+	{
+	public:
+		using TaskId = uint64_t;
+		using ErrorHandler = std::function<void(TaskId, const std::string&)>;
+
+		static constexpr TaskId kInvalidTask = 0;
+		static constexpr double kDefaultResolution = 1.0 / 60.0;
+		static constexpr size_t kDefaultSlotCount = 256;
+
+	private:
+		struct Task
+		{
+			LuaCoroutine coroutine;
+			LuaTaskState state = LuaTaskState::Runnable;
+			double wakeTime = 0.0;
+			bool isKilled = false;
+		};
+
+		struct TimerEntry
+		{
+			TaskId id;
+			double wakeTime;
+		};
+
+		LuaState* m_pState;
+
+		std::unordered_map<TaskId, Task> m_tasks;
+		std::unordered_map<lua_State*, TaskId> m_threadTasks;
+		TaskId m_nextId;
+
+		std::deque<TaskId> m_runQueue;
+		std::vector<TaskId> m_nextTickQueue;
+
+		std::vector<std::vector<TimerEntry>> m_wheel;
+		size_t m_wheelCursor;
+		double m_wheelTime;
+		double m_resolution;
+		size_t m_sleepingCount;
+
+		std::unordered_map<std::string, std::vector<TaskId>> m_eventWaiters;
+		std::mutex m_signalMutex;
+		std::vector<std::string> m_signals;
+
+		std::vector<lua_State*> m_readyThreads;
+
+		double m_now;
+		double m_timeBudget;
+		ErrorHandler m_errorHandler;
+
+	public:
+		/// Creates a scheduler and registers `wait` and `waitEvent` as globals of the state.
+		/// \param resolution Width of a timer wheel slot in seconds, Sleeps are rounded up to it.
+		/// \param slotCount Amount of slots in the timer wheel.
+		explicit LuaScheduler(LuaState* pState, double resolution = kDefaultResolution, size_t slotCount = kDefaultSlotCount);
+		~LuaScheduler();
+
+		LuaScheduler(const LuaScheduler&) = delete;
+		LuaScheduler& operator=(const LuaScheduler&) = delete;
+
+		/// Starts the function as a new coroutine, It runs right away until it suspends for the first time.
+		/// \return The id of the task or kInvalidTask if the function finished or failed during its first run.
+		template<typename... Args>
+		TaskId Spawn(const LuaVar& function, Args&&... args);
+
+		/// Stops the task, Its coroutine is never resumed again.
+		void Kill(TaskId id);
+
+		/// Wakes a task immediately regardless of what it is waiting on, Except pending results which can't be interrupted.
+		void Wake(TaskId id);
+
+		/// Wakes every task waiting on the event on the next Tick(). Can be called from any thread.
+		void Signal(const std::string& eventName);
+
+		/// Advances the timers to `now` and resumes every task that is due, Within the time budget.
+		/// \return The amount of coroutines resumed.
+		size_t Tick(double now);
+
+		/// Limits the wall-clock time a Tick() spends resuming coroutines, Remaining tasks run on the next tick. Zero disables the budget.
+		void SetTimeBudget(double seconds) { m_timeBudget = seconds; }
+
+		/// Called when a task raises an error, The task is removed afterwards.
+		void SetErrorHandler(ErrorHandler handler) { m_errorHandler = std::move(handler); }
+
+		bool HasTask(TaskId id) const { return m_tasks.find(id) != m_tasks.end(); }
+		LuaTaskState GetTaskState(TaskId id) const;
+
+		size_t GetTaskCount() const { return m_tasks.size(); }
+		size_t GetRunnableCount() const { return m_runQueue.size() + m_nextTickQueue.size(); }
+		size_t GetSleepingCount() const { return m_sleepingCount; }
+
+		/// The time passed to the last Tick().
+		double GetTime() const { return m_now; }
+
+	private:
+
+		TaskId AddTask(LuaCoroutine&& coroutine);
+
+		/// Updates the task after its coroutine returned control, Parks it, requeues it or removes it.
+		void OnSuspended(TaskId id);
+
+		void RemoveTask(TaskId id);
+
+		/// Resumes a task from the run queue.
+		bool RunTask(TaskId id);
+
+		void Schedule(TaskId id, double wakeTime);
+
+		/// Moves the timers that passed into the run queue.
+		void AdvanceWheel(double now);
+
+		void MakeRunnable(TaskId id);
+
+		Task* FindTask(TaskId id);
+
+		/// `wait(seconds)`
+		static int LuaWait(lua_State* pState);
+
+		/// `waitEvent(name)`
+		static int LuaWaitEvent(lua_State* pState);
+	};
+
+#pragma region Template Definitions
+
+	template<typename... Args>
+	inline LuaScheduler::TaskId LuaScheduler::Spawn(const LuaVar& function, Args&&... args)
+	{
+		LuaCoroutine coroutine(m_pState, function);
+		if (!coroutine.IsSuspended())
+			return kInvalidTask;
+
+		TaskId id = AddTask(std::move(coroutine));
+		Task& task = m_tasks.at(id);
+
+		task.state = LuaTaskState::Running;
+		task.coroutine.Resume(std::forward<Args>(args)...);
+
+		OnSuspended(id);
+		return HasTask(id) ? id : kInvalidTask;
+	}
+
+#pragma endregion
+
+}
\ No newline at end of file
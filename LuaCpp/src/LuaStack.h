@@ -3,6 +3,7 @@
 #include <type_traits>
 
 #include <lua.hpp>
+#include <LuaStats.h>
 #include <LuaVar.h>
 
 namespace lpp
@@ -39,6 +40,10 @@ namespace lpp
 		template<typename Type>
 		static void Push(lua_State* pState, Type&& val);
 
+		/// The kind of value Push() pushes for the type, Counted by LuaStats.
+		template<typename Type>
+		static constexpr LuaPushType GetPushType();
+
 		/// Do not allow popping more than the amount of items on the stack.
 		static bool SafePop(lua_State* pState, int amount);
 
@@ -72,7 +77,9 @@ namespace lpp
 		}
 		else if constexpr (std::is_same_v<std::string, decayed_t>)
 		{
-			return std::string(lua_tostring(pState, index));
+			size_t length = 0;
+			const char* str = lua_tolstring(pState, index, &length);
+			return std::string(str, length);
 		}
 		else
 		{
@@ -151,7 +158,7 @@ namespace lpp
 		}
 		else if constexpr (std::is_same_v<std::string, decayed_t>)
 		{
-			lua_pushstring(pState, val.c_str());
+			lua_pushlstring(pState, val.data(), val.size());
 		}
 		else if constexpr (std::is_pointer_v<decayed_t>)
 		{
@@ -159,7 +166,8 @@ namespace lpp
 		}
 		else if constexpr (std::is_same_v<LuaVar, decayed_t>)
 		{
-			val.PushToStack();
+			if (!val.PushToStack(pState))
+				lua_pushnil(pState);
 		}
 		else if constexpr (std::is_null_pointer_v<decayed_t>)
 		{
@@ -171,4 +179,25 @@ namespace lpp
 		}
 	}
 
+	template<typename Type>
+	inline constexpr LuaPushType LuaStack::GetPushType()
+	{
+		using decayed_t = std::decay_t<Type>;
+
+		if constexpr (std::is_same_v<bool, decayed_t>)
+			return LuaPushType::Boolean;
+		else if constexpr (std::is_integral_v<decayed_t> || std::is_enum_v<decayed_t>)
+			return LuaPushType::Integer;
+		else if constexpr (std::is_floating_point_v<decayed_t>)
+			return LuaPushType::Number;
+		else if constexpr (is_c_string_v<decayed_t> || std::is_same_v<std::string, decayed_t>)
+			return LuaPushType::String;
+		else if constexpr (std::is_pointer_v<decayed_t>)
+			return LuaPushType::LightUserdata;
+		else if constexpr (std::is_same_v<LuaVar, decayed_t>)
+			return LuaPushType::Reference;
+		else
+			return LuaPushType::Nil;
+	}
+
 }
\ No newline at end of file
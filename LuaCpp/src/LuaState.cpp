@@ -1,27 +1,218 @@
 #include "LuaState.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
 #include <LuaVar.h>
+#include <LuaAllocationProfiler.h>
+#include <LuaArenaAllocator.h>
+#include <LuaBudget.h>
+#include <LuaBytecodeCache.h>
+#include <LuaProfiler.h>
+#include <LuaTracer.h>
 
 
 namespace lpp
 {
+	namespace
+	{
+		// Registry table of the libraries not opened yet, Name to luaopen function.
+		constexpr const char* kLazyLibrariesKey = "lpp.LazyLibraries";
+
+		struct LibraryInfo
+		{
+			LuaLibrary library;
+			const char* name;
+			lua_CFunction open;
+		};
+
+		// In the order of luaL_openlibs.
+		constexpr LibraryInfo kLibraries[] =
+		{
+			{ LuaLibrary::Base, LUA_GNAME, luaopen_base },
+			{ LuaLibrary::Package, LUA_LOADLIBNAME, luaopen_package },
+			{ LuaLibrary::Coroutine, LUA_COLIBNAME, luaopen_coroutine },
+			{ LuaLibrary::Table, LUA_TABLIBNAME, luaopen_table },
+			{ LuaLibrary::IO, LUA_IOLIBNAME, luaopen_io },
+			{ LuaLibrary::OS, LUA_OSLIBNAME, luaopen_os },
+			{ LuaLibrary::String, LUA_STRLIBNAME, luaopen_string },
+			{ LuaLibrary::Math, LUA_MATHLIBNAME, luaopen_math },
+			{ LuaLibrary::UTF8, LUA_UTF8LIBNAME, luaopen_utf8 },
+			{ LuaLibrary::Debug, LUA_DBLIBNAME, luaopen_debug },
+		};
+
+		/// Opens a lazy library and pushes it, Pushes nothing when it is not lazy or already open.
+		bool OpenLazyLibrary(lua_State* pState, const char* name)
+		{
+			lua_getfield(pState, LUA_REGISTRYINDEX, kLazyLibrariesKey);			// [lazy]
+			lua_getfield(pState, -1, name);											// [lazy, open]
+
+			lua_CFunction open = lua_tocfunction(pState, -1);
+			if (!open)
+			{
+				lua_pop(pState, 2);
+				return false;
+			}
+
+			lua_pop(pState, 1);														// [lazy]
+			lua_pushnil(pState);
+			lua_setfield(pState, -2, name);
+			lua_pop(pState, 1);														// []
+
+			//DEBUG_LOG("Opening lazy library: %s", name);
+			luaL_requiref(pState, name, open, 1);									// [library]
+			return true;
+		}
+
+		/// `__index` of `_G`, Opens a library the first time its global is read.
+		int IndexLazyGlobal(lua_State* pState)
+		{
+			if (lua_type(pState, 2) != LUA_TSTRING)
+				return 0;
+
+			const char* key = lua_tostring(pState, 2);
+
+			// The package library defines the require global.
+			if (std::strcmp(key, "require") == 0)
+			{
+				if (!OpenLazyLibrary(pState, LUA_LOADLIBNAME))
+					return 0;
+
+				lua_getfield(pState, 1, "require");
+				return 1;
+			}
+
+			return OpenLazyLibrary(pState, key) ? 1 : 0;
+		}
+
+		/// `__index` of the string metatable, So methods like `s:upper()` work before the string global was read.
+		int IndexLazyString(lua_State* pState)
+		{
+			if (!OpenLazyLibrary(pState, LUA_STRLIBNAME))							// [s, key, string]
+				return 0;
+
+			lua_pushvalue(pState, 2);
+			lua_gettable(pState, -2);												// [s, key, string, value]
+			return 1;
+		}
+
+		/// `package.preload` loader of a lazy library, The name is the first argument.
+		int RequireLazyLibrary(lua_State* pState)
+		{
+			const char* name = luaL_checkstring(pState, 1);
+			if (!OpenLazyLibrary(pState, name))
+				lua_getglobal(pState, name);
+
+			return 1;
+		}
+	}
+
+	LuaState::LuaState(LuaArenaAllocator* pArena)
+		: LuaState(CreateState(&LuaArenaAllocator::Allocate, pArena))
+	{
+		m_pArena = pArena;
+	}
+
 	LuaState::~LuaState()
 	{
+		// Every object lives in the arena, No need to free them one by one.
+		if (m_pArena)
+		{
+			m_pArena->Reset();
+			return;
+		}
+
 		//Cleanup the state.
+		m_isClosing = true;
 		lua_close(m_pState);
 	}
 
-	bool LuaState::Init()
+	bool LuaState::Init(LuaLibrary libraries, LuaLibrary lazyLibraries)
 	{
-		m_pState = luaL_newstate();
-		luaL_openlibs(m_pState);
+		// The constructor already created a state, Only create one when wrapping nothing.
+		if (!m_pState)
+		{
+			// The arena was too small to even create the state.
+			if (m_pArena)
+				return false;
+
+			m_pState = luaL_newstate();
+			BindExtraSpace();
+			InstallCycleCounter();
+		}
+
+		OpenLibraries(libraries, lazyLibraries);
 
 		return true;
 	}
 
+	void LuaState::OpenLibraries(LuaLibrary libraries, LuaLibrary lazyLibraries)
+	{
+		libraries = libraries | LuaLibrary::Base;
+		lazyLibraries = lazyLibraries & ~libraries;
+
+		for (const LibraryInfo& info : kLibraries)
+		{
+			if ((libraries & info.library) != LuaLibrary::None)
+			{
+				luaL_requiref(m_pState, info.name, info.open, 1);
+				lua_pop(m_pState, 1);
+			}
+		}
+
+		if (lazyLibraries == LuaLibrary::None)
+			return;
+
+		lua_newtable(m_pState);														// [lazy]
+		for (const LibraryInfo& info : kLibraries)
+		{
+			if ((lazyLibraries & info.library) != LuaLibrary::None)
+			{
+				lua_pushcfunction(m_pState, info.open);
+				lua_setfield(m_pState, -2, info.name);
+			}
+		}
+		lua_setfield(m_pState, LUA_REGISTRYINDEX, kLazyLibrariesKey);				// []
+
+		lua_pushglobaltable(m_pState);												// [_G]
+		lua_newtable(m_pState);														// [_G, mt]
+		lua_pushcfunction(m_pState, &IndexLazyGlobal);
+		lua_setfield(m_pState, -2, "__index");
+		lua_setmetatable(m_pState, -2);												// [_G]
+		lua_pop(m_pState, 1);														// []
+
+		// Opening the string library replaces this metatable with its own.
+		if ((lazyLibraries & LuaLibrary::String) != LuaLibrary::None)
+		{
+			lua_pushliteral(m_pState, "");											// [""]
+			lua_newtable(m_pState);													// ["", mt]
+			lua_pushcfunction(m_pState, &IndexLazyString);
+			lua_setfield(m_pState, -2, "__index");
+			lua_setmetatable(m_pState, -2);											// [""]
+			lua_pop(m_pState, 1);													// []
+		}
+
+		// A lazy package library picks up the preload table from the registry when it opens.
+		if (((libraries | lazyLibraries) & LuaLibrary::Package) != LuaLibrary::None)
+		{
+			luaL_getsubtable(m_pState, LUA_REGISTRYINDEX, LUA_PRELOAD_TABLE);		// [preload]
+			for (const LibraryInfo& info : kLibraries)
+			{
+				if ((lazyLibraries & info.library) != LuaLibrary::None)
+				{
+					lua_pushcfunction(m_pState, &RequireLazyLibrary);
+					lua_setfield(m_pState, -2, info.name);
+				}
+			}
+			lua_pop(m_pState, 1);													// []
+		}
+	}
+
 	bool LuaState::LoadScript(const char* fileName)
 	{
-		int result = luaL_loadfile(m_pState, fileName);
+		int result = m_pBytecodeCache ? m_pBytecodeCache->Load(m_pState, fileName) : luaL_loadfile(m_pState, fileName);
 		
 		if (result == LUA_ERRFILE)
 		{
@@ -38,6 +229,55 @@ namespace lpp
 
 		if (lua_pcall(m_pState, 0, 0, 0) != LUA_OK)
 		{
+			LUACPP_STATS(m_stats.OnCallFailed();)
+			//DEBUG_LOG("%s : %s", fileName, lua_tostring(m_pState, -1));
+			lua_pop(m_pState, 1);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool LuaState::LoadScript(std::string_view code, const char* chunkName)
+	{
+		if (m_chunkCache.Push(code, chunkName) != LUA_OK)
+		{
+			//DEBUG_LOG("%s", lua_tostring(m_pState, -1));
+			lua_pop(m_pState, 1);
+			return false;
+		}
+
+		if (lua_pcall(m_pState, 0, 0, 0) != LUA_OK)
+		{
+			LUACPP_STATS(m_stats.OnCallFailed();)
+			//DEBUG_LOG("%s", lua_tostring(m_pState, -1));
+			lua_pop(m_pState, 1);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool LuaState::LoadScript(const char* fileName, const LuaVar& environment)
+	{
+		// Lua does not verify bytecode so only source is accepted, The cache only loads bytecode it compiled from source itself.
+		int result = m_pBytecodeCache ? m_pBytecodeCache->Load(m_pState, fileName) : luaL_loadfilex(m_pState, fileName, "t");
+		if (result != LUA_OK)
+		{
+			//DEBUG_LOG("%s : %s", fileName, lua_tostring(m_pState, -1));
+			lua_pop(m_pState, 1);
+			return false;
+		}
+																					// [func]
+		// The first upvalue of a main chunk compiled from source is always _ENV.
+		if (!environment.PushToStack(m_pState))
+			lua_newtable(m_pState);													// [func, env]
+
+		lua_setupvalue(m_pState, -2, 1);											// [func]
+
+		if (lua_pcall(m_pState, 0, 0, 0) != LUA_OK)
+		{
+			LUACPP_STATS(m_stats.OnCallFailed();)
 			//DEBUG_LOG("%s : %s", fileName, lua_tostring(m_pState, -1));
 			lua_pop(m_pState, 1);
 			return false;
@@ -46,6 +286,325 @@ namespace lpp
 		return true;
 	}
 
+	bool LuaState::LoadScript(std::string_view code, const char* chunkName, const LuaVar& environment)
+	{
+		// Everything before the code stays on the first line.
+		std::string factory = "local _ENV = ...; return function(...) ";
+		factory.append(code);
+		factory.append("\nend");
+
+		// Like luaL_loadstring the code is the chunk name when there is none, Not the factory.
+		const std::string codeName = chunkName ? std::string() : std::string(code);
+
+		if (m_chunkCache.Push(factory, chunkName ? chunkName : codeName.c_str()) != LUA_OK)
+		{
+			//DEBUG_LOG("%s", lua_tostring(m_pState, -1));
+			lua_pop(m_pState, 1);
+			return false;
+		}
+																					// [factory]
+		if (!environment.PushToStack(m_pState))
+			lua_newtable(m_pState);													// [factory, env]
+
+		if (lua_pcall(m_pState, 1, 1, 0) != LUA_OK || lua_pcall(m_pState, 0, 0, 0) != LUA_OK)
+		{
+			LUACPP_STATS(m_stats.OnCallFailed();)
+			//DEBUG_LOG("%s", lua_tostring(m_pState, -1));
+			lua_pop(m_pState, 1);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool LuaState::MountBundle(const char* path)
+	{
+		auto pBundle = std::make_unique<LuaBundle>();
+		if (!pBundle->Open(path))
+		{
+			//DEBUG_LOG("Could not mount bundle: %s", path);
+			return false;
+		}
+
+		// Each searcher goes right after the preload searcher, So later bundles override modules of earlier ones.
+		pBundle->InstallSearcher(m_pState);
+		m_bundles.push_back(std::move(pBundle));
+		return true;
+	}
+
+#pragma region Garbage Collection
+
+	LuaGCMode LuaState::SetIncrementalGC(int pause, int stepMultiplier, int stepSize)
+	{
+		const int previous = lua_gc(m_pState, LUA_GCINC, pause, stepMultiplier, stepSize);
+		return previous == LUA_GCGEN ? LuaGCMode::Generational : LuaGCMode::Incremental;
+	}
+
+	LuaGCMode LuaState::SetGenerationalGC(int minorMultiplier, int majorMultiplier)
+	{
+		const int previous = lua_gc(m_pState, LUA_GCGEN, minorMultiplier, majorMultiplier);
+		return previous == LUA_GCGEN ? LuaGCMode::Generational : LuaGCMode::Incremental;
+	}
+
+	void LuaState::SetGCRunning(bool isRunning)
+	{
+		lua_gc(m_pState, isRunning ? LUA_GCRESTART : LUA_GCSTOP);
+	}
+
+	bool LuaState::IsGCRunning()
+	{
+		return lua_gc(m_pState, LUA_GCISRUNNING) != 0;
+	}
+
+	void LuaState::CollectGarbage()
+	{
+		lua_gc(m_pState, LUA_GCCOLLECT);
+	}
+
+	bool LuaState::Step(double budgetMicros)
+	{
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point start = Clock::now();
+
+		bool isCycleFinished = false;
+		double elapsedMicros = 0.0;
+
+		do
+		{
+			++m_gcStats.stepCount;
+			isCycleFinished = lua_gc(m_pState, LUA_GCSTEP, 0) != 0;
+			elapsedMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+		}
+		while (!isCycleFinished && elapsedMicros < budgetMicros);
+
+		m_gcStats.stepMicros += elapsedMicros;
+		return isCycleFinished;
+	}
+
+	void LuaState::SetMemoryLimit(size_t bytes)
+	{
+		m_gcStats.memoryLimit = bytes;
+		UpdateAllocator();
+	}
+
+	void LuaState::SetAllocationTracking(bool isEnabled)
+	{
+		m_isTrackingAllocations = isEnabled;
+		UpdateAllocator();
+	}
+
+	void LuaState::UpdateAllocator()
+	{
+		const bool isNeeded = m_gcStats.memoryLimit > 0 || m_isTrackingAllocations;
+
+		if (isNeeded && !m_baseAlloc)
+		{
+			m_baseAlloc = lua_getallocf(m_pState, &m_pBaseAllocData);
+			m_allocatedBytes = GetHeapBytes();
+			lua_setallocf(m_pState, &LuaState::TrackingAllocate, this);
+		}
+		else if (!isNeeded && m_baseAlloc)
+		{
+			// Under a wrapper the state does not know the tracking allocator stays, It only forwards without a limit.
+			if (!RemoveAllocator(&LuaState::TrackingAllocate, this, m_baseAlloc, m_pBaseAllocData))
+				return;
+
+			m_baseAlloc = nullptr;
+			m_pBaseAllocData = nullptr;
+		}
+	}
+
+	bool LuaState::RemoveAllocator(lua_Alloc alloc, void* pUserData, lua_Alloc baseAlloc, void* pBaseAllocData)
+	{
+		void* pTopData = nullptr;
+		if (lua_getallocf(m_pState, &pTopData) == alloc && pTopData == pUserData)
+		{
+			lua_setallocf(m_pState, baseAlloc, pBaseAllocData);
+			return true;
+		}
+
+		// Wrapped by the tracking allocator or the allocation profiler installed afterwards, Which forward to its base from now on.
+		if (m_baseAlloc == alloc && m_pBaseAllocData == pUserData)
+		{
+			m_baseAlloc = baseAlloc;
+			m_pBaseAllocData = pBaseAllocData;
+			return true;
+		}
+
+		return m_pAllocationProfiler && m_pAllocationProfiler->ReplaceBaseAllocator(alloc, pUserData, baseAlloc, pBaseAllocData);
+	}
+
+	LuaStatsSnapshot LuaState::GetStatsSnapshot() const
+	{
+#ifdef LUACPP_NO_STATS
+		return LuaStatsSnapshot();
+#else
+		return m_stats.GetSnapshot();
+#endif
+	}
+
+	void LuaState::ResetStats()
+	{
+		LUACPP_STATS(m_stats.Reset();)
+	}
+
+	void LuaState::UpdateHook(lua_State* pThread)
+	{
+		int mask = 0;
+		int count = 0;
+
+		if (m_pBudget)
+		{
+			mask |= LUA_MASKCOUNT;
+			count = m_pBudget->GetHookCount();
+		}
+
+		// Only the count hook mode checks for a due sample every few instructions, The signal mode arms a one-shot hook itself.
+		if (m_pProfiler && m_pProfiler->GetMode() == LuaProfilerMode::CountHook)
+		{
+			mask |= LUA_MASKCOUNT;
+			count = count > 0 ? std::min(count, LuaProfiler::kCheckInterval) : LuaProfiler::kCheckInterval;
+		}
+
+		// An allocation waiting for the hook keeps its count of one.
+		if (m_pAllocationProfiler && m_pAllocationProfiler->HasPending())
+		{
+			mask |= LUA_MASKCOUNT;
+			count = 1;
+		}
+
+		if (m_pTracer && m_pTracer->IsTracingLua())
+			mask |= LUA_MASKCALL | LUA_MASKRET;
+
+		lua_sethook(pThread, mask ? &LuaState::Hook : nullptr, mask, count);
+	}
+
+	void LuaState::Hook(lua_State* pState, lua_Debug* pDebug)
+	{
+		LuaState* pLuaState = FromState(pState);
+
+		if (pDebug->event != LUA_HOOKCOUNT)
+		{
+			if (pLuaState->m_pTracer)
+				pLuaState->m_pTracer->OnHook(pState, pDebug);
+			else
+				pLuaState->UpdateHook(pState);
+
+			return;
+		}
+
+		// Instructions run since the count was set, Before anything below changes it.
+		const int instructionCount = lua_gethookcount(pState);
+
+		if (pLuaState->m_pProfiler && pLuaState->m_pProfiler->IsSampleDue())
+			pLuaState->m_pProfiler->Sample(pState);
+
+		if (pLuaState->m_pAllocationProfiler && pLuaState->m_pAllocationProfiler->HasPending())
+			pLuaState->m_pAllocationProfiler->ResolvePending(pState);
+
+		// Last since it may raise an error or yield.
+		if (pLuaState->m_pBudget)
+			pLuaState->m_pBudget->Check(pState, instructionCount);
+		else
+			pLuaState->UpdateHook(pState);
+	}
+
+	size_t LuaState::GetHeapBytes()
+	{
+		return static_cast<size_t>(lua_gc(m_pState, LUA_GCCOUNT)) * 1024 + static_cast<size_t>(lua_gc(m_pState, LUA_GCCOUNTB));
+	}
+
+	LuaGCStats LuaState::GetGCStats()
+	{
+		LuaGCStats stats = m_gcStats;
+		stats.heapBytes = GetHeapBytes();
+		return stats;
+	}
+
+	void LuaState::InstallCycleCounter()
+	{
+		if (!m_pState)
+			return;
+
+		constexpr const char kSentinelMetatable[] = "lpp.GCSentinel";
+
+		lua_newuserdatauv(m_pState, 0, 0);									// [sentinel]
+
+		if (luaL_newmetatable(m_pState, kSentinelMetatable))					// [sentinel, mt]
+		{
+			lua_pushcfunction(m_pState, &LuaState::OnCycleCollected);			// [sentinel, mt, func]
+			lua_setfield(m_pState, -2, "__gc");									// [sentinel, mt]
+		}
+
+		// Unreferenced right away, Its finalizer runs at the end of the next cycle. In generational mode the sentinel is young,
+		// So that is the next minor collection.
+		lua_setmetatable(m_pState, -2);										// [sentinel]
+		lua_pop(m_pState, 1);												// []
+	}
+
+	int LuaState::OnCycleCollected(lua_State* pState)
+	{
+		LuaState* pLuaState = FromState(pState);
+		if (!pLuaState || pLuaState->m_isClosing)
+			return 0;
+
+		++pLuaState->m_gcStats.cycleCount;
+		pLuaState->InstallCycleCounter();
+		return 0;
+	}
+
+	void* LuaState::TrackingAllocate(void* pUserData, void* pBlock, size_t oldSize, size_t newSize)
+	{
+		LuaState* pLuaState = static_cast<LuaState*>(pUserData);
+
+		// When allocating, oldSize holds the type of the object instead of a size.
+		const size_t oldBytes = pBlock ? oldSize : 0;
+		const size_t limit = pLuaState->m_gcStats.memoryLimit;
+
+		if (limit > 0 && newSize > oldBytes && pLuaState->m_allocatedBytes - oldBytes + newSize > limit)
+		{
+			++pLuaState->m_gcStats.limitFailureCount;
+			return nullptr;
+		}
+
+		void* pNewBlock = pLuaState->m_baseAlloc(pLuaState->m_pBaseAllocData, pBlock, oldSize, newSize);
+
+		if (pNewBlock || newSize == 0)
+		{
+			pLuaState->m_allocatedBytes = pLuaState->m_allocatedBytes - oldBytes + newSize;
+
+			if (newSize > oldBytes)
+				pLuaState->m_totalAllocatedBytes += newSize - oldBytes;
+		}
+
+		return pNewBlock;
+	}
+
+#pragma endregion
+
+	void LuaState::BindExtraSpace()
+	{
+		if (m_pState)
+			*static_cast<LuaState**>(lua_getextraspace(m_pState)) = this;
+	}
+
+	lua_State* LuaState::CreateState(lua_Alloc allocFunc, void* pUserData)
+	{
+		lua_State* pState = lua_newstate(allocFunc, pUserData);
+
+		if (pState)
+			lua_atpanic(pState, &LuaState::Panic);
+
+		return pState;
+	}
+
+	int LuaState::Panic(lua_State* pState)
+	{
+		const char* msg = lua_tostring(pState, -1);
+		std::fprintf(stderr, "PANIC: unprotected error in call to Lua API (%s)\n", msg ? msg : "error object is not a string");
+		return 0;
+	}
+
 	void LuaState::PrintStack()
 	{
 		if(m_pState)
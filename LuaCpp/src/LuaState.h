@@ -2,10 +2,68 @@
 
 //#include <Dragon/Logic/Scripts/LuaVar.h>
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
 #include <lua.hpp>
+#include <LuaBundle.h>
+#include <LuaChunkCache.h>
+#include <LuaEmbeddedScripts.h>
+#include <LuaPendingQueue.h>
+#include <LuaStats.h>
+#include <LuaThreadPool.h>
 
 namespace lpp
 {
+	class LuaAllocationProfiler;
+	class LuaArenaAllocator;
+	class LuaBudget;
+	class LuaBytecodeCache;
+	class LuaProfiler;
+	class LuaReferenceTracker;
+	class LuaTracer;
+	class LuaVar;
+
+	/// Standard libraries, Combine them with `|` for LuaState::Init().
+	enum class LuaLibrary : uint32_t
+	{
+		None		= 0,
+		Base		= 1 << 0,	///< Always opened, The lazy stubs depend on it.
+		Package		= 1 << 1,
+		Coroutine	= 1 << 2,
+		Table		= 1 << 3,
+		IO			= 1 << 4,
+		OS			= 1 << 5,
+		String		= 1 << 6,
+		Math		= 1 << 7,
+		UTF8		= 1 << 8,
+		Debug		= 1 << 9,
+		All			= (1 << 10) - 1,
+	};
+
+	constexpr LuaLibrary operator|(LuaLibrary left, LuaLibrary right) { return static_cast<LuaLibrary>(static_cast<uint32_t>(left) | static_cast<uint32_t>(right)); }
+	constexpr LuaLibrary operator&(LuaLibrary left, LuaLibrary right) { return static_cast<LuaLibrary>(static_cast<uint32_t>(left) & static_cast<uint32_t>(right)); }
+	constexpr LuaLibrary operator~(LuaLibrary library) { return static_cast<LuaLibrary>(~static_cast<uint32_t>(library)) & LuaLibrary::All; }
+
+	enum class LuaGCMode
+	{
+		Incremental,
+		Generational,
+	};
+
+	/// Garbage collector counters of a LuaState, See LuaState::GetGCStats().
+	struct LuaGCStats
+	{
+		size_t heapBytes = 0;			///< Bytes currently allocated by the state.
+		size_t memoryLimit = 0;			///< Hard memory limit, Zero when unlimited.
+		size_t limitFailureCount = 0;	///< Allocations refused because of the memory limit.
+		size_t cycleCount = 0;			///< Completed collections, Minor collections count too in generational mode.
+		size_t stepCount = 0;			///< Steps run by LuaState::Step().
+		double stepMicros = 0.0;		///< Total time spent in LuaState::Step().
+	};
 
 	/// <summary>
 	/// \class LuaState
@@ -26,21 +84,71 @@ namespace lpp
 	{
 		lua_State* m_pState;
 
+#ifndef LUACPP_NO_STATS
+		// Before the members releasing references when destroyed.
+		LuaStats m_stats;
+#endif
+
+		LuaThreadPool m_threadPool;
+		LuaPendingQueue m_pendingQueue;
+		LuaChunkCache m_chunkCache;
+		LuaArenaAllocator* m_pArena = nullptr;
+
+		LuaGCStats m_gcStats;
+		bool m_isClosing = false;
+
+		// The allocator wrapped while a memory limit is set or allocations are tracked.
+		lua_Alloc m_baseAlloc = nullptr;
+		void* m_pBaseAllocData = nullptr;
+		size_t m_allocatedBytes = 0;
+		size_t m_totalAllocatedBytes = 0;
+		bool m_isTrackingAllocations = false;
+
+		LuaBytecodeCache* m_pBytecodeCache = nullptr;
+		LuaBudget* m_pBudget = nullptr;
+		LuaProfiler* m_pProfiler = nullptr;
+		LuaAllocationProfiler* m_pAllocationProfiler = nullptr;
+		LuaTracer* m_pTracer = nullptr;
+		LuaReferenceTracker* m_pReferenceTracker = nullptr;
+
+		// The coroutine LuaCoroutine is resuming, nullptr while the main thread runs. Read by the signal handler of LuaProfiler.
+		std::atomic<lua_State*> m_pRunningThread{ nullptr };
+
+		// Mounted bundles, The last one mounted is searched first.
+		std::vector<std::unique_ptr<LuaBundle>> m_bundles;
 
 	public:
 		LuaState() : LuaState(luaL_newstate()) {}
-		LuaState(lua_State* pState) : m_pState(pState) {}
+		LuaState(lua_State* pState) : m_pState(pState), m_threadPool(this), m_chunkCache(this) { BindExtraSpace(); InstallCycleCounter(); }
+
+		/// <summary>
+		/// Creates the state with a custom allocator, e.g. LuaPoolAllocator::Allocate. The user data must outlive the state.
+		/// </summary>
+		LuaState(lua_Alloc allocFunc, void* pUserData) : LuaState(CreateState(allocFunc, pUserData)) {}
+
+		/// <summary>
+		/// Creates a request-scoped state allocating from the arena.
+		/// The destructor skips `lua_close` and resets the arena instead, So `__gc` metamethods and to-be-closed variables are not run.
+		/// </summary>
+		explicit LuaState(LuaArenaAllocator* pArena);
+
+		LuaState(const LuaState&) = delete;
+		LuaState& operator=(const LuaState&) = delete;
 
 		/// <summary>
-		/// Clean up the underlying lua state memory.
+		/// Clean up the underlying lua state memory, Or release the arena at once for request-scoped states.
 		/// </summary>
 		~LuaState();
 
 		/// <summary>
 		/// Initializes the lua state and general purpose libraries.
+		/// Libraries in `lazyLibraries` but not in `libraries` open on first use, Through a metatable on `_G` and `package.preload`.
+		/// Libraries in neither are not available at all.
 		/// </summary>
-		/// <returns></returns>
-		bool Init();
+		/// <param name="libraries">\param libraries The libraries opened right away.</param>
+		/// <param name="lazyLibraries">\param lazyLibraries The libraries that may be opened on first use.</param>
+		/// <devnote>Scripts replacing the metatable of `_G` remove the lazy stubs, Open those libraries eagerly.</devnote>
+		bool Init(LuaLibrary libraries = LuaLibrary::All, LuaLibrary lazyLibraries = LuaLibrary::All);
 
 		/// <summary>
 		/// Get the actual lua state.
@@ -48,6 +156,173 @@ namespace lpp
 		/// <returns>\ret The underlying lua state memory.</returns>
 		lua_State* GetState() { return m_pState; }
 
+		/// <summary>
+		/// Get the pool recycling the threads used by coroutines.
+		/// </summary>
+		LuaThreadPool& GetThreadPool() { return m_threadPool; }
+
+		/// <summary>
+		/// Get the coroutines suspended on a pending result of a bound function, See LuaPending.
+		/// </summary>
+		LuaPendingQueue& GetPendingQueue() { return m_pendingQueue; }
+
+		/// <summary>
+		/// Get the cache of compiled code used by Execute() and LoadScript(code, chunkName).
+		/// </summary>
+		LuaChunkCache& GetChunkCache() { return m_chunkCache; }
+
+		/// <summary>
+		/// Get the budget limiting the scripts of the state right now, nullptr when unlimited. Set by LuaBudget.
+		/// </summary>
+		LuaBudget* GetBudget() const { return m_pBudget; }
+		void SetBudget(LuaBudget* pBudget) { m_pBudget = pBudget; }
+
+		/// <summary>
+		/// Get the profiler sampling the state right now, nullptr when not profiling. Set by LuaProfiler::Start().
+		/// </summary>
+		LuaProfiler* GetProfiler() const { return m_pProfiler; }
+		void SetProfiler(LuaProfiler* pProfiler) { m_pProfiler = pProfiler; }
+
+		/// <summary>
+		/// Get the allocation profiler wrapping the allocator of the state, nullptr when not profiling. Set by LuaAllocationProfiler.
+		/// </summary>
+		LuaAllocationProfiler* GetAllocationProfiler() const { return m_pAllocationProfiler; }
+		void SetAllocationProfiler(LuaAllocationProfiler* pProfiler) { m_pAllocationProfiler = pProfiler; }
+
+		/// <summary>
+		/// Get the tracer recording the calls of the state, nullptr when not tracing. Set by LuaTracer::Start().
+		/// </summary>
+		LuaTracer* GetTracer() const { return m_pTracer; }
+		void SetTracer(LuaTracer* pTracer) { m_pTracer = pTracer; }
+
+		/// <summary>
+		/// Get the tracker recording the creation site of every LuaVar reference, nullptr when not tracking. Set by LuaReferenceTracker::Start().
+		/// </summary>
+		LuaReferenceTracker* GetReferenceTracker() const { return m_pReferenceTracker; }
+		void SetReferenceTracker(LuaReferenceTracker* pTracker) { m_pReferenceTracker = pTracker; }
+
+#ifndef LUACPP_NO_STATS
+		/// <summary>
+		/// Get the counters updated by LuaVar and the binder, Only while LUACPP_NO_STATS is not defined.
+		/// </summary>
+		LuaStats& GetStats() { return m_stats; }
+#endif
+
+		/// <summary>
+		/// Copies the counters of the boundary between C++ and Lua, Empty when LUACPP_NO_STATS is defined.
+		/// </summary>
+		LuaStatsSnapshot GetStatsSnapshot() const;
+
+		/// <summary>
+		/// Clears the counters, Bound functions keep their entry.
+		/// </summary>
+		void ResetStats();
+
+		/// <summary>
+		/// Get the thread running Lua code, The coroutine being resumed by LuaCoroutine or else the main thread.
+		/// Coroutines resumed by scripts are not tracked, Their resumer is returned instead.
+		/// </summary>
+		lua_State* GetRunningThread() const
+		{
+			lua_State* pThread = m_pRunningThread.load(std::memory_order_relaxed);
+			return pThread ? pThread : m_pState;
+		}
+
+		void SetRunningThread(lua_State* pThread) { m_pRunningThread.store(pThread == m_pState ? nullptr : pThread, std::memory_order_relaxed); }
+
+		/// <summary>
+		/// Sets the hook of the thread to what the budget, profilers and tracer of the state need right now, Or removes it.
+		/// </summary>
+		/// <devnote>Lua has one hook per thread, Every feature shares Hook() and only changes the mask and count through here.</devnote>
+		void UpdateHook(lua_State* pThread);
+
+		/// <summary>
+		/// The hook of every thread of the state, Dispatches to LuaBudget, LuaProfiler, LuaAllocationProfiler and LuaTracer.
+		/// </summary>
+		static void Hook(lua_State* pState, lua_Debug* pDebug);
+
+		/// <summary>
+		/// Get the LuaState owning a lua state or any of its threads.
+		/// </summary>
+		/// <devnote>The LuaState is stored in the extra space of the main thread, Lua copies it into every new thread.</devnote>
+		static LuaState* FromState(lua_State* pState) { return *static_cast<LuaState**>(lua_getextraspace(pState)); }
+
+#pragma region Garbage Collection
+
+		/// <summary>
+		/// Switches to incremental collection. Zero keeps the current value of a parameter.
+		/// </summary>
+		/// <param name="pause">How long the collector waits before a new cycle, In percent of the heap after the last collection.</param>
+		/// <param name="stepMultiplier">Speed of the collector relative to allocation, In percent.</param>
+		/// <param name="stepSize">Log2 of the bytes allocated between steps.</param>
+		/// <returns>The mode before the switch, As lua reports it so switches made by scripts count too.</returns>
+		/// <devnote>There is no getter for the mode, Lua only reports it when switching and a cached copy misses switches made by scripts.</devnote>
+		LuaGCMode SetIncrementalGC(int pause = 0, int stepMultiplier = 0, int stepSize = 0);
+
+		/// <summary>
+		/// Switches to generational collection. Zero keeps the current value of a parameter.
+		/// </summary>
+		/// <param name="minorMultiplier">Heap growth in percent that triggers a minor collection.</param>
+		/// <param name="majorMultiplier">Heap growth in percent that triggers a major collection.</param>
+		/// <returns>The mode before the switch.</returns>
+		LuaGCMode SetGenerationalGC(int minorMultiplier = 0, int majorMultiplier = 0);
+
+		/// <summary>
+		/// Stops or restarts the automatic collector, Step() and CollectGarbage() still work while it is stopped.
+		/// </summary>
+		void SetGCRunning(bool isRunning);
+		bool IsGCRunning();
+
+		/// <summary>
+		/// Runs a full collection.
+		/// </summary>
+		void CollectGarbage();
+
+		/// <summary>
+		/// Runs collector steps until the time budget is used up or the cycle finished.
+		/// At least one step is run, So a step larger than the budget can overshoot it.
+		/// </summary>
+		/// <returns>\ret Wether a collection cycle finished.</returns>
+		bool Step(double budgetMicros);
+
+		/// <summary>
+		/// Limits the bytes the state may allocate, Past it allocations fail and lua raises `LUA_ERRMEM` after an emergency collection.
+		/// Zero removes the limit. The limit wraps the allocator of the state, Which costs a little on every allocation while set.
+		/// </summary>
+		void SetMemoryLimit(size_t bytes);
+		size_t GetMemoryLimit() const { return m_gcStats.memoryLimit; }
+
+		/// <summary>
+		/// Counts the bytes allocated by the state in GetTotalAllocatedBytes(), Used to measure the allocation rate.
+		/// Like the memory limit this wraps the allocator of the state while enabled.
+		/// </summary>
+		void SetAllocationTracking(bool isEnabled);
+		bool IsTrackingAllocations() const { return m_isTrackingAllocations; }
+
+		/// <summary>
+		/// Bytes allocated while tracking or a memory limit was enabled, Growing blocks count their growth. Frees are not subtracted.
+		/// </summary>
+		size_t GetTotalAllocatedBytes() const { return m_totalAllocatedBytes; }
+
+		/// <summary>
+		/// Removes an allocator wrapping `baseAlloc`, Wrappers of the state may be removed in any order.
+		/// Either the allocator of the state or the base of the tracking allocator or the LuaAllocationProfiler is replaced.
+		/// </summary>
+		/// <returns>False if the wrapper is under an allocator the state does not know, It can't be removed then.</returns>
+		bool RemoveAllocator(lua_Alloc alloc, void* pUserData, lua_Alloc baseAlloc, void* pBaseAllocData);
+
+		/// <summary>
+		/// Bytes currently allocated by the state.
+		/// </summary>
+		size_t GetHeapBytes();
+
+		/// <summary>
+		/// Get the collector counters, Including the current heap size.
+		/// </summary>
+		LuaGCStats GetGCStats();
+
+#pragma endregion
+
 		/// <summary>
 		/// Loads a script and returns if the file was loaded.
 		/// </summary>
@@ -55,11 +330,99 @@ namespace lpp
 		/// <returns>\ret Wether the file was loaded or not</returns>
 		bool LoadScript(const char* fileName);
 
+		/// <summary>
+		/// Loads and runs a script from memory, The compiled function is kept in the chunk cache so running the same code again skips the parser.
+		/// </summary>
+		/// <param name="chunkName">\param chunkName Name used in error messages, nullptr uses the code itself.</param>
+		/// <returns>\ret Wether the script was loaded and ran without errors</returns>
+		bool LoadScript(std::string_view code, const char* chunkName);
+
+		/// <summary>
+		/// Runs a snippet of code through the chunk cache, e.g. rule expressions that run over and over.
+		/// </summary>
+		/// <returns>\ret Wether the code compiled and ran without errors</returns>
+		bool Execute(std::string_view code) { return LoadScript(code, nullptr); }
+
+		/// <summary>
+		/// Loads and runs a script with the table as its `_ENV`, So its globals resolve in the table. See LuaSandbox for environments.
+		/// Precompiled chunks are refused, Lua does not verify bytecode and a crafted chunk could escape the table.
+		/// </summary>
+		/// <returns>\ret Wether the file was loaded and ran without errors</returns>
+		bool LoadScript(const char* fileName, const LuaVar& environment);
+
+		/// <summary>
+		/// Loads and runs a script from memory with the table as its `_ENV`, Through the chunk cache.
+		/// </summary>
+		/// <devnote>
+		/// The cache holds a factory `local _ENV = ...; return function(...) code end` written on the first line so line numbers match.
+		/// Every run calls the factory for a new closure, The cached function is never changed.
+		/// </devnote>
+		bool LoadScript(std::string_view code, const char* chunkName, const LuaVar& environment);
+
+		/// <summary>
+		/// Runs a snippet of code through the chunk cache with the table as its `_ENV`.
+		/// </summary>
+		bool Execute(std::string_view code, const LuaVar& environment) { return LoadScript(code, nullptr, environment); }
+
+		/// <summary>
+		/// Makes LoadScript() load compiled scripts from the cache, nullptr compiles every script again. The cache must outlive the state.
+		/// </summary>
+		void SetBytecodeCache(LuaBytecodeCache* pCache) { m_pBytecodeCache = pCache; }
+		LuaBytecodeCache* GetBytecodeCache() const { return m_pBytecodeCache; }
+
+		/// <summary>
+		/// Maps a bundle written by LuaBundleWriter and lets `require` load its modules, Ahead of `package.path`.
+		/// Call after Init(), The package library must be open.
+		/// </summary>
+		/// <returns>\ret Wether the bundle was mapped</returns>
+		bool MountBundle(const char* path);
+
+		/// <summary>
+		/// Lets `require` load the scripts compiled into the executable by LuaCppEmbed, Ahead of `package.path`. Call after Init().
+		/// </summary>
+		void MountScripts(const LuaEmbeddedScripts& scripts) { scripts.InstallSearcher(m_pState); }
+
 		/// <summary>
 		/// Prints the current stack of the state to the console.
 		/// TODO: Make it fancy by using the //DEBUG_LOG and coloring for different types.
 		/// </summary>
 		void PrintStack();
+
+	private:
+
+		/// <summary>
+		/// Stores this LuaState in the extra space of the lua state, See FromState().
+		/// </summary>
+		void BindExtraSpace();
+
+		/// <summary>
+		/// Creates an object whose finalizer counts a collection cycle and creates the next one.
+		/// </summary>
+		void InstallCycleCounter();
+
+		static int OnCycleCollected(lua_State* pState);
+
+		/// <summary>
+		/// Opens the libraries in the mask and installs the lazy stubs for the others, See Init().
+		/// </summary>
+		void OpenLibraries(LuaLibrary libraries, LuaLibrary lazyLibraries);
+
+		/// <summary>
+		/// Installs or removes the tracking allocator depending on the memory limit and allocation tracking.
+		/// </summary>
+		void UpdateAllocator();
+
+		/// <summary>
+		/// Allocator wrapping the base allocator while a memory limit is set or allocations are tracked.
+		/// </summary>
+		static void* TrackingAllocate(void* pUserData, void* pBlock, size_t oldSize, size_t newSize);
+
+		/// <summary>
+		/// Creates a lua state using the allocator with the same panic handler as luaL_newstate.
+		/// </summary>
+		static lua_State* CreateState(lua_Alloc allocFunc, void* pUserData);
+
+		static int Panic(lua_State* pState);
 	};
 
 }
\ No newline at end of file
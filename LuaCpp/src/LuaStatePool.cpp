@@ -0,0 +1,226 @@
+#include "LuaStatePool.h"
+
+#include <algorithm>
+
+namespace lpp
+{
+	LuaStatePool::LuaStatePool(size_t workerCount, Setup setup)
+		: m_setup(std::move(setup))
+		, m_queuedCount(0)
+		, m_nextWorker(0)
+		, m_isStopping(false)
+		, m_statsStart(Now())
+	{
+		if (workerCount == 0)
+			workerCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+		// Every worker exists before any of them starts stealing.
+		for (size_t i = 0; i < workerCount; ++i)
+			m_workers.push_back(std::make_unique<Worker>());
+
+		for (size_t i = 0; i < workerCount; ++i)
+			m_workers[i]->thread = std::thread(&LuaStatePool::WorkerLoop, this, i);
+	}
+
+	LuaStatePool::~LuaStatePool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_signalMutex);
+			m_isStopping = true;
+		}
+
+		m_signal.notify_all();
+
+		for (const std::unique_ptr<Worker>& pWorker : m_workers)
+			pWorker->thread.join();
+	}
+
+	std::future<LuaJobResult> LuaStatePool::Submit(std::string entryPoint, std::vector<LuaValue> arguments)
+	{
+		Job job{ std::move(entryPoint), std::move(arguments), std::promise<LuaJobResult>() };
+		std::future<LuaJobResult> result = job.result.get_future();
+
+		// Counted before it is queued so a worker never takes a job that is not counted yet, At worst it looks again.
+		{
+			std::unique_lock<std::mutex> lock(m_signalMutex);
+			++m_queuedCount;
+		}
+
+		Worker& worker = *m_workers[m_nextWorker++ % m_workers.size()];
+		{
+			std::unique_lock<std::mutex> lock(worker.mutex);
+			worker.jobs.push_back(std::move(job));
+		}
+
+		m_signal.notify_one();
+		return result;
+	}
+
+	std::vector<LuaWorkerStats> LuaStatePool::GetWorkerStats() const
+	{
+		const double elapsedMicros = std::max<int64_t>(1, Now() - m_statsStart) / 1000.0;
+
+		std::vector<LuaWorkerStats> stats;
+		stats.reserve(m_workers.size());
+
+		for (const std::unique_ptr<Worker>& pWorker : m_workers)
+		{
+			LuaWorkerStats workerStats;
+			{
+				std::unique_lock<std::mutex> lock(pWorker->mutex);
+				workerStats.queueDepth = pWorker->jobs.size();
+			}
+
+			workerStats.executedCount = pWorker->executedCount;
+			workerStats.stolenCount = pWorker->stolenCount;
+			workerStats.busyMicros = pWorker->busyNanoseconds / 1000.0;
+			workerStats.utilization = std::min(1.0, workerStats.busyMicros / elapsedMicros);
+			stats.push_back(workerStats);
+		}
+
+		return stats;
+	}
+
+	void LuaStatePool::ResetStats()
+	{
+		for (const std::unique_ptr<Worker>& pWorker : m_workers)
+			pWorker->busyNanoseconds = 0;
+
+		m_statsStart = Now();
+	}
+
+	void LuaStatePool::WorkerLoop(size_t index)
+	{
+		Worker& worker = *m_workers[index];
+
+		LuaState state;
+		m_setup(state);
+
+		for (;;)
+		{
+			Job job;
+			if (TakeJob(index, job))
+			{
+				const int64_t start = Now();
+				LuaJobResult result = Run(state, job);
+				worker.busyNanoseconds += Now() - start;
+				++worker.executedCount;
+
+				job.result.set_value(std::move(result));
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_signalMutex);
+			m_signal.wait(lock, [this]() { return m_isStopping || m_queuedCount > 0; });
+
+			// Queued jobs still run when stopping.
+			if (m_isStopping && m_queuedCount == 0)
+				return;
+		}
+	}
+
+	bool LuaStatePool::TakeJob(size_t index, Job& job)
+	{
+		Worker& own = *m_workers[index];
+		{
+			std::unique_lock<std::mutex> lock(own.mutex);
+			if (!own.jobs.empty())
+			{
+				job = std::move(own.jobs.front());
+				own.jobs.pop_front();
+				--m_queuedCount;
+				return true;
+			}
+		}
+
+		// Start with the next worker so thieves spread over the victims.
+		for (size_t i = 1; i < m_workers.size(); ++i)
+		{
+			Worker& victim = *m_workers[(index + i) % m_workers.size()];
+
+			std::unique_lock<std::mutex> lock(victim.mutex);
+			if (!victim.jobs.empty())
+			{
+				job = std::move(victim.jobs.back());
+				victim.jobs.pop_back();
+				--m_queuedCount;
+				++own.stolenCount;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	LuaJobResult LuaStatePool::Run(LuaState& state, const Job& job)
+	{
+		lua_State* L = state.GetState();
+		const int top = lua_gettop(L);
+
+		LuaJobResult result;
+
+		// Resolving the entry point, Pushing the arguments and the call itself may all raise errors.
+		lua_pushcfunction(L, &LuaStatePool::CallJob);						// [CallJob]
+		lua_pushlightuserdata(L, const_cast<Job*>(&job));					// [CallJob, job]
+		if (lua_pcall(L, 1, LUA_MULTRET, 0) != LUA_OK)						// [results...]
+		{
+			const char* pMessage = lua_tostring(L, -1);
+			result.error = pMessage ? pMessage : "error object is not a string";
+			lua_settop(L, top);
+			return result;
+		}
+
+		// Copying raises no errors, Tables it has to leave out fail the job instead.
+		bool isComplete = true;
+		for (int i = top + 1; i <= lua_gettop(L); ++i)
+			result.values.push_back(LuaValue::FromStack(L, i, &isComplete));
+
+		lua_settop(L, top);
+
+		if (!isComplete)
+		{
+			result.values.clear();
+			result.error = "the results are nested too deeply";
+			return result;
+		}
+
+		result.isOk = true;
+		return result;
+	}
+
+	int LuaStatePool::CallJob(lua_State* L)
+	{
+		const Job& job = *static_cast<const Job*>(lua_touserdata(L, 1));
+		lua_settop(L, 0);
+
+		// Resolve "a.b.c" from the globals.
+		lua_pushglobaltable(L);												// [_G]
+		size_t start = 0;
+		while (start <= job.entryPoint.size())
+		{
+			size_t end = job.entryPoint.find('.', start);
+			if (end == std::string::npos)
+				end = job.entryPoint.size();
+
+			if (!lua_istable(L, -1))
+				break;
+
+			lua_pushlstring(L, job.entryPoint.data() + start, end - start);	// [table, key]
+			lua_gettable(L, -2);											// [table, value]
+			lua_remove(L, -2);												// [value]
+			start = end + 1;
+		}
+
+		if (start <= job.entryPoint.size() || !lua_isfunction(L, -1))
+			return luaL_error(L, "entry point '%s' is not a function", job.entryPoint.c_str());
+
+		const int argumentCount = static_cast<int>(job.arguments.size());
+		luaL_checkstack(L, argumentCount, "too many arguments");
+
+		for (const LuaValue& argument : job.arguments)
+			argument.Push(L);												// [func, args...]
+
+		lua_call(L, argumentCount, LUA_MULTRET);							// [results...]
+		return lua_gettop(L);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <LuaState.h>
+#include <LuaValue.h>
+
+namespace lpp
+{
+	/// The outcome of a job run by LuaStatePool.
+	struct LuaJobResult
+	{
+		bool isOk = false;
+
+		/// The error raised by the entry point, Empty when it ran.
+		std::string error;
+
+		/// Everything the entry point returned.
+		std::vector<LuaValue> values;
+	};
+
+	/// Load of a single LuaStatePool worker, See LuaStatePool::GetWorkerStats().
+	struct LuaWorkerStats
+	{
+		size_t queueDepth = 0;		///< Jobs waiting in the deque of the worker.
+		size_t executedCount = 0;	///< Jobs run by the worker.
+		size_t stolenCount = 0;		///< Jobs the worker took from the deques of other workers.
+		double busyMicros = 0.0;	///< Time spent running jobs.
+		double utilization = 0.0;	///< Busy time over the time since the pool started or the stats were reset, 0 to 1.
+	};
+
+	/// \class LuaStatePool
+	/// \brief Runs scripted jobs on N worker threads, Each owning its own LuaState.
+	///
+	/// Every state is created on its worker and set up by the same callback, e.g. LuaState::Init() or LuaStateTemplate::Stamp().
+	/// A job names a global function as its entry point, Dotted names like "handlers.onRequest" index tables, And carries
+	/// its arguments as LuaValue so nothing of one state leaks into another.
+	///
+	/// Submitted jobs are dealt round robin over the deques of the workers. A worker takes jobs from the front of its own deque
+	/// and steals from the back of the others when it runs dry, So a slow job does not hold up the jobs queued behind it.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaStatePool pool(4, [](LuaState& state) { state.Init(); state.LoadScript("handlers.lua"); });
+	/// std::future<LuaJobResult> result = pool.Submit("handlers.onRequest", { "GET", "/index" });
+	/// ~~~~~
+	///
+	/// \devnote The deques are guarded by a mutex each, Jobs run for far longer than the lock is held.
+	class LuaStatePool
+	{
+	public:
+		using Setup = std::function<void(LuaState&)>;
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Job
+		{
+			std::string entryPoint;
+			std::vector<LuaValue> arguments;
+			std::promise<LuaJobResult> result;
+		};
+
+		struct Worker
+		{
+			std::mutex mutex;
+			std::deque<Job> jobs;
+
+			std::atomic<size_t> executedCount{ 0 };
+			std::atomic<size_t> stolenCount{ 0 };
+			std::atomic<int64_t> busyNanoseconds{ 0 };
+
+			std::thread thread;
+		};
+
+		Setup m_setup;
+		std::vector<std::unique_ptr<Worker>> m_workers;
+
+		// Guards sleeping and waking up, The job counts are atomic so workers check them without it.
+		std::mutex m_signalMutex;
+		std::condition_variable m_signal;
+		std::atomic<size_t> m_queuedCount;
+		std::atomic<size_t> m_nextWorker;
+		bool m_isStopping;
+
+		std::atomic<int64_t> m_statsStart;
+
+	public:
+		/// Starts the workers, Each creating its state and calling the setup callback on it.
+		/// \param workerCount Zero uses one worker per hardware thread.
+		LuaStatePool(size_t workerCount, Setup setup);
+
+		/// Runs the jobs still queued, Then joins the workers and closes their states.
+		~LuaStatePool();
+
+		LuaStatePool(const LuaStatePool&) = delete;
+		LuaStatePool& operator=(const LuaStatePool&) = delete;
+
+		/// Queues a call of the entry point on whichever state gets to it first.
+		std::future<LuaJobResult> Submit(std::string entryPoint, std::vector<LuaValue> arguments = {});
+
+		size_t GetWorkerCount() const { return m_workers.size(); }
+
+		/// Jobs queued on all workers and not started yet.
+		size_t GetQueueDepth() const { return m_queuedCount; }
+
+		std::vector<LuaWorkerStats> GetWorkerStats() const;
+
+		/// Restarts the busy time and utilization measurement of every worker.
+		void ResetStats();
+
+	private:
+
+		void WorkerLoop(size_t index);
+
+		/// Takes a job from the front of the own deque or the back of another.
+		bool TakeJob(size_t index, Job& job);
+
+		static LuaJobResult Run(LuaState& state, const Job& job);
+
+		/// Calls the entry point of the job in the light userdata with its arguments, Run through lua_pcall by Run().
+		static int CallJob(lua_State* L);
+
+		static int64_t Now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count(); }
+	};
+}
\ No newline at end of file
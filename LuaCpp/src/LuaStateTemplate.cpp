@@ -0,0 +1,91 @@
+#include "LuaStateTemplate.h"
+
+namespace lpp
+{
+	LuaStateTemplate::LuaStateTemplate(LuaLibrary libraries, LuaLibrary lazyLibraries, size_t workerCount)
+		: m_libraries(libraries)
+		, m_lazyLibraries(lazyLibraries)
+		, m_modules(workerCount)
+		, m_scripts(workerCount)
+		, m_isBuilt(false)
+	{}
+
+	void LuaStateTemplate::AddBinding(Binding binding)
+	{
+		m_bindings.push_back(std::move(binding));
+	}
+
+	void LuaStateTemplate::AddModule(const std::string& name, const std::string& code)
+	{
+		m_modules.AddSource(name, code);
+		m_isBuilt = false;
+	}
+
+	void LuaStateTemplate::AddModuleFile(const std::string& path, const std::string& name)
+	{
+		m_modules.AddFile(path, name);
+		m_isBuilt = false;
+	}
+
+	bool LuaStateTemplate::AddModuleDirectory(const std::string& directory)
+	{
+		m_isBuilt = false;
+		if (!m_modules.AddDirectory(directory))
+		{
+			m_error = m_modules.GetError();
+			return false;
+		}
+
+		return true;
+	}
+
+	void LuaStateTemplate::AddScript(const std::string& code, const std::string& chunkName)
+	{
+		m_scripts.AddSource(chunkName, code, chunkName);
+		m_isBuilt = false;
+	}
+
+	void LuaStateTemplate::AddScriptFile(const std::string& path)
+	{
+		m_scripts.AddFile(path, path);
+		m_isBuilt = false;
+	}
+
+	bool LuaStateTemplate::Build()
+	{
+		// Both report every script that failed.
+		const bool isModulesCompiled = m_modules.Compile();
+		const bool isScriptsCompiled = m_scripts.Compile();
+
+		m_error = m_modules.GetError();
+		if (!m_scripts.GetError().empty())
+			m_error += (m_error.empty() ? "" : "\n") + m_scripts.GetError();
+
+		m_isBuilt = isModulesCompiled && isScriptsCompiled;
+		return m_isBuilt;
+	}
+
+	bool LuaStateTemplate::Stamp(LuaState& state, std::string* pError) const
+	{
+		std::string error;
+
+		if (!m_isBuilt)
+			error = "the template is not built";
+		else if (!state.Init(m_libraries, m_lazyLibraries))
+			error = "the state could not be initialized";
+		else
+		{
+			for (const Binding& binding : m_bindings)
+				binding(state);
+
+			// Errors go to the local string, Other threads may stamp with the same compilers.
+			if (m_modules.Load(state, error))
+				m_scripts.Run(state, error);
+		}
+
+		if (pError)
+			*pError = error;
+
+		return error.empty();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <LuaParallelCompiler.h>
+#include <LuaState.h>
+
+namespace lpp
+{
+	/// \class LuaStateTemplate
+	/// \brief Records how a state is set up once and stamps out new states by replaying it, Without parsing any script again.
+	///
+	/// A template holds the library masks for LuaState::Init(), The list of binding callbacks and the framework scripts.
+	/// Build() compiles the scripts once, In parallel through LuaParallelCompiler. Stamp() then initializes a state,
+	/// Runs the binding callbacks, Loads the modules in dependency order and runs the scripts, All from bytecode.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaStateTemplate worker(LuaLibrary::String | LuaLibrary::Math);
+	/// worker.AddBinding([](LuaState& state) { lua_register(state.GetState(), "log", &Log); });
+	/// worker.AddModuleDirectory("framework");
+	/// worker.AddScript("require('framework.main')", "=main");
+	/// worker.Build();
+	///
+	/// LuaStatePool pool(4, [&worker](LuaState& state) { worker.Stamp(state); });
+	/// ~~~~~
+	///
+	/// \devnote Replaying keeps stamped states independent, Nothing is shared between them and the template holds no lua state.
+	class LuaStateTemplate
+	{
+	public:
+		using Binding = std::function<void(LuaState&)>;
+
+	private:
+		LuaLibrary m_libraries;
+		LuaLibrary m_lazyLibraries;
+
+		std::vector<Binding> m_bindings;
+		LuaParallelCompiler m_modules;
+		LuaParallelCompiler m_scripts;
+
+		bool m_isBuilt;
+		std::string m_error;
+
+	public:
+		/// \param libraries \param lazyLibraries Passed to LuaState::Init() of every stamped state.
+		/// \param workerCount Threads compiling the scripts in Build(), Zero uses one per hardware thread.
+		explicit LuaStateTemplate(LuaLibrary libraries = LuaLibrary::All, LuaLibrary lazyLibraries = LuaLibrary::All, size_t workerCount = 0);
+
+		/// Adds a callback registering C++ functions, Called on every stamped state in the order added and before any script runs.
+		void AddBinding(Binding binding);
+
+		/// Adds a module stamped states have in `package.loaded`.
+		void AddModule(const std::string& name, const std::string& code);
+		void AddModuleFile(const std::string& path, const std::string& name);
+		bool AddModuleDirectory(const std::string& directory);
+
+		/// Adds a script run on every stamped state after the modules.
+		void AddScript(const std::string& code, const std::string& chunkName);
+		void AddScriptFile(const std::string& path);
+
+		/// Compiles every module and script, Needed once before Stamp().
+		bool Build();
+
+		/// Initializes the state and replays the template on it, Several threads may stamp their own states at once.
+		/// The bindings are then called concurrently too.
+		/// \param pError Receives the error when stamping failed, The template keeps no error of Stamp() so it stays unchanged.
+		/// \return False when the template is not built or a script raised an error.
+		bool Stamp(LuaState& state, std::string* pError = nullptr) const;
+
+		bool IsBuilt() const { return m_isBuilt; }
+
+		/// The error of the last call to Build() or AddModuleDirectory() that failed.
+		const std::string& GetError() const { return m_error; }
+	};
+}
\ No newline at end of file
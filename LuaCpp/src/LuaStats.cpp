@@ -0,0 +1,91 @@
+#include "LuaStats.h"
+
+#include <algorithm>
+
+namespace lpp
+{
+	uint64_t LuaLatencyHistogram::GetPercentile(double percentile) const
+	{
+		if (m_count == 0)
+			return 0;
+
+		const double rank = std::min(std::max(percentile, 0.0), 100.0) / 100.0 * m_count;
+		const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(rank + 0.5));
+
+		uint64_t seen = 0;
+		for (size_t i = 0; i < kBucketCount; ++i)
+		{
+			seen += m_buckets[i];
+			if (seen >= target)
+				return i + 1 < kBucketCount ? std::min(GetBucketStart(i + 1) - 1, m_max) : m_max;
+		}
+
+		return m_max;
+	}
+
+	size_t LuaLatencyHistogram::GetBucket(uint64_t nanoseconds)
+	{
+		if (nanoseconds < kSubBucketCount)
+			return static_cast<size_t>(nanoseconds);
+
+		int exponent = kSubBucketBits;
+		while ((nanoseconds >> exponent) > 1)
+			++exponent;
+
+		// The bits below the leading one pick the linear bucket within the power of two.
+		const size_t subBucket = static_cast<size_t>(nanoseconds >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1);
+		return static_cast<size_t>(exponent - kSubBucketBits + 1) * kSubBucketCount + subBucket;
+	}
+
+	uint64_t LuaLatencyHistogram::GetBucketStart(size_t bucket)
+	{
+		if (bucket < kSubBucketCount)
+			return bucket;
+
+		const int exponent = static_cast<int>(bucket / kSubBucketCount) + kSubBucketBits - 1;
+		const uint64_t subBucket = bucket % kSubBucketCount;
+		return (kSubBucketCount + subBucket) << (exponent - kSubBucketBits);
+	}
+
+	const LuaBindingStats* LuaStatsSnapshot::GetBinding(const char* name) const
+	{
+		for (const LuaBindingStats& binding : bindings)
+		{
+			if (binding.name == name)
+				return &binding;
+		}
+
+		return nullptr;
+	}
+
+	LuaBindingStats* LuaStats::GetBinding(const char* name)
+	{
+		auto it = m_bindingsByName.find(name);
+		if (it != m_bindingsByName.end())
+			return it->second;
+
+		m_bindings.emplace_back();
+		m_bindings.back().name = name;
+		return m_bindingsByName.emplace(name, &m_bindings.back()).first->second;
+	}
+
+	LuaStatsSnapshot LuaStats::GetSnapshot() const
+	{
+		LuaStatsSnapshot snapshot = m_counters;
+		snapshot.bindings.assign(m_bindings.begin(), m_bindings.end());
+
+		std::sort(snapshot.bindings.begin(), snapshot.bindings.end(), [](const LuaBindingStats& a, const LuaBindingStats& b) { return a.name < b.name; });
+		return snapshot;
+	}
+
+	void LuaStats::Reset()
+	{
+		m_counters = LuaStatsSnapshot();
+
+		for (LuaBindingStats& binding : m_bindings)
+		{
+			binding.dispatchCount = 0;
+			binding.latency.Reset();
+		}
+	}
+}
\ No newline at end of file
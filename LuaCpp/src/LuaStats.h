@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// \file LuaStats.h
+/// Counters at the boundary between C++ and Lua, Kept per LuaState.
+///
+/// Defining LUACPP_NO_STATS (premake `--no-stats`) compiles every counter out, LuaState::GetStatsSnapshot() then returns an empty snapshot.
+/// Every project including the headers has to agree on it.
+
+#ifdef LUACPP_NO_STATS
+#define LUACPP_STATS(...)
+#else
+#define LUACPP_STATS(...) __VA_ARGS__
+#endif
+
+namespace lpp
+{
+	/// The kinds of values pushed by LuaStack::Push().
+	enum class LuaPushType : uint8_t
+	{
+		Nil,
+		Boolean,
+		Integer,
+		Number,
+		String,
+		LightUserdata,
+		Reference,		///< A LuaVar.
+		Count,
+	};
+
+	/// \class LuaLatencyHistogram
+	/// \brief A log-linear histogram of durations in nanoseconds.
+	///
+	/// Every power of two is split into 8 linear buckets, So a percentile is off by at most 12.5%. Values below 8 ns have a bucket each.
+	class LuaLatencyHistogram
+	{
+	public:
+		static constexpr int kSubBucketBits = 3;
+		static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+		static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketCount;
+
+	private:
+		std::array<uint64_t, kBucketCount> m_buckets{};
+		uint64_t m_count = 0;
+		uint64_t m_sum = 0;
+		uint64_t m_max = 0;
+
+	public:
+		void Record(uint64_t nanoseconds)
+		{
+			++m_buckets[GetBucket(nanoseconds)];
+			++m_count;
+			m_sum += nanoseconds;
+			m_max = nanoseconds > m_max ? nanoseconds : m_max;
+		}
+
+		uint64_t GetCount() const { return m_count; }
+		uint64_t GetMax() const { return m_max; }
+		double GetMean() const { return m_count ? static_cast<double>(m_sum) / m_count : 0.0; }
+
+		/// The upper bound of the bucket holding the percentile, 0 when empty.
+		/// \param percentile From 0 to 100.
+		uint64_t GetPercentile(double percentile) const;
+
+		void Reset() { *this = LuaLatencyHistogram(); }
+
+		static size_t GetBucket(uint64_t nanoseconds);
+
+		/// The smallest value falling into the bucket.
+		static uint64_t GetBucketStart(size_t bucket);
+	};
+
+	/// Dispatches of a function bound with LuaVar::BindMemberFunction().
+	struct LuaBindingStats
+	{
+		std::string name;
+		uint64_t dispatchCount = 0;
+
+		/// One in LuaStats::kLatencySampleInterval dispatches starting with the first, Only if it returned.
+		/// Dispatches raising an error or yielding are counted but not timed.
+		LuaLatencyHistogram latency;
+	};
+
+	/// A copy of the counters of a LuaState, See LuaState::GetStatsSnapshot().
+	struct LuaStatsSnapshot
+	{
+		uint64_t referencesCreated = 0;		///< Registry references taken by LuaVar.
+		uint64_t referencesReleased = 0;	///< Registry references released by LuaVar.
+		std::array<uint64_t, static_cast<size_t>(LuaPushType::Count)> pushes{};
+		uint64_t callCount = 0;				///< Calls made by LuaVar::Call() and LuaVar::operator()().
+		uint64_t callFailureCount = 0;		///< Protected calls of LuaVar and LuaState that raised an error.
+
+		/// Sorted by name, Functions bound under the same name on several tables share their stats.
+		std::vector<LuaBindingStats> bindings;
+
+		uint64_t GetLiveReferenceCount() const { return referencesCreated - referencesReleased; }
+		uint64_t GetPushCount(LuaPushType type) const { return pushes[static_cast<size_t>(type)]; }
+
+		/// nullptr when nothing was bound under the name.
+		const LuaBindingStats* GetBinding(const char* name) const;
+	};
+
+	/// \class LuaStats
+	/// \brief The counters of a LuaState, Updated by LuaVar and the binder while LUACPP_NO_STATS is not defined.
+	///
+	/// \devnote Counters are plain integers like the rest of the state, Read them on the thread running the state.
+	class LuaStats
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		/// Bound functions time one dispatch in this many, Reading the clock costs about as much as a small binding.
+		static constexpr uint64_t kLatencySampleInterval = 8;
+
+	private:
+		LuaStatsSnapshot m_counters;
+
+		// Bindings keep their address, Closures hold on to them as an upvalue.
+		std::deque<LuaBindingStats> m_bindings;
+		std::unordered_map<std::string, LuaBindingStats*> m_bindingsByName;
+
+	public:
+		void OnReferenceCreated() { ++m_counters.referencesCreated; }
+		void OnReferenceReleased() { ++m_counters.referencesReleased; }
+		void OnPush(LuaPushType type) { ++m_counters.pushes[static_cast<size_t>(type)]; }
+		void OnCall() { ++m_counters.callCount; }
+		void OnCallFailed() { ++m_counters.callFailureCount; }
+
+		/// Get the stats a bound function updates, Created on first use of the name.
+		LuaBindingStats* GetBinding(const char* name);
+
+		LuaStatsSnapshot GetSnapshot() const;
+
+		/// Clears every counter, Bindings stay registered.
+		void Reset();
+
+		static int64_t Now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count(); }
+	};
+}
\ No newline at end of file
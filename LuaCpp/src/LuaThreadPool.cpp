@@ -0,0 +1,71 @@
+#include "LuaThreadPool.h"
+
+#include <LuaState.h>
+
+#define L m_pState->GetState()
+
+namespace lpp
+{
+	void ResetThread(lua_State* pThread, lua_State* pFrom)
+	{
+#if LUA_VERSION_RELEASE_NUM >= 50406
+		lua_closethread(pThread, pFrom);
+#else
+		(void)pFrom;
+		lua_resetthread(pThread);
+#endif
+		// A thread that died with an error keeps the error object on its stack after the reset.
+		lua_settop(pThread, 0);
+	}
+
+	LuaThread LuaThreadPool::Acquire()
+	{
+		if (!m_freeThreads.empty())
+		{
+			LuaThread thread = m_freeThreads.back();
+			m_freeThreads.pop_back();
+			return thread;
+		}
+
+		LuaThread thread;
+		thread.pThread = lua_newthread(L);						// [thread]
+		thread.ref = luaL_ref(L, LUA_REGISTRYINDEX);			// []
+		++m_createdCount;
+
+		return thread;
+	}
+
+	void LuaThreadPool::Release(LuaThread thread)
+	{
+		if (!thread.IsValid())
+			return;
+
+		if (m_freeThreads.size() >= m_maxFree)
+		{
+			luaL_unref(L, LUA_REGISTRYINDEX, thread.ref);
+			return;
+		}
+
+		ResetThread(thread.pThread, L);
+		m_freeThreads.push_back(thread);
+	}
+
+	void LuaThreadPool::Clear()
+	{
+		for (const LuaThread& thread : m_freeThreads)
+			luaL_unref(L, LUA_REGISTRYINDEX, thread.ref);
+
+		m_freeThreads.clear();
+	}
+
+	void LuaThreadPool::SetMaxFree(size_t maxFree)
+	{
+		m_maxFree = maxFree;
+
+		while (m_freeThreads.size() > m_maxFree)
+		{
+			luaL_unref(L, LUA_REGISTRYINDEX, m_freeThreads.back().ref);
+			m_freeThreads.pop_back();
+		}
+	}
+}
\ No newline at end of file
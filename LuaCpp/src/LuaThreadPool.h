@@ -0,0 +1,66 @@
+#pragma once
+
+#include <lua.hpp>
+#include <vector>
+
+namespace lpp
+{
+	class LuaState;
+
+	/// A Lua thread (coroutine stack) anchored in the registry so the garbage collector keeps it alive.
+	struct LuaThread
+	{
+		lua_State* pThread = nullptr;
+		int ref = LUA_NOREF;
+
+		bool IsValid() const { return pThread != nullptr; }
+	};
+
+	/// \class LuaThreadPool
+	/// \brief Recycles Lua threads so coroutines do not pay for `lua_newthread` and a fresh stack on every start.
+	///
+	/// Released threads are reset with `lua_closethread` and parked until the next Acquire().
+	/// When more than `maxFree` threads are parked, the surplus is unreferenced and left to the garbage collector.
+	///
+	/// \devnote The pool never touches the lua state in its destructor, The owning LuaState closes every thread with `lua_close`.
+	class LuaThreadPool
+	{
+		LuaState* m_pState;
+		std::vector<LuaThread> m_freeThreads;
+		size_t m_maxFree;
+		size_t m_createdCount;
+
+	public:
+		static constexpr size_t kDefaultMaxFree = 64;
+
+		explicit LuaThreadPool(LuaState* pState, size_t maxFree = kDefaultMaxFree)
+			: m_pState(pState)
+			, m_maxFree(maxFree)
+			, m_createdCount(0)
+		{}
+
+		LuaThreadPool(const LuaThreadPool&) = delete;
+		LuaThreadPool& operator=(const LuaThreadPool&) = delete;
+
+		/// Returns a parked thread or creates a new one. The stack of the returned thread is empty.
+		LuaThread Acquire();
+
+		/// Resets the thread and parks it for reuse. The thread must not be running.
+		void Release(LuaThread thread);
+
+		/// Unreferences every parked thread.
+		void Clear();
+
+		/// Sets the maximum amount of parked threads.
+		void SetMaxFree(size_t maxFree);
+
+		/// Amount of threads currently parked in the pool.
+		size_t GetFreeCount() const { return m_freeThreads.size(); }
+
+		/// Amount of threads created by the pool since construction, A low number compared to the amount of Acquire() calls means threads are being reused.
+		size_t GetCreatedCount() const { return m_createdCount; }
+	};
+
+	/// Resets a thread so it can run a new function, Clears the stack including a possible error object.
+	void ResetThread(lua_State* pThread, lua_State* pFrom);
+}
\ No newline at end of file
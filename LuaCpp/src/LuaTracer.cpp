@@ -0,0 +1,336 @@
+#include "LuaTracer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+
+namespace lpp
+{
+	namespace
+	{
+		constexpr const char* kCategoryNames[] = { "lua", "c", "binding" };
+	}
+
+	LuaTracer::LuaTracer(LuaState* pState, size_t capacity, bool isTracingLua)
+		: m_pState(pState)
+		, m_isTracingLua(isTracingLua)
+		, m_isRunning(false)
+		, m_processId(1)
+		, m_firstThreadId(1)
+		, m_mask(0)
+		, m_head(0)
+		, m_tail(0)
+		, m_droppedCount(0)
+		, m_flushedThreadCount(0)
+	{
+		size_t size = 1;
+		while (size < capacity)
+			size <<= 1;
+
+		m_events.resize(size);
+		m_mask = size - 1;
+	}
+
+	LuaTracer::~LuaTracer()
+	{
+		Stop();
+	}
+
+	bool LuaTracer::Start()
+	{
+		if (m_isRunning || m_pState->GetTracer())
+			return false;
+
+		m_isRunning = true;
+		m_pState->SetTracer(this);
+		m_pState->UpdateHook(m_pState->GetState());
+		return true;
+	}
+
+	void LuaTracer::Stop()
+	{
+		if (!m_isRunning)
+			return;
+
+		const int64_t nanoseconds = Now();
+		for (auto& [pThread, thread] : m_threads)
+		{
+			while (!thread.frames.empty())
+			{
+				Record(thread, thread.frames.back(), 'E', nanoseconds);
+				thread.frames.pop_back();
+			}
+		}
+
+		// Hooks left on other threads are removed the next time they fire without a tracer.
+		m_pState->SetTracer(nullptr);
+		m_pState->UpdateHook(m_pState->GetState());
+		m_isRunning = false;
+	}
+
+	void LuaTracer::OnHook(lua_State* pThread, lua_Debug* pDebug)
+	{
+		const int64_t nanoseconds = Now();
+		Thread& thread = GetThread(pThread);
+
+		// i_ci is private to lua, It is only compared to tell the frames of the stack apart.
+		const void* pCallInfo = pDebug->i_ci;
+
+		if (pDebug->event == LUA_HOOKRET)
+		{
+			Unwind(thread, pThread, 0, pCallInfo, nanoseconds);
+			Close(thread, pCallInfo, nanoseconds);
+			return;
+		}
+
+		if (pDebug->event == LUA_HOOKTAILCALL)
+		{
+			// The called function takes over the frame of the caller.
+			Unwind(thread, pThread, 0, pCallInfo, nanoseconds);
+			Close(thread, pCallInfo, nanoseconds);
+		}
+		else
+		{
+			// A frame on the call info of the new call was left by an error.
+			lua_Debug caller;
+			Unwind(thread, pThread, 1, lua_getstack(pThread, 1, &caller) ? caller.i_ci : nullptr, nanoseconds);
+		}
+
+		lua_getinfo(pThread, "Sn", pDebug);
+
+		const FunctionKey key{ pDebug->source, pDebug->name, pDebug->linedefined };
+		auto it = m_functionNames.find(key);
+		if (it == m_functionNames.end())
+		{
+			char name[LUA_IDSIZE + 96];
+			if (*pDebug->what == 'C')
+				std::snprintf(name, sizeof(name), "%s", pDebug->name ? pDebug->name : "?");
+			else if (*pDebug->what == 'm')
+				std::snprintf(name, sizeof(name), "main chunk %s", pDebug->short_src);
+			else
+				std::snprintf(name, sizeof(name), "%s %s:%d", pDebug->name ? pDebug->name : "anonymous", pDebug->short_src, pDebug->linedefined);
+
+			it = m_functionNames.emplace(key, AddName(name)).first;
+		}
+
+		thread.frames.push_back(Frame{ pCallInfo, it->second, *pDebug->what == 'C' ? Category::C : Category::Lua });
+		Record(thread, thread.frames.back(), 'B', nanoseconds);
+	}
+
+	void LuaTracer::BeginBinding(lua_State* pThread, const char* pName)
+	{
+		const int64_t nanoseconds = Now();
+		Thread& thread = GetThread(pThread);
+
+		auto it = m_bindingNames.find(pName);
+		if (it == m_bindingNames.end())
+			it = m_bindingNames.emplace(pName, AddName(pName)).first;
+
+		// Nested in the frame of the C function when the hooks trace it too.
+		lua_Debug info;
+		const void* pCallInfo = lua_getstack(pThread, 0, &info) ? info.i_ci : nullptr;
+
+		Unwind(thread, pThread, 0, pCallInfo, nanoseconds);
+
+		// A binding on the same call info was left by an error, The C function frame stays.
+		if (!thread.frames.empty() && thread.frames.back().category == Category::Binding && thread.frames.back().pCallInfo == pCallInfo)
+		{
+			Record(thread, thread.frames.back(), 'E', nanoseconds);
+			thread.frames.pop_back();
+		}
+
+		thread.frames.push_back(Frame{ pCallInfo, it->second, Category::Binding });
+		Record(thread, thread.frames.back(), 'B', nanoseconds);
+	}
+
+	void LuaTracer::EndBinding(lua_State* pThread)
+	{
+		Thread& thread = GetThread(pThread);
+
+		if (!thread.frames.empty() && thread.frames.back().category == Category::Binding)
+		{
+			Record(thread, thread.frames.back(), 'E', Now());
+			thread.frames.pop_back();
+		}
+	}
+
+	LuaTracer::Thread& LuaTracer::GetThread(lua_State* pThread)
+	{
+		auto it = m_threads.find(pThread);
+		if (it != m_threads.end())
+			return it->second;
+
+		std::unique_lock<std::mutex> lock(m_namesMutex);
+
+		const uint16_t id = static_cast<uint16_t>(m_threadNames.size() + 1);
+		if (pThread == m_pState->GetState())
+		{
+			m_threadNames.push_back("lua main");
+		}
+		else
+		{
+			char name[64];
+			std::snprintf(name, sizeof(name), "lua thread %u", static_cast<unsigned>(id));
+			m_threadNames.push_back(name);
+		}
+
+		return m_threads.emplace(pThread, Thread{ id, {} }).first->second;
+	}
+
+	void LuaTracer::Unwind(Thread& thread, lua_State* pThread, int level, const void* pExpected, int64_t nanoseconds)
+	{
+		if (thread.frames.empty() || thread.frames.back().pCallInfo == pExpected)
+			return;
+
+		// Only after an error or when the caller has no frame, e.g. a call from C++.
+		// Call infos are reused per depth, A frame left by an error is deeper than every event that follows it.
+		std::vector<const void*>& active = m_active;
+		active.clear();
+
+		lua_Debug info;
+		while (lua_getstack(pThread, level++, &info))
+			active.push_back(info.i_ci);
+
+		while (!thread.frames.empty() && std::find(active.begin(), active.end(), thread.frames.back().pCallInfo) == active.end())
+		{
+			Record(thread, thread.frames.back(), 'E', nanoseconds);
+			thread.frames.pop_back();
+		}
+	}
+
+	void LuaTracer::Close(Thread& thread, const void* pCallInfo, int64_t nanoseconds)
+	{
+		while (!thread.frames.empty() && thread.frames.back().pCallInfo == pCallInfo)
+		{
+			Record(thread, thread.frames.back(), 'E', nanoseconds);
+			thread.frames.pop_back();
+		}
+	}
+
+	void LuaTracer::Record(const Thread& thread, const Frame& frame, char phase, int64_t nanoseconds)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) > m_mask)
+		{
+			++m_droppedCount;
+			return;
+		}
+
+		m_events[head & m_mask] = Event{ nanoseconds, frame.name, thread.id, phase, frame.category };
+		m_head.store(head + 1, std::memory_order_release);
+	}
+
+	uint32_t LuaTracer::AddName(std::string name)
+	{
+		std::unique_lock<std::mutex> lock(m_namesMutex);
+		m_names.push_back(std::move(name));
+		return static_cast<uint32_t>(m_names.size() - 1);
+	}
+
+	std::string LuaTracer::Flush()
+	{
+		std::string json = "{\"traceEvents\":[\n";
+		bool isFirst = true;
+		char buffer[128];
+
+		const auto separate = [&]()
+		{
+			if (!isFirst)
+				json += ",\n";
+			isFirst = false;
+		};
+
+		std::unique_lock<std::mutex> lock(m_namesMutex);
+
+		// Every flush names the tracks, Each one is loaded on its own.
+		for (size_t i = 0; i < m_threadNames.size(); ++i)
+		{
+			separate();
+			std::snprintf(buffer, sizeof(buffer), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lld,\"tid\":%lld,\"args\":{\"name\":\"",
+				static_cast<long long>(m_processId), static_cast<long long>(m_firstThreadId + static_cast<int64_t>(i)));
+			json += buffer;
+			WriteEscaped(json, m_threadNames[i]);
+			json += "\"}}";
+		}
+
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		const size_t head = m_head.load(std::memory_order_acquire);
+
+		// Escaped once per flush instead of once per event.
+		std::vector<std::string> prefixes(m_names.size());
+		json.reserve(json.size() + (head - tail) * 96);
+
+		const std::string processId = ",\"pid\":" + std::to_string(m_processId) + ",\"tid\":";
+
+		for (size_t i = tail; i != head; ++i)
+		{
+			const Event& event = m_events[i & m_mask];
+
+			std::string& prefix = prefixes[event.name];
+			if (prefix.empty())
+			{
+				prefix = "{\"name\":\"";
+				WriteEscaped(prefix, m_names[event.name]);
+				prefix += "\",\"cat\":\"";
+			}
+
+			separate();
+			json += prefix;
+			json += kCategoryNames[static_cast<size_t>(event.category)];
+			json += "\",\"ph\":\"";
+			json += event.phase;
+			json += "\",\"ts\":";
+
+			// Microseconds with the nanoseconds as decimals.
+			char* pEnd = std::to_chars(buffer, buffer + sizeof(buffer), event.nanoseconds / 1000).ptr;
+			const int64_t decimals = event.nanoseconds % 1000;
+			*pEnd++ = '.';
+			*pEnd++ = static_cast<char>('0' + decimals / 100);
+			*pEnd++ = static_cast<char>('0' + decimals / 10 % 10);
+			*pEnd++ = static_cast<char>('0' + decimals % 10);
+			json.append(buffer, pEnd);
+
+			json += processId;
+			json.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), m_firstThreadId + event.thread - 1).ptr);
+			json += '}';
+		}
+
+		m_tail.store(head, std::memory_order_release);
+
+		json += "\n],\"displayTimeUnit\":\"ns\"}\n";
+		return json;
+	}
+
+	bool LuaTracer::Flush(const char* path)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		file << Flush();
+		return static_cast<bool>(file);
+	}
+
+	void LuaTracer::WriteEscaped(std::string& output, const std::string& text)
+	{
+		for (const char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				output += '\\';
+				output += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+				output += escaped;
+			}
+			else
+			{
+				output += c;
+			}
+		}
+	}
+}
\ No newline at end of file
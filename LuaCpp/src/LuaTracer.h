@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <LuaState.h>
+
+namespace lpp
+{
+	/// \class LuaTracer
+	/// \brief Records every call and return of a state as Chrome trace events, To view script activity on a timeline in Perfetto.
+	///
+	/// Lua functions are recorded through the call and return hooks, C++ member functions bound with LuaVar::BindMemberFunction()
+	/// are recorded by the binder. Events go into a lock-free ring buffer written by the thread running the state,
+	/// Flush() may run on any other thread and writes the events recorded since the last flush as trace-event JSON.
+	/// Every Lua thread gets its own track, So coroutines show up next to the main thread.
+	///
+	/// Timestamps are the microseconds of `std::chrono::steady_clock` since its epoch, Not since the tracer started, So a trace lines up
+	/// with native traces of the process taken on the same clock (`CLOCK_MONOTONIC` on Linux). SetTraceIds() picks the pid and tids
+	/// the events are written with when the traces are merged.
+	///
+	/// Tracing the bindings alone costs a clock read per bound call, Tracing Lua functions installs the hooks and costs every call.
+	///
+	/// \b Example:
+	/// ~~~~~
+	/// LuaTracer tracer(&state);
+	/// tracer.Start();
+	/// RunFrame();
+	/// tracer.Flush("frame.json");
+	/// ~~~~~
+	///
+	/// \devnote Frames left by an error have no return event, They are closed at the next event of their thread by comparing the call infos
+	/// of the stack. A full ring buffer drops events, GetDroppedCount() tells how many.
+	class LuaTracer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		static constexpr size_t kDefaultCapacity = 1 << 16;
+
+		enum class Category : uint8_t
+		{
+			Lua,
+			C,
+			Binding,
+		};
+
+	private:
+		struct Event
+		{
+			int64_t nanoseconds;
+			uint32_t name;
+			uint16_t thread;
+			char phase;			///< 'B' or 'E'.
+			Category category;
+		};
+
+		struct Frame
+		{
+			const void* pCallInfo;
+			uint32_t name;
+			Category category;
+		};
+
+		struct FunctionKey
+		{
+			const void* pSource;
+			const void* pName;
+			int line;
+
+			bool operator==(const FunctionKey& other) const { return pSource == other.pSource && pName == other.pName && line == other.line; }
+		};
+
+		struct FunctionKeyHash
+		{
+			size_t operator()(const FunctionKey& key) const
+			{
+				return std::hash<const void*>()(key.pSource) ^ (std::hash<const void*>()(key.pName) << 1) ^ static_cast<size_t>(key.line);
+			}
+		};
+
+		struct Thread
+		{
+			uint16_t id;
+			std::vector<Frame> frames;
+		};
+
+		LuaState* m_pState;
+		bool m_isTracingLua;
+		bool m_isRunning;
+		int64_t m_processId;
+		int64_t m_firstThreadId;
+
+		// Single producer, Single consumer.
+		std::vector<Event> m_events;
+		size_t m_mask;
+		std::atomic<size_t> m_head;
+		std::atomic<size_t> m_tail;
+		std::atomic<uint64_t> m_droppedCount;
+
+		// Only touched by the thread running the state.
+		std::unordered_map<FunctionKey, uint32_t, FunctionKeyHash> m_functionNames;
+		std::unordered_map<const void*, uint32_t> m_bindingNames;
+		std::unordered_map<lua_State*, Thread> m_threads;
+		std::vector<const void*> m_active;
+
+		// Appended by the thread running the state, Read by Flush().
+		mutable std::mutex m_namesMutex;
+		std::vector<std::string> m_names;
+		std::vector<std::string> m_threadNames;
+		size_t m_flushedThreadCount;
+
+	public:
+		/// \param capacity Events the ring buffer holds, Rounded up to a power of two.
+		/// \param isTracingLua False only records the bound C++ functions, Without any hook.
+		explicit LuaTracer(LuaState* pState, size_t capacity = kDefaultCapacity, bool isTracingLua = true);
+
+		/// Stops tracing, The events not flushed yet are lost.
+		~LuaTracer();
+
+		LuaTracer(const LuaTracer&) = delete;
+		LuaTracer& operator=(const LuaTracer&) = delete;
+
+		/// Installs the hooks on the main thread, Only one tracer per state can run.
+		/// \return False if this or another tracer is already running on the state.
+		bool Start();
+
+		/// Removes the hooks, Frames still open get their end event.
+		void Stop();
+
+		bool IsRunning() const { return m_isRunning; }
+		bool IsTracingLua() const { return m_isTracingLua; }
+
+		/// Ids of the process and of the track of the first Lua thread, Later threads count up from it. Both default to 1.
+		/// Pick a thread id no native trace uses, Call before flushing.
+		void SetTraceIds(int64_t processId, int64_t firstThreadId) { m_processId = processId; m_firstThreadId = firstThreadId; }
+
+		/// Events in the ring buffer waiting for Flush().
+		size_t GetPendingCount() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+		uint64_t GetDroppedCount() const { return m_droppedCount; }
+
+		/// Takes the events recorded since the last flush, As a Chrome trace-event JSON document.
+		std::string Flush();
+
+		/// Writes Flush() to a file.
+		/// \return Wether the file was written.
+		bool Flush(const char* path);
+
+		/// Called by the hook of the state for calls and returns.
+		void OnHook(lua_State* pThread, lua_Debug* pDebug);
+
+		/// Called by the binder around a bound C++ function.
+		/// \param pName Name the function was bound with, Its address identifies the binding.
+		void BeginBinding(lua_State* pThread, const char* pName);
+		void EndBinding(lua_State* pThread);
+
+	private:
+
+		Thread& GetThread(lua_State* pThread);
+
+		/// Ends the frames left by an error, Those no longer on the stack from the level down.
+		/// \param pExpected Call info of the frame expected on top, Nothing is walked when it is.
+		void Unwind(Thread& thread, lua_State* pThread, int level, const void* pExpected, int64_t nanoseconds);
+
+		/// Ends the frames on top running on the call info.
+		void Close(Thread& thread, const void* pCallInfo, int64_t nanoseconds);
+
+		void Record(const Thread& thread, const Frame& frame, char phase, int64_t nanoseconds);
+
+		uint32_t AddName(std::string name);
+
+		static int64_t Now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count(); }
+
+		static void WriteEscaped(std::string& output, const std::string& text);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "LuaValue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lpp
+{
+	namespace
+	{
+		const std::string kEmptyString;
+		const LuaValue::Table kEmptyTable;
+		const LuaValue kNil;
+	}
+
+	bool LuaValue::ToBoolean() const
+	{
+		switch (GetType())
+		{
+		case Type::Nil: return false;
+		case Type::Boolean: return std::get<bool>(m_value);
+		default: return true;
+		}
+	}
+
+	lua_Integer LuaValue::ToInteger() const
+	{
+		switch (GetType())
+		{
+		case Type::Integer: return std::get<lua_Integer>(m_value);
+		case Type::Number: return static_cast<lua_Integer>(std::get<lua_Number>(m_value));
+		default: return 0;
+		}
+	}
+
+	lua_Number LuaValue::ToNumber() const
+	{
+		switch (GetType())
+		{
+		case Type::Integer: return static_cast<lua_Number>(std::get<lua_Integer>(m_value));
+		case Type::Number: return std::get<lua_Number>(m_value);
+		default: return 0.0;
+		}
+	}
+
+	const std::string& LuaValue::ToString() const
+	{
+		return GetType() == Type::String ? std::get<std::string>(m_value) : kEmptyString;
+	}
+
+	const LuaValue::Table& LuaValue::ToTable() const
+	{
+		return GetType() == Type::Table ? std::get<Table>(m_value) : kEmptyTable;
+	}
+
+	const LuaValue& LuaValue::operator[](const char* key) const
+	{
+		for (const auto& [fieldKey, value] : ToTable())
+		{
+			if (fieldKey.GetType() == Type::String && fieldKey.ToString() == key)
+				return value;
+		}
+
+		return kNil;
+	}
+
+	void LuaValue::Push(lua_State* pState) const
+	{
+		switch (GetType())
+		{
+		case Type::Nil:
+			lua_pushnil(pState);
+			break;
+		case Type::Boolean:
+			lua_pushboolean(pState, std::get<bool>(m_value));
+			break;
+		case Type::Integer:
+			lua_pushinteger(pState, std::get<lua_Integer>(m_value));
+			break;
+		case Type::Number:
+			lua_pushnumber(pState, std::get<lua_Number>(m_value));
+			break;
+		case Type::String:
+		{
+			const std::string& value = std::get<std::string>(m_value);
+			lua_pushlstring(pState, value.data(), value.size());
+			break;
+		}
+		case Type::Table:
+		{
+			const Table& table = std::get<Table>(m_value);
+			luaL_checkstack(pState, 3, "too many nested tables");
+
+			lua_createtable(pState, 0, static_cast<int>(table.size()));	// [t]
+			for (const auto& [key, value] : table)
+			{
+				key.Push(pState);											// [t, key]
+				value.Push(pState);											// [t, key, value]
+				lua_rawset(pState, -3);										// [t]
+			}
+			break;
+		}
+		}
+	}
+
+	LuaValue LuaValue::FromStack(lua_State* pState, int index, bool* pIsComplete)
+	{
+		std::vector<const void*> parents;
+		bool isComplete = true;
+		LuaValue value = FromStack(pState, index, parents, isComplete);
+
+		if (pIsComplete && !isComplete)
+			*pIsComplete = false;
+
+		return value;
+	}
+
+	LuaValue LuaValue::FromStack(lua_State* pState, int index, std::vector<const void*>& parents, bool& isComplete)
+	{
+		switch (lua_type(pState, index))
+		{
+		case LUA_TBOOLEAN:
+			return LuaValue(lua_toboolean(pState, index) != 0);
+
+		case LUA_TNUMBER:
+			return lua_isinteger(pState, index) ? LuaValue(lua_tointeger(pState, index)) : LuaValue(lua_tonumber(pState, index));
+
+		case LUA_TSTRING:
+		{
+			size_t length = 0;
+			const char* value = lua_tolstring(pState, index, &length);
+			return LuaValue(std::string(value, length));
+		}
+
+		case LUA_TTABLE:
+		{
+			const void* pTable = lua_topointer(pState, index);
+			if (std::find(parents.begin(), parents.end(), pTable) != parents.end())
+				return LuaValue();
+
+			if (parents.size() >= kMaxDepth || !lua_checkstack(pState, 3))
+			{
+				isComplete = false;
+				return LuaValue();
+			}
+
+			parents.push_back(pTable);
+
+			index = lua_absindex(pState, index);
+
+			Table table;
+			lua_pushnil(pState);											// [nil]
+			while (lua_next(pState, index) != 0)							// [key, value]
+			{
+				LuaValue key = FromStack(pState, -2, parents, isComplete);
+				LuaValue value = FromStack(pState, -1, parents, isComplete);
+
+				if (!key.IsNil() && !value.IsNil())
+					table.emplace_back(std::move(key), std::move(value));
+
+				lua_pop(pState, 1);											// [key]
+			}
+
+			parents.pop_back();
+			return LuaValue(std::move(table));
+		}
+
+		default:
+			return LuaValue();
+		}
+	}
+}
\ No newline at end of file
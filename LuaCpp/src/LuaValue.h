@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <lua.hpp>
+
+namespace lpp
+{
+	/// \class LuaValue
+	/// \brief A lua value copied out of a state, So it can cross threads and be pushed into another state.
+	///
+	/// Holds nil, booleans, integers, numbers, strings and tables of those. Functions, Userdata and threads can't be copied
+	/// and become nil, A table nested in itself becomes nil where it repeats.
+	class LuaValue
+	{
+	public:
+		using Table = std::vector<std::pair<LuaValue, LuaValue>>;
+
+		enum class Type
+		{
+			Nil,
+			Boolean,
+			Integer,
+			Number,
+			String,
+			Table,
+		};
+
+	private:
+		// In the order of Type.
+		std::variant<std::monostate, bool, lua_Integer, lua_Number, std::string, Table> m_value;
+
+	public:
+		LuaValue() = default;
+		LuaValue(bool value) : m_value(value) {}
+		LuaValue(int value) : m_value(static_cast<lua_Integer>(value)) {}
+		LuaValue(lua_Integer value) : m_value(value) {}
+		LuaValue(lua_Number value) : m_value(value) {}
+		LuaValue(const char* value) : m_value(std::string(value)) {}
+		LuaValue(std::string value) : m_value(std::move(value)) {}
+		LuaValue(Table value) : m_value(std::move(value)) {}
+
+		Type GetType() const { return static_cast<Type>(m_value.index()); }
+		bool IsNil() const { return GetType() == Type::Nil; }
+
+		/// Like `lua_toboolean`, Only nil and false are false.
+		bool ToBoolean() const;
+
+		/// Integers and numbers converted to each other, Zero for other types.
+		lua_Integer ToInteger() const;
+		lua_Number ToNumber() const;
+
+		/// Strings only, Empty for other types.
+		const std::string& ToString() const;
+
+		/// Tables only, Empty for other types.
+		const Table& ToTable() const;
+
+		/// Looks up a field of a table by a string key, nil when there is none.
+		const LuaValue& operator[](const char* key) const;
+
+		/// Tables nested deeper are not copied, See FromStack().
+		static constexpr size_t kMaxDepth = 200;
+
+		/// Pushes a copy of the value, Raises a lua error when out of memory or stack so it must be called from protected code.
+		void Push(lua_State* pState) const;
+
+		/// Copies the value at the index, Raises no lua errors.
+		/// \param pIsComplete Set to false when a table nested deeper than kMaxDepth or beyond the stack of the state became nil.
+		static LuaValue FromStack(lua_State* pState, int index, bool* pIsComplete = nullptr);
+
+	private:
+		/// \param parents The tables being copied around this one, A table among them becomes nil.
+		static LuaValue FromStack(lua_State* pState, int index, std::vector<const void*>& parents, bool& isComplete);
+	};
+}
\ No newline at end of file
@@ -2,9 +2,10 @@
 
 #include <LuaState.h>
 #include <LuaTableIterator.h>
+#include <LuaTracer.h>
 #include <assert.h>
 
-#define L m_pState->GetState()
+#define L GetContext()
 
 namespace lpp
 {
@@ -13,8 +14,10 @@ namespace lpp
 
 	LuaVar::LuaVar(const LuaVar& other)
 		: m_pState(other.m_pState)
+		, m_pContext(other.m_pContext)
 		, m_luaRef(other.m_luaRef)
 		, m_pRefCount(other.m_pRefCount)
+		LUACPP_TRACKING(, m_location(other.m_location))
 	{
 		assert(m_pRefCount != nullptr);
 		other.m_pRefCount->Increment();
@@ -22,22 +25,26 @@ namespace lpp
 
 	LuaVar::LuaVar(LuaVar&& other) noexcept
 		: m_pState(std::move(other.m_pState))
+		, m_pContext(other.m_pContext)
 		, m_luaRef(std::exchange(other.m_luaRef, LUA_NOREF))
-		, m_pRefCount(std::move(other.m_pRefCount))
+		, m_pRefCount(std::exchange(other.m_pRefCount, nullptr))
+		LUACPP_TRACKING(, m_location(other.m_location))
 	{
 	}
 
 	LuaVar& LuaVar::operator=(const LuaVar& other)
 	{
-		if (m_pRefCount)
-		{
-			if (m_pRefCount->Decrement() == 0)
-				delete m_pRefCount;
-		}
+		if (this == &other)
+			return *this;
+
+		// The last LuaVar of a reference releases it, Or the registry slot leaks.
+		Release();
 
 		m_pState = other.m_pState;
+		m_pContext = other.m_pContext;
 		m_luaRef = other.m_luaRef;
 		m_pRefCount = other.m_pRefCount;
+		LUACPP_TRACKING(m_location = other.m_location;)
 
 		assert(m_pRefCount != nullptr);
 		m_pRefCount->Increment();
@@ -47,51 +54,90 @@ namespace lpp
 
 	LuaVar& LuaVar::operator=(LuaVar&& other) noexcept
 	{
-		if (m_pRefCount)
-		{
-			if (m_pRefCount->Decrement() == 0)
-				delete m_pRefCount;
-		}
+		if (this == &other)
+			return *this;
+
+		Release();
 
 		m_pState = std::move(other.m_pState);
+		m_pContext = other.m_pContext;
 		m_luaRef = std::exchange(other.m_luaRef, LUA_NOREF);
-		m_pRefCount = std::move(other.m_pRefCount);
+		m_pRefCount = std::exchange(other.m_pRefCount, nullptr);
+		LUACPP_TRACKING(m_location = other.m_location;)
 
 		return *this;
 	}
 
-	LuaVar::LuaVar(LuaState* pState, int index)
+	LuaVar::LuaVar(LuaState* pState, int index LUACPP_TRACKING(, LuaSourceLocation location))
+		: LuaVar(pState, nullptr, index LUACPP_TRACKING(, location))
+	{}
+
+	LuaVar::LuaVar(LuaState* pState, lua_State* pContext, int index LUACPP_TRACKING(, LuaSourceLocation location))
 		: m_pState(pState)
+		, m_pContext(pContext)
 		, m_pRefCount(new RefCounter(1))
+		LUACPP_TRACKING(, m_location(location))
 	{
 		//Stack: [-index] {any}
 		lua_pushvalue(L, index);
 		m_luaRef = luaL_ref(L, LUA_REGISTRYINDEX);
+		OnReferenceCreated();
 	}
 
-	LuaVar::LuaVar(LuaState* pState, const char* globalName)
+	LuaVar::LuaVar(LuaState* pState, const char* globalName LUACPP_TRACKING(, LuaSourceLocation location))
+		: LuaVar(pState, nullptr, globalName LUACPP_TRACKING(, location))
+	{}
+
+	LuaVar::LuaVar(LuaState* pState, lua_State* pContext, const char* globalName LUACPP_TRACKING(, LuaSourceLocation location))
 		: m_pState(pState)
+		, m_pContext(pContext)
 		, m_luaRef(LUA_NOREF)
 		, m_pRefCount(new RefCounter(1))
+		LUACPP_TRACKING(, m_location(location))
 	{
 		GetGlobal(globalName);
 	}
 
 	LuaVar::~LuaVar()
+	{
+		Release();
+	}
+
+	void LuaVar::Release()
 	{
 		if (m_pRefCount)
 		{
 			// If we were the last RefCounted obj then unreference.
 			if (m_pRefCount->Decrement() == 0)
 			{
+				// The main thread, The context may be released by now.
 				if(m_luaRef != LUA_NOREF)
-					luaL_unref(L, LUA_REGISTRYINDEX, m_luaRef);
+					luaL_unref(m_pState->GetState(), LUA_REGISTRYINDEX, m_luaRef);
+
+				// nil takes no slot.
+				if (m_luaRef >= 0)
+				{
+					LUACPP_STATS(m_pState->GetStats().OnReferenceReleased();)
+					LUACPP_TRACKING(if (LuaReferenceTracker* pTracker = m_pState->GetReferenceTracker()) pTracker->OnReferenceReleased(m_luaRef);)
+				}
 
 				delete m_pRefCount;
 			}
+
+			m_pRefCount = nullptr;
 		}
 	}
 
+	void LuaVar::OnReferenceCreated()
+	{
+		// nil takes no slot.
+		if (m_luaRef < 0)
+			return;
+
+		LUACPP_STATS(m_pState->GetStats().OnReferenceCreated();)
+		LUACPP_TRACKING(if (LuaReferenceTracker* pTracker = m_pState->GetReferenceTracker()) pTracker->OnReferenceCreated(m_luaRef, m_location);)
+	}
+
 	void LuaVar::GetGlobal(const char* globalName)
 	{
 		lua_getglobal(L, globalName);	// Stack: [*]
@@ -135,6 +181,15 @@ namespace lpp
 		}
 	}
 
+	bool LuaVar::PushToStack(lua_State* pThread) const
+	{
+		if (!m_pState || m_luaRef == LUA_NOREF)
+			return false;
+
+		lua_rawgeti(pThread, LUA_REGISTRYINDEX, m_luaRef);
+		return true;
+	}
+
 	bool LuaVar::ReferenceTop()
 	{
 		// If we have a reference, Overwrite
@@ -145,6 +200,7 @@ namespace lpp
 		}
 
 		m_luaRef = luaL_ref(L, LUA_REGISTRYINDEX);
+		OnReferenceCreated();
 		return m_luaRef != LUA_NOREF;
 	}
 
@@ -228,7 +284,7 @@ namespace lpp
 		if(!PushToStack())
 			return false;
 
-		bool result = lua_istable(m_pState->GetState(), -1);	// Stack: [table]
+		bool result = lua_istable(L, -1);	// Stack: [table]
 		lua_pop(L, 1);											// Stack: 
 		return result;
 	}
@@ -249,13 +305,13 @@ namespace lpp
 	LuaVar LuaVar::GetField(const char* fieldName)
 	{
 		if (!PushToStack())
-			return LuaVar(m_pState);	//Return a nil val.
+			return LuaVar(m_pState, m_pContext LUACPP_TRACKING(, m_location));	//Return a nil val.
 										//Stack: [1] table
 
 		lua_pushstring(L, fieldName);
 		lua_rawget(L, -2);				//Stack: [1] table, [2] value
 
-		LuaVar var(m_pState, -1);		//Stack: [1] table, [2] value
+		LuaVar var(m_pState, m_pContext, -1 LUACPP_TRACKING(, m_location));	//Stack: [1] table, [2] value
 		lua_pop(L, 2);					//Stack: 
 		return var;
 	}
@@ -263,13 +319,13 @@ namespace lpp
 	const LuaVar LuaVar::GetField(const char* fieldName) const
 	{
 		if (!PushToStack())
-			return LuaVar(m_pState);	//Return a nil val.
+			return LuaVar(m_pState, m_pContext LUACPP_TRACKING(, m_location));	//Return a nil val.
 										//Stack: [1] table
 
 		lua_pushstring(L, fieldName);
 		lua_rawget(L, -2);				//Stack: [1] table, [2] value
 
-		LuaVar var(m_pState, -1);		//Stack: [1] table, [2] value
+		LuaVar var(m_pState, m_pContext, -1 LUACPP_TRACKING(, m_location));	//Stack: [1] table, [2] value
 		lua_pop(L, 2);					//Stack: 
 		return var;
 	}
@@ -277,13 +333,13 @@ namespace lpp
 	LuaVar LuaVar::operator[](const char* field)
 	{
 		if (!PushToStack())
-			return LuaVar(m_pState);	//Return a nil val.
+			return LuaVar(m_pState, m_pContext LUACPP_TRACKING(, m_location));	//Return a nil val.
 										//Stack: [1] table
 
 		lua_pushstring(L, field);
 		lua_rawget(L, -2);				//Stack: [1] table, [2] value
 
-		LuaVar var(m_pState, -1);		//Stack: [1] table, [2] value
+		LuaVar var(m_pState, m_pContext, -1 LUACPP_TRACKING(, m_location));	//Stack: [1] table, [2] value
 		lua_pop(L, 2);					//Stack: 
 		return var;
 	}
@@ -291,12 +347,12 @@ namespace lpp
 	LuaVar LuaVar::operator[](int index)
 	{
 		if (!PushToStack())
-			return LuaVar(m_pState);	//Return a nil val.
+			return LuaVar(m_pState, m_pContext LUACPP_TRACKING(, m_location));	//Return a nil val.
 										//Stack: [1] table
 
 		lua_rawgeti(L, -1, index);		//Stack: [1] table, [2] value
 
-		LuaVar var(m_pState, -1);		//Stack: [1] table, [2] value
+		LuaVar var(m_pState, m_pContext, -1 LUACPP_TRACKING(, m_location));	//Stack: [1] table, [2] value
 		lua_pop(L, 2);					//Stack: 
 		return var;
 	}
@@ -392,10 +448,14 @@ namespace lpp
 
 		lua_pushvalue(L, -2);						// [table, func, table]
 
+		LUACPP_STATS(m_pState->GetStats().OnCall();)
+
 		// Call the function
 		if (int result = lua_pcall(L, 1, LUA_MULTRET, 0); result != LUA_OK)
 		{
-			FormatCallError(result, functionName);
+			LUACPP_STATS(m_pState->GetStats().OnCallFailed();)
+			FormatCallError(result, functionName);	// [table]
+			lua_pop(L, 1);							// []
 			return LuaVar();
 		}
 
@@ -422,9 +482,12 @@ namespace lpp
 
 		int lastTop = lua_gettop(L);
 
+		LUACPP_STATS(m_pState->GetStats().OnCall();)
+
 		// Call the function
 		if (int result = lua_pcall(L, 0, LUA_MULTRET, 0); result != LUA_OK)
 		{
+			LUACPP_STATS(m_pState->GetStats().OnCallFailed();)
 			FormatCallError(result, "Anonymous function call failed.");
 			return LuaVar();
 		}
@@ -456,9 +519,20 @@ namespace lpp
 		lua_pop(L, 1);
 	}
 
+	void LuaVar::BeginBindingTrace(lua_State* pState, const char* funcName)
+	{
+		LuaState::FromState(pState)->GetTracer()->BeginBinding(pState, funcName);
+	}
+
+	void LuaVar::EndBindingTrace(lua_State* pState)
+	{
+		if (LuaTracer* pTracer = LuaState::FromState(pState)->GetTracer())
+			pTracer->EndBinding(pState);
+	}
+
 	LuaVar LuaVar::BuildReturnValue(int stackTop, int stackNew)
 	{
-		LuaVar result(m_pState);
+		LuaVar result(m_pState, m_pContext LUACPP_TRACKING(, m_location));
 		
 		const int count = stackNew - stackTop;
 
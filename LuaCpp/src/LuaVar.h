@@ -7,6 +7,9 @@
 #include <RefCounter.h>
 #include <LuaState.h>
 #include <LuaStack.h>
+#include <LuaPending.h>
+#include <LuaExceptions.h>
+#include <LuaReferenceTracker.h>
 
 namespace lpp
 {
@@ -22,9 +25,18 @@ namespace lpp
 	{
 	private:
 		LuaState* m_pState;
+
+		// The thread whose stack is used, nullptr uses the main thread of the state.
+		lua_State* m_pContext;
+
 		int m_luaRef;
 		RefCounter* m_pRefCount;
 
+#ifdef LUACPP_TRACK_REFERENCES
+		// Where the LuaVar was created, Reported by LuaReferenceTracker.
+		LuaSourceLocation m_location;
+#endif
+
 	public:
 
 #pragma region Constructors / Initialization
@@ -32,15 +44,27 @@ namespace lpp
 		/// Creates an empty LuaVar. This LuaVar has no LuaState
 		LuaVar()
 			: m_pState(nullptr)
+			, m_pContext(nullptr)
 			, m_luaRef(LUA_NOREF)
 			, m_pRefCount(new RefCounter(1))
 		{}
 
 		/// Creates an empty LuaVar.
-		LuaVar(LuaState* pState)
+		LuaVar(LuaState* pState LUACPP_TRACKING(, LuaSourceLocation location = LuaSourceLocation::Current()))
+			: m_pState(pState)
+			, m_pContext(nullptr)
+			, m_luaRef(LUA_NOREF)
+			, m_pRefCount(new RefCounter(1))
+			LUACPP_TRACKING(, m_location(location))
+		{}
+
+		/// Creates an empty LuaVar using the stack of a thread of the state, e.g. a LuaExecutionContext.
+		LuaVar(LuaState* pState, lua_State* pContext LUACPP_TRACKING(, LuaSourceLocation location = LuaSourceLocation::Current()))
 			: m_pState(pState)
+			, m_pContext(pContext)
 			, m_luaRef(LUA_NOREF)
 			, m_pRefCount(new RefCounter(1))
+			LUACPP_TRACKING(, m_location(location))
 		{}
 
 		LuaVar(const LuaVar&);
@@ -49,16 +73,33 @@ namespace lpp
 		LuaVar& operator=(LuaVar&&) noexcept;
 
 		/// Creates a LuaVar from the stack.
-		LuaVar(LuaState* pState, int index);
+		LuaVar(LuaState* pState, int index LUACPP_TRACKING(, LuaSourceLocation location = LuaSourceLocation::Current()));
+
+		/// Creates a LuaVar from the stack of a thread of the state.
+		LuaVar(LuaState* pState, lua_State* pContext, int index LUACPP_TRACKING(, LuaSourceLocation location = LuaSourceLocation::Current()));
 
 		/// Creates a LuaVar from a global variable.
-		LuaVar(LuaState* pState, const char* globalName);
+		LuaVar(LuaState* pState, const char* globalName LUACPP_TRACKING(, LuaSourceLocation location = LuaSourceLocation::Current()));
+
+		/// Creates a LuaVar from a global variable, Using the stack of a thread of the state.
+		LuaVar(LuaState* pState, lua_State* pContext, const char* globalName LUACPP_TRACKING(, LuaSourceLocation location = LuaSourceLocation::Current()));
 
 		/// Decrement Reference Count, If last reference then dereference the lua reference.
 		~LuaVar();
 
 #pragma endregion
 
+		/// <summary>
+		/// Get the thread whose stack the LuaVar uses, The main thread of the state unless a context was given.
+		/// </summary>
+		lua_State* GetContext() const { return m_pContext ? m_pContext : m_pState->GetState(); }
+
+		/// <summary>
+		/// Use the stack of another thread of the same state, nullptr uses the main thread. References are shared by every thread.
+		/// Only destroying the LuaVar is safe once the thread is released, Switch back to the main thread to keep using it.
+		/// </summary>
+		void SetContext(lua_State* pContext) { m_pContext = pContext; }
+
 		/// <summary>
 		/// Reference the global variable.
 		/// </summary>
@@ -74,14 +115,16 @@ namespace lpp
 		template<typename Type>
 		void Set(Type&& val)
 		{
-			LuaStack::Push(m_pState->GetState(), std::forward<Type>(val));
+			LUACPP_STATS(m_pState->GetStats().OnPush(LuaStack::GetPushType<Type>());)
+			LuaStack::Push(GetContext(), std::forward<Type>(val));
 			ReferenceTop();
 		}
 
 		template<typename Type>
 		void Set(const Type& val)
 		{
-			LuaStack::Push(m_pState->GetState(), val);
+			LUACPP_STATS(m_pState->GetStats().OnPush(LuaStack::GetPushType<Type>());)
+			LuaStack::Push(GetContext(), val);
 			ReferenceTop();
 		}
 
@@ -91,8 +134,8 @@ namespace lpp
 			if (!PushToStack())
 				return Type();
 
-			Type val = LuaStack::Get<Type>(m_pState->GetState(), -1);
-			lua_pop(m_pState->GetState(), 1);
+			Type val = LuaStack::Get<Type>(GetContext(), -1);
+			lua_pop(GetContext(), 1);
 			return val;
 		}
 
@@ -104,12 +147,12 @@ namespace lpp
 
 			Type val = defaultVal;
 
-			if (Is(m_pState->GetState(), -1))
-				val = LuaStack::Get<Type>(m_pState->GetState(), -1);
+			if (Is(GetContext(), -1))
+				val = LuaStack::Get<Type>(GetContext(), -1);
 			else
 				val = defaultVal;
 
-			lua_pop(m_pState->GetState(), 1);
+			lua_pop(GetContext(), 1);
 			return val;
 		}
 
@@ -125,7 +168,9 @@ namespace lpp
 			}
 			else
 			{
-				return LuaStack::Is<Type>(m_pState->GetState(), -1);
+				const bool isType = LuaStack::Is<Type>(GetContext(), -1);
+				lua_pop(GetContext(), 1);
+				return isType;
 			}
 		}
 
@@ -208,6 +253,11 @@ namespace lpp
 		template<typename... Args>
 		LuaVar Call(const char* functionName, Args&&... args);
 
+		/// Calls a function on the LuaVar on the stack of the given thread, e.g. the thread of a LuaExecutionContext.
+		/// The returned LuaVar uses the same context.
+		template<typename... Args>
+		LuaVar Call(lua_State* pContext, const char* functionName, Args&&... args);
+
 		/// Check wether the current LuaVar reference is a function.
 		bool IsFunction();
 
@@ -227,6 +277,10 @@ namespace lpp
 		/// \return If the LuaVar is a nil reference it will return false.
 		bool PushToStack() const;
 
+		/// Pushes the LuaVar reference to the stack of another thread sharing the same registry, e.g. a coroutine.
+		/// \return If the LuaVar is a nil reference it will return false.
+		bool PushToStack(lua_State* pThread) const;
+
 		/// Prints the LuaVar as best to its ability.
 		void Print() const;
 
@@ -237,6 +291,16 @@ namespace lpp
 		/// </summary>
 		bool ReferenceTop();
 
+		/// <summary>
+		/// Drops this LuaVar from the shared reference count, Releasing the reference when it was the last one.
+		/// </summary>
+		void Release();
+
+		/// <summary>
+		/// Counts the reference just taken and reports it to the LuaReferenceTracker of the state.
+		/// </summary>
+		void OnReferenceCreated();
+
 		/// <summary>
 		/// Sets the current reference to the value on top of the stack.
 		/// </summary>
@@ -259,10 +323,15 @@ namespace lpp
 		/// <devnote>
 		///	Grabs the object from the table from the field `__this`
 		///	Then we extract the function pointer we bound from the upvalue and call the function.
+		///	Exceptions thrown by the function are raised as lua errors, Unless the function is `noexcept`.
 		/// </devnote>
 		template<typename Object, typename Function>
 		static int CallBoundMemberFunction(lua_State* pState);
 
+		/// Records the bound function with the LuaTracer of the state, See LuaState::GetTracer().
+		static void BeginBindingTrace(lua_State* pState, const char* funcName);
+		static void EndBindingTrace(lua_State* pState);
+
 		/// We first grab the amount of arguments we require to call the function.
 		/// After building the argument pack we call the function passing the arguments through.
 		/// \returns If the function has a return type we push the value to the stack using LuaStack::Push() and return 1
@@ -305,7 +374,7 @@ namespace lpp
 
 														// [?]
 
-		lua_State* L = m_pState->GetState();
+		lua_State* L = GetContext();
 
 		Type val = LuaStack::Get(L, -1, defaultVal);
 
@@ -322,8 +391,9 @@ namespace lpp
 
 								// [?]
 
-		lua_State* L = m_pState->GetState();
+		lua_State* L = GetContext();
 
+		LUACPP_STATS(m_pState->GetStats().OnPush(LuaStack::GetPushType<Type>());)
 		LuaStack::Push(L, value);
 		SetReferenceTop();
 
@@ -337,12 +407,13 @@ namespace lpp
 		if (!PushToStack())
 			return;
 
-		lua_State* L = m_pState->GetState();
+		lua_State* L = GetContext();
 
 		if (!lua_istable(L, -1))
 			return;
 										// [table]
 
+		LUACPP_STATS(m_pState->GetStats().OnPush(LuaStack::GetPushType<Type>());)
 		LuaStack::Push(L, val);
 		lua_setfield(L, -2, fieldName);
 
@@ -357,7 +428,7 @@ namespace lpp
 
 													// [table]
 
-		lua_State* L = m_pState->GetState();
+		lua_State* L = GetContext();
 
 		int lastTop = lua_gettop(L);
 
@@ -381,10 +452,15 @@ namespace lpp
 		int argCount = sizeof...(Args) + 1; // arguments + table.
 		// --
 
+		LUACPP_STATS(LuaStats& stats = m_pState->GetStats();)
+		LUACPP_STATS(((void)stats.OnPush(LuaStack::GetPushType<Args>()), ...); stats.OnCall();)
+
 		// Call the function
 		if (int result = lua_pcall(L, argCount, LUA_MULTRET, 0); result != LUA_OK)
 		{
-			FormatCallError(result, functionName);
+			LUACPP_STATS(stats.OnCallFailed();)
+			FormatCallError(result, functionName);	// [table]
+			lua_pop(L, 1);							// []
 			return LuaVar();
 		}
 
@@ -397,6 +473,15 @@ namespace lpp
 		return result;
 	}
 
+	template<typename... Args>
+	inline LuaVar LuaVar::Call(lua_State* pContext, const char* functionName, Args&&... args)
+	{
+		// A copy shares the reference, Only the stack differs.
+		LuaVar var(*this);
+		var.m_pContext = pContext;
+		return var.Call(functionName, std::forward<Args>(args)...);
+	}
+
 	template<typename... Args>
 	inline LuaVar LuaVar::operator()(Args... args)
 	{
@@ -409,12 +494,19 @@ namespace lpp
 		PushToStack();																						//  [t]
 
 		// HACK: Literally copying the memory address of the member function storing it as an upvalue.
-		void* pBuffer = lua_newuserdata(m_pState->GetState(), sizeof(Function));   //  [t, pMemberFunc]
+		void* pBuffer = lua_newuserdata(GetContext(), sizeof(Function));   //  [t, pMemberFunc]
 		std::memcpy(pBuffer, &func, sizeof(Function));
 
-		lua_pushcclosure(m_pState->GetState(), &CallBoundMemberFunction<Object, Function>, 1);				//  [t, closure]
-		lua_setfield(m_pState->GetState(), -2, funcName); 													//  [t]
-		lua_pop(m_pState->GetState(), 1);
+		lua_pushstring(GetContext(), funcName);															//  [t, pMemberFunc, name]
+
+#ifdef LUACPP_NO_STATS
+		lua_pushcclosure(GetContext(), &CallBoundMemberFunction<Object, Function>, 2);				//  [t, closure]
+#else
+		lua_pushlightuserdata(GetContext(), m_pState->GetStats().GetBinding(funcName));				//  [t, pMemberFunc, name, pStats]
+		lua_pushcclosure(GetContext(), &CallBoundMemberFunction<Object, Function>, 3);				//  [t, closure]
+#endif
+		lua_setfield(GetContext(), -2, funcName); 													//  [t]
+		lua_pop(GetContext(), 1);
 	}
 
 	template<typename Object, typename Function>
@@ -435,7 +527,26 @@ namespace lpp
 			{
 				void* pFuncBuffer = lua_touserdata(pState, lua_upvalueindex(1));		// [t, pMemberFunction]
 				Function* pFunc = reinterpret_cast<Function*>(pFuncBuffer);
-				return LuaVar::StdCall(pState, pObj, *pFunc);
+
+				LUACPP_STATS(LuaBindingStats* pStats = static_cast<LuaBindingStats*>(lua_touserdata(pState, lua_upvalueindex(3))));
+				LUACPP_STATS(const bool isTimed = pStats->dispatchCount++ % LuaStats::kLatencySampleInterval == 0;)
+				LUACPP_STATS(const int64_t start = isTimed ? LuaStats::Now() : 0;)
+
+				// An error skips the end, The tracer closes the binding at the next event of the thread.
+				const bool isTracing = LuaState::FromState(pState)->GetTracer() != nullptr;
+				if (isTracing)
+					BeginBindingTrace(pState, lua_tostring(pState, lua_upvalueindex(2)));
+
+				const int resultCount = CallWithExceptionBoundary<is_noexcept_function_v<std::decay_t<Function>>>(pState, [pState, pObj, pFunc]()
+				{
+					return LuaVar::StdCall(pState, pObj, *pFunc);
+				});
+
+				if (isTracing)
+					EndBindingTrace(pState);
+
+				LUACPP_STATS(if (isTimed) pStats->latency.Record(static_cast<uint64_t>(LuaStats::Now() - start));)
+				return resultCount;
 			}
 			else
 			{
@@ -454,19 +565,30 @@ namespace lpp
 	inline int LuaVar::StdCall(lua_State* pState, Object* pObj, ReturnType(Object::* pFunc)(Args...))
 	{
 		using ObjectTuple = std::tuple<Object*>;
-		auto arguments = std::tuple_cat(ObjectTuple(pObj), BuildArguments<Args...>(pState));
 
-		if constexpr (std::is_void_v<ReturnType>)
+		if constexpr (is_lua_pending_v<ReturnType>)
 		{
-			// ((*pObj).*(pFunc))(pack...);
-			std::apply(pFunc, arguments);
-			return 0;
+			// The arguments are destroyed at the end of the statement, Before yielding unwinds the C function.
+			std::shared_ptr<LuaPendingSlot> pSlot = std::apply(pFunc, std::tuple_cat(ObjectTuple(pObj), BuildArguments<Args...>(pState))).GetSlot();
+			return LuaPendingSlot::Yield(pState, std::move(pSlot));
 		}
 		else
 		{
-			ReturnType val = std::apply(pFunc, arguments);
-			LuaStack::Push(pState, val);
-			return 1;
+			auto arguments = std::tuple_cat(ObjectTuple(pObj), BuildArguments<Args...>(pState));
+
+			if constexpr (std::is_void_v<ReturnType>)
+			{
+				// ((*pObj).*(pFunc))(pack...);
+				std::apply(pFunc, arguments);
+				return 0;
+			}
+			else
+			{
+				ReturnType val = std::apply(pFunc, arguments);
+				LUACPP_STATS(LuaState::FromState(pState)->GetStats().OnPush(LuaStack::GetPushType<ReturnType>());)
+				LuaStack::Push(pState, val);
+				return 1;
+			}
 		}
 	}
 
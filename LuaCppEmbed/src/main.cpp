@@ -0,0 +1,52 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#include <LuaBundle.h>
+
+// Compiles a directory of scripts into a C++ translation unit defining a lpp::LuaEmbeddedScripts, See embedscripts() in premake5.lua.
+//
+// Usage: LuaCppEmbed <scriptDirectory> <output.cpp> <symbol> [--source] [--debug]
+//   --source  Embed the source instead of bytecode.
+//   --debug   Keep debug information in the bytecode.
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		std::fprintf(stderr, "Usage: LuaCppEmbed <scriptDirectory> <output.cpp> <symbol> [--source] [--debug]\n");
+		return 1;
+	}
+
+	bool isCompiling = true;
+	bool isStripping = true;
+	for (int i = 4; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--source") == 0)
+			isCompiling = false;
+		else if (std::strcmp(argv[i], "--debug") == 0)
+			isStripping = false;
+	}
+
+	namespace fs = std::filesystem;
+
+	fs::path directory = fs::absolute(argv[1]).lexically_normal();
+	if (!directory.has_filename())
+		directory = directory.parent_path();
+
+	const fs::path output = fs::absolute(argv[2]);
+	fs::create_directories(output.parent_path());
+
+	// Chunk names become "@scripts/ui/button.lua" instead of the absolute path on the build machine.
+	fs::current_path(directory.parent_path());
+
+	lpp::LuaBundleWriter writer(isStripping);
+	if (!writer.AddDirectory(directory.filename().string(), isCompiling) || !writer.WriteEmbedded(output.string().c_str(), argv[3]))
+	{
+		std::fprintf(stderr, "LuaCppEmbed: %s\n", writer.GetError().c_str());
+		return 1;
+	}
+
+	std::printf("LuaCppEmbed: %zu scripts from %s\n", writer.GetChunkCount(), directory.string().c_str());
+	return 0;
+}
\ No newline at end of file
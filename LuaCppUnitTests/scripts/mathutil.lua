@@ -0,0 +1,7 @@
+local M = {}
+
+function M.clamp(value, low, high)
+	return math.max(low, math.min(high, value))
+end
+
+return M
\ No newline at end of file
@@ -0,0 +1,14 @@
+local ui = require("ui")
+
+local button = {}
+button.__index = button
+
+function button.new(label)
+	return setmetatable({ label = label, parent = ui.name }, button)
+end
+
+function button:text()
+	return "[" .. self.label .. "]"
+end
+
+return button
\ No newline at end of file
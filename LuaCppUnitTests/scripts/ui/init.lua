@@ -0,0 +1,4 @@
+return {
+	name = "ui",
+	version = 2,
+}
\ No newline at end of file
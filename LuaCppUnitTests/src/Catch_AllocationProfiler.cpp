@@ -0,0 +1,191 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <LuaVar.h>
+#include <LuaAllocationProfiler.h>
+#include <LuaCoroutine.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	const lpp::LuaAllocationSite* FindSite(const std::vector<lpp::LuaAllocationSite>& sites, const std::string& location)
+	{
+		for (const lpp::LuaAllocationSite& site : sites)
+		{
+			if (site.location == location)
+				return &site;
+		}
+
+		return nullptr;
+	}
+
+	uint64_t GetAllocatedBytes(const std::vector<lpp::LuaAllocationSite>& sites, const std::string& function)
+	{
+		uint64_t bytes = 0;
+		for (const lpp::LuaAllocationSite& site : sites)
+		{
+			if (site.location.find("(" + function + ")") != std::string::npos)
+				bytes += site.allocatedBytes;
+		}
+
+		return bytes;
+	}
+}
+
+TEST_CASE("Allocation Profiler", "[LuaCpp][AllocationProfiler]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	REQUIRE(state.LoadScript(R"(
+		function leak(n)
+			cache = cache or {}
+			for i = 1, n do
+				cache[#cache + 1] = { i, i + 1, i + 2, i + 3 }
+			end
+		end
+		function churn(n)
+			for i = 1, n do
+				local s = string.rep('x', 100) .. i
+			end
+		end
+	)", "=allocating"));
+
+	SECTION("Every allocation is attributed when sampling every byte")
+	{
+		lpp::LuaAllocationProfiler profiler(&state, 1);
+		REQUIRE(state.GetAllocationProfiler() == &profiler);
+
+		REQUIRE(state.Execute("leak(1000)"));
+		REQUIRE(state.Execute("churn(1000)"));
+		state.CollectGarbage();
+
+		const std::vector<lpp::LuaAllocationSite> sites = profiler.GetSites();
+
+		// The tables stay alive in the cache, The strings are garbage.
+		const lpp::LuaAllocationSite* pLeak = FindSite(sites, "allocating:5 (leak)");
+		REQUIRE(pLeak != nullptr);
+		REQUIRE(pLeak->allocationCount >= 1000);
+		REQUIRE(pLeak->liveCount >= 1000);
+		REQUIRE(pLeak->liveBytes >= 1000 * 4 * sizeof(lua_Integer));
+		REQUIRE(sites[0].location == pLeak->location);
+
+		// string.rep is a C function, Its allocations belong to the calling line.
+		const lpp::LuaAllocationSite* pChurn = FindSite(sites, "allocating:10 (churn)");
+		REQUIRE(pChurn != nullptr);
+		REQUIRE(pChurn->allocationCount >= 2000);
+		REQUIRE(pChurn->liveCount < pChurn->allocationCount / 10);
+
+		REQUIRE(profiler.GetReport(5).find("allocating:5 (leak)\n") != std::string::npos);
+	}
+
+	SECTION("Sampling estimates the bytes allocated")
+	{
+		lpp::LuaAllocationProfiler profiler(&state, 4096);
+		state.SetAllocationTracking(true);
+
+		const size_t allocatedBefore = state.GetTotalAllocatedBytes();
+		REQUIRE(state.Execute("churn(20000)"));
+		const size_t allocated = state.GetTotalAllocatedBytes() - allocatedBefore;
+
+		state.SetAllocationTracking(false);
+
+		REQUIRE(profiler.GetSampleCount() < 20000);
+
+		// Within a few percent, Every sample counts for 4096 bytes.
+		const uint64_t estimated = GetAllocatedBytes(profiler.GetSites(), "churn");
+		REQUIRE(static_cast<double>(estimated) == Approx(static_cast<double>(allocated)).epsilon(0.05));
+	}
+
+	SECTION("Allocations outside of Lua code and in coroutines")
+	{
+		lpp::LuaAllocationProfiler profiler(&state, 1);
+
+		lua_createtable(state.GetState(), 100, 0);
+		lua_pop(state.GetState(), 1);
+
+		REQUIRE(state.Execute("function worker() coroutine.yield() leak(100) end"));
+		lpp::LuaCoroutine coroutine(&state, lpp::LuaVar(&state, "worker"));
+		REQUIRE(coroutine.Resume());
+		REQUIRE(coroutine.Resume());
+
+		const std::vector<lpp::LuaAllocationSite> sites = profiler.GetSites();
+		REQUIRE(FindSite(sites, "[C++]") != nullptr);
+		REQUIRE(FindSite(sites, "allocating:5 (leak)") != nullptr);
+		REQUIRE(FindSite(sites, "allocating:5 (leak)")->allocationCount >= 100);
+
+		profiler.Reset();
+		REQUIRE(profiler.GetSites().empty());
+	}
+
+	SECTION("Wrappers of the state are removed in any order")
+	{
+		void* pBaseData = nullptr;
+		const lua_Alloc baseAlloc = lua_getallocf(state.GetState(), &pBaseData);
+
+		{
+			// The memory limit wraps the profiler, It forwards to the base allocator once the profiler is gone.
+			lpp::LuaAllocationProfiler profiler(&state, 1);
+			state.SetMemoryLimit(64 * 1024 * 1024);
+		}
+
+		REQUIRE(state.Execute("leak(100)"));
+		state.SetMemoryLimit(0);
+
+		void* pData = nullptr;
+		REQUIRE(lua_getallocf(state.GetState(), &pData) == baseAlloc);
+		REQUIRE(pData == pBaseData);
+
+		{
+			// The profiler wraps the memory limit, It forwards to the base allocator once the limit is removed.
+			state.SetMemoryLimit(64 * 1024 * 1024);
+			lpp::LuaAllocationProfiler profiler(&state, 1);
+			state.SetMemoryLimit(0);
+
+			REQUIRE(state.Execute("leak(100)"));
+			REQUIRE(FindSite(profiler.GetSites(), "allocating:5 (leak)") != nullptr);
+		}
+
+		REQUIRE(lua_getallocf(state.GetState(), &pData) == baseAlloc);
+		REQUIRE(pData == pBaseData);
+	}
+
+	// The allocator of the state is restored.
+	REQUIRE(state.GetAllocationProfiler() == nullptr);
+	REQUIRE(state.Execute("leak(10)"));
+}
+
+TEST_CASE("Allocation Profiler Benchmark", "[LuaCpp][AllocationProfiler][!benchmark]")
+{
+	lpp::LuaState state;
+	state.Init();
+	state.Execute("function churn(n) for i = 1, n do local t = { i, tostring(i) } end end");
+
+	BENCHMARK("100k allocating iterations without the profiler")
+	{
+		state.Execute("churn(100000)");
+	}
+
+	{
+		lpp::LuaAllocationProfiler profiler(&state);
+
+		BENCHMARK("100k allocating iterations sampled every 64KB")
+		{
+			state.Execute("churn(100000)");
+		}
+	}
+
+	{
+		lpp::LuaAllocationProfiler profiler(&state, 1);
+
+		BENCHMARK("100k allocating iterations recording every allocation")
+		{
+			state.Execute("churn(100000)");
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <ostream>
+#include <thread>
+
+#include <LuaVar.h>
+#include <LuaPoolAllocator.h>
+#include <LuaArenaAllocator.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	constexpr const char* kGarbageScript =
+		"local t = {}\n"
+		"for i = 1, 20000 do\n"
+		"	t[i % 500] = { x = i, name = 'item' .. i, list = { i, i + 1 } }\n"
+		"end\n"
+		"big = string.rep('x', 4096)\n";
+}
+
+TEST_CASE("Pool Allocator", "[LuaCpp][Allocator]")
+{
+	lpp::LuaPoolAllocator allocator;
+
+	SECTION("Runs scripts")
+	{
+		lpp::LuaState state(&lpp::LuaPoolAllocator::Allocate, &allocator);
+		state.Init();
+
+		REQUIRE(luaL_dostring(state.GetState(), kGarbageScript) == LUA_OK);
+		REQUIRE(lpp::LuaVar(&state, "big").Get<std::string>().size() == 4096);
+
+		const lpp::LuaAllocatorStats& stats = allocator.GetStats();
+		REQUIRE(stats.pooledCount > 0);
+		REQUIRE(stats.fallbackCount > 0);
+		REQUIRE(stats.freeCount > 0);
+		REQUIRE(stats.bytesInUse > 0);
+		REQUIRE(stats.peakBytesInUse >= stats.bytesInUse);
+
+		// Matches what lua itself accounts for.
+		size_t luaBytes = static_cast<size_t>(lua_gc(state.GetState(), LUA_GCCOUNT, 0)) * 1024 + lua_gc(state.GetState(), LUA_GCCOUNTB, 0);
+		REQUIRE(stats.bytesInUse == luaBytes);
+	}
+
+	SECTION("Everything is released on close")
+	{
+		{
+			lpp::LuaState state(&lpp::LuaPoolAllocator::Allocate, &allocator);
+			state.Init();
+			luaL_dostring(state.GetState(), kGarbageScript);
+		}
+
+		const lpp::LuaAllocatorStats& stats = allocator.GetStats();
+		REQUIRE(stats.bytesInUse == 0);
+		REQUIRE(stats.allocationCount == stats.freeCount);
+	}
+
+	SECTION("States on other threads")
+	{
+		lpp::LuaPoolAllocator threadAllocator;
+
+		std::thread worker([&threadAllocator]()
+		{
+			lpp::LuaState state(&lpp::LuaPoolAllocator::Allocate, &threadAllocator);
+			state.Init();
+			luaL_dostring(state.GetState(), kGarbageScript);
+		});
+		worker.join();
+
+		// The free lists of the exited thread are reused here.
+		lpp::LuaState state(&lpp::LuaPoolAllocator::Allocate, &allocator);
+		state.Init();
+		REQUIRE(luaL_dostring(state.GetState(), kGarbageScript) == LUA_OK);
+
+		REQUIRE(threadAllocator.GetStats().bytesInUse == 0);
+	}
+}
+
+TEST_CASE("Pool Allocator Benchmark", "[LuaCpp][Allocator][!benchmark]")
+{
+	constexpr const char* kScript =
+		"local live = {}\n"
+		"for i = 1, 1000000 do\n"
+		"	live[i % 1000] = { i, tostring(i), function() return i end }\n"
+		"end\n";
+
+	BENCHMARK("Default allocator")
+	{
+		lpp::LuaState state;
+		state.Init();
+		luaL_dostring(state.GetState(), kScript);
+	}
+
+	lpp::LuaPoolAllocator allocator;
+
+	BENCHMARK("Pool allocator")
+	{
+		lpp::LuaState state(&lpp::LuaPoolAllocator::Allocate, &allocator);
+		state.Init();
+		luaL_dostring(state.GetState(), kScript);
+	}
+
+	const lpp::LuaAllocatorStats& stats = allocator.GetStats();
+	WARN("Pooled: " << stats.pooledCount << ", Fallback: " << stats.fallbackCount << ", Peak bytes: " << stats.peakBytesInUse);
+}
+
+TEST_CASE("Arena Allocator", "[LuaCpp][Allocator]")
+{
+	lpp::LuaArenaAllocator arena;
+
+	SECTION("Teardown releases the arena")
+	{
+		{
+			lpp::LuaState state(&arena);
+			REQUIRE(state.Init());
+			REQUIRE(luaL_dostring(state.GetState(), kGarbageScript) == LUA_OK);
+			REQUIRE(lpp::LuaVar(&state, "big").Get<std::string>().size() == 4096);
+			REQUIRE(arena.GetReservedBytes() > lpp::LuaArenaAllocator::kDefaultChunkSize);
+		}
+
+		REQUIRE(arena.GetUsedBytes() == 0);
+		REQUIRE(arena.GetReservedBytes() == lpp::LuaArenaAllocator::kDefaultChunkSize);
+
+		// The arena is reused by the next request.
+		lpp::LuaState state(&arena);
+		REQUIRE(state.Init());
+		REQUIRE(luaL_dostring(state.GetState(), "x = 1 + 1") == LUA_OK);
+	}
+
+	SECTION("Capacity")
+	{
+		arena.SetCapacity(512 * 1024);
+
+		lpp::LuaState state(&arena);
+		REQUIRE(state.Init());
+
+		REQUIRE(luaL_loadstring(state.GetState(), "local t = {} for i = 1, 1e7 do t[i] = {} end") == LUA_OK);
+		REQUIRE(lua_pcall(state.GetState(), 0, 0, 0) == LUA_ERRMEM);
+		lua_pop(state.GetState(), 1);
+
+		REQUIRE(arena.GetFailedCount() > 0);
+		REQUIRE(arena.GetReservedBytes() <= arena.GetCapacity());
+	}
+
+	SECTION("Too small to create a state")
+	{
+		arena.SetCapacity(64);
+
+		lpp::LuaState state(&arena);
+		REQUIRE(state.GetState() == nullptr);
+		REQUIRE(state.Init() == false);
+	}
+}
+
+TEST_CASE("Arena Allocator Benchmark", "[LuaCpp][Allocator][!benchmark]")
+{
+	// A request that builds up a lot of objects and tears the state down again.
+	constexpr const char* kScript =
+		"local live = {}\n"
+		"for i = 1, 200000 do\n"
+		"	live[i] = { i, tostring(i) }\n"
+		"end\n"
+		"keep = live\n";
+
+	BENCHMARK("Default allocator request")
+	{
+		lpp::LuaState state;
+		state.Init();
+		luaL_dostring(state.GetState(), kScript);
+	}
+
+	lpp::LuaArenaAllocator arena;
+
+	BENCHMARK("Arena request")
+	{
+		lpp::LuaState state(&arena);
+		state.Init();
+		luaL_dostring(state.GetState(), kScript);
+	}
+}
\ No newline at end of file
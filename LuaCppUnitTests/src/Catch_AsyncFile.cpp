@@ -0,0 +1,171 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <ostream>
+#include <string>
+
+#include <LuaVar.h>
+#include <LuaAsyncFile.h>
+#include <LuaScheduler.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	constexpr const char* kTestFile = "LuaCppAsyncFileTest.bin";
+
+	/// Ticks until every task finished, Fails the test instead of hanging when something never completes.
+	bool TickUntilDone(lpp::LuaScheduler& scheduler, double& now)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (scheduler.GetTaskCount() > 0)
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+				return false;
+
+			now += 0.01;
+			scheduler.Tick(now);
+		}
+
+		return true;
+	}
+}
+
+TEST_CASE("Async File", "[LuaCpp][AsyncFile]")
+{
+	// Binary content, The embedded zero must survive the round trip.
+	const std::string content("Hello\0World", 11);
+
+	{
+		std::FILE* pFile = std::fopen(kTestFile, "wb");
+		REQUIRE(pFile != nullptr);
+		std::fwrite(content.data(), 1, content.size(), pFile);
+		std::fclose(pFile);
+	}
+
+	lpp::LuaState state;
+	state.Init();
+
+	lpp::LuaScheduler scheduler(&state);
+	lpp::LuaAsyncFile files(&state);
+
+	double now = 0.0;
+
+	luaL_dostring(state.GetState(),
+		"function ReadAll(path) data, message = asyncio.readFile(path) end\n"
+		"function ReadRange(path, offset, size) data, message = asyncio.readRange(path, offset, size) end\n"
+		"function WriteAll(path, text) written, message = asyncio.writeFile(path, text) end\n");
+
+	SECTION("Read file")
+	{
+		// Small reads can finish before the coroutine suspends, Spawn then returns kInvalidTask as it completed right away.
+		scheduler.Spawn(lpp::LuaVar(&state, "ReadAll"), kTestFile);
+		REQUIRE(TickUntilDone(scheduler, now));
+
+		REQUIRE(lpp::LuaVar(&state, "data").Get<std::string>() == content);
+	}
+
+	SECTION("Read range")
+	{
+		scheduler.Spawn(lpp::LuaVar(&state, "ReadRange"), kTestFile, 6, 100);
+		REQUIRE(TickUntilDone(scheduler, now));
+
+		REQUIRE(lpp::LuaVar(&state, "data").Get<std::string>() == "World");
+	}
+
+	SECTION("Read range larger than the file")
+	{
+		// The buffer is sized by the file, Not by what the script asked for.
+		luaL_dostring(state.GetState(), "function ReadHuge(path, offset) data, message = asyncio.readRange(path, offset, 1 << 52) end");
+
+		scheduler.Spawn(lpp::LuaVar(&state, "ReadHuge"), kTestFile, 6);
+		REQUIRE(TickUntilDone(scheduler, now));
+		REQUIRE(lpp::LuaVar(&state, "data").Get<std::string>() == "World");
+
+		scheduler.Spawn(lpp::LuaVar(&state, "ReadHuge"), kTestFile, 100);
+		REQUIRE(TickUntilDone(scheduler, now));
+		REQUIRE(lpp::LuaVar(&state, "data").Get<std::string>().empty());
+	}
+
+	SECTION("Write file")
+	{
+		scheduler.Spawn(lpp::LuaVar(&state, "WriteAll"), kTestFile, "Rewritten");
+		REQUIRE(TickUntilDone(scheduler, now));
+		REQUIRE(lpp::LuaVar(&state, "written").Get<bool>());
+
+		scheduler.Spawn(lpp::LuaVar(&state, "ReadAll"), kTestFile);
+		REQUIRE(TickUntilDone(scheduler, now));
+		REQUIRE(lpp::LuaVar(&state, "data").Get<std::string>() == "Rewritten");
+	}
+
+	SECTION("Missing file")
+	{
+		scheduler.Spawn(lpp::LuaVar(&state, "ReadAll"), "LuaCppMissingFile.bin");
+		REQUIRE(TickUntilDone(scheduler, now));
+
+		REQUIRE_FALSE(lpp::LuaVar(&state, "data").Is<std::string>());
+		REQUIRE(lpp::LuaVar(&state, "message").Get<std::string>().find("LuaCppMissingFile.bin") != std::string::npos);
+	}
+
+	SECTION("Outside of a coroutine")
+	{
+		REQUIRE(luaL_dostring(state.GetState(), "asyncio.readFile('anything')") != LUA_OK);
+		lua_pop(state.GetState(), 1);
+	}
+
+	std::remove(kTestFile);
+}
+
+TEST_CASE("Async File Loopback", "[LuaCpp][AsyncFile][!benchmark]")
+{
+	// Scripts stream a file in while the host keeps ticking, The frame time should not grow with the file size.
+	const size_t fileSize = 8 * 1024 * 1024;
+
+	{
+		std::string content(fileSize, 'x');
+		std::FILE* pFile = std::fopen(kTestFile, "wb");
+		REQUIRE(pFile != nullptr);
+		std::fwrite(content.data(), 1, content.size(), pFile);
+		std::fclose(pFile);
+	}
+
+	lpp::LuaState state;
+	state.Init();
+
+	lpp::LuaScheduler scheduler(&state);
+	lpp::LuaAsyncFile files(&state, 4);
+
+	luaL_dostring(state.GetState(),
+		"total = 0\n"
+		"function Stream(path) local data = asyncio.readFile(path) total = total + #data end\n");
+
+	const int taskCount = 16;
+	for (int i = 0; i < taskCount; ++i)
+		scheduler.Spawn(lpp::LuaVar(&state, "Stream"), kTestFile);
+
+	using Clock = std::chrono::steady_clock;
+
+	double now = 0.0;
+	double worstFrame = 0.0;
+	size_t frameCount = 0;
+
+	while (scheduler.GetTaskCount() > 0)
+	{
+		Clock::time_point start = Clock::now();
+		now += 1.0 / 60.0;
+		scheduler.Tick(now);
+		std::chrono::duration<double> frame = Clock::now() - start;
+
+		if (frame.count() > worstFrame)
+			worstFrame = frame.count();
+
+		++frameCount;
+	}
+
+	WARN("Frames: " << frameCount << ", Worst frame: " << worstFrame * 1000.0 << "ms");
+	REQUIRE(lpp::LuaVar(&state, "total").Get<lua_Integer>() == static_cast<lua_Integer>(fileSize) * taskCount);
+
+	std::remove(kTestFile);
+}
\ No newline at end of file
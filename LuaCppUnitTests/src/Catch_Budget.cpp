@@ -0,0 +1,149 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include <LuaVar.h>
+#include <LuaBudget.h>
+#include <LuaCoroutine.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+TEST_CASE("Budget", "[LuaCpp][Budget]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	lua_State* L = state.GetState();
+
+	SECTION("Instruction limit aborts runaway scripts")
+	{
+		lpp::LuaBudget budget(&state, 100000);
+		REQUIRE(lua_gethook(L) != nullptr);
+
+		REQUIRE(state.Execute("while true do end") == false);
+		REQUIRE(budget.GetStatus() == lpp::LuaBudgetStatus::InstructionsExceeded);
+		REQUIRE(budget.GetInstructionCount() == 100000);
+		REQUIRE(lua_gettop(L) == 0);
+
+		// The error is raised to the caller with the position of the loop.
+		REQUIRE(luaL_loadstring(L, "local n = 0 while true do n = n + 1 end") == LUA_OK);
+		REQUIRE(lua_pcall(L, 0, 0, 0) == LUA_ERRRUN);
+		REQUIRE(std::string(lua_tostring(L, -1)).find("instruction budget exceeded") != std::string::npos);
+		lua_pop(L, 1);
+	}
+
+	SECTION("Scripts can not catch the error and carry on")
+	{
+		lpp::LuaBudget budget(&state, 10000);
+		REQUIRE(state.Execute("while true do pcall(function() while true do end end) end") == false);
+		REQUIRE(budget.IsExceeded());
+	}
+
+	SECTION("Time limit aborts runaway calls")
+	{
+		REQUIRE(state.Execute("function spin() while true do end end"));
+		lpp::LuaVar spin(&state, "spin");
+
+		lpp::LuaBudget budget(&state, 0, 2000.0);
+		spin();
+
+		REQUIRE(budget.GetStatus() == lpp::LuaBudgetStatus::TimeExceeded);
+		REQUIRE(budget.GetElapsedMicros() >= 2000.0);
+		REQUIRE(lua_gettop(L) == 0);
+	}
+
+	SECTION("Scripts within the budget run normally")
+	{
+		lpp::LuaBudget budget(&state, 1000000, 1000000.0);
+		REQUIRE(state.Execute("total = 0 for i = 1, 1000 do total = total + i end"));
+		REQUIRE(budget.IsExceeded() == false);
+		REQUIRE(lpp::LuaVar(&state, "total").Get<int>() == 500500);
+	}
+
+	SECTION("The hook is removed without a budget")
+	{
+		{
+			lpp::LuaBudget unlimited(&state, 0);
+			REQUIRE(lua_gethook(L) == nullptr);
+			REQUIRE(state.GetBudget() == nullptr);
+		}
+
+		{
+			lpp::LuaBudget outer(&state, 1000000);
+			{
+				lpp::LuaBudget inner(&state, 1000);
+				REQUIRE(state.GetBudget() == &inner);
+				REQUIRE(state.Execute("while true do end") == false);
+				REQUIRE(inner.IsExceeded());
+			}
+
+			REQUIRE(state.GetBudget() == &outer);
+			REQUIRE(state.Execute("for i = 1, 100 do end"));
+			REQUIRE(outer.IsExceeded() == false);
+		}
+
+		REQUIRE(state.GetBudget() == nullptr);
+		REQUIRE(lua_gethook(L) == nullptr);
+		REQUIRE(state.Execute("for i = 1, 100000 do end"));
+	}
+
+	SECTION("Coroutines yield when out of budget")
+	{
+		REQUIRE(state.Execute("count = 0 function work() for i = 1, 100000 do count = count + 1 end return 'done' end"));
+		lpp::LuaCoroutine coroutine(&state, lpp::LuaVar(&state, "work"));
+
+		int sliceCount = 0;
+		while (!coroutine.IsDead())
+		{
+			lpp::LuaBudget slice(&state, 50000, 0.0, coroutine.GetThread());
+			REQUIRE(coroutine.Resume());
+			++sliceCount;
+		}
+
+		REQUIRE(coroutine.GetStatus() == lpp::LuaCoroutineStatus::Dead);
+		REQUIRE(coroutine.GetResult<std::string>() == "done");
+		REQUIRE(sliceCount > 5);
+		REQUIRE(lpp::LuaVar(&state, "count").Get<int>() == 100000);
+
+		// A budget of the main thread also yields coroutines resumed from C++.
+		lpp::LuaCoroutine spinner(&state, lpp::LuaVar(&state, "work"));
+		lpp::LuaBudget budget(&state, 1000);
+		REQUIRE(spinner.Resume());
+		REQUIRE(spinner.IsSuspended());
+		REQUIRE(budget.IsExceeded());
+	}
+}
+
+TEST_CASE("Budget Benchmark", "[LuaCpp][Budget][!benchmark]")
+{
+	lpp::LuaState state;
+	state.Init();
+	state.Execute("function work() local total = 0 for i = 1, 1000000 do total = total + i % 7 end return total end");
+
+	lpp::LuaVar work(&state, "work");
+
+	BENCHMARK("1M iterations without a budget")
+	{
+		work();
+	}
+
+	BENCHMARK("1M iterations with an instruction budget")
+	{
+		lpp::LuaBudget budget(&state, 100000000);
+		work();
+	}
+
+	BENCHMARK("1M iterations with a time budget")
+	{
+		lpp::LuaBudget budget(&state, 0, 10000000.0);
+		work();
+	}
+
+	BENCHMARK("1M iterations with a time budget checked every 100 instructions")
+	{
+		lpp::LuaBudget budget(&state, 0, 10000000.0, nullptr, 100);
+		work();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <ostream>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <LuaVar.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	std::filesystem::path GetBundleDirectory(const char* name)
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / name;
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory);
+		return directory;
+	}
+
+	void WriteFile(const std::filesystem::path& path, const std::string& content)
+	{
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream(path, std::ios::binary) << content;
+	}
+}
+
+TEST_CASE("Script Bundle", "[LuaCpp][Bundle]")
+{
+	const std::filesystem::path directory = GetBundleDirectory("luacpp_bundle_test");
+	const std::string bundlePath = (directory / "scripts.bundle").string();
+
+	lpp::LuaState state;
+	state.Init();
+
+	SECTION("Require from a bundle")
+	{
+		lpp::LuaBundleWriter writer;
+		REQUIRE(writer.Add("util.math", "return { add = function(a, b) return a + b end }", false));
+		REQUIRE(writer.Add("util.strings", "return { upper = string.upper }", true));
+		REQUIRE(writer.Write(bundlePath.c_str()));
+
+		REQUIRE(state.MountBundle(bundlePath.c_str()));
+		REQUIRE(state.Execute("sum = require('util.math').add(2, 3) text = require('util.strings').upper('abc')"));
+
+		REQUIRE(lpp::LuaVar(&state, "sum").Get<int>() == 5);
+		REQUIRE(lpp::LuaVar(&state, "text").Get<std::string>() == "ABC");
+	}
+
+	SECTION("Modules from a directory")
+	{
+		const std::filesystem::path scripts = directory / "scripts";
+		WriteFile(scripts / "ui" / "init.lua", "return { name = 'ui' }");
+		WriteFile(scripts / "ui" / "button.lua", "return { name = 'button', parent = require('ui').name }");
+		WriteFile(scripts / "readme.txt", "not a script");
+
+		lpp::LuaBundleWriter writer(true);
+		REQUIRE(writer.AddDirectory(scripts.string(), true));
+		REQUIRE(writer.GetChunkCount() == 2);
+		REQUIRE(writer.Write(bundlePath.c_str()));
+
+		lpp::LuaBundle bundle;
+		REQUIRE(bundle.Open(bundlePath.c_str()));
+		REQUIRE(bundle.Contains("ui"));
+		REQUIRE(bundle.Contains("ui.button"));
+		REQUIRE(bundle.Contains("readme") == false);
+
+		REQUIRE(bundle.Load(state.GetState(), "ui.button") == LUA_OK);
+		REQUIRE(lua_isfunction(state.GetState(), -1));
+		lua_pop(state.GetState(), 1);
+
+		bundle.InstallSearcher(state.GetState());
+		REQUIRE(state.Execute("parent = require('ui.button').parent"));
+		REQUIRE(lpp::LuaVar(&state, "parent").Get<std::string>() == "ui");
+	}
+
+	SECTION("Files with a shebang or a BOM")
+	{
+		const std::filesystem::path scripts = directory / "scripts";
+		WriteFile(scripts / "tool.lua", "#!/usr/bin/env lua\nreturn debug.getinfo(1, 'l').currentline");
+		WriteFile(scripts / "marked.lua", "\xEF\xBB\xBFreturn 'marked'");
+
+		lpp::LuaBundleWriter writer;
+		REQUIRE(writer.AddFile((scripts / "tool.lua").string(), "tool", true));
+		REQUIRE(writer.AddFile((scripts / "marked.lua").string(), "marked", false));
+		REQUIRE(writer.Write(bundlePath.c_str()));
+
+		REQUIRE(state.MountBundle(bundlePath.c_str()));
+		REQUIRE(state.Execute("line = require('tool') text = require('marked')"));
+
+		REQUIRE(lpp::LuaVar(&state, "line").Get<int>() == 2);
+		REQUIRE(lpp::LuaVar(&state, "text").Get<std::string>() == "marked");
+	}
+
+	SECTION("Missing modules")
+	{
+		lpp::LuaBundleWriter writer;
+		REQUIRE(writer.Add("present", "return true", false));
+		REQUIRE(writer.Write(bundlePath.c_str()));
+		REQUIRE(state.MountBundle(bundlePath.c_str()));
+
+		REQUIRE(luaL_loadstring(state.GetState(), "require('absent')") == LUA_OK);
+		REQUIRE(lua_pcall(state.GetState(), 0, 0, 0) != LUA_OK);
+		REQUIRE(std::string(lua_tostring(state.GetState(), -1)).find("no module 'absent' in bundle") != std::string::npos);
+		lua_pop(state.GetState(), 1);
+
+		lpp::LuaBundle bundle;
+		REQUIRE(bundle.Open(bundlePath.c_str()));
+		REQUIRE(bundle.Load(state.GetState(), "absent") == LUA_ERRFILE);
+		lua_pop(state.GetState(), 1);
+	}
+
+	SECTION("Invalid bundles")
+	{
+		lpp::LuaBundleWriter writer;
+		REQUIRE(writer.Add("broken", "return = 1", true) == false);
+		REQUIRE(writer.GetError().empty() == false);
+
+		WriteFile(directory / "invalid.bundle", "LPPB but not really a bundle");
+		REQUIRE(state.MountBundle((directory / "invalid.bundle").string().c_str()) == false);
+		REQUIRE(state.MountBundle((directory / "missing.bundle").string().c_str()) == false);
+	}
+
+	SECTION("Later bundles override earlier ones")
+	{
+		const std::string patchPath = (directory / "patch.bundle").string();
+
+		lpp::LuaBundleWriter base;
+		base.Add("config", "return 'base'", false);
+		REQUIRE(base.Write(bundlePath.c_str()));
+
+		lpp::LuaBundleWriter patch;
+		patch.Add("config", "return 'patch'", false);
+		REQUIRE(patch.Write(patchPath.c_str()));
+
+		REQUIRE(state.MountBundle(bundlePath.c_str()));
+		REQUIRE(state.MountBundle(patchPath.c_str()));
+		REQUIRE(state.Execute("config = require('config')"));
+		REQUIRE(lpp::LuaVar(&state, "config").Get<std::string>() == "patch");
+	}
+}
+
+TEST_CASE("Script Bundle Benchmark", "[LuaCpp][Bundle][!benchmark]")
+{
+	constexpr int kModuleCount = 200;
+
+	const std::filesystem::path directory = GetBundleDirectory("luacpp_bundle_benchmark");
+	const std::filesystem::path scripts = directory / "scripts";
+	const std::string bundlePath = (directory / "scripts.bundle").string();
+
+	std::string requireAll;
+	for (int i = 0; i < kModuleCount; ++i)
+	{
+		const std::string name = "module" + std::to_string(i);
+		WriteFile(scripts / (name + ".lua"), "local M = {} for i = 1, 20 do M['f' .. i] = function(x) return x * i end end return M");
+		requireAll += "require('" + name + "') ";
+	}
+
+	lpp::LuaBundleWriter writer;
+	writer.AddDirectory(scripts.string(), true);
+	writer.Write(bundlePath.c_str());
+
+	const std::string packagePath = "package.path = '" + scripts.generic_string() + "/?.lua'";
+
+	BENCHMARK("require 200 modules from package.path")
+	{
+		lpp::LuaState state;
+		state.Init();
+		state.Execute(packagePath);
+		state.Execute(requireAll);
+	}
+
+	BENCHMARK("require 200 modules from a bundle")
+	{
+		lpp::LuaState state;
+		state.Init();
+		state.MountBundle(bundlePath.c_str());
+		state.Execute(requireAll);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <ostream>
+#include <string>
+
+#include <LuaVar.h>
+#include <LuaBytecodeCache.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	constexpr const char* kScriptDirectory = "LuaCppCacheTestScripts";
+	constexpr const char* kCacheDirectory = "LuaCppCacheTestCache";
+
+	void WriteScript(const std::string& path, const std::string& code)
+	{
+		std::FILE* pFile = std::fopen(path.c_str(), "wb");
+		std::fwrite(code.data(), 1, code.size(), pFile);
+		std::fclose(pFile);
+	}
+}
+
+TEST_CASE("Bytecode Cache", "[LuaCpp][BytecodeCache]")
+{
+	std::filesystem::create_directories(kScriptDirectory);
+	const std::string scriptPath = std::string(kScriptDirectory) + "/main.lua";
+	WriteScript(scriptPath, "#!/usr/bin/lua\nvalue = 42\nfunction Fail() error('line three') end\n");
+
+	lpp::LuaBytecodeCache cache(kCacheDirectory);
+	cache.Clear();
+
+	auto loadValue = [&cache, &scriptPath]()
+	{
+		lpp::LuaState state;
+		state.Init();
+		state.SetBytecodeCache(&cache);
+
+		REQUIRE(state.LoadScript(scriptPath.c_str()));
+		return lpp::LuaVar(&state, "value").Get<int>();
+	};
+
+	SECTION("Miss then hit")
+	{
+		REQUIRE(loadValue() == 42);
+		REQUIRE(cache.GetStats().missCount == 1);
+		REQUIRE(cache.GetStats().writeCount == 1);
+
+		REQUIRE(loadValue() == 42);
+		REQUIRE(cache.GetStats().hitCount == 1);
+	}
+
+	SECTION("Changed scripts are compiled again")
+	{
+		loadValue();
+
+		WriteScript(scriptPath, "value = 1234567\n");
+		REQUIRE(loadValue() == 1234567);
+		REQUIRE(cache.GetStats().missCount == 2);
+	}
+
+	SECTION("Touched scripts with the same content hit")
+	{
+		loadValue();
+
+		std::filesystem::last_write_time(scriptPath, std::filesystem::last_write_time(scriptPath) + std::chrono::hours(1));
+		REQUIRE(loadValue() == 42);
+		REQUIRE(cache.GetStats().hitCount == 1);
+
+		// The entry was updated with the new time, The next load does not hash the source again.
+		REQUIRE(loadValue() == 42);
+		REQUIRE(cache.GetStats().hitCount == 2);
+	}
+
+	SECTION("Line numbers are kept")
+	{
+		loadValue();
+
+		lpp::LuaState state;
+		state.Init();
+		state.SetBytecodeCache(&cache);
+		REQUIRE(state.LoadScript(scriptPath.c_str()));
+		REQUIRE(cache.GetStats().hitCount == 1);
+
+		REQUIRE(luaL_dostring(state.GetState(), "ok, message = pcall(Fail)") == LUA_OK);
+		REQUIRE(lpp::LuaVar(&state, "message").Get<std::string>().find("main.lua:3:") != std::string::npos);
+	}
+
+	SECTION("Stripped bytecode")
+	{
+		lpp::LuaBytecodeCache strippedCache(std::string(kCacheDirectory) + "/stripped", true);
+		strippedCache.Clear();
+
+		for (int i = 0; i < 2; ++i)
+		{
+			lpp::LuaState state;
+			state.Init();
+			state.SetBytecodeCache(&strippedCache);
+			REQUIRE(state.LoadScript(scriptPath.c_str()));
+			REQUIRE(lpp::LuaVar(&state, "value").Get<int>() == 42);
+		}
+
+		REQUIRE(strippedCache.GetStats().hitCount == 1);
+	}
+
+	SECTION("Missing scripts")
+	{
+		lpp::LuaState state;
+		state.Init();
+		state.SetBytecodeCache(&cache);
+		REQUIRE(state.LoadScript("LuaCppMissingScript.lua") == false);
+	}
+
+	std::filesystem::remove_all(kScriptDirectory);
+	std::filesystem::remove_all(kCacheDirectory);
+}
+
+TEST_CASE("Bytecode Cache Startup", "[LuaCpp][BytecodeCache][!benchmark]")
+{
+	// A corpus of scripts with a fair amount of code each.
+	const int scriptCount = 200;
+	std::filesystem::create_directories(kScriptDirectory);
+
+	std::vector<std::string> paths;
+	for (int i = 0; i < scriptCount; ++i)
+	{
+		std::string code;
+		for (int f = 0; f < 50; ++f)
+		{
+			code += "function Script" + std::to_string(i) + "_" + std::to_string(f) + "(a, b)\n";
+			code += "	local t = { a = a, b = b, list = { 1, 2, 3 } }\n";
+			code += "	for k, v in pairs(t) do if type(v) == 'number' then t[k] = v * 2 end end\n";
+			code += "	return t.a + t.b + #t.list\n";
+			code += "end\n";
+		}
+
+		paths.push_back(std::string(kScriptDirectory) + "/script" + std::to_string(i) + ".lua");
+		WriteScript(paths.back(), code);
+	}
+
+	using Clock = std::chrono::steady_clock;
+
+	auto loadAll = [&paths](lpp::LuaBytecodeCache* pCache)
+	{
+		const Clock::time_point start = Clock::now();
+
+		lpp::LuaState state;
+		state.Init();
+		state.SetBytecodeCache(pCache);
+
+		for (const std::string& path : paths)
+			state.LoadScript(path.c_str());
+
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	lpp::LuaBytecodeCache cache(kCacheDirectory);
+	cache.Clear();
+
+	const double uncached = loadAll(nullptr);
+	const double cold = loadAll(&cache);
+	const double warm = loadAll(&cache);
+
+	WARN("Scripts: " << scriptCount << ", No cache: " << uncached << "ms, Cold cache: " << cold << "ms, Warm cache: " << warm << "ms");
+	REQUIRE(cache.GetStats().hitCount == scriptCount);
+
+	std::filesystem::remove_all(kScriptDirectory);
+	std::filesystem::remove_all(kCacheDirectory);
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include <LuaVar.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+TEST_CASE("Chunk Cache", "[LuaCpp][ChunkCache]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	lpp::LuaChunkCache& cache = state.GetChunkCache();
+	luaL_dostring(state.GetState(), "counter = 0");
+
+	SECTION("Repeated execution hits")
+	{
+		for (int i = 0; i < 10; ++i)
+			REQUIRE(state.Execute("counter = counter + 1"));
+
+		REQUIRE(lpp::LuaVar(&state, "counter").Get<int>() == 10);
+		REQUIRE(cache.GetMissCount() == 1);
+		REQUIRE(cache.GetHitCount() == 9);
+		REQUIRE(cache.GetCount() == 1);
+	}
+
+	SECTION("Chunk names are part of the key")
+	{
+		REQUIRE(state.LoadScript("counter = counter + 1", "first"));
+		REQUIRE(state.LoadScript("counter = counter + 1", "second"));
+		REQUIRE(state.LoadScript("counter = counter + 1", "first"));
+
+		REQUIRE(cache.GetCount() == 2);
+		REQUIRE(cache.GetHitCount() == 1);
+
+		REQUIRE(state.LoadScript("error('boom')", "=rules") == false);
+		REQUIRE(cache.Push("error('boom')", "=rules") == LUA_OK);
+		REQUIRE(lua_pcall(state.GetState(), 0, 0, 0) != LUA_OK);
+		REQUIRE(std::string(lua_tostring(state.GetState(), -1)).find("rules:1:") != std::string::npos);
+		lua_pop(state.GetState(), 1);
+	}
+
+	SECTION("Syntax errors are not cached")
+	{
+		REQUIRE(state.Execute("counter = = 1") == false);
+		REQUIRE(state.Execute("counter = = 1") == false);
+
+		REQUIRE(cache.GetCount() == 0);
+		REQUIRE(cache.GetMissCount() == 2);
+		REQUIRE(lua_gettop(state.GetState()) == 0);
+	}
+
+	SECTION("Evicted by count")
+	{
+		cache.SetLimits(4, 0);
+
+		for (int i = 0; i < 10; ++i)
+			REQUIRE(state.Execute("counter = " + std::to_string(i)));
+
+		REQUIRE(cache.GetCount() == 4);
+		REQUIRE(cache.GetEvictionCount() == 6);
+
+		// The most recent ones are still cached.
+		REQUIRE(state.Execute("counter = 9"));
+		REQUIRE(cache.GetHitCount() == 1);
+
+		REQUIRE(state.Execute("counter = 0"));
+		REQUIRE(cache.GetHitCount() == 1);
+	}
+
+	SECTION("Evicted by bytes")
+	{
+		cache.SetLimits(0, 64);
+
+		const std::string longCode = "counter = 1 --" + std::string(40, '-');
+		REQUIRE(state.Execute(longCode));
+		REQUIRE(state.Execute(longCode + "x"));
+
+		REQUIRE(cache.GetCount() == 1);
+		REQUIRE(cache.GetBytes() <= 64);
+	}
+
+	SECTION("Clear")
+	{
+		state.Execute("counter = 1");
+		cache.Clear();
+
+		REQUIRE(cache.GetCount() == 0);
+		REQUIRE(state.Execute("counter = 1"));
+		REQUIRE(cache.GetMissCount() == 2);
+	}
+}
+
+TEST_CASE("Chunk Cache Benchmark", "[LuaCpp][ChunkCache][!benchmark]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	luaL_dostring(state.GetState(), "price = 10 quantity = 3 discount = 0.1 result = 0");
+	const char* kFormula = "result = price * quantity * (1 - discount) + (quantity > 2 and 5 or 0)";
+
+	BENCHMARK("luaL_dostring 100k")
+	{
+		for (int i = 0; i < 100000; ++i)
+			luaL_dostring(state.GetState(), kFormula);
+	}
+
+	BENCHMARK("Execute 100k")
+	{
+		for (int i = 0; i < 100000; ++i)
+			state.Execute(kFormula);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include <LuaVar.h>
+#include <LuaCoroutine.h>
+
+class AssetLoader
+{
+public:
+	std::vector<lpp::LuaPending<std::string, int>> m_requests;
+
+	lpp::LuaPending<std::string, int> Fetch(std::string path)
+	{
+		lpp::LuaPending<std::string, int> pending;
+
+		if (path == "cached")
+			pending.Resolve(std::string("cached data"), 11);
+		else
+			m_requests.push_back(pending);
+
+		return pending;
+	}
+};
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+TEST_CASE("Coroutines", "[LuaCpp][Coroutines]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	luaL_dostring(state.GetState(),
+		"function Counter(from, to)\n"
+		"	for i = from, to do\n"
+		"		local step = coroutine.yield(i)\n"
+		"		if step then i = i + step end\n"
+		"	end\n"
+		"	return 'done', to\n"
+		"end\n"
+		"function Failing() coroutine.yield(1) error('boom') end\n");
+
+	lpp::LuaVar counter(&state, "Counter");
+
+	SECTION("Resume and yield values")
+	{
+		lpp::LuaCoroutine coroutine(&state, counter);
+		REQUIRE(coroutine.GetStatus() == lpp::LuaCoroutineStatus::Suspended);
+
+		REQUIRE(coroutine.Resume(1, 3));
+		REQUIRE(coroutine.IsSuspended());
+		REQUIRE(coroutine.GetResultCount() == 1);
+		REQUIRE(coroutine.GetResult<int>() == 1);
+
+		REQUIRE(coroutine.Resume());
+		REQUIRE(coroutine.GetResult<int>() == 2);
+
+		REQUIRE(coroutine.Resume());
+		REQUIRE(coroutine.GetResult<int>() == 3);
+
+		REQUIRE(coroutine.Resume());
+		REQUIRE(coroutine.GetStatus() == lpp::LuaCoroutineStatus::Dead);
+
+		auto [word, last] = coroutine.GetResults<std::string, int>();
+		REQUIRE(word == "done");
+		REQUIRE(last == 3);
+
+		REQUIRE(coroutine.Resume() == false);
+	}
+
+	SECTION("Errors")
+	{
+		lpp::LuaCoroutine coroutine(&state, lpp::LuaVar(&state, "Failing"));
+
+		REQUIRE(coroutine.Resume());
+		REQUIRE(coroutine.Resume() == false);
+		REQUIRE(coroutine.GetStatus() == lpp::LuaCoroutineStatus::Error);
+		REQUIRE(coroutine.GetError().find("boom") != std::string::npos);
+
+		// A failed coroutine can be reused.
+		REQUIRE(coroutine.Reset(counter));
+		REQUIRE(coroutine.Resume(5, 5));
+		REQUIRE(coroutine.GetResult<int>() == 5);
+	}
+
+	SECTION("Yield iteration")
+	{
+		lpp::LuaCoroutine coroutine(&state, counter);
+		coroutine.Resume(1, 4);
+
+		std::vector<int> values{ coroutine.GetResult<int>() };
+		for (int value : coroutine.Yields<int>())
+			values.push_back(value);
+
+		REQUIRE(values == std::vector<int>{ 1, 2, 3, 4 });
+		REQUIRE(coroutine.IsDead());
+	}
+
+	SECTION("Thread pooling")
+	{
+		lpp::LuaThreadPool& pool = state.GetThreadPool();
+		size_t created = pool.GetCreatedCount();
+
+		for (int i = 0; i < 10; ++i)
+		{
+			lpp::LuaCoroutine coroutine(&state, counter);
+			coroutine.Resume(0, 1);
+		}
+
+		REQUIRE(pool.GetCreatedCount() == created + 1);
+		REQUIRE(pool.GetFreeCount() == 1);
+	}
+}
+
+TEST_CASE("Pending Bindings", "[LuaCpp][Coroutines]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	lpp::LuaVar meta(&state);
+	meta.CreateMetaTable("AssetLoader_Meta");
+	meta.BindMemberFunction<AssetLoader>("fetch", &AssetLoader::Fetch);
+
+	AssetLoader loader;
+	lpp::LuaVar loaderTable(&state);
+	loaderTable.CreateTable();
+	loaderTable.SetField("__this", &loader);
+	loaderTable.SetMetaTable("AssetLoader_Meta");
+
+	luaL_dostring(state.GetState(),
+		"function Load(loader, path)\n"
+		"	local data, size = loader:fetch(path)\n"
+		"	return data, size\n"
+		"end\n"
+		"function SafeLoad(loader, path)\n"
+		"	return pcall(loader.fetch, loader, path)\n"
+		"end\n");
+
+	lpp::LuaPendingQueue& queue = state.GetPendingQueue();
+
+	SECTION("Yield until resolved")
+	{
+		lpp::LuaCoroutine coroutine(&state, lpp::LuaVar(&state, "Load"));
+
+		REQUIRE(coroutine.Resume(loaderTable, "level.json"));
+		REQUIRE(coroutine.IsWaiting());
+		REQUIRE(coroutine.Resume() == false);
+		REQUIRE(loader.m_requests.size() == 1);
+
+		std::vector<lua_State*> ready;
+		REQUIRE(queue.PopReady(ready) == 0);
+
+		loader.m_requests[0].Resolve(std::string("level data"), 10);
+
+		REQUIRE(queue.PopReady(ready) == 1);
+		REQUIRE(ready[0] == coroutine.GetThread());
+
+		REQUIRE(coroutine.Resume());
+		REQUIRE(coroutine.IsDead());
+		REQUIRE(coroutine.GetResult<std::string>(1) == "level data");
+		REQUIRE(coroutine.GetResult<int>(2) == 10);
+		REQUIRE(queue.GetWaitingCount() == 0);
+	}
+
+	SECTION("Resolved before yielding")
+	{
+		lpp::LuaCoroutine coroutine(&state, lpp::LuaVar(&state, "Load"));
+
+		REQUIRE(coroutine.Resume(loaderTable, "cached"));
+		REQUIRE(coroutine.IsDead());
+		REQUIRE(coroutine.GetResult<std::string>() == "cached data");
+	}
+
+	SECTION("Rejected")
+	{
+		lpp::LuaCoroutine coroutine(&state, lpp::LuaVar(&state, "SafeLoad"));
+
+		REQUIRE(coroutine.Resume(loaderTable, "missing.json"));
+		loader.m_requests[0].Reject("file not found");
+		loader.m_requests[0].Reject("rejected twice");
+
+		REQUIRE(coroutine.Resume());
+		REQUIRE(coroutine.IsDead());
+		REQUIRE(coroutine.GetResult<bool>(1) == false);
+		REQUIRE(coroutine.GetResult<std::string>(2) == "file not found");
+	}
+
+	SECTION("Outside of a coroutine")
+	{
+		lpp::LuaVar result = loaderTable.Call("fetch", "level.json");
+		REQUIRE(loader.m_requests.size() == 1);
+		REQUIRE(result.Is<std::string>() == false);
+	}
+
+	SECTION("Destroyed while waiting")
+	{
+		{
+			lpp::LuaCoroutine coroutine(&state, lpp::LuaVar(&state, "Load"));
+			coroutine.Resume(loaderTable, "level.json");
+		}
+
+		REQUIRE(queue.GetWaitingCount() == 0);
+		loader.m_requests[0].Resolve(std::string("late"), 4);
+
+		std::vector<lua_State*> ready;
+		REQUIRE(queue.PopReady(ready) == 0);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <ostream>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <LuaVar.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+// Generated from LuaCppUnitTests/scripts by embedscripts() in premake5.lua.
+extern const lpp::LuaEmbeddedScripts kTestScripts;
+
+TEST_CASE("Embedded Scripts", "[LuaCpp][EmbeddedScripts]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	SECTION("Index")
+	{
+		REQUIRE(kTestScripts.count == 3);
+		REQUIRE(kTestScripts.Contains("ui"));
+		REQUIRE(kTestScripts.Contains("ui.button"));
+		REQUIRE(kTestScripts.Contains("mathutil"));
+		REQUIRE(kTestScripts.Contains("ui.init") == false);
+
+		// Stripped bytecode.
+		REQUIRE(kTestScripts.Find("ui")->isBytecode);
+		REQUIRE(kTestScripts.Find("ui")->pData[0] == 0x1b);
+	}
+
+	SECTION("Require without file I/O")
+	{
+		state.MountScripts(kTestScripts);
+
+		// Nothing on package.path could satisfy these.
+		REQUIRE(state.Execute("package.path = '' package.cpath = ''"));
+		REQUIRE(state.Execute("local button = require('ui.button') text = button.new('ok'):text() parent = button.new('ok').parent"));
+		REQUIRE(state.Execute("clamped = require('mathutil').clamp(12, 0, 10)"));
+
+		REQUIRE(lpp::LuaVar(&state, "text").Get<std::string>() == "[ok]");
+		REQUIRE(lpp::LuaVar(&state, "parent").Get<std::string>() == "ui");
+		REQUIRE(lpp::LuaVar(&state, "clamped").Get<int>() == 10);
+	}
+
+	SECTION("Missing modules")
+	{
+		state.MountScripts(kTestScripts);
+
+		REQUIRE(luaL_loadstring(state.GetState(), "require('ui.missing')") == LUA_OK);
+		REQUIRE(lua_pcall(state.GetState(), 0, 0, 0) != LUA_OK);
+		REQUIRE(std::string(lua_tostring(state.GetState(), -1)).find("no embedded module 'ui.missing'") != std::string::npos);
+		lua_pop(state.GetState(), 1);
+
+		REQUIRE(kTestScripts.Load(state.GetState(), "ui.missing") == LUA_ERRFILE);
+		lua_pop(state.GetState(), 1);
+	}
+
+	SECTION("Generated translation unit")
+	{
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "luacpp_embedded_test.cpp";
+		std::filesystem::remove(path);
+
+		lpp::LuaBundleWriter writer;
+		REQUIRE(writer.Add("quote\"d", "return 1", false));
+		REQUIRE(writer.Add("empty", "", false));
+		REQUIRE(writer.Add("first", "return 2", true));
+		REQUIRE(writer.WriteEmbedded(path.string().c_str(), "kScripts"));
+
+		std::ostringstream content;
+		content << std::ifstream(path).rdbuf();
+		const std::string source = content.str();
+
+		REQUIRE(source.find("extern const lpp::LuaEmbeddedScripts kScripts = { kChunks, 3 };") != std::string::npos);
+		REQUIRE(source.find("\"quote\\\"d\"") != std::string::npos);
+
+		// Sorted by name for the binary search.
+		REQUIRE(source.find("\"empty\"") < source.find("\"first\""));
+		REQUIRE(source.find("\"first\"") < source.find("\"quote"));
+
+		// Unchanged output is not written again.
+		const auto writeTime = std::filesystem::last_write_time(path);
+		std::filesystem::last_write_time(path, writeTime - std::chrono::hours(1));
+		REQUIRE(writer.WriteEmbedded(path.string().c_str(), "kScripts"));
+		REQUIRE(std::filesystem::last_write_time(path) == writeTime - std::chrono::hours(1));
+	}
+}
+
+TEST_CASE("Embedded Scripts Benchmark", "[LuaCpp][EmbeddedScripts][!benchmark]")
+{
+	const std::string scripts = std::filesystem::absolute("scripts").generic_string();
+	const char* kRequireAll = "require('ui.button') require('mathutil')";
+
+	BENCHMARK("Cold start from package.path")
+	{
+		lpp::LuaState state;
+		state.Init();
+		state.Execute("package.path = '" + scripts + "/?.lua;" + scripts + "/?/init.lua'");
+		state.Execute(kRequireAll);
+	}
+
+	BENCHMARK("Cold start from embedded scripts")
+	{
+		lpp::LuaState state;
+		state.Init();
+		state.MountScripts(kTestScripts);
+		state.Execute(kRequireAll);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <ostream>
+#include <stdexcept>
+
+#include <LuaVar.h>
+
+class Thrower
+{
+public:
+	int m_calls = 0;
+
+	int Add(int a) { ++m_calls; return a + 1; }
+	int AddNoexcept(int a) noexcept { ++m_calls; return a + 1; }
+
+	int Fail(int a)
+	{
+		if (a < 0)
+			throw std::invalid_argument("negative value");
+
+		return a;
+	}
+
+	void FailUnknown() { throw 42; }
+};
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	void BindThrower(lpp::LuaState& state, Thrower& thrower)
+	{
+		lpp::LuaVar meta(&state);
+		meta.CreateMetaTable("Thrower_Meta");
+		meta.BindMemberFunction<Thrower>("add", &Thrower::Add);
+		meta.BindMemberFunction<Thrower>("addNoexcept", &Thrower::AddNoexcept);
+		meta.BindMemberFunction<Thrower>("fail", &Thrower::Fail);
+		meta.BindMemberFunction<Thrower>("failUnknown", &Thrower::FailUnknown);
+
+		lpp::LuaVar instance(&state);
+		instance.CreateTable();
+		instance.SetField("__this", &thrower);
+		instance.SetMetaTable("Thrower_Meta");
+		instance.SetGlobal("thrower");
+	}
+}
+
+TEST_CASE("Exceptions", "[LuaCpp][Exceptions]")
+{
+	static_assert(lpp::is_noexcept_function_v<decltype(&Thrower::AddNoexcept)>, "noexcept member functions are detected");
+	static_assert(!lpp::is_noexcept_function_v<decltype(&Thrower::Add)>, "Other member functions are not");
+
+	lpp::LuaState state;
+	state.Init();
+
+	Thrower thrower;
+	BindThrower(state, thrower);
+
+	SECTION("Exceptions become lua errors")
+	{
+		REQUIRE(luaL_dostring(state.GetState(), "ok, message = pcall(function() return thrower:fail(-1) end)") == LUA_OK);
+
+		REQUIRE(lpp::LuaVar(&state, "ok").Get<bool>() == false);
+
+		std::string message = lpp::LuaVar(&state, "message").Get<std::string>();
+		REQUIRE(message.find("negative value") != std::string::npos);
+		REQUIRE(message.find("fail") != std::string::npos);
+	}
+
+	SECTION("Successful calls")
+	{
+		REQUIRE(luaL_dostring(state.GetState(), "a = thrower:fail(5) b = thrower:addNoexcept(1)") == LUA_OK);
+		REQUIRE(lpp::LuaVar(&state, "a").Get<int>() == 5);
+		REQUIRE(lpp::LuaVar(&state, "b").Get<int>() == 2);
+	}
+
+	SECTION("State stays usable")
+	{
+		for (int i = 0; i < 10; ++i)
+			REQUIRE(luaL_dostring(state.GetState(), "pcall(thrower.fail, thrower, -1)") == LUA_OK);
+
+		REQUIRE(luaL_dostring(state.GetState(), "a = thrower:add(1)") == LUA_OK);
+		REQUIRE(lpp::LuaVar(&state, "a").Get<int>() == 2);
+	}
+
+#if !defined(LUACPP_LUA_EXCEPTIONS)
+	SECTION("Unknown exceptions")
+	{
+		REQUIRE(luaL_dostring(state.GetState(), "ok, message = pcall(thrower.failUnknown, thrower)") == LUA_OK);
+		REQUIRE(lpp::LuaVar(&state, "ok").Get<bool>() == false);
+		REQUIRE(lpp::LuaVar(&state, "message").Get<std::string>().find("unknown exception") != std::string::npos);
+	}
+#endif
+}
+
+TEST_CASE("Exceptions Call Overhead", "[LuaCpp][Exceptions][!benchmark]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	Thrower thrower;
+	BindThrower(state, thrower);
+
+#if defined(LUACPP_LUA_EXCEPTIONS)
+	WARN("Lua errors: exceptions");
+#else
+	WARN("Lua errors: longjmp");
+#endif
+
+	luaL_dostring(state.GetState(),
+		"function CallAdd(n) local t = thrower for i = 1, n do t:add(i) end end\n"
+		"function CallAddNoexcept(n) local t = thrower for i = 1, n do t:addNoexcept(i) end end\n"
+		"function CallThrowing(n) local t = thrower for i = 1, n do pcall(t.fail, t, -1) end end\n");
+
+	const int callCount = 1000000;
+
+	BENCHMARK("Bound call with exception boundary")
+	{
+		luaL_dostring(state.GetState(), "CallAdd(1000000)");
+	}
+
+	BENCHMARK("Bound noexcept call")
+	{
+		luaL_dostring(state.GetState(), "CallAddNoexcept(1000000)");
+	}
+
+	BENCHMARK("Bound call throwing")
+	{
+		luaL_dostring(state.GetState(), "CallThrowing(100000)");
+	}
+
+	REQUIRE(thrower.m_calls >= callCount * 2);
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include <LuaVar.h>
+#include <LuaExecutionContext.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+TEST_CASE("Execution Context", "[LuaCpp][ExecutionContext]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	REQUIRE(state.Execute(R"(
+		handlers = {}
+		function handlers:double(x) return x * 2 end
+		function handlers:pair(x) return x, x + 1 end
+		function handlers:fail() error('failed') end
+	)"));
+
+	lua_State* pMain = state.GetState();
+
+	SECTION("Calls run on the stack of the context")
+	{
+		lpp::LuaExecutionContext context(&state);
+		REQUIRE(context.GetState() != pMain);
+
+		lpp::LuaVar handlers = context.GetGlobal("handlers");
+		REQUIRE(handlers.GetContext() == context.GetState());
+
+		lpp::LuaVar result = handlers.Call(context.GetState(), "double", 21);
+		REQUIRE(result.Get<int>() == 42);
+		REQUIRE(result.GetContext() == context.GetState());
+
+		// The main thread and the context stay balanced.
+		REQUIRE(lua_gettop(pMain) == 0);
+		REQUIRE(lua_gettop(context.GetState()) == 0);
+
+		// A LuaVar of the main thread can call on a context too.
+		lpp::LuaVar mainHandlers(&state, "handlers");
+		REQUIRE(mainHandlers.Call(context.GetState(), "double", 4).Get<int>() == 8);
+		REQUIRE(mainHandlers.GetContext() == pMain);
+
+		REQUIRE(handlers.Call(context.GetState(), "fail").Is<std::nullptr_t>());
+		REQUIRE(lua_gettop(context.GetState()) == 0);
+	}
+
+	SECTION("Contexts have separate stacks")
+	{
+		lpp::LuaExecutionContext first(&state);
+		lpp::LuaExecutionContext second(&state);
+
+		lua_pushinteger(first.GetState(), 7);
+		REQUIRE(second.Execute("shared = (shared or 0) + 1"));
+		REQUIRE(first.Execute("shared = shared + 1"));
+
+		REQUIRE(lua_tointeger(first.GetState(), -1) == 7);
+		REQUIRE(lua_gettop(second.GetState()) == 0);
+		REQUIRE(lpp::LuaVar(&state, "shared").Get<int>() == 2);
+
+		REQUIRE(first.Execute("error('boom')") == false);
+		REQUIRE(first.Execute("shared = = 1") == false);
+		REQUIRE(lua_gettop(first.GetState()) == 1);
+		REQUIRE(lua_gettop(pMain) == 0);
+	}
+
+	SECTION("Threads are reused")
+	{
+		const size_t createdCount = state.GetThreadPool().GetCreatedCount();
+
+		for (int i = 0; i < 100; ++i)
+		{
+			lpp::LuaExecutionContext context(&state);
+			lua_pushinteger(context.GetState(), i);
+			REQUIRE(context.Execute("requests = (requests or 0) + 1"));
+		}
+
+		REQUIRE(state.GetThreadPool().GetCreatedCount() <= createdCount + 1);
+		REQUIRE(lpp::LuaVar(&state, "requests").Get<int>() == 100);
+
+		// A moved context releases its thread once.
+		lpp::LuaExecutionContext context(&state);
+		lpp::LuaExecutionContext moved(std::move(context));
+		REQUIRE(context.GetState() == nullptr);
+		REQUIRE(moved.Execute("requests = 0"));
+	}
+}
+
+TEST_CASE("Execution Context Benchmark", "[LuaCpp][ExecutionContext][!benchmark]")
+{
+	const char* kHandler = "function handle(x) local t = {} for i = 1, 10 do t[i] = x * i end return #t end";
+
+	BENCHMARK("1000 requests with a LuaState each")
+	{
+		for (int i = 0; i < 1000; ++i)
+		{
+			lpp::LuaState state;
+			state.Init();
+			state.Execute(kHandler);
+			state.Execute("handle(3)");
+		}
+	}
+
+	lpp::LuaState state;
+	state.Init();
+	state.Execute(kHandler);
+
+	BENCHMARK("1000 requests with an execution context each")
+	{
+		for (int i = 0; i < 1000; ++i)
+		{
+			lpp::LuaExecutionContext context(&state);
+			context.Execute("handle(3)");
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+
+#include <LuaVar.h>
+#include <LuaGCPacer.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+TEST_CASE("Garbage Collection", "[LuaCpp][GC]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	luaL_dostring(state.GetState(),
+		"function MakeGarbage(count)\n"
+		"	for i = 1, count do local t = { i, tostring(i) } end\n"
+		"end\n");
+
+	auto makeGarbage = [&state](int count)
+	{
+		lua_getglobal(state.GetState(), "MakeGarbage");
+		lua_pushinteger(state.GetState(), count);
+		return lua_pcall(state.GetState(), 1, 0, 0);
+	};
+
+	SECTION("Modes")
+	{
+		REQUIRE(state.SetGenerationalGC(20, 100) == lpp::LuaGCMode::Incremental);
+		REQUIRE(makeGarbage(10000) == LUA_OK);
+
+		REQUIRE(state.SetIncrementalGC(200, 100) == lpp::LuaGCMode::Generational);
+		REQUIRE(makeGarbage(10000) == LUA_OK);
+
+		// Switches made by scripts are reported too.
+		REQUIRE(state.Execute("collectgarbage('generational')"));
+		REQUIRE(state.SetIncrementalGC() == lpp::LuaGCMode::Generational);
+		REQUIRE(state.Execute("assert(collectgarbage('incremental') == 'incremental')"));
+	}
+
+	SECTION("Cycle counter")
+	{
+		size_t cycles = state.GetGCStats().cycleCount;
+
+		state.CollectGarbage();
+		state.CollectGarbage();
+
+		REQUIRE(state.GetGCStats().cycleCount == cycles + 2);
+
+		// The counter is young again after every collection, So each minor collection finalizes it.
+		state.SetGenerationalGC();
+		cycles = state.GetGCStats().cycleCount;
+		REQUIRE(makeGarbage(200000) == LUA_OK);
+		REQUIRE(state.GetGCStats().cycleCount > cycles + 10);
+
+		cycles = state.GetGCStats().cycleCount;
+		state.CollectGarbage();
+		REQUIRE(state.GetGCStats().cycleCount == cycles + 1);
+	}
+
+	SECTION("Stepping")
+	{
+		state.SetGCRunning(false);
+		REQUIRE(state.IsGCRunning() == false);
+
+		REQUIRE(makeGarbage(10000) == LUA_OK);
+		size_t heapBefore = state.GetHeapBytes();
+		size_t cycles = state.GetGCStats().cycleCount;
+
+		// A huge budget finishes the cycle.
+		REQUIRE(state.Step(1e9));
+
+		lpp::LuaGCStats stats = state.GetGCStats();
+		REQUIRE(stats.stepCount > 0);
+		REQUIRE(stats.stepMicros > 0.0);
+		REQUIRE(stats.heapBytes < heapBefore);
+
+		// The sentinel of the finished cycle is finalized at the start of the next one.
+		state.Step(1e9);
+		REQUIRE(state.GetGCStats().cycleCount > cycles);
+
+		state.SetGCRunning(true);
+	}
+
+	SECTION("Memory limit")
+	{
+		state.SetMemoryLimit(state.GetHeapBytes() + 256 * 1024);
+		REQUIRE(state.GetMemoryLimit() > 0);
+
+		// Garbage is collected to stay under the limit.
+		REQUIRE(makeGarbage(100000) == LUA_OK);
+
+		REQUIRE(luaL_loadstring(state.GetState(), "local t = {} for i = 1, 1e7 do t[i] = {} end") == LUA_OK);
+		REQUIRE(lua_pcall(state.GetState(), 0, 0, 0) == LUA_ERRMEM);
+		lua_pop(state.GetState(), 1);
+
+		lpp::LuaGCStats stats = state.GetGCStats();
+		REQUIRE(stats.limitFailureCount > 0);
+		REQUIRE(stats.heapBytes <= stats.memoryLimit);
+
+		state.SetMemoryLimit(0);
+		REQUIRE(luaL_dostring(state.GetState(), "local t = {} for i = 1, 1e5 do t[i] = {} end") == LUA_OK);
+	}
+}
+
+namespace
+{
+	constexpr const char* kFrameScript =
+		"live = {}\n"
+		"function Frame(frame)\n"
+		"	for i = 1, 2000 do local t = { frame, i, tostring(i) } end\n"
+		"	live[frame % 200] = { frame = frame, data = string.rep('x', 64) }\n"
+		"end\n";
+
+	int RunFrame(lpp::LuaState& state, int frame)
+	{
+		lua_getglobal(state.GetState(), "Frame");
+		lua_pushinteger(state.GetState(), frame);
+		return lua_pcall(state.GetState(), 1, 0, 0);
+	}
+}
+
+TEST_CASE("GC Pacer", "[LuaCpp][GC]")
+{
+	lpp::LuaState state;
+	state.Init();
+	luaL_dostring(state.GetState(), kFrameScript);
+
+	{
+		lpp::LuaGCPacer pacer(&state, 5000.0, 0.5);
+		REQUIRE(state.IsGCRunning() == false);
+		REQUIRE(state.IsTrackingAllocations());
+
+		for (int frame = 0; frame < 300; ++frame)
+		{
+			REQUIRE(RunFrame(state, frame) == LUA_OK);
+			pacer.Frame(1.0 / 60.0);
+		}
+
+		REQUIRE(pacer.GetAllocationRate() > 0.0);
+		REQUIRE(pacer.GetCycleCount() > 0);
+		REQUIRE(pacer.GetPauseHistogram().count > 0);
+		REQUIRE(pacer.GetPauseHistogram().GetPercentile(0.5) <= pacer.GetPauseHistogram().GetPercentile(1.0));
+
+		// Every frame allocates far more than this, The pacer keeps collecting it.
+		REQUIRE(state.GetHeapBytes() < 16 * 1024 * 1024);
+	}
+
+	REQUIRE(state.IsGCRunning());
+	REQUIRE(state.IsTrackingAllocations() == false);
+
+	// The mode the pacer switched away from is restored.
+	state.SetGenerationalGC();
+	{
+		lpp::LuaGCPacer pacer(&state);
+		REQUIRE(state.SetIncrementalGC() == lpp::LuaGCMode::Incremental);
+	}
+
+	REQUIRE(state.SetGenerationalGC() == lpp::LuaGCMode::Generational);
+}
+
+TEST_CASE("GC Pacer Benchmark", "[LuaCpp][GC][!benchmark]")
+{
+	using Clock = std::chrono::steady_clock;
+	const int frameCount = 2000;
+
+	auto runFrames = [frameCount](lpp::LuaState& state, lpp::LuaGCPacer* pPacer)
+	{
+		lpp::LuaPauseHistogram frameTimes;
+
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			const Clock::time_point start = Clock::now();
+			RunFrame(state, frame);
+
+			if (pPacer)
+				pPacer->Frame(1.0 / 60.0);
+
+			frameTimes.Record(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+		}
+
+		return frameTimes;
+	};
+
+	lpp::LuaState automaticState;
+	automaticState.Init();
+	luaL_dostring(automaticState.GetState(), kFrameScript);
+	lpp::LuaPauseHistogram automaticFrames = runFrames(automaticState, nullptr);
+
+	lpp::LuaState pacedState;
+	pacedState.Init();
+	luaL_dostring(pacedState.GetState(), kFrameScript);
+	lpp::LuaGCPacer pacer(&pacedState, 500.0, 0.5);
+	lpp::LuaPauseHistogram pacedFrames = runFrames(pacedState, &pacer);
+
+	WARN("Automatic GC frames, avg: " << automaticFrames.GetAverage() << "us, p99: " << automaticFrames.GetPercentile(0.99) << "us, max: " << automaticFrames.maxMicros << "us");
+	WARN("Paced GC frames, avg: " << pacedFrames.GetAverage() << "us, p99: " << pacedFrames.GetPercentile(0.99) << "us, max: " << pacedFrames.maxMicros << "us");
+	WARN("Pacer pauses, p50: " << pacer.GetPauseHistogram().GetPercentile(0.5) << "us, p99: " << pacer.GetPauseHistogram().GetPercentile(0.99) << "us, heap: " << pacedState.GetHeapBytes());
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include <LuaVar.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	bool IsLoaded(lpp::LuaState& state, const char* name)
+	{
+		lua_getfield(state.GetState(), LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+		const bool isLoaded = lua_getfield(state.GetState(), -1, name) != LUA_TNIL;
+		lua_pop(state.GetState(), 2);
+		return isLoaded;
+	}
+}
+
+TEST_CASE("Standard Libraries", "[LuaCpp][Libraries]")
+{
+	using lpp::LuaLibrary;
+
+	lpp::LuaState state;
+
+	SECTION("Every library by default")
+	{
+		REQUIRE(state.Init());
+		REQUIRE(IsLoaded(state, "io"));
+		REQUIRE(IsLoaded(state, "debug"));
+
+		// No lazy stubs.
+		lua_pushglobaltable(state.GetState());
+		REQUIRE(lua_getmetatable(state.GetState(), -1) == 0);
+		lua_pop(state.GetState(), 1);
+	}
+
+	SECTION("Lazy libraries open on first use")
+	{
+		REQUIRE(state.Init(LuaLibrary::Math));
+		REQUIRE(IsLoaded(state, "math"));
+		REQUIRE(IsLoaded(state, "table") == false);
+		REQUIRE(IsLoaded(state, "io") == false);
+
+		REQUIRE(state.Execute("joined = table.concat({ 1, 2 }, ',')"));
+		REQUIRE(lpp::LuaVar(&state, "joined").Get<std::string>() == "1,2");
+		REQUIRE(IsLoaded(state, "table"));
+		REQUIRE(IsLoaded(state, "io") == false);
+
+		// Through require and string methods.
+		REQUIRE(state.Execute("utf = require('utf8').char(72, 105) upper = ('abc'):upper()"));
+		REQUIRE(lpp::LuaVar(&state, "utf").Get<std::string>() == "Hi");
+		REQUIRE(lpp::LuaVar(&state, "upper").Get<std::string>() == "ABC");
+		REQUIRE(IsLoaded(state, "string"));
+
+		// Unknown globals are still nil.
+		REQUIRE(state.Execute("missing = undefinedGlobal == nil"));
+		REQUIRE(lpp::LuaVar(&state, "missing").Get<bool>());
+	}
+
+	SECTION("Lazy package library")
+	{
+		REQUIRE(state.Init(LuaLibrary::None));
+		REQUIRE(IsLoaded(state, "package") == false);
+
+		REQUIRE(state.Execute("package.preload.answer = function() return 42 end"));
+		REQUIRE(state.Execute("answer = require('answer')"));
+		REQUIRE(lpp::LuaVar(&state, "answer").Get<int>() == 42);
+	}
+
+	SECTION("Libraries left out")
+	{
+		REQUIRE(state.Init(LuaLibrary::Package | LuaLibrary::String, LuaLibrary::Math));
+
+		REQUIRE(state.Execute("hasIO = io == nil and os == nil and debug == nil"));
+		REQUIRE(lpp::LuaVar(&state, "hasIO").Get<bool>());
+
+		REQUIRE(state.Execute("root = math.sqrt(16)"));
+		REQUIRE(lpp::LuaVar(&state, "root").Get<int>() == 4);
+
+		REQUIRE(state.Execute("require('io')") == false);
+	}
+}
+
+TEST_CASE("Standard Libraries Benchmark", "[LuaCpp][Libraries][!benchmark]")
+{
+	using lpp::LuaLibrary;
+
+	auto measure = [](LuaLibrary libraries, LuaLibrary lazyLibraries)
+	{
+		lpp::LuaState state;
+		state.Init(libraries, lazyLibraries);
+		return state.GetHeapBytes();
+	};
+
+	WARN("Heap after Init: All " << measure(LuaLibrary::All, LuaLibrary::All)
+		<< " bytes, Base|String|Math with lazy rest " << measure(LuaLibrary::String | LuaLibrary::Math, LuaLibrary::All)
+		<< " bytes, Base only " << measure(LuaLibrary::Base, LuaLibrary::None) << " bytes");
+
+	BENCHMARK("1000 states with every library")
+	{
+		for (int i = 0; i < 1000; ++i)
+			measure(LuaLibrary::All, LuaLibrary::All);
+	}
+
+	BENCHMARK("1000 states with string and math, The rest lazy")
+	{
+		for (int i = 0; i < 1000; ++i)
+			measure(LuaLibrary::String | LuaLibrary::Math, LuaLibrary::All);
+	}
+}
\ No newline at end of file
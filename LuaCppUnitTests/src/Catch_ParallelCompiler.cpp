@@ -0,0 +1,163 @@
+#pragma once
+
+#include <ostream>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <LuaVar.h>
+#include <LuaParallelCompiler.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+TEST_CASE("Parallel Compiler", "[LuaCpp][ParallelCompiler]")
+{
+	lpp::LuaState state;
+	state.Init();
+	luaL_dostring(state.GetState(), "order = {}");
+
+	SECTION("Modules run after their dependencies")
+	{
+		lpp::LuaParallelCompiler compiler(4);
+		compiler.AddSource("game", "table.insert(order, 'game') local ui = require('ui') return { ui = ui.name }");
+		compiler.AddSource("ui", "table.insert(order, 'ui') local m = require 'util.math' return { name = 'ui', two = m.add(1, 1) }");
+		compiler.AddSource("util.math", "table.insert(order, 'util.math') return { add = function(a, b) return a + b end }");
+		compiler.AddSource("standalone", "table.insert(order, 'standalone')");
+
+		REQUIRE(compiler.Compile());
+		REQUIRE(compiler.GetScripts()[1].dependencies == std::vector<std::string>{ "util.math" });
+
+		REQUIRE(compiler.Load(state));
+		REQUIRE(state.Execute("result = table.concat(order, ',')"));
+		REQUIRE(lpp::LuaVar(&state, "result").Get<std::string>() == "util.math,ui,game,standalone");
+
+		// Modules are cached like require does, Returning nothing stores true.
+		REQUIRE(state.Execute("two = require('ui').two loaded = package.loaded.standalone == true"));
+		REQUIRE(lpp::LuaVar(&state, "two").Get<int>() == 2);
+		REQUIRE(lpp::LuaVar(&state, "loaded").Get<bool>());
+
+		// Loading again skips the loaded modules.
+		REQUIRE(compiler.Load(state));
+		REQUIRE(state.Execute("count = #order"));
+		REQUIRE(lpp::LuaVar(&state, "count").Get<int>() == 4);
+	}
+
+	SECTION("Dependency scanning")
+	{
+		lpp::LuaParallelCompiler compiler(1);
+		compiler.AddSource("a", "local x = require ( \"b\" ) local y = require'c' local z = prerequire('d') local w = require(name) require('b')");
+		compiler.AddSource("b", "");
+		compiler.AddSource("c", "");
+		compiler.AddSource("d", "");
+
+		REQUIRE(compiler.Compile());
+		REQUIRE(compiler.GetScripts()[0].dependencies == std::vector<std::string>{ "b", "c" });
+
+		const std::vector<size_t> order = compiler.GetLoadOrder();
+		REQUIRE(order == std::vector<size_t>{ 1, 2, 0, 3 });
+	}
+
+	SECTION("Cycles")
+	{
+		lpp::LuaParallelCompiler compiler(2);
+		compiler.AddSource("a", "table.insert(order, 'a') return require('b')");
+		compiler.AddSource("b", "table.insert(order, 'b') if false then require('a') end return 'b'");
+
+		REQUIRE(compiler.Compile());
+		REQUIRE(compiler.Load(state));
+		REQUIRE(state.Execute("result = table.concat(order, ',')"));
+		REQUIRE(lpp::LuaVar(&state, "result").Get<std::string>() == "b,a");
+	}
+
+	SECTION("Errors")
+	{
+		lpp::LuaParallelCompiler compiler(2);
+		compiler.AddSource("good", "return 1");
+		compiler.AddSource("bad", "return = 1");
+		compiler.AddFile("missing/file.lua", "missing");
+
+		REQUIRE(compiler.Compile() == false);
+		REQUIRE(compiler.GetScripts()[0].error.empty());
+		REQUIRE(compiler.GetScripts()[1].error.find("bad:1:") != std::string::npos);
+		REQUIRE(compiler.GetError().find("cannot open missing/file.lua") != std::string::npos);
+
+		lpp::LuaParallelCompiler failing(1);
+		failing.AddSource("boom", "error('boom')");
+		REQUIRE(failing.Compile());
+		REQUIRE(failing.Load(state) == false);
+		REQUIRE(failing.GetError().find("boom") != std::string::npos);
+		REQUIRE(lua_gettop(state.GetState()) == 0);
+
+		lpp::LuaParallelCompiler nonString(1);
+		nonString.AddSource("thrown", "error({})");
+		REQUIRE(nonString.Compile());
+		REQUIRE(nonString.Load(state) == false);
+		REQUIRE(nonString.GetError() == "thrown: error object is not a string");
+		REQUIRE(nonString.Run(state) == false);
+		REQUIRE(nonString.GetError() == "thrown: error object is not a string");
+		REQUIRE(lua_gettop(state.GetState()) == 0);
+	}
+
+	SECTION("Files")
+	{
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "luacpp_parallel_test";
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory / "ui");
+
+		std::ofstream(directory / "ui" / "init.lua") << "#!/usr/bin/lua\nreturn { name = 'ui' }";
+		std::ofstream(directory / "main.lua") << "return require('ui').name";
+
+		lpp::LuaParallelCompiler compiler(0, true);
+		REQUIRE(compiler.GetWorkerCount() >= 1);
+		REQUIRE(compiler.AddDirectory(directory.string()));
+		REQUIRE(compiler.Compile());
+		REQUIRE(compiler.Load(state));
+
+		REQUIRE(state.Execute("name = package.loaded.main"));
+		REQUIRE(lpp::LuaVar(&state, "name").Get<std::string>() == "ui");
+	}
+}
+
+TEST_CASE("Parallel Compiler Benchmark", "[LuaCpp][ParallelCompiler][!benchmark]")
+{
+	constexpr int kScriptCount = 400;
+
+	// Scripts of a few hundred lines, Each requiring the one before it.
+	std::string body;
+	for (int i = 0; i < 200; ++i)
+		body += "function M.f" + std::to_string(i) + "(x, y) local t = { x, y, x * y } for i = 1, #t do t[i] = t[i] + " + std::to_string(i) + " end return t end\n";
+
+	auto addScripts = [&](lpp::LuaParallelCompiler& compiler)
+	{
+		for (int i = 0; i < kScriptCount; ++i)
+		{
+			const std::string require = i > 0 ? "require('module" + std::to_string(i - 1) + "')\n" : "";
+			compiler.AddSource("module" + std::to_string(i), require + "local M = {}\n" + body + "return M");
+		}
+	};
+
+	for (size_t workerCount : { size_t(1), size_t(2), size_t(4), size_t(0) })
+	{
+		lpp::LuaParallelCompiler compiler(workerCount);
+		addScripts(compiler);
+
+		BENCHMARK("Compile 400 scripts with " + std::to_string(compiler.GetWorkerCount()) + " workers")
+		{
+			lpp::LuaParallelCompiler timed(workerCount);
+			addScripts(timed);
+			timed.Compile();
+		}
+	}
+
+	lpp::LuaParallelCompiler compiler;
+	addScripts(compiler);
+	compiler.Compile();
+
+	BENCHMARK("Load 400 compiled scripts")
+	{
+		lpp::LuaState state;
+		state.Init();
+		compiler.Load(state);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include <LuaVar.h>
+#include <LuaBudget.h>
+#include <LuaCoroutine.h>
+#include <LuaProfiler.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	// Windows has no signals to arm the hook with, The count hook has to be asked for there.
+#if defined(_WIN32)
+	constexpr lpp::LuaProfilerMode kMode = lpp::LuaProfilerMode::CountHook;
+#else
+	constexpr lpp::LuaProfilerMode kMode = lpp::LuaProfilerMode::Signal;
+#endif
+}
+
+TEST_CASE("Profiler", "[LuaCpp][Profiler]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	lua_State* L = state.GetState();
+
+	REQUIRE(state.LoadScript(R"(
+		function hot(n) local total = 0 for i = 1, n do total = total + i % 7 end return total end
+		function cold(n) local total = 0 for i = 1, n do total = total + i end return total end
+		function frame() for i = 1, 20 do hot(20000) end cold(20000) end
+		function spin(milliseconds)
+			local finish = os.clock() + milliseconds / 1000
+			while os.clock() < finish do frame() end
+		end
+	)", "=profiled"));
+
+	SECTION("Samples land in the hot function")
+	{
+		lpp::LuaProfiler profiler(&state, 1000.0, kMode);
+		REQUIRE(profiler.Start());
+		REQUIRE(state.GetProfiler() == &profiler);
+
+		// A second profiler can not run on the same state.
+		lpp::LuaProfiler second(&state, 1000.0, kMode);
+		REQUIRE(second.Start() == false);
+
+		REQUIRE(state.Execute("spin(200)"));
+		profiler.Stop();
+
+		REQUIRE(state.GetProfiler() == nullptr);
+		REQUIRE(lua_gethook(L) == nullptr);
+		REQUIRE(profiler.GetSampleCount() > 20);
+
+		const std::vector<lpp::LuaProfileEntry> top = profiler.GetTop(3);
+		REQUIRE(top.size() == 3);
+		REQUIRE(top[0].function == "hot profiled:2");
+		REQUIRE(top[0].selfPercent > 50.0);
+		REQUIRE(top[0].totalSamples >= top[0].selfSamples);
+
+		const std::string stacks = profiler.GetCollapsedStacks();
+		REQUIRE(stacks.find("main chunk [string \"spin(200)\"];spin profiled:5;frame profiled:4;hot profiled:2 ") != std::string::npos);
+
+		REQUIRE(profiler.GetReport(5).find("hot profiled:2\n") != std::string::npos);
+
+		profiler.Reset();
+		REQUIRE(profiler.GetSampleCount() == 0);
+		REQUIRE(profiler.GetCollapsedStacks().empty());
+	}
+
+	SECTION("Coroutines resumed from C++ are sampled")
+	{
+		REQUIRE(state.Execute("function worker() while true do spin(20) coroutine.yield() end end"));
+		lpp::LuaCoroutine coroutine(&state, lpp::LuaVar(&state, "worker"));
+
+		lpp::LuaProfiler profiler(&state, lpp::LuaProfiler::kDefaultFrequency, kMode);
+		REQUIRE(profiler.Start());
+
+		for (int i = 0; i < 10; ++i)
+			REQUIRE(coroutine.Resume());
+
+		profiler.Stop();
+
+		REQUIRE(profiler.GetSampleCount() > 20);
+		// The function of a coroutine has no caller to name it.
+		const std::string stacks = profiler.GetCollapsedStacks();
+		REQUIRE(stacks.rfind("anonymous [string \"function worker()", 0) == 0);
+		REQUIRE(stacks.find(";spin profiled:5;frame profiled:4;hot profiled:2 ") != std::string::npos);
+		REQUIRE(stacks.find("main chunk") == std::string::npos);
+	}
+
+	SECTION("Budgets keep working while profiling")
+	{
+		lpp::LuaProfiler profiler(&state, lpp::LuaProfiler::kDefaultFrequency, kMode);
+		REQUIRE(profiler.Start());
+
+		{
+			lpp::LuaBudget budget(&state, 0, 50000.0);
+			REQUIRE(state.Execute("while true do frame() end") == false);
+			REQUIRE(budget.GetStatus() == lpp::LuaBudgetStatus::TimeExceeded);
+		}
+
+		profiler.Stop();
+		REQUIRE(profiler.GetSampleCount() > 0);
+	}
+
+	SECTION("The count hook is only there when asked for")
+	{
+		lpp::LuaProfiler profiler(&state, 1000.0, lpp::LuaProfilerMode::CountHook);
+		REQUIRE(profiler.Start());
+		REQUIRE(lua_gethookcount(L) == lpp::LuaProfiler::kCheckInterval);
+
+		REQUIRE(state.Execute("spin(100)"));
+		profiler.Stop();
+
+		REQUIRE(lua_gethook(L) == nullptr);
+		REQUIRE(profiler.GetSampleCount() > 10);
+		REQUIRE(profiler.GetTop(1)[0].function == "hot profiled:2");
+	}
+
+#if !defined(_WIN32)
+	SECTION("Signals arm a one-shot hook")
+	{
+		lpp::LuaProfiler profiler(&state, 1000.0, lpp::LuaProfilerMode::Signal);
+		REQUIRE(profiler.Start());
+
+		// Only one signal profiler runs in the process.
+		lpp::LuaState other;
+		lpp::LuaProfiler otherProfiler(&other, 1000.0, lpp::LuaProfilerMode::Signal);
+		REQUIRE(otherProfiler.Start() == false);
+
+		// The sample removes the hook again, Nothing traps between samples.
+		REQUIRE(state.Execute("spin(100) hooked = 0 for i = 1, 100000 do if debug.gethook() then hooked = hooked + 1 end end"));
+		REQUIRE(lpp::LuaVar(&state, "hooked").Get<int>() < 1000);
+
+		profiler.Stop();
+		REQUIRE(lua_gethook(L) == nullptr);
+		REQUIRE(profiler.GetSampleCount() > 10);
+	}
+#endif
+}
+
+TEST_CASE("Profiler Benchmark", "[LuaCpp][Profiler][!benchmark]")
+{
+	lpp::LuaState state;
+	state.Init();
+	state.Execute("function work() local total = 0 for i = 1, 3000000 do total = total + i % 7 end return total end");
+
+	lpp::LuaVar work(&state, "work");
+
+	BENCHMARK("3M iterations without the profiler")
+	{
+		work();
+	}
+
+	lpp::LuaProfiler profiler(&state, 1000.0, kMode);
+	profiler.Start();
+
+	BENCHMARK("3M iterations sampled at 1 kHz")
+	{
+		work();
+	}
+
+	profiler.Stop();
+	WARN(profiler.GetSampleCount() << " samples, " << profiler.GetDueCount() << " due");
+
+	lpp::LuaProfiler countProfiler(&state, 1000.0, lpp::LuaProfilerMode::CountHook);
+	countProfiler.Start();
+
+	BENCHMARK("3M iterations sampled at 1 kHz by the count hook")
+	{
+		work();
+	}
+
+	countProfiler.Stop();
+}
\ No newline at end of file
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <LuaVar.h>
+#include <LuaReferenceTracker.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+#ifdef LUACPP_TRACK_REFERENCES
+
+namespace
+{
+	size_t GetSiteCount(const std::vector<lpp::LuaReferenceSite>& sites, int line)
+	{
+		for (const lpp::LuaReferenceSite& site : sites)
+		{
+			if (site.location.line == line && std::string(site.location.file).find("Catch_ReferenceTracker.cpp") != std::string::npos)
+				return site.liveCount;
+		}
+
+		return 0;
+	}
+}
+
+TEST_CASE("Reference Tracker", "[LuaCpp][ReferenceTracker]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	REQUIRE(state.LoadScript(R"(
+		config = { name = "level", spawn = function() end }
+		names = { "a", "b", "c" }
+	)", "=tracked"));
+
+	lpp::LuaReferenceTracker tracker(&state);
+	REQUIRE(tracker.Start());
+	REQUIRE(state.GetReferenceTracker() == &tracker);
+
+	SECTION("Only one tracker per state")
+	{
+		lpp::LuaReferenceTracker second(&state);
+		REQUIRE(second.Start() == false);
+
+		tracker.Stop();
+		REQUIRE(state.GetReferenceTracker() == nullptr);
+		REQUIRE(second.Start());
+	}
+
+	SECTION("Live references are grouped by site")
+	{
+		std::vector<lpp::LuaVar> kept;
+
+		const int configLine = __LINE__ + 2;
+		for (int i = 0; i < 3; ++i)
+			kept.push_back(lpp::LuaVar(&state, "config"));
+
+		const int namesLine = __LINE__ + 1;
+		lpp::LuaVar names(&state, "names");
+
+		{
+			lpp::LuaVar released(&state, "config");
+			REQUIRE(tracker.GetLiveCount() == 5);
+		}
+
+		// Copies share the reference of the LuaVar they copy.
+		lpp::LuaVar copy = names;
+		REQUIRE(tracker.GetLiveCount() == 4);
+
+		const std::vector<lpp::LuaReferenceSite> sites = tracker.GetSites();
+		REQUIRE(sites.size() == 2);
+		REQUIRE(GetSiteCount(sites, configLine) == 3);
+		REQUIRE(GetSiteCount(sites, namesLine) == 1);
+
+		// The oldest reference comes first.
+		REQUIRE(sites[0].location.line == configLine);
+		REQUIRE(std::string(sites[0].location.function).empty() == false);
+		REQUIRE(sites[0].types.size() == 1);
+		REQUIRE(sites[0].types[0].first == "table");
+		REQUIRE(sites[0].types[0].second == 3);
+
+		kept.clear();
+		REQUIRE(tracker.GetLiveCount() == 1);
+		REQUIRE(GetSiteCount(tracker.GetSites(), configLine) == 0);
+	}
+
+	SECTION("Values taken from a LuaVar are attributed to its site")
+	{
+		const int configLine = __LINE__ + 1;
+		lpp::LuaVar config(&state, "config");
+
+		lpp::LuaVar name = config.GetField("name");
+		lpp::LuaVar spawn = config["spawn"];
+		lpp::LuaVar missing = config.GetField("missing");
+
+		REQUIRE(tracker.GetLiveCount() == 3);
+		REQUIRE(GetSiteCount(tracker.GetSites(), configLine) == 3);
+
+		const std::vector<std::pair<std::string, size_t>> types = tracker.GetTypes();
+		REQUIRE(types.size() == 3);
+		for (const auto& [type, count] : types)
+		{
+			REQUIRE(count == 1);
+			REQUIRE((type == "table" || type == "string" || type == "function"));
+		}
+	}
+
+	SECTION("Types are read when reporting")
+	{
+		lpp::LuaVar value(&state);
+		value.Set(std::string("text"));
+		REQUIRE(tracker.GetTypes()[0].first == "string");
+
+		value.CreateTable();
+		REQUIRE(tracker.GetLiveCount() == 1);
+		REQUIRE(tracker.GetTypes()[0].first == "table");
+	}
+
+	SECTION("Assigning releases the reference held before")
+	{
+		lpp::LuaVar a(&state, "config");
+		lpp::LuaVar b(&state, "names");
+		REQUIRE(tracker.GetLiveCount() == 2);
+
+		a = b;
+		REQUIRE(tracker.GetLiveCount() == 1);
+
+		a = lpp::LuaVar(&state, "config");
+		REQUIRE(tracker.GetLiveCount() == 2);
+
+		a = a;
+		REQUIRE(tracker.GetLiveCount() == 2);
+		REQUIRE(a.IsTable());
+
+#ifndef LUACPP_NO_STATS
+		const lpp::LuaStatsSnapshot stats = state.GetStatsSnapshot();
+		REQUIRE(stats.GetLiveReferenceCount() >= 2);
+#endif
+	}
+
+	SECTION("Young references are left out")
+	{
+		const int line = __LINE__ + 1;
+		lpp::LuaVar config(&state, "config");
+
+		REQUIRE(tracker.GetSites(3600.0).empty());
+		REQUIRE(tracker.GetTypes(3600.0).empty());
+
+		const std::string report = tracker.GetReport();
+		REQUIRE(report.rfind("1 live references from 1 sites\n", 0) == 0);
+		REQUIRE(report.find("Catch_ReferenceTracker.cpp:" + std::to_string(line) + " (") != std::string::npos);
+		REQUIRE(report.find(" table 1\n") != std::string::npos);
+		REQUIRE(report.find("by type\n       1  table\n") != std::string::npos);
+
+		REQUIRE(tracker.GetReport(20, 3600.0).rfind("0 live references from 0 sites\n", 0) == 0);
+	}
+
+	SECTION("References taken before starting are not listed")
+	{
+		tracker.Stop();
+		lpp::LuaVar before(&state, "config");
+
+		REQUIRE(tracker.Start());
+		lpp::LuaVar after(&state, "names");
+
+		REQUIRE(tracker.GetLiveCount() == 1);
+
+		tracker.Reset();
+		REQUIRE(tracker.GetLiveCount() == 0);
+	}
+}
+
+#else
+
+TEST_CASE("Reference Tracker", "[LuaCpp][ReferenceTracker]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	// LuaVar carries no site to report.
+	lpp::LuaReferenceTracker tracker(&state);
+	REQUIRE(tracker.Start() == false);
+	REQUIRE(state.GetReferenceTracker() == nullptr);
+}
+
+#endif
+
+TEST_CASE("Reference Tracker Benchmark", "[LuaCpp][ReferenceTracker][!benchmark]")
+{
+	lpp::LuaState state;
+	state.Init();
+	state.Execute("config = {}");
+
+	BENCHMARK("10K LuaVar references without the tracker")
+	{
+		for (int i = 0; i < 10000; ++i)
+			lpp::LuaVar var(&state, "config");
+	}
+
+#ifdef LUACPP_TRACK_REFERENCES
+	std::vector<lpp::LuaVar> kept;
+	kept.reserve(10000);
+
+	lpp::LuaReferenceTracker tracker(&state);
+	tracker.Start();
+
+	BENCHMARK("10K LuaVar references tracked")
+	{
+		for (int i = 0; i < 10000; ++i)
+			lpp::LuaVar var(&state, "config");
+	}
+
+	for (int i = 0; i < 10000; ++i)
+		kept.push_back(lpp::LuaVar(&state, "config"));
+
+	BENCHMARK("Report of 10K live references")
+	{
+		tracker.GetReport();
+	}
+#endif
+}
\ No newline at end of file
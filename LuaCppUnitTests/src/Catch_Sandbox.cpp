@@ -0,0 +1,200 @@
+#pragma once
+
+#include <ostream>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <LuaVar.h>
+#include <LuaSandbox.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+TEST_CASE("Sandbox", "[LuaCpp][Sandbox]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	lpp::LuaSandbox sandbox(&state);
+	lua_State* L = state.GetState();
+
+	SECTION("Globals stay in their own environment")
+	{
+		lpp::LuaVar first = sandbox.CreateEnvironment();
+		lpp::LuaVar second = sandbox.CreateEnvironment();
+
+		REQUIRE(state.Execute("count = (count or 0) + 1", first));
+		REQUIRE(state.Execute("count = (count or 0) + 1", first));
+		REQUIRE(state.Execute("count = (count or 0) + 1", second));
+
+		REQUIRE(first["count"].Get<int>() == 2);
+		REQUIRE(second["count"].Get<int>() == 1);
+		REQUIRE(lpp::LuaVar(&state, "count").Is<std::nullptr_t>());
+
+		// Base globals resolve through the environment, _G is the environment itself.
+		REQUIRE(state.Execute("result = string.rep('a', 3) .. tostring(_G == _ENV)", first));
+		REQUIRE(first["result"].Get<std::string>() == "aaatrue");
+
+		REQUIRE(lua_gettop(L) == 0);
+	}
+
+	SECTION("The base is read-only")
+	{
+		lpp::LuaVar first = sandbox.CreateEnvironment();
+		lpp::LuaVar second = sandbox.CreateEnvironment();
+
+		REQUIRE(state.Execute("string.upper = function() return 'patched' end", first) == false);
+		REQUIRE(state.Execute("math.pi = 3", first) == false);
+		REQUIRE(state.Execute("setmetatable(_G, nil)", first) == false);
+		REQUIRE(state.Execute("getmetatable('').__index.upper = nil", first) == false);
+
+		// Shadowing a base global only changes the own environment.
+		REQUIRE(state.Execute("print = nil", first));
+		REQUIRE(state.Execute("result = string.upper('a') .. tostring(print ~= nil)", second));
+		REQUIRE(second["result"].Get<std::string>() == "Atrue");
+
+		// Proxies still iterate and measure like the library.
+		REQUIRE(state.Execute("n = 0 for k, v in pairs(math) do n = n + 1 end", first));
+		REQUIRE(first["n"].Get<int>() > 10);
+		REQUIRE(state.Execute("n = select(2, pairs(string)) == string", first));
+		REQUIRE(first["n"].Get<bool>());
+
+		REQUIRE(lua_gettop(L) == 0);
+	}
+
+	SECTION("Nested tables are read-only too")
+	{
+		REQUIRE(state.Execute("cfg = { limits = { max = 10 }, list = {} } cfg.list[1] = cfg.limits cfg.self = cfg cfg[cfg.limits] = 'key'"));
+
+		lpp::LuaSandbox custom(&state, { "cfg", "pairs", "type" });
+		lpp::LuaVar first = custom.CreateEnvironment();
+		lpp::LuaVar second = custom.CreateEnvironment();
+
+		REQUIRE(state.Execute("cfg.limits.max = 999", first) == false);
+		REQUIRE(state.Execute("for k, v in pairs(cfg) do if type(v) == 'table' then v.max = 999 end end", first) == false);
+		REQUIRE(state.Execute("for k, v in pairs(cfg) do if type(k) == 'table' then k.max = 999 end end", first) == false);
+		REQUIRE(state.Execute("cfg.list[1].max = 999", first) == false);
+
+		REQUIRE(state.Execute("result = cfg.limits.max", second));
+		REQUIRE(second["result"].Get<int>() == 10);
+
+		// Shared and cyclic tables have a single proxy, Proxies handed out as keys find their value.
+		REQUIRE(state.Execute("result = cfg.list[1] == cfg.limits and cfg.self == cfg and cfg.self.self.limits == cfg.limits", second));
+		REQUIRE(second["result"].Get<bool>());
+		REQUIRE(state.Execute("for k, v in pairs(cfg) do if type(k) == 'table' then result = cfg[k] end end", second));
+		REQUIRE(second["result"].Get<std::string>() == "key");
+
+		// The host still changes the original.
+		REQUIRE(state.Execute("cfg.limits.max = 20"));
+		REQUIRE(state.Execute("result = cfg.limits.max", second));
+		REQUIRE(second["result"].Get<int>() == 20);
+
+		REQUIRE(lua_gettop(L) == 0);
+	}
+
+	SECTION("Only whitelisted globals are reachable")
+	{
+		lpp::LuaVar environment = sandbox.CreateEnvironment();
+
+		REQUIRE(state.Execute("result = io == nil and load == nil and require == nil and debug == nil and rawset == nil", environment));
+		REQUIRE(environment["result"].Get<bool>());
+
+		REQUIRE(state.Execute("result = type(os.time()) == 'number' and os.exit == nil and os.execute == nil", environment));
+		REQUIRE(environment["result"].Get<bool>());
+
+		lpp::LuaSandbox custom(&state, { "tostring", "os.clock", "missing" });
+		lpp::LuaVar customEnvironment = custom.CreateEnvironment();
+		REQUIRE(state.Execute("result = tostring(type == nil and os.time == nil and os.clock ~= nil)", customEnvironment));
+		REQUIRE(customEnvironment["result"].Get<std::string>() == "true");
+	}
+
+	SECTION("Environments share the chunk cache")
+	{
+		const size_t missCount = state.GetChunkCache().GetMissCount();
+
+		std::vector<lpp::LuaVar> environments;
+		for (int i = 0; i < 10; ++i)
+		{
+			environments.push_back(sandbox.CreateEnvironment());
+			REQUIRE(state.Execute("value = ...", environments.back()));
+			REQUIRE(state.Execute("value = (value or 0) + 1", environments.back()));
+		}
+
+		REQUIRE(state.GetChunkCache().GetMissCount() == missCount + 2);
+		REQUIRE(environments[3]["value"].Get<int>() == 1);
+
+		REQUIRE(state.LoadScript("local x = 1\nerror('failed')", "=sandboxed", environments[0]) == false);
+		REQUIRE(state.Execute("value = = 1", environments[0]) == false);
+		REQUIRE(lua_gettop(L) == 0);
+	}
+
+	SECTION("Files run in the environment")
+	{
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "luacpp_sandbox_test.lua";
+		std::ofstream(path) << "greeting = 'hello ' .. name";
+
+		lpp::LuaVar environment = sandbox.CreateEnvironment();
+		environment.SetField("name", "sandbox");
+
+		REQUIRE(state.LoadScript(path.string().c_str(), environment));
+		REQUIRE(environment["greeting"].Get<std::string>() == "hello sandbox");
+		REQUIRE(lpp::LuaVar(&state, "greeting").Is<std::nullptr_t>());
+
+		// Lua does not verify bytecode, A crafted chunk could escape the environment.
+		REQUIRE(state.Execute("dumped = string.dump(function() greeting = 'escaped' end)"));
+		std::ofstream(path, std::ios::binary) << lpp::LuaVar(&state, "dumped").Get<std::string>();
+
+		REQUIRE(state.LoadScript(path.string().c_str(), environment) == false);
+		REQUIRE(environment["greeting"].Get<std::string>() == "hello sandbox");
+		REQUIRE(lua_gettop(L) == 0);
+
+		std::filesystem::remove(path);
+	}
+}
+
+TEST_CASE("Sandbox Benchmark", "[LuaCpp][Sandbox][!benchmark]")
+{
+	const char* kScript = "local t = {} for i = 1, 10 do t[i] = math.floor(i * 1.5) end total = #t";
+
+	const auto heapOfStates = []()
+	{
+		lpp::LuaState state;
+		state.Init();
+		return state.GetHeapBytes();
+	};
+
+	lpp::LuaState state;
+	state.Init();
+	lpp::LuaSandbox sandbox(&state);
+
+	const size_t heapBefore = state.GetHeapBytes();
+	std::vector<lpp::LuaVar> environments;
+	for (int i = 0; i < 1000; ++i)
+		environments.push_back(sandbox.CreateEnvironment());
+
+	WARN("Heap per sandbox: LuaState " << heapOfStates() << " bytes, Environment " << (state.GetHeapBytes() - heapBefore) / 1000 << " bytes");
+
+	BENCHMARK("1000 scripts with a LuaState each")
+	{
+		for (int i = 0; i < 1000; ++i)
+		{
+			lpp::LuaState isolated;
+			isolated.Init();
+			isolated.Execute(kScript);
+		}
+	}
+
+	BENCHMARK("1000 scripts with an environment each")
+	{
+		for (int i = 0; i < 1000; ++i)
+			state.Execute(kScript, environments[i]);
+	}
+
+	BENCHMARK("1000 scripts in the globals")
+	{
+		for (int i = 0; i < 1000; ++i)
+			state.Execute(kScript);
+	}
+}
\ No newline at end of file
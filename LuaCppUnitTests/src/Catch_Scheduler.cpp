@@ -0,0 +1,143 @@
+#pragma once
+
+#include <ostream>
+
+#include <LuaVar.h>
+#include <LuaScheduler.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+TEST_CASE("Scheduler", "[LuaCpp][Scheduler]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	lpp::LuaScheduler scheduler(&state, 0.1, 16);
+
+	luaL_dostring(state.GetState(),
+		"steps = 0\n"
+		"function Sleeper(seconds)\n"
+		"	steps = steps + 1\n"
+		"	wait(seconds)\n"
+		"	steps = steps + 1\n"
+		"end\n"
+		"function Listener()\n"
+		"	waitEvent('door')\n"
+		"	steps = steps + 10\n"
+		"end\n"
+		"function Yielder(count)\n"
+		"	for i = 1, count do coroutine.yield() steps = steps + 1 end\n"
+		"end\n"
+		"function Failing() wait(0) error('boom') end\n");
+
+	auto steps = [&state]() { return lpp::LuaVar(&state, "steps").Get<int>(); };
+
+	SECTION("Timers")
+	{
+		lpp::LuaScheduler::TaskId id = scheduler.Spawn(lpp::LuaVar(&state, "Sleeper"), 1.0);
+		REQUIRE(id != lpp::LuaScheduler::kInvalidTask);
+		REQUIRE(steps() == 1);
+		REQUIRE(scheduler.GetTaskState(id) == lpp::LuaTaskState::Sleeping);
+		REQUIRE(scheduler.GetSleepingCount() == 1);
+
+		REQUIRE(scheduler.Tick(0.5) == 0);
+		REQUIRE(steps() == 1);
+
+		REQUIRE(scheduler.Tick(1.0) == 1);
+		REQUIRE(steps() == 2);
+		REQUIRE(scheduler.HasTask(id) == false);
+		REQUIRE(scheduler.GetSleepingCount() == 0);
+	}
+
+	SECTION("Sleeps longer than a wheel rotation")
+	{
+		scheduler.Spawn(lpp::LuaVar(&state, "Sleeper"), 5.0);
+
+		for (double now = 0.1; now < 4.95; now += 0.1)
+			scheduler.Tick(now);
+
+		REQUIRE(steps() == 1);
+
+		scheduler.Tick(5.0);
+		REQUIRE(steps() == 2);
+	}
+
+	SECTION("Large time jumps")
+	{
+		scheduler.Spawn(lpp::LuaVar(&state, "Sleeper"), 30.0);
+
+		scheduler.Tick(29.0);
+		REQUIRE(steps() == 1);
+
+		scheduler.Tick(30.0);
+		REQUIRE(steps() == 2);
+	}
+
+	SECTION("Events")
+	{
+		lpp::LuaScheduler::TaskId id = scheduler.Spawn(lpp::LuaVar(&state, "Listener"));
+		REQUIRE(scheduler.GetTaskState(id) == lpp::LuaTaskState::WaitingEvent);
+
+		scheduler.Tick(1.0);
+		REQUIRE(steps() == 0);
+
+		scheduler.Signal("door");
+		scheduler.Tick(1.1);
+		REQUIRE(steps() == 10);
+		REQUIRE(scheduler.GetTaskCount() == 0);
+	}
+
+	SECTION("Wake and kill")
+	{
+		lpp::LuaScheduler::TaskId sleeper = scheduler.Spawn(lpp::LuaVar(&state, "Sleeper"), 100.0);
+		lpp::LuaScheduler::TaskId listener = scheduler.Spawn(lpp::LuaVar(&state, "Listener"));
+
+		scheduler.Wake(sleeper);
+		scheduler.Kill(listener);
+		scheduler.Signal("door");
+
+		scheduler.Tick(0.1);
+		REQUIRE(steps() == 2);
+		REQUIRE(scheduler.GetTaskCount() == 0);
+	}
+
+	SECTION("Yields continue next tick")
+	{
+		scheduler.Spawn(lpp::LuaVar(&state, "Yielder"), 3);
+
+		REQUIRE(scheduler.Tick(0.1) == 1);
+		REQUIRE(steps() == 1);
+		REQUIRE(scheduler.Tick(0.2) == 1);
+		REQUIRE(scheduler.Tick(0.3) == 1);
+		REQUIRE(steps() == 3);
+		REQUIRE(scheduler.GetTaskCount() == 0);
+	}
+
+	SECTION("Time budget")
+	{
+		for (int i = 0; i < 100; ++i)
+			scheduler.Spawn(lpp::LuaVar(&state, "Yielder"), 1);
+
+		// A budget this small only allows the minimum of one resume per tick.
+		scheduler.SetTimeBudget(1e-12);
+		REQUIRE(scheduler.Tick(0.1) == 1);
+		REQUIRE(scheduler.GetRunnableCount() == 99);
+
+		scheduler.SetTimeBudget(0.0);
+		REQUIRE(scheduler.Tick(0.2) == 99);
+		REQUIRE(scheduler.GetTaskCount() == 0);
+	}
+
+	SECTION("Errors")
+	{
+		std::string error;
+		scheduler.SetErrorHandler([&error](lpp::LuaScheduler::TaskId, const std::string& msg) { error = msg; });
+
+		scheduler.Spawn(lpp::LuaVar(&state, "Failing"));
+		scheduler.Tick(0.1);
+
+		REQUIRE(error.find("boom") != std::string::npos);
+		REQUIRE(scheduler.GetTaskCount() == 0);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include <LuaVar.h>
+#include <LuaStatePool.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	constexpr const char* kHandlers = R"(
+		handlers = {}
+
+		function handlers.add(a, b) return a + b end
+		function handlers.echo(...) return ... end
+		function handlers.fail(message) error(message, 0) end
+
+		function handlers.describe(request)
+			return { method = request.method, count = #request.items, first = request.items[1] }
+		end
+
+		requests = 0
+		function handlers.count()
+			requests = requests + 1
+			return requests
+		end
+
+		function handlers.nest(depth)
+			local root = {}
+			local current = root
+			for i = 1, depth do current.child = {} current = current.child end
+			return root
+		end
+
+		guarded = setmetatable({}, { __index = function(_, key) error("no handler " .. key, 0) end })
+
+		function handlers.spin(iterations)
+			local sum = 0
+			for i = 1, iterations do sum = sum + i % 7 end
+			return sum
+		end
+	)";
+
+	void SetupHandlers(lpp::LuaState& state)
+	{
+		state.Init();
+		state.Execute(kHandlers);
+	}
+}
+
+TEST_CASE("Lua Value", "[LuaCpp][StatePool]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	SECTION("Round trip")
+	{
+		REQUIRE(state.Execute("value = { 1, 2.5, 'three', true, nested = { key = 'value' }, [10] = false }"));
+
+		lua_getglobal(state.GetState(), "value");
+		lpp::LuaValue value = lpp::LuaValue::FromStack(state.GetState(), -1);
+		lua_pop(state.GetState(), 1);
+
+		REQUIRE(value.GetType() == lpp::LuaValue::Type::Table);
+		REQUIRE(value.ToTable().size() == 6);
+		REQUIRE(value["nested"]["key"].ToString() == "value");
+		REQUIRE(value["missing"].IsNil());
+
+		value.Push(state.GetState());
+		lua_setglobal(state.GetState(), "copy");
+		REQUIRE(state.Execute("same = copy[1] == 1 and math.type(copy[1]) == 'integer' and copy[2] == 2.5 and copy[3] == 'three' and copy[4] and copy[10] == false and copy.nested.key == 'value'"));
+		REQUIRE(lpp::LuaVar(&state, "same").Get<bool>());
+	}
+
+	SECTION("Values that can't be copied")
+	{
+		REQUIRE(state.Execute("value = { f = print, co = coroutine.create(print), name = 'kept' } value.self = value"));
+
+		lua_getglobal(state.GetState(), "value");
+		lpp::LuaValue value = lpp::LuaValue::FromStack(state.GetState(), -1);
+		lua_pop(state.GetState(), 1);
+
+		REQUIRE(value.ToTable().size() == 1);
+		REQUIRE(value["name"].ToString() == "kept");
+	}
+
+	SECTION("Tables nested too deeply")
+	{
+		REQUIRE(state.Execute("value = {} local current = value for i = 1, 300 do current.child = {} current = current.child end"));
+
+		bool isComplete = true;
+		lua_getglobal(state.GetState(), "value");
+		lpp::LuaValue value = lpp::LuaValue::FromStack(state.GetState(), -1, &isComplete);
+		lua_pop(state.GetState(), 1);
+
+		REQUIRE(isComplete == false);
+		REQUIRE(value["child"]["child"].GetType() == lpp::LuaValue::Type::Table);
+	}
+}
+
+TEST_CASE("State Pool", "[LuaCpp][StatePool]")
+{
+	lpp::LuaStatePool pool(3, &SetupHandlers);
+	REQUIRE(pool.GetWorkerCount() == 3);
+
+	SECTION("Results")
+	{
+		std::future<lpp::LuaJobResult> sum = pool.Submit("handlers.add", { 2, 3 });
+		std::future<lpp::LuaJobResult> echo = pool.Submit("handlers.echo", { "text", 1.5, true });
+
+		lpp::LuaJobResult sumResult = sum.get();
+		REQUIRE(sumResult.isOk);
+		REQUIRE(sumResult.values.size() == 1);
+		REQUIRE(sumResult.values[0].ToInteger() == 5);
+
+		lpp::LuaJobResult echoResult = echo.get();
+		REQUIRE(echoResult.values.size() == 3);
+		REQUIRE(echoResult.values[0].ToString() == "text");
+		REQUIRE(echoResult.values[1].ToNumber() == 1.5);
+		REQUIRE(echoResult.values[2].ToBoolean());
+	}
+
+	SECTION("Tables as arguments and results")
+	{
+		lpp::LuaValue::Table items = { { 1, "apple" }, { 2, "pear" } };
+		lpp::LuaValue request(lpp::LuaValue::Table{ { "method", "GET" }, { "items", items } });
+
+		lpp::LuaJobResult result = pool.Submit("handlers.describe", { request }).get();
+		REQUIRE(result.isOk);
+		REQUIRE(result.values[0]["method"].ToString() == "GET");
+		REQUIRE(result.values[0]["count"].ToInteger() == 2);
+		REQUIRE(result.values[0]["first"].ToString() == "apple");
+	}
+
+	SECTION("Errors")
+	{
+		lpp::LuaJobResult failed = pool.Submit("handlers.fail", { "bad request" }).get();
+		REQUIRE(failed.isOk == false);
+		REQUIRE(failed.error == "bad request");
+
+		REQUIRE(pool.Submit("handlers.missing").get().error == "entry point 'handlers.missing' is not a function");
+		REQUIRE(pool.Submit("requests.count").get().isOk == false);
+		REQUIRE(pool.Submit("").get().isOk == false);
+
+		// Errors while resolving the entry point or copying the results fail the job instead of the worker.
+		REQUIRE(pool.Submit("guarded.handler").get().error == "no handler handler");
+		REQUIRE(pool.Submit("handlers.nest", { 300 }).get().error == "the results are nested too deeply");
+		REQUIRE(pool.Submit("handlers.nest", { 10 }).get().isOk);
+	}
+
+	SECTION("Every worker has its own state")
+	{
+		std::vector<std::future<lpp::LuaJobResult>> results;
+		for (int i = 0; i < 60; ++i)
+			results.push_back(pool.Submit("handlers.count"));
+
+		lua_Integer total = 0;
+		for (std::future<lpp::LuaJobResult>& result : results)
+			total = std::max(total, result.get().values[0].ToInteger());
+
+		// Each state only counts the requests it ran.
+		size_t executed = 0;
+		for (const lpp::LuaWorkerStats& stats : pool.GetWorkerStats())
+			executed += stats.executedCount;
+
+		REQUIRE(executed >= 60);
+		REQUIRE(total <= 60);
+		REQUIRE(pool.GetQueueDepth() == 0);
+	}
+
+	SECTION("Workers steal from each other")
+	{
+		// One long job holds up a worker, The jobs dealt to it are stolen by the others.
+		std::vector<std::future<lpp::LuaJobResult>> results;
+		results.push_back(pool.Submit("handlers.spin", { 20000000 }));
+		for (int i = 0; i < 30; ++i)
+			results.push_back(pool.Submit("handlers.spin", { 1000 }));
+
+		for (std::future<lpp::LuaJobResult>& result : results)
+			REQUIRE(result.get().isOk);
+
+		std::vector<lpp::LuaWorkerStats> stats = pool.GetWorkerStats();
+		size_t stolen = 0;
+		for (const lpp::LuaWorkerStats& workerStats : stats)
+		{
+			stolen += workerStats.stolenCount;
+			REQUIRE(workerStats.utilization >= 0.0);
+			REQUIRE(workerStats.utilization <= 1.0);
+		}
+
+		REQUIRE(stolen > 0);
+
+		pool.ResetStats();
+		REQUIRE(pool.GetWorkerStats()[0].busyMicros == 0.0);
+	}
+
+	SECTION("Queued jobs run before the pool is destroyed")
+	{
+		std::vector<std::future<lpp::LuaJobResult>> results;
+		{
+			lpp::LuaStatePool shortLived(2, &SetupHandlers);
+			for (int i = 0; i < 20; ++i)
+				results.push_back(shortLived.Submit("handlers.add", { i, 1 }));
+		}
+
+		for (int i = 0; i < 20; ++i)
+			REQUIRE(results[i].get().values[0].ToInteger() == i + 1);
+	}
+}
+
+TEST_CASE("State Pool Benchmark", "[LuaCpp][StatePool][!benchmark]")
+{
+	constexpr int kJobCount = 2000;
+
+	lpp::LuaState single;
+	SetupHandlers(single);
+
+	BENCHMARK("2000 requests on a single state")
+	{
+		for (int i = 0; i < kJobCount; ++i)
+		{
+			lua_getglobal(single.GetState(), "handlers");
+			lua_getfield(single.GetState(), -1, "spin");
+			lua_pushinteger(single.GetState(), 10000);
+			lua_pcall(single.GetState(), 1, 1, 0);
+			lua_pop(single.GetState(), 2);
+		}
+	}
+
+	for (size_t workerCount : { size_t(1), size_t(4), size_t(0) })
+	{
+		lpp::LuaStatePool pool(workerCount, &SetupHandlers);
+
+		BENCHMARK("2000 requests on a pool of " + std::to_string(pool.GetWorkerCount()))
+		{
+			std::vector<std::future<lpp::LuaJobResult>> results;
+			results.reserve(kJobCount);
+			for (int i = 0; i < kJobCount; ++i)
+				results.push_back(pool.Submit("handlers.spin", { 10000 }));
+
+			for (std::future<lpp::LuaJobResult>& result : results)
+				result.wait();
+		}
+
+		for (const lpp::LuaWorkerStats& stats : pool.GetWorkerStats())
+			WARN("Worker utilization " << stats.utilization << ", Executed " << stats.executedCount << ", Stolen " << stats.stolenCount);
+	}
+}
\ No newline at end of file
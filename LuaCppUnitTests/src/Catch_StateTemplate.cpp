@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <LuaVar.h>
+#include <LuaStateTemplate.h>
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	int Twice(lua_State* pState)
+	{
+		lua_pushinteger(pState, luaL_checkinteger(pState, 1) * 2);
+		return 1;
+	}
+}
+
+TEST_CASE("State Template", "[LuaCpp][StateTemplate]")
+{
+	lpp::LuaStateTemplate worker(lpp::LuaLibrary::String | lpp::LuaLibrary::Table | lpp::LuaLibrary::Package, lpp::LuaLibrary::Math, 2);
+
+	// Counted from every thread stamping.
+	std::atomic<int> bindCount = 0;
+	worker.AddBinding([&bindCount](lpp::LuaState& state)
+	{
+		++bindCount;
+		lua_register(state.GetState(), "twice", &Twice);
+	});
+
+	worker.AddModule("framework.main", "local util = require('framework.util') return { run = function(x) return util.twice(x) + 1 end }");
+	worker.AddModule("framework.util", "return { twice = function(x) return twice(x) end }");
+	worker.AddScript("app = require('framework.main') result = app.run(20)", "=app");
+
+	SECTION("Stamped states run the template")
+	{
+		REQUIRE(worker.Build());
+
+		lpp::LuaState first;
+		lpp::LuaState second;
+		REQUIRE(worker.Stamp(first));
+		REQUIRE(worker.Stamp(second));
+		REQUIRE(bindCount == 2);
+
+		REQUIRE(lpp::LuaVar(&first, "result").Get<int>() == 41);
+		REQUIRE(lpp::LuaVar(&second, "result").Get<int>() == 41);
+
+		// The states share nothing.
+		REQUIRE(first.Execute("app.run = nil"));
+		REQUIRE(second.Execute("result = app.run(1)"));
+		REQUIRE(lpp::LuaVar(&second, "result").Get<int>() == 3);
+
+		// The libraries of the template.
+		REQUIRE(first.Execute("hasIO = io == nil and math.floor(1.5) == 1"));
+		REQUIRE(lpp::LuaVar(&first, "hasIO").Get<bool>());
+	}
+
+	SECTION("Stamping on several threads")
+	{
+		worker.AddScript("if result > 0 then error('stamped') end", "=failing");
+		REQUIRE(worker.Build());
+
+		std::vector<std::string> errors(4);
+		std::vector<std::thread> threads;
+		for (std::string& error : errors)
+		{
+			threads.emplace_back([&worker, &error]()
+			{
+				lpp::LuaState state;
+				worker.Stamp(state, &error);
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		for (const std::string& error : errors)
+			REQUIRE(error.find("stamped") != std::string::npos);
+	}
+
+	SECTION("Errors")
+	{
+		lpp::LuaState state;
+		std::string error;
+		REQUIRE(worker.Stamp(state, &error) == false);
+		REQUIRE(error == "the template is not built");
+
+		worker.AddScript("error('broken')", "=broken");
+		REQUIRE(worker.Build());
+		REQUIRE(worker.Stamp(state, &error) == false);
+		REQUIRE(error.find("broken") != std::string::npos);
+		REQUIRE(worker.GetError().empty());
+
+		lpp::LuaStateTemplate invalid;
+		invalid.AddModule("bad", "return = 1");
+		REQUIRE(invalid.Build() == false);
+		REQUIRE(invalid.GetError().find("bad:1:") != std::string::npos);
+	}
+}
+
+TEST_CASE("State Template Benchmark", "[LuaCpp][StateTemplate][!benchmark]")
+{
+	constexpr int kModuleCount = 300;
+	constexpr int kBindingCount = 500;
+
+	// A framework of modules each requiring the one before it, Calling the bound functions.
+	std::vector<std::pair<std::string, std::string>> modules;
+	for (int i = 0; i < kModuleCount; ++i)
+	{
+		std::string code = i > 0 ? "local previous = require('framework.m" + std::to_string(i - 1) + "')\n" : "";
+		code += "local M = {}\n";
+		for (int j = 0; j < 30; ++j)
+			code += "function M.f" + std::to_string(j) + "(x) return bound" + std::to_string(j) + "(x) + " + std::to_string(j) + " end\n";
+		code += "return M";
+
+		modules.emplace_back("framework.m" + std::to_string(i), std::move(code));
+	}
+
+	auto bind = [](lpp::LuaState& state)
+	{
+		for (int i = 0; i < kBindingCount; ++i)
+			lua_register(state.GetState(), ("bound" + std::to_string(i)).c_str(), &Twice);
+	};
+
+	const std::string lastModule = "require('framework.m" + std::to_string(kModuleCount - 1) + "')";
+
+	BENCHMARK("From scratch: Init, Bind and require 300 modules")
+	{
+		lpp::LuaState state;
+		state.Init();
+		bind(state);
+
+		lua_getfield(state.GetState(), LUA_REGISTRYINDEX, LUA_PRELOAD_TABLE);
+		for (const auto& [name, code] : modules)
+		{
+			luaL_loadbuffer(state.GetState(), code.data(), code.size(), name.c_str());
+			lua_setfield(state.GetState(), -2, name.c_str());
+		}
+		lua_pop(state.GetState(), 1);
+
+		state.Execute(lastModule);
+	}
+
+	lpp::LuaStateTemplate worker;
+	worker.AddBinding(bind);
+	for (const auto& [name, code] : modules)
+		worker.AddModule(name, code);
+	worker.Build();
+
+	BENCHMARK("Stamp from a template")
+	{
+		lpp::LuaState state;
+		worker.Stamp(state);
+	}
+}
\ No newline at end of file
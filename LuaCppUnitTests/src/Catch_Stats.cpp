@@ -0,0 +1,286 @@
+#pragma once
+
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include <LuaVar.h>
+#include <LuaStats.h>
+
+class Counted
+{
+public:
+	int Twice(int a) { return a * 2; }
+
+	int Fail(int a)
+	{
+		if (a < 0)
+			throw std::invalid_argument("negative value");
+
+		return a;
+	}
+};
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	void BindCounted(lpp::LuaState& state, Counted& counted)
+	{
+		lpp::LuaVar meta(&state);
+		meta.CreateMetaTable("Counted_Meta");
+		meta.BindMemberFunction<Counted>("twice", &Counted::Twice);
+		meta.BindMemberFunction<Counted>("fail", &Counted::Fail);
+
+		lpp::LuaVar instance(&state);
+		instance.CreateTable();
+		instance.SetField("__this", &counted);
+		instance.SetMetaTable("Counted_Meta");
+		instance.SetGlobal("counted");
+	}
+}
+
+TEST_CASE("Latency Histogram", "[LuaCpp][Stats]")
+{
+	using Histogram = lpp::LuaLatencyHistogram;
+
+	SECTION("Buckets are linear within a power of two")
+	{
+		for (uint64_t value = 0; value < 8; ++value)
+			REQUIRE(Histogram::GetBucket(value) == value);
+
+		REQUIRE(Histogram::GetBucket(8) == 8);
+		REQUIRE(Histogram::GetBucket(15) == 15);
+		REQUIRE(Histogram::GetBucket(16) == 16);
+		REQUIRE(Histogram::GetBucket(17) == 16);
+		REQUIRE(Histogram::GetBucket(18) == 17);
+		REQUIRE(Histogram::GetBucket(UINT64_MAX) == Histogram::kBucketCount - 1);
+
+		// Every bucket starts where the previous one ends.
+		for (size_t bucket = 0; bucket + 1 < Histogram::kBucketCount; ++bucket)
+		{
+			REQUIRE(Histogram::GetBucket(Histogram::GetBucketStart(bucket)) == bucket);
+			REQUIRE(Histogram::GetBucket(Histogram::GetBucketStart(bucket + 1) - 1) == bucket);
+		}
+	}
+
+	SECTION("Percentiles are within 12.5%")
+	{
+		Histogram histogram;
+		REQUIRE(histogram.GetPercentile(50.0) == 0);
+
+		for (uint64_t value = 1; value <= 10000; ++value)
+			histogram.Record(value * 100);
+
+		REQUIRE(histogram.GetCount() == 10000);
+		REQUIRE(histogram.GetMax() == 1000000);
+		REQUIRE(histogram.GetMean() == Approx(500050.0));
+
+		const uint64_t median = histogram.GetPercentile(50.0);
+		REQUIRE(median >= 500000);
+		REQUIRE(median <= 500000 * 1.125);
+
+		const uint64_t p99 = histogram.GetPercentile(99.0);
+		REQUIRE(p99 >= 990000);
+		REQUIRE(p99 <= 1000000);
+		REQUIRE(histogram.GetPercentile(100.0) == 1000000);
+
+		histogram.Reset();
+		REQUIRE(histogram.GetCount() == 0);
+	}
+}
+
+TEST_CASE("Stats", "[LuaCpp][Stats]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	Counted counted;
+	BindCounted(state, counted);
+
+	REQUIRE(state.LoadScript(R"(
+		handlers = {}
+		function handlers.add(self, a, b) return a + b end
+		function handlers.fail(self) error("boom") end
+		function run(n) for i = 1, n do counted:twice(i) end end
+	)", "=stats"));
+
+#ifdef LUACPP_NO_STATS
+	SECTION("Compiled out")
+	{
+		lpp::LuaVar handlers(&state, "handlers");
+		handlers.Call("add", 1, 2);
+		REQUIRE(state.Execute("run(10)"));
+
+		const lpp::LuaStatsSnapshot stats = state.GetStatsSnapshot();
+		REQUIRE(stats.referencesCreated == 0);
+		REQUIRE(stats.callCount == 0);
+		REQUIRE(stats.bindings.empty());
+	}
+#else
+	state.ResetStats();
+
+	SECTION("References")
+	{
+		{
+			lpp::LuaVar handlers(&state, "handlers");
+			lpp::LuaVar copy = handlers;
+
+			lpp::LuaVar missing(&state, "missing");
+
+			const lpp::LuaStatsSnapshot stats = state.GetStatsSnapshot();
+			REQUIRE(stats.referencesCreated == 1);
+			REQUIRE(stats.referencesReleased == 0);
+			REQUIRE(stats.GetLiveReferenceCount() == 1);
+		}
+
+		const lpp::LuaStatsSnapshot stats = state.GetStatsSnapshot();
+		REQUIRE(stats.referencesCreated == 1);
+		REQUIRE(stats.referencesReleased == 1);
+		REQUIRE(stats.GetLiveReferenceCount() == 0);
+	}
+
+	SECTION("Pushes by type")
+	{
+		lpp::LuaVar value(&state);
+		value.Set(1);
+		value.Set(2.5);
+		value.Set(true);
+		value.Set(std::string("text"));
+		value.Set("text");
+		value.Set(&counted);
+
+		lpp::LuaVar table(&state);
+		table.CreateTable();
+		table.SetField("name", std::string("value"));
+		table.SetField("other", value);
+
+		using Type = lpp::LuaPushType;
+		const lpp::LuaStatsSnapshot stats = state.GetStatsSnapshot();
+		REQUIRE(stats.GetPushCount(Type::Integer) == 1);
+		REQUIRE(stats.GetPushCount(Type::Number) == 1);
+		REQUIRE(stats.GetPushCount(Type::Boolean) == 1);
+		REQUIRE(stats.GetPushCount(Type::String) == 3);
+		REQUIRE(stats.GetPushCount(Type::LightUserdata) == 1);
+		REQUIRE(stats.GetPushCount(Type::Reference) == 1);
+		REQUIRE(stats.GetPushCount(Type::Nil) == 0);
+	}
+
+	SECTION("Calls and failures")
+	{
+		lpp::LuaVar handlers(&state, "handlers");
+		REQUIRE(handlers.Call("add", 1, 2).Get<int>() == 3);
+		REQUIRE(handlers.Call("add", 3, 4).Get<int>() == 7);
+		handlers.Call("fail");
+
+		// Not a function, No call is made.
+		handlers.Call("missing");
+
+		REQUIRE(state.Execute("error('outside of LuaVar')") == false);
+
+		const lpp::LuaStatsSnapshot stats = state.GetStatsSnapshot();
+		REQUIRE(stats.callCount == 3);
+		REQUIRE(stats.callFailureCount == 2);
+		REQUIRE(stats.GetPushCount(lpp::LuaPushType::Integer) == 4);
+	}
+
+	SECTION("Bound functions are counted and timed per name")
+	{
+		REQUIRE(state.Execute("run(100)"));
+		REQUIRE(state.Execute("pcall(counted.fail, counted, -1) counted:fail(1)"));
+
+		lpp::LuaStatsSnapshot stats = state.GetStatsSnapshot();
+		REQUIRE(stats.bindings.size() == 2);
+		REQUIRE(stats.bindings[0].name == "fail");
+		REQUIRE(stats.bindings[1].name == "twice");
+
+		const lpp::LuaBindingStats* pTwice = stats.GetBinding("twice");
+		REQUIRE(pTwice != nullptr);
+		REQUIRE(pTwice->dispatchCount == 100);
+
+		// The first dispatch and every 8th after it.
+		REQUIRE(pTwice->latency.GetCount() == (100 + lpp::LuaStats::kLatencySampleInterval - 1) / lpp::LuaStats::kLatencySampleInterval);
+		REQUIRE(pTwice->latency.GetPercentile(50.0) <= pTwice->latency.GetPercentile(99.0));
+		REQUIRE(pTwice->latency.GetPercentile(99.0) <= pTwice->latency.GetMax());
+
+		// The first dispatch raised an error, It is not timed.
+		const lpp::LuaBindingStats* pFail = stats.GetBinding("fail");
+		REQUIRE(pFail->dispatchCount == 2);
+		REQUIRE(pFail->latency.GetCount() == 0);
+		REQUIRE(stats.GetPushCount(lpp::LuaPushType::Integer) == 101);
+
+		REQUIRE(stats.GetBinding("missing") == nullptr);
+
+		REQUIRE(state.Execute("counted:fail(1)"));
+		REQUIRE(state.GetStatsSnapshot().GetBinding("fail")->latency.GetCount() == 0);
+
+		state.ResetStats();
+		REQUIRE(state.Execute("counted:fail(1)"));
+		REQUIRE(state.GetStatsSnapshot().GetBinding("fail")->latency.GetCount() == 1);
+
+		state.ResetStats();
+		stats = state.GetStatsSnapshot();
+		REQUIRE(stats.bindings.size() == 2);
+		REQUIRE(stats.GetBinding("twice")->dispatchCount == 0);
+		REQUIRE(stats.GetBinding("twice")->latency.GetCount() == 0);
+	}
+
+	SECTION("Functions bound under the same name share their stats")
+	{
+		Counted other;
+		lpp::LuaVar meta(&state);
+		meta.CreateMetaTable("Other_Meta");
+		meta.BindMemberFunction<Counted>("twice", &Counted::Twice);
+
+		lpp::LuaVar instance(&state);
+		instance.CreateTable();
+		instance.SetField("__this", &other);
+		instance.SetMetaTable("Other_Meta");
+		instance.SetGlobal("other");
+
+		REQUIRE(state.Execute("counted:twice(1) other:twice(2)"));
+		REQUIRE(state.GetStatsSnapshot().GetBinding("twice")->dispatchCount == 2);
+	}
+#endif
+}
+
+TEST_CASE("Stats Benchmark", "[LuaCpp][Stats][!benchmark]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	Counted counted;
+	BindCounted(state, counted);
+
+	state.Execute("function run() for i = 1, 100000 do counted:twice(i) end end");
+	state.Execute("function add(a, b) return a + b end");
+
+	lpp::LuaVar run(&state, "run");
+	lpp::LuaVar handlers(&state);
+	handlers.CreateTable();
+	state.Execute("adder = { add = function(self, a, b) return a + b end }");
+	lpp::LuaVar adder(&state, "adder");
+
+	BENCHMARK("100K bound function dispatches")
+	{
+		run();
+	}
+
+	BENCHMARK("10K LuaVar calls")
+	{
+		for (int i = 0; i < 10000; ++i)
+			adder.Call("add", i, 1);
+	}
+
+	BENCHMARK("10K LuaVar references")
+	{
+		for (int i = 0; i < 10000; ++i)
+			lpp::LuaVar var(&state, "adder");
+	}
+
+#ifndef LUACPP_NO_STATS
+	const lpp::LuaBindingStats* pTwice = state.GetStatsSnapshot().GetBinding("twice");
+	WARN("twice: p50 " << pTwice->latency.GetPercentile(50.0) << " ns, p99 " << pTwice->latency.GetPercentile(99.0) << " ns");
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include <LuaVar.h>
+#include <LuaBudget.h>
+#include <LuaCoroutine.h>
+#include <LuaTracer.h>
+
+class Traced
+{
+public:
+	int Twice(int a) { return a * 2; }
+
+	int Fail(int a)
+	{
+		if (a < 0)
+			throw std::invalid_argument("negative value");
+
+		return a;
+	}
+};
+
+// Must be last to include.
+#include <catch2/catch.hpp>
+
+namespace
+{
+	size_t CountOf(const std::string& text, const std::string& pattern)
+	{
+		size_t count = 0;
+		for (size_t i = text.find(pattern); i != std::string::npos; i = text.find(pattern, i + 1))
+			++count;
+
+		return count;
+	}
+
+	void BindTraced(lpp::LuaState& state, Traced& traced)
+	{
+		lpp::LuaVar meta(&state);
+		meta.CreateMetaTable("Traced_Meta");
+		meta.BindMemberFunction<Traced>("twice", &Traced::Twice);
+		meta.BindMemberFunction<Traced>("fail", &Traced::Fail);
+
+		lpp::LuaVar instance(&state);
+		instance.CreateTable();
+		instance.SetField("__this", &traced);
+		instance.SetMetaTable("Traced_Meta");
+		instance.SetGlobal("traced");
+	}
+}
+
+TEST_CASE("Tracer", "[LuaCpp][Tracer]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	lua_State* L = state.GetState();
+
+	Traced traced;
+	BindTraced(state, traced);
+
+	REQUIRE(state.LoadScript(R"(
+		function leaf(n) return traced:twice(n) end
+		function middle(n) return leaf(n) + leaf(n + 1) end
+		function throws() error("boom") end
+	)", "=traced"));
+
+	SECTION("Calls become nested begin and end events")
+	{
+		lpp::LuaTracer tracer(&state);
+		REQUIRE(tracer.Start());
+		REQUIRE(state.GetTracer() == &tracer);
+		REQUIRE(lua_gethook(L) == &lpp::LuaState::Hook);
+
+		// A second tracer can not run on the same state.
+		lpp::LuaTracer second(&state);
+		REQUIRE(second.Start() == false);
+
+		REQUIRE(state.Execute("result = middle(1)"));
+		tracer.Stop();
+
+		REQUIRE(state.GetTracer() == nullptr);
+		REQUIRE(lua_gethook(L) == nullptr);
+		REQUIRE(lpp::LuaVar(&state, "result").Get<int>() == 6);
+
+		const std::string json = tracer.Flush();
+		REQUIRE(json.rfind("{\"traceEvents\":[", 0) == 0);
+		REQUIRE(json.find("\"displayTimeUnit\":\"ns\"}") != std::string::npos);
+		REQUIRE(json.find("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"lua main\"}}") != std::string::npos);
+
+		REQUIRE(CountOf(json, "\"ph\":\"B\"") == CountOf(json, "\"ph\":\"E\""));
+		REQUIRE(CountOf(json, "{\"name\":\"middle traced:3\",\"cat\":\"lua\",\"ph\":\"B\"") == 1);
+		REQUIRE(CountOf(json, "{\"name\":\"leaf traced:2\",\"cat\":\"lua\",\"ph\":\"B\"") == 2);
+		REQUIRE(CountOf(json, "{\"name\":\"twice\",\"cat\":\"c\",\"ph\":\"B\"") == 2);
+		REQUIRE(CountOf(json, "{\"name\":\"twice\",\"cat\":\"binding\",\"ph\":\"B\"") == 2);
+
+		// The binding nests in its C function, Inside leaf, Inside middle.
+		const size_t middle = json.find("\"middle traced:3\"");
+		const size_t leaf = json.find("\"leaf traced:2\"");
+		const size_t binding = json.find("\"cat\":\"binding\"");
+		REQUIRE(middle < leaf);
+		REQUIRE(leaf < binding);
+
+		// Everything was taken by the flush.
+		REQUIRE(tracer.GetPendingCount() == 0);
+		REQUIRE(CountOf(tracer.Flush(), "\"ph\":\"B\"") == 0);
+		REQUIRE(tracer.GetDroppedCount() == 0);
+	}
+
+	SECTION("Frames left by errors are closed")
+	{
+		lpp::LuaTracer tracer(&state);
+		REQUIRE(tracer.Start());
+
+		REQUIRE(state.Execute("ok = pcall(throws) ok2 = pcall(function() return traced:fail(-1) end) after = middle(1)"));
+		REQUIRE(state.Execute("throws()") == false);
+		REQUIRE(state.Execute("middle(2)"));
+		tracer.Stop();
+
+		REQUIRE(lpp::LuaVar(&state, "ok").Get<bool>() == false);
+		REQUIRE(lpp::LuaVar(&state, "ok2").Get<bool>() == false);
+
+		const std::string json = tracer.Flush();
+		REQUIRE(CountOf(json, "\"ph\":\"B\"") == CountOf(json, "\"ph\":\"E\""));
+		// Called by pcall the function has no name.
+		REQUIRE(CountOf(json, "{\"name\":\"anonymous traced:4\",\"cat\":\"lua\",\"ph\":\"E\"") == 1);
+		REQUIRE(CountOf(json, "{\"name\":\"throws traced:4\",\"cat\":\"lua\",\"ph\":\"E\"") == 1);
+		REQUIRE(CountOf(json, "{\"name\":\"fail\",\"cat\":\"binding\",\"ph\":\"E\"") == 1);
+
+		// The calls after the errors are not nested in the frames the errors left.
+		const size_t throwsEnd = json.find("traced:4\",\"cat\":\"lua\",\"ph\":\"E\"");
+		const size_t middleBegin = json.find("{\"name\":\"middle traced:3\",\"cat\":\"lua\",\"ph\":\"B\"");
+		REQUIRE(throwsEnd < middleBegin);
+	}
+
+	SECTION("Coroutines get their own track")
+	{
+		REQUIRE(state.Execute("function worker() while true do middle(1) coroutine.yield() end end"));
+		lpp::LuaCoroutine coroutine(&state, lpp::LuaVar(&state, "worker"));
+
+		lpp::LuaTracer tracer(&state);
+		REQUIRE(tracer.Start());
+
+		for (int i = 0; i < 3; ++i)
+			REQUIRE(coroutine.Resume());
+
+		// A coroutine created by a script inherits the hook.
+		REQUIRE(state.Execute("local co = coroutine.wrap(function() middle(1) end) co()"));
+		tracer.Stop();
+
+		const std::string json = tracer.Flush();
+		REQUIRE(json.find("\"args\":{\"name\":\"lua thread 1\"}") != std::string::npos);
+		REQUIRE(json.find("\"args\":{\"name\":\"lua main\"}") != std::string::npos);
+		REQUIRE(json.find("\"args\":{\"name\":\"lua thread 3\"}") != std::string::npos);
+		REQUIRE(CountOf(json, "\"ph\":\"B\"") == CountOf(json, "\"ph\":\"E\""));
+		REQUIRE(CountOf(json, "{\"name\":\"middle traced:3\",\"cat\":\"lua\",\"ph\":\"B\",") == 4);
+	}
+
+	SECTION("Bindings are traced without the hooks")
+	{
+		lpp::LuaTracer tracer(&state, 1024, false);
+		REQUIRE(tracer.Start());
+		REQUIRE(lua_gethook(L) == nullptr);
+
+		REQUIRE(state.Execute("middle(1) pcall(function() return traced:fail(-1) end) middle(2)"));
+		tracer.Stop();
+
+		const std::string json = tracer.Flush();
+		REQUIRE(CountOf(json, "\"ph\":\"B\"") == 5);
+		REQUIRE(CountOf(json, "\"ph\":\"E\"") == 5);
+		REQUIRE(json.find("\"cat\":\"lua\"") == std::string::npos);
+	}
+
+	SECTION("A full buffer drops events")
+	{
+		lpp::LuaTracer tracer(&state, 16);
+		REQUIRE(tracer.Start());
+		REQUIRE(state.Execute("for i = 1, 100 do middle(i) end"));
+		tracer.Stop();
+
+		REQUIRE(tracer.GetPendingCount() == 16);
+		REQUIRE(tracer.GetDroppedCount() > 0);
+		REQUIRE(CountOf(tracer.Flush(), "\"pid\":1,\"tid\":1}") == 16);
+	}
+
+	SECTION("Timestamps and ids line up with native traces")
+	{
+		const auto micros = []() { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); };
+
+		lpp::LuaTracer tracer(&state);
+		tracer.SetTraceIds(4242, 100);
+
+		const long long before = micros();
+		REQUIRE(tracer.Start());
+		REQUIRE(state.Execute("result = middle(1)"));
+		tracer.Stop();
+		const long long after = micros();
+
+		const std::string json = tracer.Flush();
+		REQUIRE(json.find("\"ph\":\"M\",\"pid\":4242,\"tid\":100,") != std::string::npos);
+		REQUIRE(CountOf(json, "\"pid\":4242,\"tid\":100}") == CountOf(json, "\"ph\":\"B\"") * 2);
+
+		const size_t ts = json.find("\"ts\":");
+		REQUIRE(ts != std::string::npos);
+		const long long timestamp = std::stoll(json.substr(ts + 5));
+		REQUIRE(timestamp >= before);
+		REQUIRE(timestamp <= after);
+	}
+
+	SECTION("Budgets keep working while tracing")
+	{
+		lpp::LuaTracer tracer(&state);
+		REQUIRE(tracer.Start());
+
+		{
+			lpp::LuaBudget budget(&state, 20000);
+			REQUIRE(state.Execute("while true do middle(1) end") == false);
+			REQUIRE(budget.GetStatus() == lpp::LuaBudgetStatus::InstructionsExceeded);
+		}
+
+		// The budget gave the hook back to the tracer.
+		REQUIRE(lua_gethook(L) == &lpp::LuaState::Hook);
+		REQUIRE(lua_gethookmask(L) == (LUA_MASKCALL | LUA_MASKRET));
+
+		tracer.Stop();
+		REQUIRE(lua_gethook(L) == nullptr);
+
+		const std::string json = tracer.Flush();
+		REQUIRE(tracer.GetDroppedCount() == 0);
+		REQUIRE(CountOf(json, "\"ph\":\"B\"") == CountOf(json, "\"ph\":\"E\""));
+	}
+}
+
+TEST_CASE("Tracer Benchmark", "[LuaCpp][Tracer][!benchmark]")
+{
+	lpp::LuaState state;
+	state.Init();
+
+	Traced traced;
+	BindTraced(state, traced);
+
+	state.Execute(R"(
+		local function add(a, b) return a + b end
+		function work() local total = 0 for i = 1, 100000 do total = add(total, traced:twice(i)) end return total end
+	)");
+
+	lpp::LuaVar work(&state, "work");
+
+	BENCHMARK("100K calls and bindings without the tracer")
+	{
+		work();
+	}
+
+	{
+		lpp::LuaTracer tracer(&state, 1 << 20, false);
+		tracer.Start();
+
+		BENCHMARK("100K calls and bindings tracing the bindings")
+		{
+			work();
+			tracer.Flush();
+		}
+	}
+
+	{
+		lpp::LuaTracer tracer(&state, 1 << 20);
+		tracer.Start();
+
+		BENCHMARK("100K calls and bindings tracing everything")
+		{
+			work();
+			tracer.Flush();
+		}
+
+		WARN(tracer.GetDroppedCount() << " dropped");
+	}
+}
\ No newline at end of file
@@ -15,6 +15,74 @@ workspace "LuaCpp"
         "x86"
     }
 
+newoption
+{
+    trigger = "lua-errors",
+    value = "MODE",
+    description = "How lua raises errors, Bindings translate C++ exceptions into lua errors in both modes",
+    allowed =
+    {
+        { "longjmp", "Compile lua as C, lua_error uses longjmp (default)" },
+        { "exceptions", "Compile lua as C++, lua_error throws and unwinds C++ frames" },
+    },
+    default = "longjmp"
+}
+
+-- Every project including lua.hpp has to agree on the linkage of lua.
+function luaerrors()
+    filter "options:lua-errors=exceptions"
+        defines "LUACPP_LUA_EXCEPTIONS"
+
+    filter {}
+end
+
+newoption
+{
+    trigger = "no-stats",
+    description = "Compile out the counters of LuaStats at the boundary between C++ and Lua"
+}
+
+-- Every project including the LuaCpp headers has to agree on the stats.
+function luastats()
+    filter "options:no-stats"
+        defines "LUACPP_NO_STATS"
+
+    filter {}
+end
+
+newoption
+{
+    trigger = "track-references",
+    description = "Keep the creation site of every LuaVar for LuaReferenceTracker in Release too"
+}
+
+-- Every project including the LuaCpp headers has to agree on the layout of LuaVar.
+function trackreferences()
+    filter "configurations:Debug"
+        defines "LUACPP_TRACK_REFERENCES"
+
+    filter "options:track-references"
+        defines "LUACPP_TRACK_REFERENCES"
+
+    filter {}
+end
+
+-- Runs LuaCppEmbed on a script directory relative to the workspace before the build,
+-- The generated %{prj.name}/generated/<symbol>.cpp defines `const lpp::LuaEmbeddedScripts <symbol>`.
+function embedscripts(directory, symbol)
+    local embed = "%{wks.location}/bin/%{cfg.buildcfg}_%{cfg.architecture}/LuaCppEmbed/LuaCppEmbed"
+    local generated = "%{prj.name}/generated/" .. symbol .. ".cpp"
+
+    dependson "LuaCppEmbed"
+
+    files { generated }
+
+    prebuildcommands
+    {
+        '"' .. embed .. '" "%{wks.location}/' .. directory .. '" "%{wks.location}/' .. generated .. '" ' .. symbol
+    }
+end
+
 project "lua"
     location "thirdparty/lua"
     kind "StaticLib"
@@ -27,6 +95,16 @@ project "lua"
 
     files { "thirdparty/lua/*.h", "thirdparty/lua/*.c" }
 
+    filter "options:lua-errors=exceptions"
+        compileas "C++"
+
+    filter "options:lua-errors=longjmp"
+        compileas "C"
+
+    filter {}
+
+    luaerrors()
+
     -- Copy lua.h luaconf.h lualib.h lauxlib.h to include dir.
     print("Creating 'include/' folder for lua.")
     os.mkdir("thirdparty/lua/include/")
@@ -57,6 +135,10 @@ project "LuaCpp"
     -- This allows for <Dragon/...> includes.
     includedirs "%{prj.name}/src"
 
+    luaerrors()
+    luastats()
+    trackreferences()
+
     filter "platforms:x64"
         architecture "x64"
 
@@ -86,6 +168,50 @@ project "LuaCpp"
         "lua"
     }
 
+project "LuaCppEmbed"
+    kind "ConsoleApp"
+    language "C++"
+
+    targetdir("bin/" .. outputdir)
+    objdir("temp/" .. outputdir)
+
+    cppdialect "C++17"
+    systemversion "latest"
+
+    location "%{prj.name}"
+
+    filter "configurations:Debug"
+        symbols "full"
+        runtime "Debug"
+
+    filter "configurations:Release"
+        optimize "On"
+        runtime "Release"
+
+    filter{}
+
+    luaerrors()
+    luastats()
+    trackreferences()
+
+    files
+    {
+        "%{prj.name}/src/**.h",
+        "%{prj.name}/src/**.cpp",
+    }
+
+    includedirs
+    {
+        "LuaCpp/src/",
+        "thirdparty/lua/include"
+    }
+
+    links
+    {
+        "lua",
+        "LuaCpp"
+    }
+
 project "LuaCppUnitTests"
     kind "ConsoleApp"
     language "C++"
@@ -108,6 +234,10 @@ project "LuaCppUnitTests"
 
     filter{}
 
+    luaerrors()
+    luastats()
+    trackreferences()
+
     files
     {
         "%{prj.name}/src/**.h",
@@ -126,3 +256,5 @@ project "LuaCppUnitTests"
         "lua",
         "LuaCpp"
     }
+
+    embedscripts("LuaCppUnitTests/scripts", "kTestScripts")
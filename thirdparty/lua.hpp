@@ -1,6 +1,13 @@
+// Lua compiled as C++ (LUACPP_LUA_EXCEPTIONS) has C++ linkage.
+#if defined(LUACPP_LUA_EXCEPTIONS)
+	#include "lua.h"
+	#include "lualib.h"
+	#include "lauxlib.h"
+#else
 extern "C" 
 {
 	#include "lua.h"
 	#include "lualib.h"
 	#include "lauxlib.h"
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file